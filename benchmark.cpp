@@ -0,0 +1,468 @@
+/***********************************************************************
+ * Program:
+ *    Benchmark
+ * Summary:
+ *    Times custom::set against std::set and std::unordered_set so we can
+ *    tell when a change makes things slower. Every measurement is one
+ *    line of comma separated values on stdout:
+ *
+ *       container,element,operation,n,ns_per_op,comparisons_per_op,peak_rss_kb,heap_bytes_per_element
+ *
+ *    comparisons_per_op is only filled in for Spy elements, which count
+ *    every operator< and operator== they see. peak_rss_kb is the peak for
+ *    the whole process so far, so it only ever goes up. That makes it
+ *    useless for telling two containers apart, so the read-mostly runs
+ *    also give each container a counting allocator and report how many
+ *    bytes it holds per element in heap_bytes_per_element.
+ *
+ *    This has its own main(), so build it apart from the unit tests:
+ *       g++ -O2 -std=c++17 benchmark.cpp -o benchmark
+ *       ./benchmark [n]
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#include "set.h"        // custom::set
+#include "flat_set.h"   // custom::flat_set
+#include "btree.h"      // custom::set<T, C, custom::btree_tag>
+#include "frozen_set.h" // custom::frozen_set
+#include "persistent_set.h" // custom::persistent_set
+#include "cow_set.h"    // custom::set<T, C, custom::cow_tag>
+#include "spy.h"        // elements that count their comparisons
+
+#include <set>          // std::set
+#include <unordered_set>// std::unordered_set
+#include <string>
+#include <vector>
+#include <algorithm>    // std::shuffle
+#include <random>       // std::mt19937
+#include <chrono>       // std::chrono::steady_clock
+#include <iostream>
+#include <cstdlib>      // std::atoi
+#include <type_traits>  // std::is_same
+#include <cstdint>      // int64_t
+
+// windows.h has a DELETE macro of its own, so it has to come after spy.h
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#include <psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+int Spy::counters[] = {};
+
+// a place to put results so the optimizer cannot throw the work away
+volatile size_t sink = 0;
+
+/**********************************************************************
+ * PEAK RSS
+ * The most physical memory the process has used so far, in kilobytes
+ ***********************************************************************/
+long peakRSS()
+{
+#ifdef _WIN32
+   PROCESS_MEMORY_COUNTERS counters;
+   GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+   return (long)(counters.PeakWorkingSetSize / 1024);
+#else
+   struct rusage usage;
+   getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+   return (long)(usage.ru_maxrss / 1024);   // macOS reports bytes
+#else
+   return (long)usage.ru_maxrss;            // Linux reports kilobytes
+#endif
+#endif
+}
+
+/**********************************************************************
+ * COUNTING ALLOCATOR
+ * Goes to the heap like std::allocator, but keeps track of how many
+ * bytes are out right now across every container that uses it
+ ***********************************************************************/
+long bytesLive = 0;
+
+template <class T>
+class CountingAllocator
+{
+public:
+   using value_type = T;
+   CountingAllocator() {}
+   template <class U>
+   CountingAllocator(const CountingAllocator<U>&) {}
+
+   T* allocate(size_t n)
+   {
+      bytesLive += (long)(n * sizeof(T));
+      return std::allocator<T>().allocate(n);
+   }
+   void deallocate(T* p, size_t n)
+   {
+      bytesLive -= (long)(n * sizeof(T));
+      std::allocator<T>().deallocate(p, n);
+   }
+
+   template <class U>
+   bool operator == (const CountingAllocator<U>&) const { return true; }
+   template <class U>
+   bool operator != (const CountingAllocator<U>&) const { return false; }
+};
+
+/**********************************************************************
+ * SPY HASH
+ * std::unordered_set needs a hash, Spy does not come with one
+ ***********************************************************************/
+struct SpyHash
+{
+   size_t operator()(const Spy& s) const { return std::hash<int>()(s.empty() ? 0 : s.get()); }
+};
+
+/**********************************************************************
+ * MAKE
+ * Turn a key into each of the element types we measure. Strings are
+ * padded so they sort the same way the numbers do
+ ***********************************************************************/
+template <class T>
+T make(int key);
+
+template <>
+int make<int>(int key) { return key; }
+
+template <>
+int64_t make<int64_t>(int key) { return (int64_t)key * 1000003; }
+
+template <>
+std::string make<std::string>(int key)
+{
+   std::string s = std::to_string(key);
+   return std::string(12 - s.size(), '0') + s;
+}
+
+template <>
+Spy make<Spy>(int key) { return Spy(key); }
+
+/**********************************************************************
+ * VALUE OF
+ * A number that depends on what is in the element. Walking a container
+ * and adding these up has to read every element, where just counting
+ * the steps can be worked out without walking at all
+ ***********************************************************************/
+inline size_t valueOf(int t) { return (size_t)t; }
+inline size_t valueOf(int64_t t) { return (size_t)t; }
+inline size_t valueOf(const std::string& t) { return t.size() + (size_t)t.back(); }
+inline size_t valueOf(const Spy& t) { return t.empty() ? 0 : (size_t)t.get(); }
+
+/**********************************************************************
+ * REPORT
+ * Time f, which does numOps operations, and print one line about it
+ ***********************************************************************/
+template <class T, class F>
+void report(const char* container, const char* element, const char* operation, int n, int numOps, F f,
+            double bytesPerElement = -1.0)
+{
+   Spy::reset();
+   auto start = std::chrono::steady_clock::now();
+   f();
+   auto stop = std::chrono::steady_clock::now();
+   long comparisons = (long)Spy::numLessthan() + Spy::numEquals();
+
+   double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+   std::cout << container << ',' << element << ',' << operation << ',' << n << ','
+             << ns / numOps << ',';
+   if (std::is_same<T, Spy>::value)
+      std::cout << (double)comparisons / numOps;
+   std::cout << ',' << peakRSS() << ',';
+   if (bytesPerElement >= 0.0)
+      std::cout << bytesPerElement;
+   std::cout << std::endl;
+}
+
+/**********************************************************************
+ * RUN SUITE
+ * Every operation against one container holding one element type
+ ***********************************************************************/
+template <class Set, class T>
+void runSuite(const char* container, const char* element, int n)
+{
+   // the keys that are in the set, in three different orders, and some that are not
+   std::vector<T> sorted;
+   std::vector<T> missing;
+   for (int i = 0; i < n; i++)
+   {
+      sorted.push_back(make<T>(i * 2));
+      missing.push_back(make<T>(i * 2 + 1));
+   }
+   std::vector<T> reversed(sorted.rbegin(), sorted.rend());
+   std::vector<T> shuffled(sorted);
+   std::mt19937 random(232);
+   std::shuffle(shuffled.begin(), shuffled.end(), random);
+   std::shuffle(missing.begin(), missing.end(), random);
+
+   // insert
+   {
+      Set s;
+      report<T>(container, element, "insert_random", n, n, [&]()
+      {
+         for (auto& t : shuffled)
+            s.insert(t);
+      });
+   }
+   {
+      Set s;
+      report<T>(container, element, "insert_sorted", n, n, [&]()
+      {
+         for (auto& t : sorted)
+            s.insert(t);
+      });
+   }
+   {
+      Set s;
+      report<T>(container, element, "insert_hint_end", n, n, [&]()
+      {
+         for (auto& t : sorted)
+            s.insert(s.end(), t);
+      });
+   }
+   {
+      Set s;
+      report<T>(container, element, "insert_reverse", n, n, [&]()
+      {
+         for (auto& t : reversed)
+            s.insert(t);
+      });
+   }
+
+   Set s;
+   for (auto& t : shuffled)
+      s.insert(t);
+
+   // find
+   report<T>(container, element, "find_hit", n, n, [&]()
+   {
+      size_t found = 0;
+      for (auto& t : shuffled)
+         found += (s.find(t) != s.end());
+      sink = found;
+   });
+   report<T>(container, element, "find_miss", n, n, [&]()
+   {
+      size_t found = 0;
+      for (auto& t : missing)
+         found += (s.find(t) != s.end());
+      sink = found;
+   });
+
+   // iterate
+   report<T>(container, element, "iterate", n, n, [&]()
+   {
+      size_t total = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         total += valueOf(*it);
+      sink = total;
+   });
+
+   // copy
+   {
+      report<T>(container, element, "copy", n, n, [&]()
+      {
+         Set sCopy(s);
+         sink = sCopy.size();
+      });
+   }
+
+   // erase
+   {
+      Set sErase(s);
+      report<T>(container, element, "erase", n, n, [&]()
+      {
+         for (auto& t : shuffled)
+            sErase.erase(t);
+      });
+   }
+
+   // clear
+   {
+      Set sClear(s);
+      report<T>(container, element, "clear", n, n, [&]()
+      {
+         sClear.clear();
+      });
+   }
+}
+
+/**********************************************************************
+ * RUN READ MOSTLY
+ * Build the set once from shuffled keys and then only look things up.
+ * This is the case flat_set and frozen_set are for, so they run against the trees here
+ * rather than in runSuite, where inserting one at a time into an array
+ * would take all day
+ ***********************************************************************/
+template <class Set, class T>
+void runReadMostly(const char* container, const char* element, int n)
+{
+   std::vector<T> shuffled;
+   std::vector<T> missing;
+   for (int i = 0; i < n; i++)
+   {
+      shuffled.push_back(make<T>(i * 2));
+      missing.push_back(make<T>(i * 2 + 1));
+   }
+   std::mt19937 random(232);
+   std::shuffle(shuffled.begin(), shuffled.end(), random);
+   std::shuffle(missing.begin(), missing.end(), random);
+
+   long bytesBefore = bytesLive;
+   Set s;
+   report<T>(container, element, "build", n, n, [&]()
+   {
+      s = Set(shuffled.begin(), shuffled.end());
+   });
+   double bytesPerElement = (double)(bytesLive - bytesBefore) / n;
+
+   report<T>(container, element, "find_hit", n, n, [&]()
+   {
+      size_t found = 0;
+      for (auto& t : shuffled)
+         found += (s.find(t) != s.end());
+      sink = found;
+   }, bytesPerElement);
+   report<T>(container, element, "find_miss", n, n, [&]()
+   {
+      size_t found = 0;
+      for (auto& t : missing)
+         found += (s.find(t) != s.end());
+      sink = found;
+   }, bytesPerElement);
+   report<T>(container, element, "iterate", n, n, [&]()
+   {
+      size_t total = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         total += valueOf(*it);
+      sink = total;
+   }, bytesPerElement);
+}
+
+/**********************************************************************
+ * RUN VERSIONS
+ * The same operations as runSuite, for a set where every change gives
+ * back a new version instead of changing the one we have. copy is the
+ * one to compare: it is a snapshot here and a walk of the whole tree
+ * for the others
+ ***********************************************************************/
+template <class Set, class T>
+void runVersions(const char* container, const char* element, int n)
+{
+   std::vector<T> shuffled;
+   std::vector<T> missing;
+   for (int i = 0; i < n; i++)
+   {
+      shuffled.push_back(make<T>(i * 2));
+      missing.push_back(make<T>(i * 2 + 1));
+   }
+   std::mt19937 random(232);
+   std::shuffle(shuffled.begin(), shuffled.end(), random);
+   std::shuffle(missing.begin(), missing.end(), random);
+
+   Set s;
+   report<T>(container, element, "insert_random", n, n, [&]()
+   {
+      for (auto& t : shuffled)
+         s = s.insert(t);
+   });
+
+   report<T>(container, element, "find_hit", n, n, [&]()
+   {
+      size_t found = 0;
+      for (auto& t : shuffled)
+         found += (s.find(t) != s.end());
+      sink = found;
+   });
+   report<T>(container, element, "find_miss", n, n, [&]()
+   {
+      size_t found = 0;
+      for (auto& t : missing)
+         found += (s.find(t) != s.end());
+      sink = found;
+   });
+   report<T>(container, element, "iterate", n, n, [&]()
+   {
+      size_t total = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         total += valueOf(*it);
+      sink = total;
+   });
+   report<T>(container, element, "copy", n, n, [&]()
+   {
+      Set sCopy(s.snapshot());
+      sink = sCopy.size();
+   });
+
+   // the old version is still around, so every erase copies its path
+   {
+      Set sErase(s);
+      report<T>(container, element, "erase", n, n, [&]()
+      {
+         for (auto& t : shuffled)
+            sErase = sErase.erase(t);
+      });
+   }
+}
+
+/**********************************************************************
+ * MAIN
+ * The only argument is how many elements to put in each set
+ ***********************************************************************/
+int main(int argc, char** argv)
+{
+   int n = (argc > 1) ? std::atoi(argv[1]) : 100000;
+   if (n <= 0)
+   {
+      std::cerr << "usage: " << argv[0] << " [n]\n";
+      return 1;
+   }
+
+   std::cout << "container,element,operation,n,ns_per_op,comparisons_per_op,peak_rss_kb,heap_bytes_per_element\n";
+
+   runSuite<custom::set<int>, int>                ("custom::set",        "int",    n);
+   runSuite<custom::set<int, std::less<int>, custom::btree_tag>, int>("custom::set<btree>", "int", n);
+   runSuite<custom::set<int, std::less<int>, custom::cow_tag>, int>("custom::set<cow>", "int", n);
+   runSuite<std::set<int>, int>                   ("std::set",           "int",    n);
+   runSuite<std::unordered_set<int>, int>         ("std::unordered_set", "int",    n);
+
+   runSuite<custom::set<std::string>, std::string>("custom::set",        "string", n);
+   runSuite<custom::set<std::string, std::less<std::string>, custom::cow_tag>, std::string>("custom::set<cow>", "string", n);
+   runSuite<std::set<std::string>, std::string>   ("std::set",           "string", n);
+   runSuite<std::unordered_set<std::string>, std::string>("std::unordered_set", "string", n);
+
+   runSuite<custom::set<Spy>, Spy>                ("custom::set",        "Spy",    n);
+   runSuite<std::set<Spy>, Spy>                   ("std::set",           "Spy",    n);
+   runSuite<std::unordered_set<Spy, SpyHash>, Spy>("std::unordered_set", "Spy",    n);
+
+   runVersions<custom::persistent_set<int>, int>                ("custom::persistent_set", "int",    n);
+   runVersions<custom::persistent_set<std::string>, std::string>("custom::persistent_set", "string", n);
+   runVersions<custom::persistent_set<Spy>, Spy>                ("custom::persistent_set", "Spy",    n);
+
+   runReadMostly<custom::frozen_set<int, std::less<int>, CountingAllocator<int>>, int>("custom::frozen_set", "int", n);
+   runReadMostly<custom::flat_set<int, std::less<int>, CountingAllocator<int>>, int>("custom::flat_set", "int", n);
+   runReadMostly<custom::set<int, std::less<int>, CountingAllocator<int>>, int>     ("custom::set",      "int", n);
+   runReadMostly<std::set<int, std::less<int>, CountingAllocator<int>>, int>        ("std::set",         "int", n);
+
+   runReadMostly<custom::frozen_set<std::string, std::less<std::string>, CountingAllocator<std::string>>, std::string>("custom::frozen_set", "string", n);
+   runReadMostly<custom::flat_set<std::string, std::less<std::string>, CountingAllocator<std::string>>, std::string>("custom::flat_set", "string", n);
+   runReadMostly<custom::set<std::string, std::less<std::string>, CountingAllocator<std::string>>, std::string>     ("custom::set",      "string", n);
+   runReadMostly<std::set<std::string, std::less<std::string>, CountingAllocator<std::string>>, std::string>        ("std::set",         "string", n);
+
+   runReadMostly<custom::frozen_set<int64_t, std::less<int64_t>, CountingAllocator<int64_t>>, int64_t>("custom::frozen_set", "int64_t", n);
+   runReadMostly<custom::set<int64_t, std::less<int64_t>, custom::btree_alloc<CountingAllocator<int64_t>>>, int64_t>
+                                                                                  ("custom::set<btree>", "int64_t", n);
+   runReadMostly<custom::set<int64_t, std::less<int64_t>, CountingAllocator<int64_t>>, int64_t>("custom::set", "int64_t", n);
+   runReadMostly<std::set<int64_t, std::less<int64_t>, CountingAllocator<int64_t>>, int64_t>   ("std::set",    "int64_t", n);
+
+   runReadMostly<custom::flat_set<Spy, std::less<Spy>, CountingAllocator<Spy>>, Spy>("custom::flat_set", "Spy", n);
+   runReadMostly<custom::set<Spy, std::less<Spy>, CountingAllocator<Spy>>, Spy>     ("custom::set",      "Spy", n);
+
+   return 0;
+}
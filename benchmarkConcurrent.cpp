@@ -0,0 +1,206 @@
+/***********************************************************************
+ * Program:
+ *    Benchmark Concurrent
+ * Summary:
+ *    Times the sets many threads share, one thread and then more and
+ *    more of them up to every core, so we can see which ones keep going
+ *    faster as we add cores and which ones stall. Every measurement is
+ *    one line of comma separated values on stdout:
+ *
+ *       container,mix,threads,n,ns_per_op,mops_per_sec
+ *
+ *    ns_per_op is the wall clock time over every operation every thread
+ *    did, so a set that scales has it go down as threads goes up.
+ *    mops_per_sec is the same thing the other way up, millions of
+ *    operations a second across all the threads.
+ *
+ *    The mixes are how many of every hundred operations are lookups,
+ *    the rest are split evenly between inserts and erases. Keys are
+ *    drawn from twice the range that is in the set, so half the lookups
+ *    hit and the set stays about the same size.
+ *
+ *    This has its own main(), so build it apart from the unit tests:
+ *       g++ -O2 -std=c++17 -pthread benchmarkConcurrent.cpp -o benchmarkConcurrent
+ *       ./benchmarkConcurrent [n] [maxThreads]
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#include "set.h"            // custom::set
+#include "concurrent_set.h" // custom::concurrent_set
+#include "lockfree_set.h"   // custom::lockfree_set
+#include "sharded_set.h"    // custom::sharded_set
+
+#include <mutex>            // std::mutex
+#include <shared_mutex>     // std::shared_mutex
+#include <thread>           // std::thread
+#include <atomic>           // std::atomic
+#include <vector>
+#include <chrono>           // std::chrono::steady_clock
+#include <iostream>
+#include <cstdlib>          // std::atoi
+#include <cstdint>          // uint64_t
+#include <type_traits>      // std::is_same
+
+// a place to put results so the optimizer cannot throw the work away
+std::atomic<size_t> sink(0);
+
+/**********************************************************************
+ * LOCKED SET
+ * What we do today: a custom::set with one lock in front of it. With
+ * std::shared_mutex the lookups take it shared, with std::mutex
+ * everybody waits their turn
+ ***********************************************************************/
+template <class Mutex>
+class LockedSet
+{
+public:
+   bool contains(int key) const
+   {
+      if constexpr (std::is_same<Mutex, std::shared_mutex>::value)
+      {
+         std::shared_lock<Mutex> lock(mutex);
+         return elements.count(key) != 0;
+      }
+      else
+      {
+         std::lock_guard<Mutex> lock(mutex);
+         return elements.count(key) != 0;
+      }
+   }
+   bool insert(int key)
+   {
+      std::lock_guard<Mutex> lock(mutex);
+      return elements.insert(key).second;
+   }
+   size_t erase(int key)
+   {
+      std::lock_guard<Mutex> lock(mutex);
+      return elements.erase(key);
+   }
+private:
+   mutable Mutex mutex;
+   custom::set<int> elements;
+};
+
+/**********************************************************************
+ * RANDOM
+ * xorshift, so drawing a key costs next to nothing next to what we
+ * are timing, and every thread has its own
+ ***********************************************************************/
+class Random
+{
+public:
+   Random(uint64_t seed) : state(seed * 0x9e3779b97f4a7c15ull + 1) {}
+   uint64_t next()
+   {
+      state ^= state << 13;
+      state ^= state >> 7;
+      state ^= state << 17;
+      return state;
+   }
+private:
+   uint64_t state;
+};
+
+/**********************************************************************
+ * RUN MIX
+ * Fill the set with the even numbers below 2n, then let numThreads
+ * threads loose on it all at once, each doing numOps operations with
+ * percentRead of them lookups
+ ***********************************************************************/
+template <class Set>
+void runMix(const char* container, const char* mix, int percentRead, int numThreads, int n, int numOps)
+{
+   Set s;
+   for (int i = 0; i < n; i++)
+      s.insert(i * 2);
+
+   // nobody starts until everybody is ready, or the first thread gets a head start
+   std::atomic<int> numReady(0);
+   std::atomic<bool> go(false);
+   std::vector<std::thread> threads;
+   for (int t = 0; t < numThreads; t++)
+      threads.emplace_back([&, t]()
+      {
+         Random random(t + 1);
+         size_t found = 0;
+         numReady++;
+         while (!go)
+            std::this_thread::yield();
+         for (int i = 0; i < numOps; i++)
+         {
+            uint64_t r = random.next();
+            int key = (int)((r >> 8) % (uint64_t)(n * 2));
+            int roll = (int)(r & 0x7f) % 100;
+            if (roll < percentRead)
+               found += s.contains(key);
+            else if ((roll - percentRead) % 2 == 0)
+               s.insert(key);
+            else
+               s.erase(key);
+         }
+         sink += found;
+      });
+
+   while (numReady < numThreads)
+      std::this_thread::yield();
+   auto start = std::chrono::steady_clock::now();
+   go = true;
+   for (auto& thread : threads)
+      thread.join();
+   auto stop = std::chrono::steady_clock::now();
+
+   double ns = std::chrono::duration<double, std::nano>(stop - start).count();
+   double totalOps = (double)numOps * numThreads;
+   std::cout << container << ',' << mix << ',' << numThreads << ',' << n << ','
+             << ns / totalOps << ',' << totalOps / ns * 1000.0 << std::endl;
+}
+
+/**********************************************************************
+ * RUN SCALING
+ * Every mix at one thread, two, four, and so on up to maxThreads
+ ***********************************************************************/
+template <class Set>
+void runScaling(const char* container, int n, int maxThreads)
+{
+   const int numOps = 200000;
+   for (int numThreads = 1; ; numThreads *= 2)
+   {
+      if (numThreads > maxThreads)
+         numThreads = maxThreads;
+      runMix<Set>(container, "read_100", 100, numThreads, n, numOps);
+      runMix<Set>(container, "read_90",   90, numThreads, n, numOps);
+      runMix<Set>(container, "read_50",   50, numThreads, n, numOps);
+      if (numThreads == maxThreads)
+         break;
+   }
+}
+
+/**********************************************************************
+ * MAIN
+ * How many elements to put in each set, and how many threads to go up
+ * to, every core if we are not told
+ ***********************************************************************/
+int main(int argc, char** argv)
+{
+   int n = (argc > 1) ? std::atoi(argv[1]) : 100000;
+   int maxThreads = (argc > 2) ? std::atoi(argv[2]) : (int)std::thread::hardware_concurrency();
+   if (maxThreads <= 0)
+      maxThreads = 1;
+   if (n <= 0)
+   {
+      std::cerr << "usage: " << argv[0] << " [n] [maxThreads]\n";
+      return 1;
+   }
+
+   std::cout << "container,mix,threads,n,ns_per_op,mops_per_sec\n";
+
+   runScaling<LockedSet<std::mutex>>       ("custom::set+mutex",        n, maxThreads);
+   runScaling<LockedSet<std::shared_mutex>>("custom::set+shared_mutex", n, maxThreads);
+   runScaling<custom::concurrent_set<int>> ("custom::concurrent_set",   n, maxThreads);
+   runScaling<custom::lockfree_set<int>>   ("custom::lockfree_set",     n, maxThreads);
+   runScaling<custom::sharded_set<int>>    ("custom::sharded_set",      n, maxThreads);
+
+   return 0;
+}
@@ -30,6 +30,10 @@
 #include <memory>
 #include <functional>
 #include <utility>
+#include <type_traits>
+#include <iterator>
+#include <optional>
+#include "redblack.h"
 
 class TestBST; // forward declaration for unit tests
 class TestMap;
@@ -37,27 +41,53 @@ class TestSet;
 
 namespace custom
 {
-    template <class TT>
+    template <class TT, class CC, class AA>
     class set;
-    template <class KK, class VV>
+    template <class KK, class VV, class CC, class AA>
     class map;
 
-    template <typename T>
-    class BST
+    /************************************************
+     * COMPARE BASE
+     * Holds the comparator for the BST. A comparator with no data, like
+     * std::less, becomes a base class instead of a member so it takes up
+     * no room at all (the empty base optimization)
+     ***********************************************/
+    template <class C, bool = std::is_empty<C>::value && !std::is_final<C>::value>
+    class CompareBase : private C
+    {
+    public:
+        CompareBase(const C& c = C()) : C(c) {}
+        const C& comp() const { return *this; }
+        C& comp() { return *this; }
+    };
+
+    template <class C>
+    class CompareBase <C, false>
+    {
+    public:
+        CompareBase(const C& c = C()) : c(c) {}
+        const C& comp() const { return c; }
+        C& comp() { return c; }
+    private:
+        C c;
+    };
+
+    template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
+    class BST : private CompareBase<C>
     {
         // all of the friend classes are needed for the unit tests as access all the BST
         friend class ::TestBST;
         friend class ::TestMap;
         friend class ::TestSet;
 
-        template <class KK, class VV>
+        template <class KK, class VV, class CC, class AA>
         friend class map;
 
-        template <class TT>
+        template <class TT, class CC, class AA>
         friend class set;
 
-        template <class KK, class VV>
-        friend void swap(map<KK, VV>& lhs, map<KK, VV>& rhs);
+        template <class KK, class VV, class CC, class AA>
+        friend void swap(map<KK, VV, CC, AA>& lhs, map<KK, VV, CC, AA>& rhs);
 #ifdef DEBUG
     public:
 #else
@@ -65,17 +95,91 @@ namespace custom
 #endif
         //Bnode is a node in the tree, we use this to create data points in the tree that are linked to other data points creating our tree
         class BNode;
+        using NodeAlloc  = typename std::allocator_traits<A>::template rebind_alloc<BNode>;
+        using NodeTraits = std::allocator_traits<NodeAlloc>;
+
         BNode* root; //root node of the tree
         size_t numElements;  // number of elements in the tree or the size of the tree
+        NodeAlloc alloc;     // where the nodes come from, the heap by default or a pool
+        BNode* pRightmost = nullptr; // the biggest node so appends skip the descent, null only when the tree is empty
+        BNode* pLeftmost = nullptr;  // the smallest node so begin() skips the descent, null only when the tree is empty
+
+        // the biggest and smallest nodes. Every change to the tree keeps them up to date,
+        // so reading them never writes anything and two threads can read at once
+        BNode* rightmost() const { return pRightmost; }
+        BNode* leftmost() const { return pLeftmost; }
+        void findEnds(); // walk down both sides of a tree that was just built or copied
+
+        // does k belong right in front of pNext (or at the very end if pNext is null)?
+        template <class K>
+        bool fitsBefore(const BNode* pNext, const K& k) const;
+
+        // every node goes through these two so the allocator sees all of them
+        template <class... Args>
+        BNode* createNode(Args&&... args);
+        void destroyNode(BNode* pNode);
 
         void deleteBinaryTree(BNode*& p); // this will delete the tree
-        BNode* copyBinaryTree(const BNode* pSrc);
+        BNode* copyBinaryTree(const BNode* pSrc); // a brand new copy of the tree, nothing is reused
         void assignBinaryTree(BNode*& pDest, const BNode* pSrc); // this will assign the tree to another tree
+        void assignNode(BNode*& pSlot, const BNode* pSrc, BNode* pParent); // one node's worth of assignBinaryTree
+
+        // the one place that knows how two elements are ordered
+        // L and R are both T unless the comparator is transparent
+        template <class L, class R>
+        bool less(const L& lhs, const R& rhs) const { return this->comp()(lhs, rhs); }
+
+        // the one descent behind find and count
+        template <class K>
+        BNode* findNode(const K& k) const;
+
+        // the descents behind lower_bound and upper_bound
+        template <class K>
+        BNode* lowerNode(const K& k) const; // first node not less than k
+        template <class K>
+        BNode* upperNode(const K& k) const; // first node greater than k
+        template <class K>
+        BNode* lowerNodeFrom(BNode* pFrom, const K& k) const; // lowerNode, starting at pFrom instead of the root
+
+        // red-black balancing, these keep the height of the tree at O(log n)
+        // redblack does the rotating, and gets at our links through the ones below
+        friend class redblack<BST, BNode>;
+        void balanceInsert(BNode* pNode);
+        int  blackHeight(const BNode* pNode) const;
+
+        // the links as redblack sees them
+        static BNode* leftOf(const BNode* pNode) { return pNode->pLeft; }
+        static BNode* rightOf(const BNode* pNode) { return pNode->pRight; }
+        static void setLeft(BNode* pNode, BNode* pChild) { pNode->addLeft(pChild); }
+        static void setRight(BNode* pNode, BNode* pChild) { pNode->addRight(pChild); }
+        void replaceChild(BNode* pParent, BNode* pOld, BNode* pNew);
+        BNode* rootNode() const { return root; }
+
+        // and the sizes, which redblack knows nothing about
+        static void rotated(BNode* pNode, BNode* pPivot);
+        static void leaving(BNode* pNode);
+        static void replaced(const BNode* pNode, BNode* pNext) { pNext->size = pNode->size; }
+
+        // pull pNode out of the tree and rebalance, but leave it alive. It comes back
+        // with no links and red, ready to be hung in this tree or another one
+        BNode* unlinkNode(BNode* pNode);
+
+        // order statistics: every node knows the size of its subtree, so position in
+        // the tree can be found from the top down or the bottom up in O(log n)
+        static size_t sizeOf(const BNode* pNode) { return pNode ? pNode->size : 0; }
+        size_t indexOf(const BNode* pNode) const; // how many nodes come before pNode, size() for end()
     public:
+        using allocator_type = A;
+        using key_compare = C;
+
         BST(); //default constructor
+        explicit BST(const A& a); // start empty, but get the nodes from a
+        explicit BST(const C& comp, const A& a = A()); // start empty, ordered by comp
         BST(const BST& rhs); // copy constructor
-        BST(BST&& rhs) : BST() { *this = std::move(rhs); } // move constructor, the move calls the move assignment operator
-        BST(const std::initializer_list<T>& il) : BST() { *this = il; } // initializer list constructor
+        BST(const BST& rhs, const A& a); // copy into a tree that uses a different allocator
+        BST(BST&& rhs); // move constructor, the nodes come along with the allocator that made them
+        BST(BST&& rhs, const A& a); // move into a tree that uses a different allocator
+        BST(const std::initializer_list<T>& il, const A& a = A()) : BST(a) { *this = il; } // initializer list constructor
         ~BST(); // destructor
 
         BST& operator = (const BST& rhs);
@@ -84,39 +188,117 @@ namespace custom
         void swap(BST& rhs);
 
         class iterator; // will use iterator to move about the tree
+        class node_type; // owns a node that was pulled out of the tree
         iterator begin() const noexcept; 
-        iterator end() const noexcept { return iterator(nullptr); }
-
-        iterator find(const T& t); // find an element in the tree
-
-        std::pair<iterator, bool> insert(const T& t, bool keepUnique = true); // insert an element into the tree, keepUnique is true by default because when do we not want to keep it unique?
-        std::pair<iterator, bool> insert(T&& t, bool keepUnique = true); 
+        iterator end() const noexcept { return iterator(nullptr, this); }
+
+        iterator find(const T& t) { return iterator(findNode(t), this); } // find an element in the tree
+        template <class K, class CC = C, class = typename CC::is_transparent>
+        iterator find(const K& k) { return iterator(findNode(k), this); } // find without making a T, if the comparator allows it
+
+        // bounds of the run of elements equal to t, each is a single trip down the tree
+        iterator lower_bound(const T& t) const { return iterator(lowerNode(t), this); }
+        iterator upper_bound(const T& t) const { return iterator(upperNode(t), this); }
+        std::pair<iterator, iterator> equal_range(const T& t) const { return std::make_pair(lower_bound(t), upper_bound(t)); }
+        template <class K, class CC = C, class = typename CC::is_transparent>
+        iterator lower_bound(const K& k) const { return iterator(lowerNode(k), this); }
+        template <class K, class CC = C, class = typename CC::is_transparent>
+        iterator upper_bound(const K& k) const { return iterator(upperNode(k), this); }
+        template <class K, class CC = C, class = typename CC::is_transparent>
+        std::pair<iterator, iterator> equal_range(const K& k) const { return std::make_pair(lower_bound(k), upper_bound(k)); }
+
+        // finger search: lower_bound, but start looking at itFrom instead of the root.
+        // Everything before itFrom has to be less than k. The cost is the log of how
+        // far we move, not the log of the size, so walking a sorted list of keys through
+        // the tree costs O(m log(n/m + 1)) instead of O(m log n)
+        template <class K>
+        iterator lower_bound(iterator itFrom, const K& k) const { return iterator(lowerNodeFrom(itFrom.pNode, k), this); }
+
+        // how many elements are less than k, one trip down the tree
+        template <class K>
+        size_t rank(const K& k) const;
+        // the element with i elements in front of it, or end() if there are not that many
+        iterator select(size_t i) const;
+
+        std::pair<iterator, bool> insert(const T& t, bool keepUnique = false); // insert an element into the tree, set asks for keepUnique, a plain BST allows duplicates
+        std::pair<iterator, bool> insert(T&& t, bool keepUnique = false); 
+        // insert right in front of itHint if t belongs there, no descent at all. Appending with end() as the hint
+        // is a single comparison against the biggest element, which we keep track of
+        iterator insert(iterator itHint, const T& t) { return insertHint(itHint, t, false).first; }
+        iterator insert(iterator itHint, T&& t) { return insertHint(itHint, std::move(t), false).first; }
+        template <class... Args>
+        iterator emplace(Args&&... args) { return insertNode(createNode(std::in_place, std::forward<Args>(args)...), false).first; } // build the element in its node, duplicates are fine
 
         iterator erase(iterator& it); // erase an element from the tree
+        iterator erase(iterator first, iterator last); // erase [first, last), no searching involved
+
+        // Move nodes between trees without freeing or allocating them, and without touching
+        // the elements. Both trees have to get their nodes from allocators that compare equal
+        node_type extract(iterator it); // unlink the node and hand it over, the tree forgets it
+        std::pair<iterator, bool> insert(node_type&& nh, bool keepUnique = false); // hang it back up, on a match nh keeps the node
+        void merge(BST& source, bool keepUnique = false); // relink source's nodes into us, on a match the node stays in source
+
+        // replace the contents with [first, last), which must already be sorted with no duplicates
+        template <class Iterator>
+        void assignSorted(Iterator first, Iterator last);
+        // is [first, last) strictly increasing? Only asks, never changes the tree
+        template <class Iterator>
+        bool isSortedUnique(Iterator first, Iterator last) const;
         void clear() noexcept; // clear the tree
 
         void deleteNode(BNode*& pDelete, bool toRight); // delete a node from the tree
 
         bool empty() const noexcept { return numElements == 0; }    // check if the tree is empty
         size_t size() const noexcept { return numElements; } // return the size of the tree
+
+        bool validate() const; // check the red-black rules, handy to prove the tree is balanced
+
+        allocator_type get_allocator() const { return allocator_type(alloc); }
+        key_compare key_comp() const { return this->comp(); }
+
+    private:
+        // the work behind both inserts, U is either const T& or T
+        template <class U>
+        std::pair<iterator, bool> insertValue(U&& t, bool keepUnique);
+
+        // find k, and if it is not there hang whatever node makeNode() builds where k belongs,
+        // one trip down the tree either way. This is how map gets try_emplace and operator []
+        template <class K, class MakeNode>
+        std::pair<iterator, bool> findOrInsert(const K& k, MakeNode makeNode);
+
+        // put t right in front of itNext (or at the very end) without searching, the caller knows it belongs there
+        template <class U>
+        iterator insertBefore(iterator itNext, U&& t);
+        void attachBefore(BNode* pNext, BNode* pNew);
+
+        // hang a node that is already built, this is how emplace avoids moving the element.
+        // If keepUnique turns up a match, pNew is destroyed and we point at the match
+        std::pair<iterator, bool> insertNode(BNode* pNew, bool keepUnique);
+        // same, but try right in front of itHint first, no descent if that is where pNew goes
+        std::pair<iterator, bool> insertNodeHint(iterator itHint, BNode* pNew);
+        template <class U>
+        std::pair<iterator, bool> insertHint(iterator itHint, U&& t, bool keepUnique);
+
+        // the work behind assignSorted, builds n nodes from it and returns the root of them
+        template <class Iterator>
+        BNode* buildSorted(Iterator& it, size_t n, int depth, int depthRed);
     };
 
-    template <typename T>
-    class BST <T> ::BNode
+    template <typename T, typename C, typename A>
+    class BST <T, C, A> ::BNode
     {
     public:
         // Bnode constructors
-        BNode() : data(T()), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true) {}
-        BNode(const T& t) : data(t), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true) {}
-        BNode(T&& t) : data(std::move(t)), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true) {}
+        BNode() : data(T()), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true), size(1) {}
+        BNode(const T& t) : data(t), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true), size(1) {}
+        BNode(T&& t) : data(std::move(t)), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true), size(1) {}
+        // build the data right here in the node out of whatever T's constructor takes
+        template <class... Args>
+        explicit BNode(std::in_place_t, Args&&... args) : data(std::forward<Args>(args)...), pLeft(nullptr), pRight(nullptr), pParent(nullptr), isRed(true), size(1) {}
 
         // Bnode functions, these functions handle the where the node is placed in the tree
         void addLeft(BNode* pNode);
         void addRight(BNode* pNode);
-        void addLeft(const T& t);
-        void addRight(const T& t);
-        void addLeft(T&& t);
-        void addRight(T&& t);
 
         // checks and balances for the tree
         bool isRightChild() const { return pParent && pParent->pRight == this; }
@@ -128,32 +310,108 @@ namespace custom
         BNode* pRight;
         BNode* pParent;
         bool isRed;
+        size_t size;   // how many nodes hang from here, this one included
+    };
+
+    // A node handle, like C++17's. It owns one node that has been pulled out of a
+    // tree, element and all, so the node can go back into this tree or into another
+    // one without being freed and allocated again. The element can be changed while
+    // it is out, which is the only way to change a key without copying it. If nobody
+    // takes the node back, the handle gives it to the allocator that made it
+    template <typename T, typename C, typename A>
+    class BST <T, C, A> ::node_type
+    {
+        friend class ::TestBST;
+        friend class ::TestSet;
+        friend class BST <T, C, A>;
+    public:
+        using value_type     = T;
+        using allocator_type = A;
+
+        node_type() noexcept : pNode(nullptr) {}
+        node_type(node_type&& rhs) noexcept : pNode(rhs.pNode), alloc(std::move(rhs.alloc))
+        {
+            rhs.pNode = nullptr;
+            rhs.alloc.reset();
+        }
+        node_type& operator = (node_type&& rhs)
+        {
+            release();
+            pNode = rhs.pNode;
+            alloc = std::move(rhs.alloc);
+            rhs.pNode = nullptr;
+            rhs.alloc.reset();
+            return *this;
+        }
+        node_type(const node_type&) = delete;
+        node_type& operator = (const node_type&) = delete;
+        ~node_type() { release(); }
+
+        bool empty() const noexcept { return pNode == nullptr; }
+        explicit operator bool() const noexcept { return pNode != nullptr; }
+
+        // the element, which is ours to change until the node goes back in a tree
+        T& value() const { assert(pNode); return pNode->data; }
+        allocator_type get_allocator() const { assert(alloc); return allocator_type(*alloc); }
+
+        void swap(node_type& rhs) noexcept
+        {
+            std::swap(pNode, rhs.pNode);
+            std::swap(alloc, rhs.alloc);
+        }
+
+    private:
+        node_type(BNode* pNode, const NodeAlloc& alloc) : pNode(pNode), alloc(alloc) {}
+
+        // the tree took the node back, so it is not ours to free anymore
+        BNode* take()
+        {
+            BNode* p = pNode;
+            pNode = nullptr;
+            alloc.reset();
+            return p;
+        }
+
+        void release()
+        {
+            if (pNode)
+            {
+                NodeTraits::destroy(*alloc, pNode);
+                NodeTraits::deallocate(*alloc, pNode, 1);
+            }
+            pNode = nullptr;
+            alloc.reset();
+        }
+
+        BNode* pNode;                   // null when the handle is empty
+        std::optional<NodeAlloc> alloc; // the allocator that can free pNode, only there when pNode is
     };
 
 
     // The iterator will move about the tree and allow us to access the data in the tree
-    template <typename T>
-    class BST <T> ::iterator
+    template <typename T, typename C, typename A>
+    class BST <T, C, A> ::iterator
     {
         // more unit test access
         friend class ::TestBST;
         friend class ::TestMap;
         friend class ::TestSet;
 
-        template <class KK, class VV>
+        template <class KK, class VV, class CC, class AA>
         friend class map;
 
-        template <class TT>
+        template <class TT, class CC, class AA>
         friend class set;
     public:
-        // iterator constructors
-        iterator(BNode* p = nullptr) : pNode(p) {}
-        iterator(const iterator& rhs) : pNode(rhs.pNode) {}
+        // iterator constructors, the tree is only needed to back up from end()
+        iterator(BNode* p = nullptr, const BST* pTree = nullptr) : pNode(p), pTree(pTree) {}
+        iterator(const iterator& rhs) : pNode(rhs.pNode), pTree(rhs.pTree) {}
 
         // iterator assignment operator
         iterator& operator = (const iterator& rhs)
         {
             pNode = rhs.pNode;
+            pTree = rhs.pTree;
             return *this;
         }
 
@@ -177,59 +435,156 @@ namespace custom
 
         // iterator prefix increment
         iterator& operator ++ ();
-        iterator   operator ++ (int postfix)
+        iterator   operator ++ (int)
         {
-            return *this;
+            iterator tmp(*this);
+            ++(*this);
+            return tmp;
         }
 
-        // iterator prefix decrement
+        // jump n places in O(log n): climb to find where we are, then go straight down to
+        // where we want to be. Jumping past either end lands on end()
+        iterator& operator += (std::ptrdiff_t n);
+        iterator& operator -= (std::ptrdiff_t n) { return *this += -n; }
+
+        // iterator prefix decrement, from end() this lands on the biggest element
         iterator& operator -- ();
-        iterator   operator -- (int postfix)
+        iterator   operator -- (int)
         {
-            return *this;
+            iterator tmp(*this);
+            --(*this);
+            return tmp;
         }
 
-        friend BST <T> ::iterator BST <T> ::erase(iterator& it);
+        friend BST <T, C, A> ::iterator BST <T, C, A> ::erase(iterator& it);
+        friend class BST <T, C, A>;
 
     private:
-        // the only attribute of the iterator is the node as this is our vehicle to move about the tree
+        // the node is our vehicle to move about the tree, null is end()
         BNode* pNode;
+        // the tree we are walking, end() has no node so this is how it finds the biggest one
+        const BST* pTree;
     };
 
     // The BST class constructors implementations, well some, others are defined at class declaration
     // could move these to the .cpp file but keeping them in the header for convenience
-    template <typename T>
-    BST <T> ::BST() : numElements(0), root(nullptr) {}
+    template <typename T, typename C, typename A>
+    BST <T, C, A> ::BST() : numElements(0), root(nullptr) {}
+
+    template <typename T, typename C, typename A>
+    BST <T, C, A> ::BST(const A& a) : root(nullptr), numElements(0), alloc(a) {}
 
-    template <typename T>
-    BST<T>::BST(const BST<T>& rhs) : numElements(0), root(nullptr)
+    template <typename T, typename C, typename A>
+    BST <T, C, A> ::BST(const C& comp, const A& a) : CompareBase<C>(comp), root(nullptr), numElements(0), alloc(a) {}
+
+    template <typename T, typename C, typename A>
+    BST<T, C, A>::BST(const BST<T, C, A>& rhs) : CompareBase<C>(rhs.comp()), root(nullptr), numElements(0),
+        alloc(NodeTraits::select_on_container_copy_construction(rhs.alloc))
     {
-        *this = rhs;
+        root = copyBinaryTree(rhs.root);
+        numElements = rhs.numElements;
+        findEnds();
     }
 
-    template <typename T>
-    BST <T> :: ~BST()
+    template <typename T, typename C, typename A>
+    BST<T, C, A>::BST(const BST<T, C, A>& rhs, const A& a) : CompareBase<C>(rhs.comp()), root(nullptr), numElements(0), alloc(a)
     {
-        clear();
+        root = copyBinaryTree(rhs.root);
+        numElements = rhs.numElements;
+        findEnds();
     }
 
-    // using recursion find the leaf node left and right then on the way back up th tree delete the node
-    template <class T>
-    void BST<T>::deleteBinaryTree(BST<T>::BNode*& node)
+    // the allocator is copied, not moved, so rhs can still make nodes after we take its tree
+    template <typename T, typename C, typename A>
+    BST<T, C, A>::BST(BST<T, C, A>&& rhs) : CompareBase<C>(rhs.comp()), root(nullptr), numElements(0), alloc(rhs.alloc)
     {
-        if (!node)
-            return;
+        std::swap(root, rhs.root);
+        std::swap(numElements, rhs.numElements);
+        std::swap(pRightmost, rhs.pRightmost);
+        std::swap(pLeftmost, rhs.pLeftmost);
+    }
 
-        deleteBinaryTree(node->pLeft);
-        deleteBinaryTree(node->pRight);
+    // we can only steal the nodes if our allocator can free them
+    template <typename T, typename C, typename A>
+    BST<T, C, A>::BST(BST<T, C, A>&& rhs, const A& a) : CompareBase<C>(rhs.comp()), root(nullptr), numElements(0), alloc(a)
+    {
+        if (alloc == rhs.alloc)
+        {
+            std::swap(root, rhs.root);
+            std::swap(numElements, rhs.numElements);
+            std::swap(pRightmost, rhs.pRightmost);
+            std::swap(pLeftmost, rhs.pLeftmost);
+        }
+        else
+        {
+            *this = rhs;
+            rhs.clear();
+        }
+    }
 
-        delete node;
+    template <typename T, typename C, typename A>
+    BST <T, C, A> :: ~BST()
+    {
+        clear();
+    }
+
+    // no recursion, so a tall tree cannot blow the stack. Rotate left children up until
+    // the node on top has none, then it can go and its right child takes its place.
+    // Every rotation moves one node out of the left spine for good, so this is O(n)
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::deleteBinaryTree(BST<T, C, A>::BNode*& node)
+    {
+        BNode* pNode = node;
+        while (pNode)
+        {
+            if (pNode->pLeft)
+            {
+                BNode* pLeft = pNode->pLeft;
+                pNode->pLeft = pLeft->pRight;
+                pLeft->pRight = pNode;
+                pNode = pLeft;
+            }
+            else
+            {
+                BNode* pRight = pNode->pRight;
+                destroyNode(pNode);
+                pNode = pRight;
+            }
+        }
         node = nullptr;
     }
 
-    // also using recursion find the left or right most node and on the way back up the tree assign the nodes
-    template <class T>
-    void BST<T>::assignBinaryTree(BST<T>::BNode*& pDest, const BST<T>::BNode* pSrc)
+    // grab memory for one node from the allocator and build the node in it
+    template <typename T, typename C, typename A>
+    template <class... Args>
+    typename BST<T, C, A>::BNode* BST<T, C, A>::createNode(Args&&... args)
+    {
+        BNode* pNode = NodeTraits::allocate(alloc, 1);
+        try
+        {
+            NodeTraits::construct(alloc, pNode, std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+            NodeTraits::deallocate(alloc, pNode, 1);
+            throw;
+        }
+        return pNode;
+    }
+
+    // tear down the node and give its memory back to the allocator
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::destroyNode(BNode* pNode)
+    {
+        NodeTraits::destroy(alloc, pNode);
+        NodeTraits::deallocate(alloc, pNode, 1);
+    }
+
+    // walk both trees in preorder together, reusing the nodes pDest already has and
+    // making or deleting nodes where the shapes differ. We find our way back up with
+    // the parent pointers instead of the call stack, so the depth of the tree does not matter
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::assignBinaryTree(BST<T, C, A>::BNode*& pDest, const BST<T, C, A>::BNode* pSrc)
     {
         if (!pSrc)
         {
@@ -237,32 +592,126 @@ namespace custom
             return;
         }
 
-        if (!pDest)
-            pDest = new BNode(pSrc->data);
-        else
-            pDest->data = pSrc->data;
+        // a map's pair<const K, V> cannot be assigned, so start from scratch
+        if constexpr (!std::is_copy_assignable<T>::value)
+            deleteBinaryTree(pDest);
+
+        assignNode(pDest, pSrc, pDest ? pDest->pParent : nullptr);
+
+        const BNode* pS = pSrc;
+        BNode* pD = pDest;
+        for (;;)
+        {
+            pD->isRed = pS->isRed;
+            pD->size = pS->size;
+
+            // first time here, go left if the source does
+            if (pS->pLeft)
+            {
+                assignNode(pD->pLeft, pS->pLeft, pD);
+                pS = pS->pLeft;
+                pD = pD->pLeft;
+                continue;
+            }
+            deleteBinaryTree(pD->pLeft);
+
+            // the left side is done, go right here or at the closest ancestor with a right side left to do
+            for (;;)
+            {
+                if (pS->pRight)
+                {
+                    assignNode(pD->pRight, pS->pRight, pD);
+                    pS = pS->pRight;
+                    pD = pD->pRight;
+                    break;
+                }
+                deleteBinaryTree(pD->pRight);
+
+                // climb out of every subtree we finished from the right
+                while (pS != pSrc && pS->pParent->pRight == pS)
+                {
+                    pS = pS->pParent;
+                    pD = pD->pParent;
+                }
+                if (pS == pSrc)
+                    return;
 
-        assignBinaryTree(pDest->pLeft, pSrc->pLeft);
-        if (pDest->pLeft)
-            pDest->pLeft->pParent = pDest;
+                // we came up from a left child, its parent's right side is next
+                pS = pS->pParent;
+                pD = pD->pParent;
+            }
+        }
+    }
 
-        assignBinaryTree(pDest->pRight, pSrc->pRight);
-        if (pDest->pRight)
-            pDest->pRight->pParent = pDest;
+    // copy pSrc's data into the node at pSlot, reusing the node if there is one
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::assignNode(BNode*& pSlot, const BNode* pSrc, BNode* pParent)
+    {
+        if constexpr (std::is_copy_assignable<T>::value)
+        {
+            if (pSlot)
+            {
+                pSlot->data = pSrc->data;
+                pSlot->pParent = pParent;
+                return;
+            }
+        }
+        pSlot = createNode(pSrc->data);
+        pSlot->pParent = pParent;
+    }
+
+    // a brand new copy of the tree at pSrc. If we run out of memory part way
+    // through, the part we did copy is given back before the exception goes on
+    template <typename T, typename C, typename A>
+    typename BST<T, C, A>::BNode* BST<T, C, A>::copyBinaryTree(const BNode* pSrc)
+    {
+        BNode* pDest = nullptr;
+        try
+        {
+            assignBinaryTree(pDest, pSrc);
+        }
+        catch (...)
+        {
+            deleteBinaryTree(pDest);
+            throw;
+        }
+        return pDest;
     }
 
     // 
-    template <typename T>
-    BST <T>& BST <T> :: operator = (const BST <T>& rhs)
+    // if the allocator propagates, our old nodes have to go back to our old allocator first
+    template <typename T, typename C, typename A>
+    BST <T, C, A>& BST <T, C, A> :: operator = (const BST <T, C, A>& rhs)
     {
-        assignBinaryTree(root, rhs.root);
+        if (this == &rhs)
+            return *this;
+
+        this->comp() = rhs.comp();
+        if constexpr (NodeTraits::propagate_on_container_copy_assignment::value)
+        {
+            if (alloc != rhs.alloc)
+                clear();
+            alloc = rhs.alloc;
+        }
+
+        // if we run out of memory part way through, the ends could be gone, so start over empty
+        try
+        {
+            assignBinaryTree(root, rhs.root);
+        }
+        catch (...)
+        {
+            clear();
+            throw;
+        }
         numElements = rhs.numElements;
+        findEnds();
         return *this;
     }
  
     // if we get a list of elements, make room, and loop through the list and insert the elements
-    template <typename T>
-    BST <T>& BST <T> :: operator = (const std::initializer_list<T>& il)
+    template <typename T, typename C, typename A>
+    BST <T, C, A>& BST <T, C, A> :: operator = (const std::initializer_list<T>& il)
     {
         clear();
         for (auto&& it : il)
@@ -270,173 +719,521 @@ namespace custom
         return *this;
     }
 
-    template <typename T>
-    BST <T>& BST <T> :: operator = (BST <T>&& rhs)
+    // steal the tree if the allocator comes along or the two allocators are the same,
+    // otherwise rhs's nodes belong to a different heap and we have to copy them
+    template <typename T, typename C, typename A>
+    BST <T, C, A>& BST <T, C, A> :: operator = (BST <T, C, A>&& rhs)
     {
+        if (this == &rhs)
+            return *this;
+
         clear();
-        swap(rhs);
+        this->comp() = rhs.comp();
+        if constexpr (NodeTraits::propagate_on_container_move_assignment::value)
+            alloc = rhs.alloc;
+        else if (alloc != rhs.alloc)
+        {
+            *this = rhs;
+            rhs.clear();
+            return *this;
+        }
+
+        std::swap(root, rhs.root);
+        std::swap(numElements, rhs.numElements);
+        std::swap(pRightmost, rhs.pRightmost);
+        std::swap(pLeftmost, rhs.pLeftmost);
         return *this;
     }
 
     // swap, switch, flip, exchange, you get the idea
     // just swap the old tree with the new tree
-    template <typename T>
-    void BST <T> ::swap(BST <T>& rhs)
+    // the nodes have to stay with the allocator that made them, so it comes along if it can
+    template <typename T, typename C, typename A>
+    void BST <T, C, A> ::swap(BST <T, C, A>& rhs)
     {
         std::swap(root, rhs.root);
         std::swap(numElements, rhs.numElements);
+        std::swap(pRightmost, rhs.pRightmost);
+        std::swap(pLeftmost, rhs.pLeftmost);
+        std::swap(this->comp(), rhs.comp());
+        if constexpr (NodeTraits::propagate_on_container_swap::value)
+            std::swap(alloc, rhs.alloc);
+        else
+            assert(alloc == rhs.alloc);
+    }
+
+
+    // insert takes two parameters, the element to insert and a bool to keep it unique
+    // both flavors share insertValue, the only difference is whether t gets copied or moved into the node
+    template <typename T, typename C, typename A>
+    std::pair<typename BST<T, C, A>::iterator, bool> BST<T, C, A>::insert(const T& t, bool keepUnique)
+    {
+        return insertValue(t, keepUnique);
     }
 
+    template <typename T, typename C, typename A>
+    std::pair<typename BST <T, C, A> ::iterator, bool> BST <T, C, A> ::insert(T&& t, bool keepUnique)
+    {
+        return insertValue(std::move(t), keepUnique);
+    }
 
-    // insert takes two parameters, the element to insert and a bool to keep it unique, the unique is true by default
     // if the tree is empty, create a new node and set it as the root, other
     // wise loop through the tree and insert the element in the correct place
-    template <typename T>
-    std::pair<typename BST<T>::iterator, bool> BST<T>::insert(const T& t, bool keepUnique)
+    // then rebalance so the tree never degrades into a linked list
+    // we only ask "is t less than this node" on the way down, one comparison per level,
+    // and remember the last node that was not bigger than t. If t is already in the
+    // tree that is the one, so a single extra comparison at the bottom settles keepUnique
+    template <typename T, typename C, typename A>
+    template <class U>
+    std::pair<typename BST <T, C, A> ::iterator, bool> BST <T, C, A> ::insertValue(U&& t, bool keepUnique)
     {
         if (!root)
         {
-            root = new BNode(t);
+            root = createNode(std::forward<U>(t));
+            root->isRed = false;
             numElements = 1;
-            return std::make_pair(iterator(root), true);
+            pRightmost = pLeftmost = root;
+            return std::make_pair(iterator(root, this), true);
         }
 
-        BNode* currentNode = root;
-        while (currentNode)
-        {
-            if (keepUnique && t == currentNode->data)
-                return std::make_pair(iterator(currentNode), false);
+        BNode* parentNode = nullptr;
+        BNode* pCandidate = nullptr;   // the last node where we went right, the only possible match
+        bool goLeft = false;           // remember the last turn so we do not compare again once t is moved
 
-            if (t < currentNode->data)
-            {
-                if (currentNode->pLeft)
-                    currentNode = currentNode->pLeft;
-                else
-                {
-                    currentNode->pLeft = new BNode(t);
-                    currentNode->pLeft->pParent = currentNode;
-                    ++numElements;
-                    return std::make_pair(iterator(currentNode->pLeft), true);
-                }
-            }
+        for (BNode* currentNode = root; currentNode; )
+        {
+            parentNode = currentNode;
+            goLeft = less(t, currentNode->data);
+            if (goLeft)
+                currentNode = currentNode->pLeft;
             else
             {
-                if (currentNode->pRight)
-                    currentNode = currentNode->pRight;
-                else
-                {
-                    currentNode->pRight = new BNode(t);
-                    currentNode->pRight->pParent = currentNode;
-                    ++numElements;
-                    return std::make_pair(iterator(currentNode->pRight), true);
-                }
+                pCandidate = currentNode;
+                currentNode = currentNode->pRight;
             }
         }
 
-        return std::make_pair(end(), false);
-    }
+        if (keepUnique && pCandidate && !less(pCandidate->data, t))
+            return std::make_pair(iterator(pCandidate, this), false);
 
+        BNode* newNode = createNode(std::forward<U>(t));
 
-    // the main difference with this insert is that we are moving the element into the tree instead of copying it
-    template <typename T>
-    std::pair<typename BST <T> ::iterator, bool> BST <T> ::insert(T&& t, bool keepUnique)
-    {
-        if (!root)
-        {
-            root = new BNode(std::move(t));
-            numElements = 1;
-            return std::make_pair(iterator(root), true);
-        }
+        if (goLeft)
+            parentNode->addLeft(newNode);
+        else
+            parentNode->addRight(newNode);
 
-        BNode* currentNode = root;
+        ++numElements;
+        balanceInsert(newNode);
+        return std::make_pair(iterator(newNode, this), true);
+    }
+
+    // the same descent as insert, but nothing is built until we know k is missing
+    template <typename T, typename C, typename A>
+    template <class K, class MakeNode>
+    std::pair<typename BST <T, C, A> ::iterator, bool> BST <T, C, A> ::findOrInsert(const K& k, MakeNode makeNode)
+    {
         BNode* parentNode = nullptr;
+        BNode* pCandidate = nullptr;
+        bool goLeft = false;
 
-        while (currentNode)
+        for (BNode* currentNode = root; currentNode; )
         {
             parentNode = currentNode;
-            if (keepUnique && t == currentNode->data)
-                return std::make_pair(iterator(currentNode), false);
-
-            if (t < currentNode->data)
+            goLeft = less(k, currentNode->data);
+            if (goLeft)
                 currentNode = currentNode->pLeft;
             else
+            {
+                pCandidate = currentNode;
                 currentNode = currentNode->pRight;
+            }
         }
 
-        BNode* newNode = new BNode(std::move(t));
-        newNode->pParent = parentNode;
+        if (pCandidate && !less(pCandidate->data, k))
+            return std::make_pair(iterator(pCandidate, this), false);
 
-        if (newNode->data < parentNode->data)
-            parentNode->pLeft = newNode;
+        BNode* newNode = makeNode();
+        if (!parentNode)
+            root = newNode;
+        else if (goLeft)
+            parentNode->addLeft(newNode);
         else
-            parentNode->pRight = newNode;
+            parentNode->addRight(newNode);
 
         ++numElements;
-        return std::make_pair(iterator(newNode), true);
+        balanceInsert(newNode);
+        return std::make_pair(iterator(newNode, this), true);
     }
 
     // erase an element from the tree using the iterator
-    template <typename T>
-    typename BST<T>::iterator BST<T>::erase(iterator& it)
+    // if we pull a black node out of the tree, one side is now short a black node so we rebalance
+    template <typename T, typename C, typename A>
+    typename BST<T, C, A>::iterator BST<T, C, A>::erase(iterator& it)
     {
         if (it == end())
             return end();
 
         iterator itNext(it);
-        BNode* pDelete = it.pNode;
+        ++itNext;
+        destroyNode(unlinkNode(it.pNode));
+        return itNext;
+    }
 
-        if (!pDelete->pLeft)
+    // the work behind erase and extract
+    // if we pull a black node out of the tree, one side is now short a black node so we rebalance
+    template <typename T, typename C, typename A>
+    typename BST<T, C, A>::BNode* BST<T, C, A>::unlinkNode(BNode* pDelete)
+    {
+        // the biggest has no right child, so the next biggest is the biggest on its left or its parent
+        if (pDelete == pRightmost)
         {
-            ++itNext;
-            deleteNode(pDelete, true);
+            pRightmost = pDelete->pLeft ? pDelete->pLeft : pDelete->pParent;
+            while (pDelete->pLeft && pRightmost->pRight)
+                pRightmost = pRightmost->pRight;
         }
-        else if (!pDelete->pRight)
+        // and the smallest has no left child, so the next smallest is its successor
+        if (pDelete == pLeftmost)
         {
-            ++itNext;
-            deleteNode(pDelete, false);
+            pLeftmost = pDelete->pRight ? pDelete->pRight : pDelete->pParent;
+            while (pDelete->pRight && pLeftmost->pLeft)
+                pLeftmost = pLeftmost->pLeft;
         }
-        else
+
+        redblack<BST, BNode>::unlink(*this, pDelete);
+
+        numElements--;
+        pDelete->pLeft = pDelete->pRight = pDelete->pParent = nullptr;
+        pDelete->isRed = true;
+        pDelete->size = 1;
+        return pDelete;
+    }
+
+    template <typename T, typename C, typename A>
+    typename BST<T, C, A>::node_type BST<T, C, A>::extract(iterator it)
+    {
+        if (it == end())
+            return node_type();
+        return node_type(unlinkNode(it.pNode), alloc);
+    }
+
+    // the node goes where its element belongs, exactly like a fresh insert minus the allocation
+    template <typename T, typename C, typename A>
+    std::pair<typename BST<T, C, A>::iterator, bool> BST<T, C, A>::insert(node_type&& nh, bool keepUnique)
+    {
+        if (nh.empty())
+            return std::make_pair(end(), false);
+        assert(*nh.alloc == alloc); // otherwise we could not free the node later
+
+        if (keepUnique)
+            return findOrInsert(nh.pNode->data, [&nh]() { return nh.take(); });
+        return insertNode(nh.take(), false);
+    }
+
+    // Walk source in order and move each node over. The successor is found before the
+    // node is unlinked, and unlinking moves nodes around but never frees one, so the
+    // walk is not thrown off. Each node costs one descent here and an unlink there
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::merge(BST& source, bool keepUnique)
+    {
+        if (&source == this)
+            return;
+        assert(source.alloc == alloc);
+
+        // nothing to collide with, so just take the whole tree
+        if (empty())
         {
-            BNode* pIOS = pDelete->pRight;
-            while (pIOS->pLeft)
-                pIOS = pIOS->pLeft;
+            std::swap(root, source.root);
+            std::swap(numElements, source.numElements);
+            std::swap(pRightmost, source.pRightmost);
+            std::swap(pLeftmost, source.pLeftmost);
+            return;
+        }
 
-            pIOS->pLeft = pDelete->pLeft;
-            if (pDelete->pLeft)
-                pDelete->pLeft->pParent = pIOS;
+        for (iterator it = source.begin(); it != source.end(); )
+        {
+            BNode* pNode = it.pNode;
+            ++it;
+            if (keepUnique)
+                findOrInsert(pNode->data, [&source, pNode]() { return source.unlinkNode(pNode); });
+            else
+                insertNode(source.unlinkNode(pNode), false);
+        }
+    }
 
-            if (pDelete->pRight != pIOS)
-            {
-                if (pIOS->pRight)
-                    pIOS->pRight->pParent = pIOS->pParent;
-                pIOS->pParent->pLeft = pIOS->pRight;
+    // erase a run of elements. The ends are already found, so there is no searching:
+    // each step is a successor and an unlink whose rebalancing is constant on average,
+    // which makes the whole thing O(k) on top of the O(log n) it took to find first
+    template <typename T, typename C, typename A>
+    typename BST<T, C, A>::iterator BST<T, C, A>::erase(iterator first, iterator last)
+    {
+        // everything is going, no need to unlink one at a time
+        if (first == begin() && last == end())
+        {
+            clear();
+            return end();
+        }
+
+        while (first != last)
+            first = erase(first);
+        return last;
+    }
+
+
+    // Build a perfectly balanced tree straight from sorted input, no comparisons and
+    // no rotations. Every level is full except maybe the last one, so coloring the
+    // bottom level red and everything else black keeps the black height the same
+    // down every path
+    template <typename T, typename C, typename A>
+    template <class Iterator>
+    void BST<T, C, A>::assignSorted(Iterator first, Iterator last)
+    {
+        // if building throws, buildSorted frees what it made and we are left empty
+        clear();
+
+        size_t n = std::distance(first, last);
+        int depthRed = 0;
+        for (size_t size = n; size > 1; size /= 2)
+            depthRed++;
 
-                pIOS->pRight = pDelete->pRight;
-                pDelete->pRight->pParent = pIOS;
+        root = buildSorted(first, n, 0, depthRed);
+        numElements = n;
+        if (root)
+        {
+            root->pParent = nullptr;
+            root->isRed = false;
+        }
+        findEnds();
+    }
+
+    // in order: the left half, then the middle, then the right half, so the iterator only goes forward
+    template <typename T, typename C, typename A>
+    template <class Iterator>
+    typename BST<T, C, A>::BNode* BST<T, C, A>::buildSorted(Iterator& it, size_t n, int depth, int depthRed)
+    {
+        if (n == 0)
+            return nullptr;
+
+        size_t numLeft = (n - 1) / 2;
+        BNode* pLeft = buildSorted(it, numLeft, depth + 1, depthRed);
+
+        // if an element will not copy, the half we already built has nobody
+        // else to free it, so give it back before the exception goes on
+        BNode* pNode;
+        try
+        {
+            pNode = createNode(*it);
+        }
+        catch (...)
+        {
+            deleteBinaryTree(pLeft);
+            throw;
+        }
+        ++it;
+        pNode->isRed = (depth == depthRed && depth != 0);
+        pNode->size = n;
+        pNode->pLeft = pLeft;
+        if (pLeft)
+            pLeft->pParent = pNode;
+
+        // pNode holds the left half now, so freeing it frees both
+        try
+        {
+            pNode->pRight = buildSorted(it, n - 1 - numLeft, depth + 1, depthRed);
+        }
+        catch (...)
+        {
+            deleteBinaryTree(pNode);
+            throw;
+        }
+        if (pNode->pRight)
+            pNode->pRight->pParent = pNode;
+        return pNode;
+    }
+
+    // Climb from pFrom until the next ancestor up and to the right is not less than k,
+    // then k belongs somewhere in the right subtree we just climbed out of. Going up costs
+    // nothing but pointers, and each comparison on the way roughly doubles how far we jump
+    template <typename T, typename C, typename A>
+    template <class K>
+    typename BST <T, C, A> ::BNode* BST<T, C, A> ::lowerNodeFrom(BNode* pFrom, const K& k) const
+    {
+        if (!pFrom || !less(pFrom->data, k))
+            return pFrom;
+
+        BNode* pNode = pFrom;
+        for (;;)
+        {
+            // the closest ancestor that is bigger than pNode
+            BNode* pChild = pNode;
+            while (pChild->pParent && pChild->pParent->pRight == pChild)
+                pChild = pChild->pParent;
+            BNode* pAbove = pChild->pParent;
+
+            if (!pAbove || !less(pAbove->data, k))
+            {
+                BNode* pCandidate = pAbove;
+                for (BNode* current = pNode->pRight; current; )
+                {
+                    if (less(current->data, k))
+                        current = current->pRight;
+                    else
+                    {
+                        pCandidate = current;
+                        current = current->pLeft;
+                    }
+                }
+                return pCandidate;
             }
+            pNode = pAbove;
+        }
+    }
 
-            pIOS->pParent = pDelete->pParent;
-            if (pDelete->pParent && pDelete->pParent->pLeft == pDelete)
-                pDelete->pParent->pLeft = pIOS;
-            if (pDelete->pParent && pDelete->pParent->pRight == pDelete)
-                pDelete->pParent->pRight = pIOS;
+    // the new node goes in the first empty spot between itNext and the element before it
+    template <typename T, typename C, typename A>
+    template <class U>
+    typename BST<T, C, A>::iterator BST<T, C, A>::insertBefore(iterator itNext, U&& t)
+    {
+        BNode* pNew = createNode(std::forward<U>(t));
+        attachBefore(itNext.pNode, pNew);
+        return iterator(pNew, this);
+    }
 
-            if (root == pDelete)
-                root = pIOS;
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::attachBefore(BNode* pNext, BNode* pNew)
+    {
+        ++numElements;
 
-            itNext = iterator(pIOS);
+        if (!root)
+            root = pNew;
+        else if (!pNext)
+            rightmost()->addRight(pNew);
+        else if (!pNext->pLeft)
+            pNext->addLeft(pNew);
+        else
+        {
+            BNode* pPrev = pNext->pLeft;
+            while (pPrev->pRight)
+                pPrev = pPrev->pRight;
+            pPrev->addRight(pNew);
         }
 
-        numElements--;
-        delete pDelete;
-        return itNext;
+        balanceInsert(pNew);
+    }
+
+    // the node is built before we know where it goes, so compare against what is in it
+    template <typename T, typename C, typename A>
+    std::pair<typename BST<T, C, A>::iterator, bool> BST<T, C, A>::insertNode(BNode* pNew, bool keepUnique)
+    {
+        if (keepUnique)
+        {
+            auto result = findOrInsert(pNew->data, [pNew]() { return pNew; });
+            if (!result.second)
+                destroyNode(pNew);
+            return result;
+        }
+
+        BNode* parentNode = nullptr;
+        bool goLeft = false;
+        for (BNode* currentNode = root; currentNode; )
+        {
+            parentNode = currentNode;
+            goLeft = less(pNew->data, currentNode->data);
+            currentNode = goLeft ? currentNode->pLeft : currentNode->pRight;
+        }
+
+        if (!parentNode)
+            root = pNew;
+        else if (goLeft)
+            parentNode->addLeft(pNew);
+        else
+            parentNode->addRight(pNew);
+
+        ++numElements;
+        balanceInsert(pNew);
+        return std::make_pair(iterator(pNew, this), true);
+    }
+
+    // k fits in front of pNext if it is smaller than pNext and bigger than the one before it.
+    // At the end there is nothing after, so appending is one comparison against the rightmost
+    template <typename T, typename C, typename A>
+    template <class K>
+    bool BST<T, C, A>::fitsBefore(const BNode* pNext, const K& k) const
+    {
+        const BNode* pPrev = nullptr;
+        if (!pNext)
+            pPrev = rightmost();
+        else if (pNext->pLeft)
+        {
+            pPrev = pNext->pLeft;
+            while (pPrev->pRight)
+                pPrev = pPrev->pRight;
+        }
+        else
+        {
+            const BNode* pChild = pNext;
+            while (pChild->isLeftChild())
+                pChild = pChild->pParent;
+            pPrev = pChild->pParent;
+        }
+
+        return (!pNext || less(k, pNext->data)) && (!pPrev || less(pPrev->data, k));
+    }
+
+    // the smallest and biggest are at the bottom of the left and right sides, O(log n)
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::findEnds()
+    {
+        pLeftmost = pRightmost = root;
+        if (!root)
+            return;
+        while (pLeftmost->pLeft)
+            pLeftmost = pLeftmost->pLeft;
+        while (pRightmost->pRight)
+            pRightmost = pRightmost->pRight;
+    }
+
+    // two comparisons instead of a whole descent when the hint is right
+    template <typename T, typename C, typename A>
+    std::pair<typename BST<T, C, A>::iterator, bool> BST<T, C, A>::insertNodeHint(iterator itHint, BNode* pNew)
+    {
+        if (fitsBefore(itHint.pNode, pNew->data))
+        {
+            attachBefore(itHint.pNode, pNew);
+            return std::make_pair(iterator(pNew, this), true);
+        }
+
+        // a bad hint, or pNew is already there
+        return insertNode(pNew, true /* keepUnique */);
+    }
+
+    // same as insertNodeHint, but nothing is built until we know t belongs in the tree
+    template <typename T, typename C, typename A>
+    template <class U>
+    std::pair<typename BST<T, C, A>::iterator, bool> BST<T, C, A>::insertHint(iterator itHint, U&& t, bool keepUnique)
+    {
+        if (fitsBefore(itHint.pNode, t))
+            return std::make_pair(insertBefore(itHint, std::forward<U>(t)), true);
+        return insertValue(std::forward<U>(t), keepUnique);
     }
 
+    // one pass, one comparison per neighbor
+    template <typename T, typename C, typename A>
+    template <class Iterator>
+    bool BST<T, C, A>::isSortedUnique(Iterator first, Iterator last) const
+    {
+        if (first == last)
+            return true;
+        for (Iterator prev = first++; first != last; prev = first++)
+            if (!less(*prev, *first))
+                return false;
+        return true;
+    }
 
     // delete a node from the tree, right is a bool to determine if we are deleting the right node or the left node
     // the client should know which node they are deleting
-    template <typename T>
-    void BST<T>::deleteNode(BNode*& pDelete, bool right)
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::deleteNode(BNode*& pDelete, bool right)
     {
         BNode* pNext = (right) ? pDelete->pRight : pDelete->pLeft;
 
@@ -456,93 +1253,270 @@ namespace custom
         else
         {
             this->root = pNext;
-            pNext->pParent = nullptr;
+            if (pNext)
+                pNext->pParent = nullptr;
+        }
+    }
+
+    // a rotation moves pPivot above pNode. The pivot takes over the whole subtree,
+    // pNode keeps what is left under it
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::rotated(BNode* pNode, BNode* pPivot)
+    {
+        pPivot->size = pNode->size;
+        pNode->size = 1 + sizeOf(pNode->pLeft) + sizeOf(pNode->pRight);
+    }
+
+    // pNode is about to leave its spot, so everything above it is one smaller
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::leaving(BNode* pNode)
+    {
+        for (BNode* pAbove = pNode->pParent; pAbove; pAbove = pAbove->pParent)
+            pAbove->size--;
+    }
+
+    // pNew takes pOld's spot under pParent, or the root's
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::replaceChild(BNode* pParent, BNode* pOld, BNode* pNew)
+    {
+        if (!pParent)
+        {
+            root = pNew;
+            if (pNew)
+                pNew->pParent = nullptr;
         }
+        else if (pParent->pLeft == pOld)
+            pParent->addLeft(pNew);
+        else
+            pParent->addRight(pNew);
+    }
+
+    // after an insert the new red node may sit under a red parent. The ends and
+    // the sizes are ours to keep, then redblack recolors and rotates
+    template <typename T, typename C, typename A>
+    void BST<T, C, A>::balanceInsert(BNode* pNode)
+    {
+        // every new node comes through here right after it is hung, so this is
+        // where we notice it went in past the end. Rotations never change the order
+        if (!pNode->pParent)
+            pRightmost = pLeftmost = pNode;
+        else if (pRightmost->pRight == pNode)
+            pRightmost = pNode;
+        else if (pLeftmost->pLeft == pNode)
+            pLeftmost = pNode;
+
+        // everything above the new node just got one bigger
+        for (BNode* pAbove = pNode->pParent; pAbove; pAbove = pAbove->pParent)
+            pAbove->size++;
+
+        redblack<BST, BNode>::balanceInsert(*this, pNode);
+    }
+
+    // count the black nodes on the way down to the leaves, -1 means a rule was broken somewhere
+    template <typename T, typename C, typename A>
+    int BST<T, C, A>::blackHeight(const BNode* pNode) const
+    {
+        if (!pNode)
+            return 1;
+
+        // parent pointers and ordering
+        if (pNode->pLeft && (pNode->pLeft->pParent != pNode || less(pNode->data, pNode->pLeft->data)))
+            return -1;
+        if (pNode->pRight && (pNode->pRight->pParent != pNode || less(pNode->pRight->data, pNode->data)))
+            return -1;
+
+        // the size has to add up
+        if (pNode->size != 1 + sizeOf(pNode->pLeft) + sizeOf(pNode->pRight))
+            return -1;
+
+        // a red node cannot have a red child
+        if (pNode->isRed && ((pNode->pLeft && pNode->pLeft->isRed) || (pNode->pRight && pNode->pRight->isRed)))
+            return -1;
+
+        // every path down has the same number of black nodes
+        int heightLeft = blackHeight(pNode->pLeft);
+        int heightRight = blackHeight(pNode->pRight);
+        if (heightLeft == -1 || heightLeft != heightRight)
+            return -1;
+
+        return heightLeft + (pNode->isRed ? 0 : 1);
+    }
+
+    // the tree is a valid red-black tree if the root is black and all the paths agree
+    template <typename T, typename C, typename A>
+    bool BST<T, C, A>::validate() const
+    {
+        if (!root)
+            return numElements == 0 && !pRightmost && !pLeftmost;
+        if (root->isRed || root->pParent)
+            return false;
+        // the ends we keep track of had better be the ends
+        const BNode* pLast = root;
+        while (pLast->pRight)
+            pLast = pLast->pRight;
+        const BNode* pFirst = root;
+        while (pFirst->pLeft)
+            pFirst = pFirst->pLeft;
+        if (pLast != pRightmost || pFirst != pLeftmost)
+            return false;
+        return blackHeight(root) != -1;
     }
 
     // clear the tree, delete the tree
-    template <typename T>
-    void BST <T> ::clear() noexcept
+    template <typename T, typename C, typename A>
+    void BST <T, C, A> ::clear() noexcept
     {
         deleteBinaryTree(root);
         numElements = 0;
+        pRightmost = pLeftmost = nullptr;
     }
 
-    template <typename T>
-    typename BST <T> ::iterator custom::BST <T> ::begin() const noexcept
+    template <typename T, typename C, typename A>
+    typename BST <T, C, A> ::iterator custom::BST <T, C, A> ::begin() const noexcept
     {
-        BNode* current = root;
-        while (current && current->pLeft)
-            current = current->pLeft;
-        return iterator(current);
+        return iterator(leftmost(), this);
     }
 
-    // the iterator searches the tree for the element, if it finds it, it returns the iterator, if not it does not find anything returns the end iterator
-    template <typename T>
-    typename BST <T> ::iterator BST<T> ::find(const T& t)
+    // the iterator searches the tree for the element, if it finds it, it returns the node, if not it does not find anything returns null
+    // same trick as insert, one comparison per level and one more at the bottom to see if the candidate is k
+    template <typename T, typename C, typename A>
+    template <class K>
+    typename BST <T, C, A> ::BNode* BST<T, C, A> ::findNode(const K& k) const
     {
+        BNode* pCandidate = nullptr;
         BNode* current = root;
         while (current)
         {
-            if (current->data == t)
-                return iterator(current);
-            else if (t < current->data)
+            if (less(k, current->data))
                 current = current->pLeft;
             else
+            {
+                pCandidate = current;
                 current = current->pRight;
+            }
         }
-        return end();
+
+        if (pCandidate && !less(pCandidate->data, k))
+            return pCandidate;
+        return nullptr;
     }
 
+    // every time we go left the node we left from is the best answer so far
+    template <typename T, typename C, typename A>
+    template <class K>
+    typename BST <T, C, A> ::BNode* BST<T, C, A> ::lowerNode(const K& k) const
+    {
+        BNode* pCandidate = nullptr;
+        BNode* current = root;
+        while (current)
+        {
+            if (less(current->data, k))
+                current = current->pRight;
+            else
+            {
+                pCandidate = current;
+                current = current->pLeft;
+            }
+        }
+        return pCandidate;
+    }
 
-    // the BNode class functions implementations moving the node to the left or right of the parent node
-    template <typename T>
-    void BST <T> ::BNode::addLeft(BNode* pNode)
+    // same as lowerNode but equal elements send us right
+    template <typename T, typename C, typename A>
+    template <class K>
+    typename BST <T, C, A> ::BNode* BST<T, C, A> ::upperNode(const K& k) const
     {
-        if (pNode)
-            pNode->pParent = this;
-        this->pLeft = pNode;
+        BNode* pCandidate = nullptr;
+        BNode* current = root;
+        while (current)
+        {
+            if (less(k, current->data))
+            {
+                pCandidate = current;
+                current = current->pLeft;
+            }
+            else
+                current = current->pRight;
+        }
+        return pCandidate;
     }
 
-    template <typename T>
-    void BST <T> ::BNode::addRight(BNode* pNode)
+
+    // every time we go right, the node and everything on its left are less than k
+    template <typename T, typename C, typename A>
+    template <class K>
+    size_t BST<T, C, A>::rank(const K& k) const
     {
-        if (pNode)
-            pNode->pParent = this;
-        this->pRight = pNode;
+        size_t numLess = 0;
+        for (BNode* current = root; current; )
+        {
+            if (less(current->data, k))
+            {
+                numLess += sizeOf(current->pLeft) + 1;
+                current = current->pRight;
+            }
+            else
+                current = current->pLeft;
+        }
+        return numLess;
     }
 
-    template <typename T>
-    void BST<T> ::BNode::addLeft(const T& t)
+    // the left subtree's size says whether the i-th is on the left, right here, or on the right
+    template <typename T, typename C, typename A>
+    typename BST<T, C, A>::iterator BST<T, C, A>::select(size_t i) const
     {
-        BNode* newNode = new BNode(t);
-        addLeft(newNode);
+        BNode* current = root;
+        while (current)
+        {
+            size_t numLeft = sizeOf(current->pLeft);
+            if (i < numLeft)
+                current = current->pLeft;
+            else if (i == numLeft)
+                break;
+            else
+            {
+                i -= numLeft + 1;
+                current = current->pRight;
+            }
+        }
+        return iterator(current, this);
     }
 
-    template <typename T>
-    void BST<T> ::BNode::addLeft(T&& t)
+    // rank without comparisons: everything on our left, plus every ancestor we are right of
+    // and everything on its left
+    template <typename T, typename C, typename A>
+    size_t BST<T, C, A>::indexOf(const BNode* pNode) const
     {
-        BNode* newNode = new BNode(t);
-        addLeft(newNode);
+        if (!pNode)
+            return numElements;
+
+        size_t index = sizeOf(pNode->pLeft);
+        for (; pNode->pParent; pNode = pNode->pParent)
+            if (pNode->isRightChild())
+                index += sizeOf(pNode->pParent->pLeft) + 1;
+        return index;
     }
 
-    template <typename T>
-    void BST <T> ::BNode::addRight(const T& t)
+    // the BNode class functions implementations moving the node to the left or right of the parent node
+    template <typename T, typename C, typename A>
+    void BST <T, C, A> ::BNode::addLeft(BNode* pNode)
     {
-        BNode* newNode = new BNode(t);
-        addRight(newNode);
+        if (pNode)
+            pNode->pParent = this;
+        this->pLeft = pNode;
     }
 
-    template <typename T>
-    void BST <T> ::BNode::addRight(T&& t)
+    template <typename T, typename C, typename A>
+    void BST <T, C, A> ::BNode::addRight(BNode* pNode)
     {
-        BNode* newNode = new BNode(t);
-        addRight(newNode);
+        if (pNode)
+            pNode->pParent = this;
+        this->pRight = pNode;
     }
 
     // the iterator prefix increment operator, this will move the iterator to the next node in the tree
-    template <typename T>
-    typename BST <T> ::iterator& BST <T> ::iterator :: operator ++ ()
+    template <typename T, typename C, typename A>
+    typename BST <T, C, A> ::iterator& BST <T, C, A> ::iterator :: operator ++ ()
     {
         if (!pNode)
             return *this;
@@ -565,11 +1539,25 @@ namespace custom
         return *this;
     }
 
-    template <typename T>
-    typename BST <T> ::iterator& BST <T> ::iterator :: operator -- ()
+    template <typename T, typename C, typename A>
+    typename BST <T, C, A> ::iterator& BST <T, C, A> ::iterator :: operator += (std::ptrdiff_t n)
     {
+        assert(pTree);
+        std::ptrdiff_t index = (std::ptrdiff_t)pTree->indexOf(pNode) + n;
+        pNode = (index < 0) ? nullptr : pTree->select((size_t)index).pNode;
+        return *this;
+    }
+
+    template <typename T, typename C, typename A>
+    typename BST <T, C, A> ::iterator& BST <T, C, A> ::iterator :: operator -- ()
+    {
+        // one step back from the end is the biggest, which the tree keeps handy
         if (!pNode)
+        {
+            if (pTree)
+                pNode = pTree->rightmost();
             return *this;
+        }
         if (pNode->pLeft)
         {
             pNode = pNode->pLeft;
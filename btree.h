@@ -0,0 +1,1164 @@
+/***********************************************************************
+ * Header:
+ *    B-Tree
+ * Summary:
+ *    A red-black tree spends three pointers, a color, and a size on
+ *    every element, and every step down the tree is a trip to some new
+ *    place in memory. A B-tree packs a few dozen elements side by side
+ *    into each node, so a node is a handful of cache lines that get
+ *    searched all at once and the tree is only a few levels deep. For
+ *    small elements like int64_t that is far fewer cache misses per
+ *    lookup and a fraction of the memory.
+ *
+ *    Ask for it through set: custom::set<T, C, custom::btree_tag>.
+ *    It has the same interface, with two differences:
+ *      - there are no node handles or rank/select, there are no
+ *        per-element nodes to hand out or subtree sizes to count
+ *      - elements move from node to node as the tree grows and
+ *        shrinks, so insert and erase make other iterators stale,
+ *        just like flat_set. Use the iterator erase hands back
+ *
+ *    This will contain the class definition of:
+ *        BTree               : A B-tree that keeps its elements in order
+ *        BTree::iterator     : An iterator through BTree
+ *        set<T, C, btree_alloc<A>>: A set backed by a BTree
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>     // for std::ptrdiff_t
+#include <new>         // for std::launder
+#include <memory>      // for std::allocator_traits
+#include <functional>  // for std::less
+#include <iterator>    // for std::bidirectional_iterator_tag
+#include <optional>    // to hold on to an erased element
+#include <utility>     // for std::pair
+#include <vector>      // to collect the result of the set algebra
+#include <algorithm>   // for std::set_union and friends
+#include "set.h"       // for the set we specialize and sorted_unique
+#include "simd.h"      // to search a node of plain numbers a vector at a time
+
+class TestBTree;      // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * BTREE TAG
+ * Put this where the allocator goes to get a set backed
+ * by a B-tree: custom::set<T, C, custom::btree_tag>.
+ * To pick where the nodes come from, wrap the allocator:
+ * custom::set<T, C, custom::btree_alloc<A>>
+ ***********************************************/
+template <class A>
+struct btree_alloc {};
+using btree_tag = btree_alloc<std::allocator<void>>;
+
+/************************************************
+ * BTREE
+ * A B-tree that keeps its elements in order
+ * Every node but the root holds between MIN_KEYS and
+ * MAX_KEYS elements and all the leaves are the same depth
+ ***********************************************/
+template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
+class BTree : private CompareBase<C>
+{
+   friend class ::TestBTree; // give unit tests access to the privates
+public:
+   class iterator;
+
+   // plain numbers in their plain order can have a whole node searched at once
+   static constexpr bool SIMD_SEARCH = simd::isSearchable<T> &&
+      (std::is_same<C, std::less<T>>::value || std::is_same<C, std::less<>>::value);
+
+   // A node is four cache lines of elements, plus the bookkeeping up front.
+   // Three is the fewest that still lets a full node split into two legal ones,
+   // and a node searched with vectors holds a whole number of them
+   static constexpr size_t NODE_BYTES = 256;
+   static constexpr int FIT_KEYS = (NODE_BYTES - 2 * sizeof(void*)) / sizeof(T) < 3 ? 3 :
+                                   (int)((NODE_BYTES - 2 * sizeof(void*)) / sizeof(T));
+   static constexpr int MAX_KEYS = SIMD_SEARCH ? FIT_KEYS / simd::width<T> * simd::width<T> : FIT_KEYS;
+   static constexpr int MIN_KEYS = (MAX_KEYS - 1) / 2;
+
+   //
+   // Construct
+   //
+   BTree(const C & comp = C(), const A & a = A()) : CompareBase<C>(comp), root(nullptr), numElements(0), alloc(a)
+   {
+   }
+   BTree(const BTree & rhs) : CompareBase<C>(rhs.comp()), root(nullptr), numElements(0),
+      alloc(std::allocator_traits<A>::select_on_container_copy_construction(rhs.alloc))
+   {
+      *this = rhs;
+   }
+   BTree(BTree && rhs) : CompareBase<C>(rhs.comp()), root(rhs.root), numElements(rhs.numElements),
+      alloc(std::move(rhs.alloc))
+   {
+      rhs.root = nullptr;
+      rhs.numElements = 0;
+   }
+  ~BTree()
+   {
+      clear();
+   }
+
+   //
+   // Assign
+   //
+   BTree & operator = (const BTree & rhs)
+   {
+      if (this == &rhs)
+         return *this;
+      clear();
+      this->comp() = rhs.comp();
+      if (rhs.root)
+         root = copyTree(rhs.root, nullptr);
+      numElements = rhs.numElements;
+      return *this;
+   }
+   BTree & operator = (BTree && rhs)
+   {
+      clear();
+      swap(rhs);
+      return *this;
+   }
+   void swap(BTree & rhs)
+   {
+      std::swap(this->comp(), rhs.comp());
+      std::swap(root, rhs.root);
+      std::swap(numElements, rhs.numElements);
+      std::swap(alloc, rhs.alloc);
+   }
+
+   //
+   // Iterator
+   //
+   iterator begin() const noexcept
+   {
+      if (!root)
+         return end();
+      Node* p = root;
+      while (!p->isLeaf)
+         p = child(p, 0);
+      return iterator(p, 0, this);
+   }
+   iterator end() const noexcept
+   {
+      return iterator(nullptr, 0, this);
+   }
+
+   //
+   // Access
+   //
+
+   // an element in an inner node is found on the way down, no need to go all the way
+   template <class K>
+   iterator find(const K & k) const
+   {
+      Node* p = root;
+      while (p)
+      {
+         int i = lowerIndex(p, k);
+         if (i < p->count && !less(k, p->key(i)))
+            return iterator(p, i, this);
+         p = p->isLeaf ? nullptr : child(p, i);
+      }
+      return end();
+   }
+
+   // the answer is the last element we turned left in front of, like the BST
+   template <class K>
+   iterator lower_bound(const K & k) const
+   {
+      return lowerFrom(root, k);
+   }
+
+   // Finger search: lower_bound, but start at itFrom instead of the root. Everything
+   // before itFrom must be less than k. Climb until a node's biggest element is not
+   // less than k, and the answer is under that node, so a sorted run of keys costs
+   // the log of how far we move each time rather than the log of the size
+   template <class K>
+   iterator lower_bound(iterator itFrom, const K & k) const
+   {
+      Node* p = itFrom.pNode;
+      if (!p)
+         return end();
+      while (p->pParent && less(p->key(p->count - 1), k))
+         p = p->pParent;
+      return lowerFrom(p, k);
+   }
+   template <class K>
+   iterator upper_bound(const K & k) const
+   {
+      iterator itCandidate = end();
+      Node* p = root;
+      while (p)
+      {
+         int i = upperIndex(p, k);
+         if (i < p->count)
+            itCandidate = iterator(p, i, this);
+         p = p->isLeaf ? nullptr : child(p, i);
+      }
+      return itCandidate;
+   }
+
+   //
+   // Insert
+   //
+
+   // one trip down to find the leaf, and an element already here stops us early
+   template <class U>
+   std::pair<iterator, bool> insert(U && t)
+   {
+      if (!root)
+         return std::make_pair(insertLeaf(nullptr, 0, std::forward<U>(t)), true);
+
+      Node* p = root;
+      while (true)
+      {
+         int i = lowerIndex(p, t);
+         if (i < p->count && !less(t, p->key(i)))
+            return std::make_pair(iterator(p, i, this), false);
+         if (p->isLeaf)
+            return std::make_pair(insertLeaf(p, i, std::forward<U>(t)), true);
+         p = child(p, i);
+      }
+   }
+
+   // t fits in front of itHint if it is smaller than the hint and bigger than the one before it
+   template <class U>
+   std::pair<iterator, bool> insertHint(iterator itHint, U && t)
+   {
+      if (itHint == end() || less(t, *itHint))
+      {
+         iterator itPrev = itHint;
+         if (itHint == begin() || less(*--itPrev, t))
+            return std::make_pair(insertBefore(itHint, std::forward<U>(t)), true);
+      }
+      return insert(std::forward<U>(t));
+   }
+
+   // Put t in right in front of it, no questions asked. New elements always go
+   // in a leaf, so in front of an inner element means after the biggest thing
+   // in the subtree to its left
+   template <class U>
+   iterator insertBefore(iterator it, U && t)
+   {
+      if (!root)
+         return insertLeaf(nullptr, 0, std::forward<U>(t));
+      if (!it.pNode)
+      {
+         Node* p = rightmost(root);
+         return insertLeaf(p, p->count, std::forward<U>(t));
+      }
+      if (it.pNode->isLeaf)
+         return insertLeaf(it.pNode, it.position, std::forward<U>(t));
+      Node* p = rightmost(child(it.pNode, it.position));
+      return insertLeaf(p, p->count, std::forward<U>(t));
+   }
+
+   //
+   // Remove
+   //
+   void clear() noexcept
+   {
+      if (root)
+         destroyTree(root);
+      root = nullptr;
+      numElements = 0;
+   }
+
+   // Take out the element at it and hand back the one after it. Most of the time
+   // that is sitting right there. When the leaf ran low and had to borrow or
+   // merge, elements have moved, so we look the next one up again
+   iterator erase(iterator it)
+   {
+      Node* p = it.pNode;
+      int i = it.position;
+      assert(p != nullptr);
+
+      // an inner element trades places with the one just before it, which is always in a leaf
+      Node* pInner = nullptr;
+      int iInner = 0;
+      if (!p->isLeaf)
+      {
+         pInner = p;
+         iInner = i;
+         p = rightmost(child(p, i));
+         i = p->count - 1;
+         using std::swap;
+         swap(pInner->key(iInner), p->key(i));
+      }
+
+      bool isShort = p != root && p->count - 1 < MIN_KEYS;
+      std::optional<T> doomed;
+      if (isShort)
+         doomed.emplace(std::move(p->key(i)));
+      removeKey(p, i);
+      numElements--;
+
+      if (isShort)
+      {
+         rebalance(p);
+         return upper_bound(*doomed);
+      }
+      if (p->count == 0)
+      {
+         // that was the last one in the whole tree
+         destroyNode(root);
+         root = nullptr;
+         return end();
+      }
+      if (pInner)
+         return ++iterator(pInner, iInner, this);
+      if (i < p->count)
+         return iterator(p, i, this);
+      return ++iterator(p, i - 1, this);
+   }
+
+   // Erasing moves elements around under itEnd, so count how many to go first
+   iterator erase(iterator itBegin, iterator itEnd)
+   {
+      if (itBegin == begin() && itEnd == end())
+      {
+         clear();
+         return end();
+      }
+      for (auto n = std::distance(itBegin, itEnd); n > 0; n--)
+         itBegin = erase(itBegin);
+      return itBegin;
+   }
+
+   //
+   // Status
+   //
+   bool   empty() const noexcept { return numElements == 0; }
+   size_t size()  const noexcept { return numElements;      }
+   const C & key_comp() const { return this->comp(); }
+   A get_allocator() const { return alloc; }
+
+   // every rule a B-tree has to follow, for the unit tests
+   bool validate() const
+   {
+      if (!root)
+         return numElements == 0;
+      int leafDepth = -1;
+      size_t count = 0;
+      return root->pParent == nullptr &&
+             validateNode(root, 0, leafDepth, nullptr, nullptr, count) &&
+             count == numElements;
+   }
+
+#ifdef DEBUG
+public:
+#else
+private:
+#endif
+
+   /************************************************
+    * NODE
+    * A leaf: up to MAX_KEYS elements in order. The room for
+    * them is raw bytes so that only the ones in use are alive
+    ***********************************************/
+   struct Node
+   {
+      Node(bool isLeaf) : pParent(nullptr), position(0), count(0), isLeaf(isLeaf) {}
+
+      T* slot(int i) { return reinterpret_cast<T*>(storage) + i; }
+      T & key(int i) { return *std::launder(slot(i)); }
+      const T & key(int i) const { return *std::launder(reinterpret_cast<const T*>(storage) + i); }
+
+      Node* pParent;
+      unsigned short position;   // which of pParent's children we are
+      unsigned short count;      // how many elements are alive
+      bool isLeaf;
+      alignas(T) unsigned char storage[MAX_KEYS * sizeof(T)];
+   };
+
+   /************************************************
+    * INNER
+    * A node with children: child i holds everything between
+    * element i-1 and element i. Leaves do not pay for these
+    ***********************************************/
+   struct Inner : public Node
+   {
+      Inner() : Node(false) {}
+      Node* children[MAX_KEYS + 1];
+   };
+
+   using ElementTraits = std::allocator_traits<A>;
+   using LeafAlloc     = typename ElementTraits::template rebind_alloc<Node>;
+   using LeafTraits    = std::allocator_traits<LeafAlloc>;
+   using InnerAlloc    = typename ElementTraits::template rebind_alloc<Inner>;
+   using InnerTraits   = std::allocator_traits<InnerAlloc>;
+
+   template <class L, class R>
+   bool less(const L & lhs, const R & rhs) const { return this->comp()(lhs, rhs); }
+
+   static Node* child(const Node* p, int i)
+   {
+      return static_cast<const Inner*>(p)->children[i];
+   }
+   static void adopt(Node* pParent, int i, Node* pChild)
+   {
+      static_cast<Inner*>(pParent)->children[i] = pChild;
+      pChild->pParent = pParent;
+      pChild->position = (unsigned short)i;
+   }
+   static Node* rightmost(Node* p)
+   {
+      while (!p->isLeaf)
+         p = child(p, p->count);
+      return p;
+   }
+
+   // Binary search with no branch to guess wrong on, the same as flat_set.
+   // Answers how many elements in p are less than k. A node of plain numbers
+   // is counted with vector compares instead, which has no branches either
+   template <class K>
+   int lowerIndex(const Node* p, const K & k) const
+   {
+      int n = p->count;
+      if (n == 0)
+         return 0;
+      if constexpr (SIMD_SEARCH && std::is_same<K, T>::value)
+         return simd::countLess<MAX_KEYS>(reinterpret_cast<const T*>(p->storage), n, k);
+      const T* pBase = &p->key(0);
+      while (n > 1)
+      {
+         int half = n / 2;
+         pBase = less(pBase[half], k) ? pBase + half : pBase;
+         n -= half;
+      }
+      return (int)(pBase - &p->key(0)) + less(*pBase, k);
+   }
+
+   // the descent behind both lower_bounds, from p down to a leaf
+   template <class K>
+   iterator lowerFrom(Node* p, const K & k) const
+   {
+      iterator itCandidate = end();
+      while (p)
+      {
+         int i = lowerIndex(p, k);
+         if (i < p->count)
+            itCandidate = iterator(p, i, this);
+         p = p->isLeaf ? nullptr : child(p, i);
+      }
+      return itCandidate;
+   }
+
+   // same, but equal elements send us up
+   template <class K>
+   int upperIndex(const Node* p, const K & k) const
+   {
+      int n = p->count;
+      if (n == 0)
+         return 0;
+      if constexpr (SIMD_SEARCH && std::is_same<K, T>::value)
+         return simd::countLessEqual<MAX_KEYS>(reinterpret_cast<const T*>(p->storage), n, k);
+      const T* pBase = &p->key(0);
+      while (n > 1)
+      {
+         int half = n / 2;
+         pBase = !less(k, pBase[half]) ? pBase + half : pBase;
+         n -= half;
+      }
+      return (int)(pBase - &p->key(0)) + !less(k, *pBase);
+   }
+
+   //
+   // Nodes and the elements in them
+   //
+   Node* createLeaf()
+   {
+      LeafAlloc a(alloc);
+      Node* p = LeafTraits::allocate(a, 1);
+      LeafTraits::construct(a, p, true);
+      return p;
+   }
+   Node* createInner()
+   {
+      InnerAlloc a(alloc);
+      Inner* p = InnerTraits::allocate(a, 1);
+      InnerTraits::construct(a, p);
+      return p;
+   }
+   // the elements had better be gone already
+   void destroyNode(Node* p)
+   {
+      if (p->isLeaf)
+      {
+         LeafAlloc a(alloc);
+         LeafTraits::destroy(a, p);
+         LeafTraits::deallocate(a, p, 1);
+      }
+      else
+      {
+         InnerAlloc a(alloc);
+         Inner* pInner = static_cast<Inner*>(p);
+         InnerTraits::destroy(a, pInner);
+         InnerTraits::deallocate(a, pInner, 1);
+      }
+   }
+   template <class... Args>
+   void constructKey(Node* p, int i, Args&&... args)
+   {
+      ElementTraits::construct(alloc, p->slot(i), std::forward<Args>(args)...);
+   }
+   void destroyKey(Node* p, int i)
+   {
+      ElementTraits::destroy(alloc, &p->key(i));
+   }
+   // move one element into an empty slot and leave the slot it came from empty
+   void moveKey(Node* pTo, int iTo, Node* pFrom, int iFrom)
+   {
+      constructKey(pTo, iTo, std::move(pFrom->key(iFrom)));
+      destroyKey(pFrom, iFrom);
+   }
+   // take element i out of p and slide the rest down over it
+   void removeKey(Node* p, int i)
+   {
+      destroyKey(p, i);
+      for (int j = i + 1; j < p->count; j++)
+         moveKey(p, j - 1, p, j);
+      p->count--;
+   }
+
+   // Put t at spot i of leaf p, splitting p first if it is full.
+   // No leaf at all means the tree is empty and t is the first
+   template <class U>
+   iterator insertLeaf(Node* p, int i, U && t)
+   {
+      if (!p)
+      {
+         root = p = createLeaf();
+         i = 0;
+      }
+      else if (p->count == MAX_KEYS)
+      {
+         Node* pRight = split(p);
+         if (i > p->count)
+         {
+            i -= p->count + 1;
+            p = pRight;
+         }
+      }
+
+      for (int j = p->count; j > i; j--)
+         moveKey(p, j, p, j - 1);
+      try
+      {
+         constructKey(p, i, std::forward<U>(t));
+      }
+      catch (...)
+      {
+         // put everything back the way it was
+         for (int j = i; j < p->count; j++)
+            moveKey(p, j, p, j + 1);
+         if (p->count == 0)
+         {
+            destroyNode(p);
+            root = nullptr;
+         }
+         throw;
+      }
+      p->count++;
+      numElements++;
+      return iterator(p, i, this);
+   }
+
+   // Split a full node in two and send the middle element up to the parent,
+   // splitting the parent first if there is no room up there either. That is
+   // the only way a B-tree gets taller: a new root on top. Hands back the new
+   // node on the right
+   Node* split(Node* p)
+   {
+      assert(p->count == MAX_KEYS);
+      if (p->pParent && p->pParent->count == MAX_KEYS)
+         split(p->pParent);   // this may give p a new parent
+
+      Node* pRight = p->isLeaf ? createLeaf() : createInner();
+      if (!p->pParent)
+      {
+         Node* pRoot;
+         try
+         {
+            pRoot = createInner();
+         }
+         catch (...)
+         {
+            destroyNode(pRight);
+            throw;
+         }
+         adopt(pRoot, 0, p);
+         root = pRoot;
+      }
+      Node* pParent = p->pParent;
+
+      // the top half goes to the new node
+      const int mid = MAX_KEYS / 2;
+      for (int j = mid + 1; j < MAX_KEYS; j++)
+         moveKey(pRight, j - mid - 1, p, j);
+      if (!p->isLeaf)
+         for (int j = mid + 1; j <= MAX_KEYS; j++)
+            adopt(pRight, j - mid - 1, child(p, j));
+      pRight->count = MAX_KEYS - mid - 1;
+
+      // and the middle one goes up between the two halves
+      int pos = p->position;
+      for (int j = pParent->count; j > pos; j--)
+         moveKey(pParent, j, pParent, j - 1);
+      for (int j = pParent->count + 1; j > pos + 1; j--)
+         adopt(pParent, j, child(pParent, j - 1));
+      moveKey(pParent, pos, p, mid);
+      adopt(pParent, pos + 1, pRight);
+      pParent->count++;
+      p->count = mid;
+      return pRight;
+   }
+
+   // p is not the root and has fallen below MIN_KEYS. Borrow from a sibling
+   // through the parent if one can spare it, otherwise merge with one
+   void rebalance(Node* p)
+   {
+      Node* pParent = p->pParent;
+      int pos = p->position;
+      Node* pLeft  = pos > 0 ? child(pParent, pos - 1) : nullptr;
+      Node* pRight = pos < pParent->count ? child(pParent, pos + 1) : nullptr;
+
+      if (pLeft && pLeft->count > MIN_KEYS)
+      {
+         // the parent's element comes down to our front, the left sibling's last goes up
+         for (int j = p->count; j > 0; j--)
+            moveKey(p, j, p, j - 1);
+         moveKey(p, 0, pParent, pos - 1);
+         moveKey(pParent, pos - 1, pLeft, pLeft->count - 1);
+         if (!p->isLeaf)
+         {
+            for (int j = p->count + 1; j > 0; j--)
+               adopt(p, j, child(p, j - 1));
+            adopt(p, 0, child(pLeft, pLeft->count));
+         }
+         p->count++;
+         pLeft->count--;
+      }
+      else if (pRight && pRight->count > MIN_KEYS)
+      {
+         // the parent's element comes down to our back, the right sibling's first goes up
+         moveKey(p, p->count, pParent, pos);
+         moveKey(pParent, pos, pRight, 0);
+         for (int j = 1; j < pRight->count; j++)
+            moveKey(pRight, j - 1, pRight, j);
+         if (!p->isLeaf)
+         {
+            adopt(p, p->count + 1, child(pRight, 0));
+            for (int j = 1; j <= pRight->count; j++)
+               adopt(pRight, j - 1, child(pRight, j));
+         }
+         p->count++;
+         pRight->count--;
+      }
+      else
+         merge(pLeft ? pLeft : p);
+   }
+
+   // Fold the right sibling of pLeft, and the parent's element between them,
+   // into pLeft. The parent loses one, which may leave it short too
+   void merge(Node* pLeft)
+   {
+      Node* pParent = pLeft->pParent;
+      int pos = pLeft->position;
+      Node* pRight = child(pParent, pos + 1);
+      int n = pLeft->count;
+
+      moveKey(pLeft, n, pParent, pos);
+      for (int j = 0; j < pRight->count; j++)
+         moveKey(pLeft, n + 1 + j, pRight, j);
+      if (!pLeft->isLeaf)
+         for (int j = 0; j <= pRight->count; j++)
+            adopt(pLeft, n + 1 + j, child(pRight, j));
+      pLeft->count = (unsigned short)(n + 1 + pRight->count);
+      destroyNode(pRight);
+
+      // close the gap in the parent
+      for (int j = pos + 1; j < pParent->count; j++)
+         moveKey(pParent, j - 1, pParent, j);
+      for (int j = pos + 2; j <= pParent->count; j++)
+         adopt(pParent, j - 1, child(pParent, j));
+      pParent->count--;
+
+      if (pParent == root)
+      {
+         // an empty root steps aside, that is the only way a B-tree gets shorter
+         if (pParent->count == 0)
+         {
+            root = pLeft;
+            pLeft->pParent = nullptr;
+            pLeft->position = 0;
+            destroyNode(pParent);
+         }
+      }
+      else if (pParent->count < MIN_KEYS)
+         rebalance(pParent);
+   }
+
+   // every element and every node from p on down
+   void destroyTree(Node* p)
+   {
+      for (int i = 0; i < p->count; i++)
+         destroyKey(p, i);
+      if (!p->isLeaf)
+         for (int i = 0; i <= p->count; i++)
+            destroyTree(child(p, i));
+      destroyNode(p);
+   }
+
+   // the same shape as pSrc, so no comparisons. If a copy throws, what we built so far goes away
+   Node* copyTree(const Node* pSrc, Node* pParent)
+   {
+      Node* p = pSrc->isLeaf ? createLeaf() : createInner();
+      p->pParent = pParent;
+      p->position = pSrc->position;
+      int numChildren = 0;
+      try
+      {
+         for (; p->count < pSrc->count; p->count++)
+            constructKey(p, p->count, pSrc->key(p->count));
+         if (!p->isLeaf)
+            for (; numChildren <= pSrc->count; numChildren++)
+               adopt(p, numChildren, copyTree(child(pSrc, numChildren), p));
+      }
+      catch (...)
+      {
+         for (int i = 0; i < numChildren; i++)
+            destroyTree(child(p, i));
+         for (int i = 0; i < p->count; i++)
+            destroyKey(p, i);
+         destroyNode(p);
+         throw;
+      }
+      return p;
+   }
+
+   // in order, between pLo and pHi, the right size, and the leaves all at the same depth
+   bool validateNode(const Node* p, int depth, int & leafDepth, const T* pLo, const T* pHi, size_t & count) const
+   {
+      if (p->count > MAX_KEYS || (p != root && p->count < MIN_KEYS) || p->count == 0)
+         return false;
+      for (int i = 0; i < p->count; i++)
+      {
+         if (i > 0 && !less(p->key(i - 1), p->key(i)))
+            return false;
+         if ((pLo && !less(*pLo, p->key(i))) || (pHi && !less(p->key(i), *pHi)))
+            return false;
+      }
+      count += p->count;
+
+      if (p->isLeaf)
+      {
+         if (leafDepth == -1)
+            leafDepth = depth;
+         return leafDepth == depth;
+      }
+      for (int i = 0; i <= p->count; i++)
+      {
+         const Node* pChild = child(p, i);
+         if (pChild->pParent != p || pChild->position != i)
+            return false;
+         if (!validateNode(pChild, depth + 1, leafDepth,
+                           i == 0 ? pLo : &p->key(i - 1), i == p->count ? pHi : &p->key(i), count))
+            return false;
+      }
+      return true;
+   }
+
+   Node*  root;          // null when there is nothing in the tree
+   size_t numElements;
+   A      alloc;         // rebound to make the nodes
+};
+
+/**************************************************
+ * BTREE ITERATOR
+ * A leaf or inner node and which element in it.
+ * The end is no node at all
+ *************************************************/
+template <typename T, typename C, typename A>
+class BTree <T, C, A> :: iterator
+{
+   friend class ::TestBTree; // give unit tests access to the privates
+   friend class BTree<T, C, A>;
+public:
+   using iterator_category = std::bidirectional_iterator_tag;
+   using value_type        = T;
+   using difference_type   = std::ptrdiff_t;
+   using pointer           = const T*;
+   using reference         = const T&;
+
+   // constructors and assignment
+   iterator() : pNode(nullptr), position(0), pTree(nullptr)
+   {
+   }
+   iterator(Node* pNode, int position, const BTree* pTree) : pNode(pNode), position(position), pTree(pTree)
+   {
+   }
+
+   // equals, not equals operator
+   bool operator == (const iterator & rhs) const { return pNode == rhs.pNode && position == rhs.position; }
+   bool operator != (const iterator & rhs) const { return !(*this == rhs); }
+
+   // dereference operator
+   const T & operator * () const { return pNode->key(position); }
+   const T * operator -> () const { return &pNode->key(position); }
+
+   // Next is the smallest thing in the child to our right if there is one.
+   // Otherwise it is the next one in this leaf, or the first one above us
+   // that we came up to from the left
+   iterator & operator ++ ()
+   {
+      if (!pNode->isLeaf)
+      {
+         pNode = BTree::child(pNode, position + 1);
+         while (!pNode->isLeaf)
+            pNode = BTree::child(pNode, 0);
+         position = 0;
+         return *this;
+      }
+      if (++position < pNode->count)
+         return *this;
+      while (pNode->pParent)
+      {
+         position = pNode->position;
+         pNode = pNode->pParent;
+         if (position < pNode->count)
+            return *this;
+      }
+      pNode = nullptr;
+      position = 0;
+      return *this;
+   }
+   iterator operator ++ (int)
+   {
+      iterator tmp(*this);
+      ++(*this);
+      return tmp;
+   }
+
+   // the mirror image of ++, and backing up from the end lands on the biggest one
+   iterator & operator -- ()
+   {
+      if (!pNode)
+      {
+         if (pTree && pTree->root)
+         {
+            pNode = BTree::rightmost(pTree->root);
+            position = pNode->count - 1;
+         }
+         return *this;
+      }
+      if (!pNode->isLeaf)
+      {
+         pNode = BTree::rightmost(BTree::child(pNode, position));
+         position = pNode->count - 1;
+         return *this;
+      }
+      if (position > 0)
+      {
+         --position;
+         return *this;
+      }
+      while (pNode->pParent)
+      {
+         position = pNode->position;
+         pNode = pNode->pParent;
+         if (position > 0)
+         {
+            --position;
+            return *this;
+         }
+      }
+      pNode = nullptr;
+      position = 0;
+      return *this;
+   }
+   iterator operator -- (int)
+   {
+      iterator tmp(*this);
+      --(*this);
+      return tmp;
+   }
+
+private:
+   Node* pNode;          // null at the end
+   int position;         // which element in pNode
+   const BTree* pTree;   // so the end knows how to back up
+};
+
+/************************************************
+ * SET with a BTREE
+ * The same set, backed by a B-tree. The tag sits
+ * where the allocator goes, so the allocator it
+ * carries is rebound to T
+ ***********************************************/
+template <typename T, typename C, typename A>
+class set <T, C, btree_alloc<A>>
+{
+   friend class ::TestBTree; // give unit tests access to the privates
+public:
+   using value_type       = T;
+   using key_type         = T;
+   using allocator_type   = typename std::allocator_traits<A>::template rebind_alloc<T>;
+   using key_compare      = C;
+   using value_compare    = C;
+   using iterator         = typename BTree<T, C, allocator_type>::iterator;
+   using const_iterator   = iterator;
+   using reverse_iterator = std::reverse_iterator<iterator>;
+
+   //
+   // Construct
+   //
+   set()
+   {
+   }
+   explicit set(const allocator_type & a) : btree(C(), a)
+   {
+   }
+   explicit set(const C & comp, const allocator_type & a = allocator_type()) : btree(comp, a)
+   {
+   }
+   set(const set & rhs) : btree(rhs.btree)
+   {
+   }
+   set(set && rhs) : btree(std::move(rhs.btree))
+   {
+   }
+   set(const std::initializer_list <T> & il, const C & comp = C(), const allocator_type & a = allocator_type())
+      : btree(comp, a)
+   {
+      insert(il);
+   }
+   template <class Iterator>
+   set(Iterator first, Iterator last, const C & comp = C(), const allocator_type & a = allocator_type())
+      : btree(comp, a)
+   {
+      insert(first, last);
+   }
+   template <class Iterator>
+   set(sorted_unique_t, Iterator first, Iterator last, const C & comp = C(),
+       const allocator_type & a = allocator_type()) : btree(comp, a)
+   {
+      // take their word for it, each one goes on the end with no comparisons
+      for (auto it = first; it != last; ++it)
+         btree.insertBefore(btree.end(), *it);
+   }
+   template <class Iterator>
+   static set from_sorted(Iterator first, Iterator last, const C & comp = C(), const allocator_type & a = allocator_type())
+   {
+      return set(sorted_unique, first, last, comp, a);
+   }
+
+   //
+   // Assign
+   //
+   set & operator = (const set & rhs)
+   {
+      btree = rhs.btree;
+      return *this;
+   }
+   set & operator = (set && rhs)
+   {
+      btree = std::move(rhs.btree);
+      return *this;
+   }
+   set & operator = (const std::initializer_list <T> & il)
+   {
+      clear();
+      insert(il);
+      return *this;
+   }
+   void swap(set & rhs) noexcept
+   {
+      btree.swap(rhs.btree);
+   }
+
+   //
+   // Iterator
+   //
+   iterator begin() const noexcept { return btree.begin(); }
+   iterator end()   const noexcept { return btree.end();   }
+   reverse_iterator rbegin() const noexcept { return reverse_iterator(end());   }
+   reverse_iterator rend()   const noexcept { return reverse_iterator(begin()); }
+
+   //
+   // Access
+   //
+   iterator find(const T & t) const
+   {
+      return btree.find(t);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator find(const K & k) const
+   {
+      return btree.find(k);
+   }
+   size_t count(const T & t) const
+   {
+      return find(t) == end() ? 0 : 1;
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   size_t count(const K & k) const
+   {
+      return find(k) == end() ? 0 : 1;
+   }
+
+   iterator lower_bound(const T & t) const { return btree.lower_bound(t); }
+   iterator upper_bound(const T & t) const { return btree.upper_bound(t); }
+   std::pair<iterator, iterator> equal_range(const T & t) const
+   {
+      return std::make_pair(lower_bound(t), upper_bound(t));
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator lower_bound(const K & k) const { return btree.lower_bound(k); }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator upper_bound(const K & k) const { return btree.upper_bound(k); }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   std::pair<iterator, iterator> equal_range(const K & k) const
+   {
+      return std::make_pair(lower_bound(k), upper_bound(k));
+   }
+
+   // Finger search: lower_bound, but start at itFrom instead of the root. Everything
+   // before itFrom must be less than k
+   template <class K>
+   iterator lower_bound(iterator itFrom, const K & k) const
+   {
+      return btree.lower_bound(itFrom, k);
+   }
+
+   //
+   // Status
+   //
+   bool   empty() const noexcept { return btree.empty(); }
+   size_t size()  const noexcept { return btree.size();  }
+   allocator_type get_allocator() const { return btree.get_allocator(); }
+   key_compare   key_comp()   const { return btree.key_comp(); }
+   value_compare value_comp() const { return btree.key_comp(); }
+
+   //
+   // Insert
+   //
+   std::pair<iterator, bool> insert(const T & t)
+   {
+      return btree.insert(t);
+   }
+   std::pair<iterator, bool> insert(T && t)
+   {
+      return btree.insert(std::move(t));
+   }
+   iterator insert(iterator itHint, const T & t)
+   {
+      return btree.insertHint(itHint, t).first;
+   }
+   iterator insert(iterator itHint, T && t)
+   {
+      return btree.insertHint(itHint, std::move(t)).first;
+   }
+
+   // there is no node to build the element in, so build it here and move it into place
+   template <class... Args>
+   std::pair<iterator, bool> emplace(Args&&... args)
+   {
+      return btree.insert(T(std::forward<Args>(args)...));
+   }
+   template <class... Args>
+   iterator emplace_hint(iterator itHint, Args&&... args)
+   {
+      return btree.insertHint(itHint, T(std::forward<Args>(args)...)).first;
+   }
+
+   void insert(const std::initializer_list <T> & il)
+   {
+      for (auto && t : il)
+         insert(t);
+   }
+   template <class Iterator>
+   void insert(Iterator first, Iterator last)
+   {
+      for (auto it = first; it != last; ++it)
+         insert(*it);
+   }
+
+   //
+   // Remove
+   //
+   void clear() noexcept
+   {
+      btree.clear();
+   }
+   iterator erase(iterator & it)
+   {
+      it = btree.erase(it);
+      return it;
+   }
+   size_t erase(const T & t)
+   {
+      auto it = btree.find(t);
+      if (it == btree.end())
+         return 0;
+      btree.erase(it);
+      return 1;
+   }
+   iterator erase(iterator & itBegin, iterator & itEnd)
+   {
+      return btree.erase(itBegin, itEnd);
+   }
+
+   //
+   // Set algebra
+   //
+
+   // Both sides already walk in order, so each one is a single merge pass
+   // and the result goes back in along the right edge with no comparisons
+   set & set_union(const set & rhs)
+   {
+      return combine(rhs, [](auto first1, auto last1, auto first2, auto last2, auto out, auto comp)
+                          { return std::set_union(first1, last1, first2, last2, out, comp); });
+   }
+   set & set_intersection(const set & rhs)
+   {
+      return combine(rhs, [](auto first1, auto last1, auto first2, auto last2, auto out, auto comp)
+                          { return std::set_intersection(first1, last1, first2, last2, out, comp); });
+   }
+   set & set_difference(const set & rhs)
+   {
+      return combine(rhs, [](auto first1, auto last1, auto first2, auto last2, auto out, auto comp)
+                          { return std::set_difference(first1, last1, first2, last2, out, comp); });
+   }
+   set & set_symmetric_difference(const set & rhs)
+   {
+      return combine(rhs, [](auto first1, auto last1, auto first2, auto last2, auto out, auto comp)
+                          { return std::set_symmetric_difference(first1, last1, first2, last2, out, comp); });
+   }
+
+private:
+   using Tree = BTree<T, C, allocator_type>;
+
+   // merge us and rhs with one of the std set algorithms and keep the result
+   template <class Algorithm>
+   set & combine(const set & rhs, Algorithm algorithm)
+   {
+      std::vector<T> v;
+      v.reserve(size() + rhs.size());
+      algorithm(begin(), end(), rhs.begin(), rhs.end(), std::back_inserter(v), key_comp());
+      *this = set(sorted_unique, std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()),
+                  key_comp(), get_allocator());
+      return *this;
+   }
+
+   Tree btree;
+};
+
+}; // namespace custom
@@ -0,0 +1,584 @@
+/***********************************************************************
+ * Header:
+ *    Concurrent Set
+ * Summary:
+ *    A set many threads can share, where lookups never lock anything
+ *    and go on while somebody else is changing the set.
+ *
+ *    The tree is the same red-black tree as custom::set, except that the
+ *    links down to the children are atomic. The two share their rotating
+ *    and rebalancing, which is in redblack.h. Writers take turns on one
+ *    mutex, so only one of them changes the tree at a time. Readers do
+ *    not take it at all: they walk down the tree while the writer works
+ *    and check afterwards that nothing moved under them.
+ *
+ *    That check is a version number, a seqlock. A writer finds where the
+ *    change goes and builds the new node first, which does not move
+ *    anything. Only then does it make the version odd, relink the nodes
+ *    and rotate, and make it even again. A reader writes down the version
+ *    before it starts, and if it is the same when it is done, no writer
+ *    relinked anything while it was looking, so its answer is right. If
+ *    it changed, the reader looks again. Only relinking ever makes a
+ *    reader start over, and that is a handful of pointers per write.
+ *    After a lot of tries in a row a reader takes the mutex and reads
+ *    with the writers held off, so a stream of writes cannot starve it.
+ *
+ *    A reader may be standing on a node the writer just erased, so
+ *    erased nodes are not freed right away. They go to an epoch domain,
+ *    which frees them once every reader that might have seen them is
+ *    done. Nothing in a node changes while it is in the tree except its
+ *    links, so a reader can compare against any node it reaches.
+ *
+ *    Nothing comes out of here that points into the set. An iterator
+ *    would be left dangling by the next writer, so find hands back a
+ *    copy and a full walk goes through snapshot().
+ *
+ *    This will contain the class definition of:
+ *        concurrent_set      : A set with optimistic, version-checked reads
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t
+#include <memory>      // for std::allocator_traits
+#include <functional>  // for std::less
+#include <optional>    // for find, which may not find anything
+#include <utility>     // for std::in_place
+#include <atomic>      // the links and the version
+#include <mutex>       // for std::mutex, writers take turns
+#include <thread>      // for std::this_thread::yield
+#include "set.h"       // for snapshot, and CompareBase
+#include "epoch.h"     // to know when an erased node can go
+#include "redblack.h"  // the rotating, shared with custom::set
+
+class TestConcurrentSet;  // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * CONCURRENT SET
+ * A red-black tree with atomic links. Writers take turns,
+ * readers go right in and check the version afterwards
+ ***********************************************/
+template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
+class concurrent_set : private CompareBase<C>
+{
+   friend class ::TestConcurrentSet; // give unit tests access to the privates
+   struct Node;
+public:
+   using key_type       = T;
+   using value_type     = T;
+   using size_type      = size_t;
+   using key_compare    = C;
+   using value_compare  = C;
+   using allocator_type = A;
+
+   //
+   // Construct
+   //
+   concurrent_set() : concurrent_set(C())
+   {
+   }
+   explicit concurrent_set(const C & comp, const A & a = A())
+      : CompareBase<C>(comp), alloc(a), version(0), root(nullptr), numElements(0)
+   {
+   }
+   concurrent_set(const std::initializer_list <T> & il, const A & a = A()) : concurrent_set(C(), a)
+   {
+      insert(il);
+   }
+   template <class Iterator>
+   concurrent_set(Iterator first, Iterator last, const A & a = A()) : concurrent_set(C(), a)
+   {
+      insert(first, last);
+   }
+
+   // Start from a set nobody else has hold of yet. Our nodes are not
+   // custom::set's nodes, so the elements come over and the nodes do not
+   explicit concurrent_set(const set<T, C, A> & s) : concurrent_set(s.key_comp(), s.get_allocator())
+   {
+      insert(s.begin(), s.end());
+   }
+   explicit concurrent_set(set<T, C, A> && s) : concurrent_set(s.key_comp(), s.get_allocator())
+   {
+      std::lock_guard<std::mutex> lock(writerLock);
+      while (!s.empty())
+         insertValue(std::move(s.extract(s.begin()).value()));
+   }
+
+   // Other threads may be halfway through a write to either side, so there is
+   // no copying or moving one of these. snapshot() is the copy
+   concurrent_set(const concurrent_set &) = delete;
+   concurrent_set & operator = (const concurrent_set &) = delete;
+
+   // Nobody else is using us any more, so whatever is still linked is
+   // still in the set. The domain frees what was erased after this
+  ~concurrent_set()
+   {
+      destroyTree(root.load(std::memory_order_relaxed));
+   }
+
+   //
+   // Access
+   //
+
+   // These all run side by side with each other and with the writers
+   bool contains(const T & t) const
+   {
+      return read([&]() { return findNode(t) != nullptr; });
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   bool contains(const K & k) const
+   {
+      return read([&]() { return findNode(k) != nullptr; });
+   }
+   size_t count(const T & t) const
+   {
+      return contains(t) ? 1 : 0;
+   }
+
+   // A copy of the element, since the one in the set may be gone the moment
+   // we let go. If the version says we have to look again, this copy is
+   // thrown away and we make another
+   std::optional<T> find(const T & t) const
+   {
+      return read([&]() -> std::optional<T>
+      {
+         Node* pNode = findNode(t);
+         if (!pNode)
+            return std::nullopt;
+         return pNode->data;
+      });
+   }
+
+   // Everything in the set at one moment, to walk at leisure. The writers
+   // wait while we copy, the readers do not
+   set<T, C, A> snapshot() const;
+
+   //
+   // Status
+   //
+
+   // With other threads inserting and erasing this is only ever a close
+   // guess, but it is exact whenever nobody is
+   size_t size() const
+   {
+      return numElements.load(std::memory_order_relaxed);
+   }
+   bool   empty() const
+   {
+      return size() == 0;
+   }
+   allocator_type get_allocator() const
+   {
+      return allocator_type(alloc);
+   }
+   key_compare key_comp() const
+   {
+      return this->comp();
+   }
+   value_compare value_comp() const
+   {
+      return this->comp();
+   }
+
+   //
+   // Insert
+   //
+
+   // true if it went in, false if it was there already
+   bool insert(const T & t)
+   {
+      std::lock_guard<std::mutex> lock(writerLock);
+      return insertValue(t);
+   }
+   bool insert(T && t)
+   {
+      std::lock_guard<std::mutex> lock(writerLock);
+      return insertValue(std::move(t));
+   }
+
+   // The element is built before we take the lock, which is the only way to
+   // find out what it is. If it is already here, it goes straight back
+   template <class... Args>
+   bool emplace(Args&&... args)
+   {
+      Node* pNew = createNode(std::in_place, std::forward<Args>(args)...);
+      std::lock_guard<std::mutex> lock(writerLock);
+      Node* pParent = nullptr;
+      bool goLeft = false;
+      if (findSpot(pNew->data, pParent, goLeft))
+      {
+         destroyNode(pNew);
+         return false;
+      }
+      link(pNew, pParent, goLeft);
+      return true;
+   }
+
+   // One turn at the lock for the lot of them. Each one is its own change,
+   // so readers get in between them
+   template <class Iterator>
+   void insert(Iterator first, Iterator last)
+   {
+      std::lock_guard<std::mutex> lock(writerLock);
+      for (; first != last; ++first)
+         insertValue(*first);
+   }
+   void insert(const std::initializer_list <T> & il)
+   {
+      insert(il.begin(), il.end());
+   }
+
+   //
+   // Remove
+   //
+   size_t erase(const T & t);
+
+   // One change takes the whole tree away, and it goes to the domain in one piece
+   void clear();
+
+private:
+   static constexpr int MAX_TRIES = 16;    // looks that a writer spoiled before we give up and take the lock
+   static constexpr int MAX_DEPTH = 128;   // twice the height of the tallest red-black tree there could be
+
+   /*****************************************
+    * NODE
+    * The element never changes once the node is in the
+    * tree, so readers may look at it any time. The links
+    * down are what readers follow, so they are atomic. The
+    * parent and the color are only for writers
+    *****************************************/
+   struct Node
+   {
+      template <class... Args>
+      explicit Node(std::in_place_t, Args&&... args) : data(std::forward<Args>(args)...)
+      {
+      }
+      const T data;
+      std::atomic<Node*> pLeft{ nullptr };
+      std::atomic<Node*> pRight{ nullptr };
+      Node* pParent = nullptr;
+      bool isRed = true;
+   };
+
+   using NodeAlloc  = typename std::allocator_traits<A>::template rebind_alloc<Node>;
+   using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+   template <class K1, class K2>
+   bool less(const K1 & lhs, const K2 & rhs) const { return this->comp()(lhs, rhs); }
+
+   /*************************************************
+    * READ
+    * Run f against the tree as it is, and if a writer
+    * relinked anything while f was looking, run it again.
+    * The fence keeps the second look at the version from
+    * happening before f's reads are done
+    *************************************************/
+   template <class F>
+   auto read(F f) const -> decltype(f())
+   {
+      auto guard = domain.pin();
+      for (int tries = 0; tries < MAX_TRIES; tries++)
+      {
+         uint64_t before = version.load(std::memory_order_acquire);
+         if (before & 1)
+         {
+            std::this_thread::yield();   // a writer is relinking right now, it will not be long
+            continue;
+         }
+         auto result = f();
+         std::atomic_thread_fence(std::memory_order_acquire);
+         if (version.load(std::memory_order_relaxed) == before)
+            return result;
+      }
+
+      // the writers keep beating us to it, so hold them off for one look
+      std::lock_guard<std::mutex> lock(writerLock);
+      return f();
+   }
+
+   // Bracket every change to the links. Odd means somebody is relinking
+   void beginChange()
+   {
+      version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_release);
+   }
+   void endChange()
+   {
+      version.store(version.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+   }
+
+   // The descent readers make, one comparison per level the same way custom::set
+   // does it. In the middle of a rotation the path can be longer than any tree
+   // could be, and then the version has moved anyway, so stop and let read() retry
+   template <class K>
+   Node* findNode(const K & k) const
+   {
+      Node* pCandidate = nullptr;
+      Node* pNode = root.load(std::memory_order_acquire);
+      for (int depth = 0; pNode && depth < MAX_DEPTH; depth++)
+      {
+         if (less(k, pNode->data))
+            pNode = pNode->pLeft.load(std::memory_order_acquire);
+         else
+         {
+            pCandidate = pNode;
+            pNode = pNode->pRight.load(std::memory_order_acquire);
+         }
+      }
+      if (pCandidate && !less(pCandidate->data, k))
+         return pCandidate;
+      return nullptr;
+   }
+
+   // Writers only, with the lock: where k goes, and the node that has it if it is here
+   template <class K>
+   Node* findSpot(const K & k, Node* & pParent, bool & goLeft) const
+   {
+      Node* pCandidate = nullptr;
+      for (Node* pNode = root.load(std::memory_order_relaxed); pNode; )
+      {
+         pParent = pNode;
+         goLeft = less(k, pNode->data);
+         if (goLeft)
+            pNode = leftOf(pNode);
+         else
+         {
+            pCandidate = pNode;
+            pNode = rightOf(pNode);
+         }
+      }
+      if (pCandidate && !less(pCandidate->data, k))
+         return pCandidate;
+      return nullptr;
+   }
+
+   // Insert under the lock: find the spot and build the node, then relink
+   template <class U>
+   bool insertValue(U && t)
+   {
+      Node* pParent = nullptr;
+      bool goLeft = false;
+      if (findSpot(t, pParent, goLeft))
+         return false;
+      link(createNode(std::in_place, std::forward<U>(t)), pParent, goLeft);
+      return true;
+   }
+
+   // The links, as writers and redblack see them. Nobody else stores to them,
+   // so nothing to wait for
+   friend class redblack<concurrent_set, Node>;
+   static Node* leftOf(const Node* pNode)  { return pNode->pLeft.load(std::memory_order_relaxed); }
+   static Node* rightOf(const Node* pNode) { return pNode->pRight.load(std::memory_order_relaxed); }
+   Node* rootNode() const { return root.load(std::memory_order_relaxed); }
+
+   // A reader that follows the new link sees the whole node, element and all
+   static void setLeft(Node* pNode, Node* pChild)
+   {
+      pNode->pLeft.store(pChild, std::memory_order_release);
+      if (pChild)
+         pChild->pParent = pNode;
+   }
+   static void setRight(Node* pNode, Node* pChild)
+   {
+      pNode->pRight.store(pChild, std::memory_order_release);
+      if (pChild)
+         pChild->pParent = pNode;
+   }
+   void replaceChild(Node* pParent, Node* pOld, Node* pNew)
+   {
+      if (!pParent)
+      {
+         root.store(pNew, std::memory_order_release);
+         if (pNew)
+            pNew->pParent = nullptr;
+      }
+      else if (leftOf(pParent) == pOld)
+         setLeft(pParent, pNew);
+      else
+         setRight(pParent, pNew);
+   }
+
+   // A node holds nothing but its element, its links and its color, so there
+   // is nothing for redblack to tell us about
+   static void rotated(Node*, Node*) {}
+   static void leaving(Node*) {}
+   static void replaced(const Node*, Node*) {}
+
+   void link(Node* pNew, Node* pParent, bool goLeft);
+
+   template <class... Args>
+   Node* createNode(Args&&... args);
+   void destroyNode(Node* pNode);
+   void destroyTree(Node* pNode);
+   static void reclaimNode(void* context, void* p)
+   {
+      static_cast<concurrent_set*>(context)->destroyNode(static_cast<Node*>(p));
+   }
+   static void reclaimTree(void* context, void* p)
+   {
+      static_cast<concurrent_set*>(context)->destroyTree(static_cast<Node*>(p));
+   }
+
+   NodeAlloc alloc;                            // where the nodes come from
+   alignas(64) std::atomic<uint64_t> version;  // even while nobody is relinking, odd while a writer is
+   std::atomic<Node*> root;                    // read with the version by every reader
+   std::atomic<size_t> numElements;            // how many, as of the last change
+   alignas(64) mutable std::mutex writerLock;  // writers take turns, on a line of its own
+   mutable epoch_domain domain;                // goes before alloc does, and frees what was erased
+};
+
+/*************************************************
+ * SNAPSHOT
+ * In order under the lock, where the parent pointers
+ * can be trusted. Every element goes on the end, which
+ * custom::set does with one comparison and no descent
+ *************************************************/
+template <typename T, typename C, typename A>
+set<T, C, A> concurrent_set <T, C, A> ::snapshot() const
+{
+   set<T, C, A> s(this->comp(), get_allocator());
+   std::lock_guard<std::mutex> lock(writerLock);
+   Node* pNode = root.load(std::memory_order_relaxed);
+   while (pNode && leftOf(pNode))
+      pNode = leftOf(pNode);
+   while (pNode)
+   {
+      s.insert(s.end(), pNode->data);
+      if (rightOf(pNode))
+      {
+         pNode = rightOf(pNode);
+         while (leftOf(pNode))
+            pNode = leftOf(pNode);
+      }
+      else
+      {
+         while (pNode->pParent && rightOf(pNode->pParent) == pNode)
+            pNode = pNode->pParent;
+         pNode = pNode->pParent;
+      }
+   }
+   return s;
+}
+
+/*************************************************
+ * ERASE
+ * Find it and take it out under the lock, then hand it
+ * to the domain, since a reader may be standing on it.
+ * Unlinking relinks nodes and never copies an element over
+ * another, and the node that goes keeps its own links, so
+ * a reader on it can keep going
+ *************************************************/
+template <typename T, typename C, typename A>
+size_t concurrent_set <T, C, A> ::erase(const T & t)
+{
+   auto guard = domain.pin();
+   std::lock_guard<std::mutex> lock(writerLock);
+   Node* pParent = nullptr;
+   bool goLeft = false;
+   Node* pVictim = findSpot(t, pParent, goLeft);
+   if (!pVictim)
+      return 0;
+
+   beginChange();
+   redblack<concurrent_set, Node>::unlink(*this, pVictim);
+   endChange();
+   numElements.fetch_sub(1, std::memory_order_relaxed);
+   domain.retire(pVictim, reclaimNode, this);
+   return 1;
+}
+
+template <typename T, typename C, typename A>
+void concurrent_set <T, C, A> ::clear()
+{
+   auto guard = domain.pin();
+   std::lock_guard<std::mutex> lock(writerLock);
+   Node* pOld = root.load(std::memory_order_relaxed);
+   if (!pOld)
+      return;
+
+   beginChange();
+   root.store(nullptr, std::memory_order_release);
+   endChange();
+   numElements.store(0, std::memory_order_relaxed);
+   domain.retire(pOld, reclaimTree, this);
+}
+
+/*************************************************
+ * LINK
+ * Hang a node that is already built where findSpot said,
+ * and rebalance. This is the part readers have to look again
+ * after, so nothing in here allocates or compares
+ *************************************************/
+template <typename T, typename C, typename A>
+void concurrent_set <T, C, A> ::link(Node* pNew, Node* pParent, bool goLeft)
+{
+   beginChange();
+   if (!pParent)
+      replaceChild(nullptr, nullptr, pNew);
+   else if (goLeft)
+      setLeft(pParent, pNew);
+   else
+      setRight(pParent, pNew);
+   redblack<concurrent_set, Node>::balanceInsert(*this, pNew);
+   endChange();
+   numElements.fetch_add(1, std::memory_order_relaxed);
+}
+
+/*************************************************
+ * CREATE NODE and DESTROY NODE
+ * Every node goes through these so the allocator sees all of them
+ *************************************************/
+template <typename T, typename C, typename A>
+template <class... Args>
+typename concurrent_set <T, C, A> ::Node* concurrent_set <T, C, A> ::createNode(Args&&... args)
+{
+   Node* pNode = NodeTraits::allocate(alloc, 1);
+   try
+   {
+      NodeTraits::construct(alloc, pNode, std::forward<Args>(args)...);
+   }
+   catch (...)
+   {
+      NodeTraits::deallocate(alloc, pNode, 1);
+      throw;
+   }
+   return pNode;
+}
+
+template <typename T, typename C, typename A>
+void concurrent_set <T, C, A> ::destroyNode(Node* pNode)
+{
+   NodeTraits::destroy(alloc, pNode);
+   NodeTraits::deallocate(alloc, pNode, 1);
+}
+
+// No recursion, the same as custom::set: rotate left children up until the
+// one on top has none, then it goes. Nobody can see these nodes any more
+template <typename T, typename C, typename A>
+void concurrent_set <T, C, A> ::destroyTree(Node* pNode)
+{
+   while (pNode)
+   {
+      Node* pLeft = leftOf(pNode);
+      if (pLeft)
+      {
+         pNode->pLeft.store(rightOf(pLeft), std::memory_order_relaxed);
+         pLeft->pRight.store(pNode, std::memory_order_relaxed);
+         pNode = pLeft;
+      }
+      else
+      {
+         Node* pRight = rightOf(pNode);
+         destroyNode(pNode);
+         pNode = pRight;
+      }
+   }
+}
+
+} // namespace custom
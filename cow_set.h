@@ -0,0 +1,537 @@
+/***********************************************************************
+ * Header:
+ *    Copy-on-Write Set
+ * Summary:
+ *    Most copies of a set are only ever read: handed to a function,
+ *    kept as a before picture, returned out of something. Copying the
+ *    whole tree for each of them costs n nodes and n elements that go
+ *    right back to the heap unchanged.
+ *
+ *    Ask for copy-on-write through set: custom::set<T, C, custom::cow_tag>.
+ *    A copy then shares the tree it was copied from and counts itself
+ *    as one more owner of it. The first change anybody makes to a shared
+ *    tree gets them a tree of their own first, so nobody else sees it.
+ *    A tree with only one owner is changed in place, like any other set,
+ *    and a change that turns out not to change anything, like inserting
+ *    what is already there, does not copy anything either.
+ *
+ *    Two sets that share a tree can be used from two threads at once,
+ *    the same as two sets that do not: nobody changes a shared tree, and
+ *    reading a tree never writes to it. cow_stats counts every time a
+ *    tree was shared and every time one had to be copied after all, so
+ *    we can see how many copies we saved.
+ *
+ *    WATCH OUT, iterators do not work the way std::set's do. They point
+ *    into the tree, not the set. If the tree is shared when we change
+ *    the set, we get a tree of our own first, and every iterator taken
+ *    before that still points into the old tree. The other sets own it
+ *    now: the iterator does not see our change, and it dangles as soon
+ *    as the last of them lets go:
+ *        auto it = a.begin();
+ *        { auto b = a; a.insert(10); }   // a copies, then b frees the old tree
+ *        *it;                            // reads freed memory
+ *    std::set never invalidates an iterator on insert, so code switched
+ *    over to cow_tag has to ask the set again after a change, or call
+ *    unshare() before it takes the iterators it wants to keep. A set
+ *    with a tree of its own keeps its iterators good across changes,
+ *    until it is copied again. The iterators handed to the set's own
+ *    erase, insert, and extract are moved over for us.
+ *
+ *    This will contain the class definition of:
+ *        cow_stats               : How many trees were shared and cloned
+ *        set<T, C, cow_alloc<A>> : A set that shares its tree with its copies
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>     // for size_t
+#include <atomic>      // how many sets share a tree
+#include <memory>      // for std::allocator_traits
+#include <functional>  // for std::less
+#include <utility>     // for std::pair and std::swap
+#include "set.h"       // for the set we specialize and what it shares
+
+class TestCowSet;     // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * COW TAG
+ * Put this where the allocator goes to get a set that
+ * shares its tree with its copies:
+ * custom::set<T, C, custom::cow_tag>.
+ * To pick where the nodes come from, wrap the allocator:
+ * custom::set<T, C, custom::cow_alloc<A>>
+ ***********************************************/
+template <class A>
+struct cow_alloc {};
+using cow_tag = cow_alloc<std::allocator<void>>;
+
+/************************************************
+ * COW STATS
+ * Every copy-on-write set in the program adds to these,
+ * whatever it holds. A share is a copy that took no
+ * copying, a clone is a shared tree copied after all
+ ***********************************************/
+class cow_stats
+{
+public:
+   static size_t numShares() { return shares.load(std::memory_order_relaxed); }
+   static size_t numClones() { return clones.load(std::memory_order_relaxed); }
+   static void reset()
+   {
+      shares.store(0, std::memory_order_relaxed);
+      clones.store(0, std::memory_order_relaxed);
+   }
+
+private:
+   template <typename T, typename C, typename A>
+   friend class set;
+
+   inline static std::atomic<size_t> shares{ 0 };
+   inline static std::atomic<size_t> clones{ 0 };
+};
+
+/************************************************
+ * SET with COPY-ON-WRITE
+ * The same set, but copies share one tree until one
+ * of them changes it. The tag sits where the allocator
+ * goes, so the allocator it carries is rebound to T
+ ***********************************************/
+template <typename T, typename C, typename A>
+class set <T, C, cow_alloc<A>>
+{
+   friend class ::TestCowSet; // give unit tests access to the privates
+public:
+   using value_type         = T;
+   using key_type           = T;
+   using allocator_type     = typename std::allocator_traits<A>::template rebind_alloc<T>;
+   using key_compare        = C;
+   using value_compare      = C;
+   using Set                = custom::set<T, C, allocator_type>;
+   using iterator           = typename Set::iterator;
+   using const_iterator     = iterator;
+   using reverse_iterator   = std::reverse_iterator<iterator>;
+   using node_type          = typename Set::node_type;
+   using insert_return_type = typename Set::insert_return_type;
+
+   //
+   // Construct
+   //
+   set() : pShared(nullptr)
+   {
+      pShared = create(Set());
+   }
+   explicit set(const allocator_type & a) : pShared(nullptr), alloc(a)
+   {
+      pShared = create(Set(a));
+   }
+   explicit set(const C & comp, const allocator_type & a = allocator_type()) : pShared(nullptr), alloc(a)
+   {
+      pShared = create(Set(comp, a));
+   }
+
+   // no copying, just one more owner
+   set(const set & rhs) : pShared(rhs.share()), alloc(rhs.alloc)
+   {
+   }
+
+   // the tree has to come from a, so this one really is a copy
+   set(const set & rhs, const allocator_type & a) : pShared(nullptr), alloc(a)
+   {
+      pShared = create(Set(rhs.tree(), a));
+   }
+   set(set && rhs) : pShared(rhs.pShared), alloc(rhs.alloc)
+   {
+      rhs.pShared = nullptr;
+   }
+   set(set && rhs, const allocator_type & a) : pShared(nullptr), alloc(a)
+   {
+      if (rhs.pShared && rhs.pShared->refs.load(std::memory_order_acquire) == 1)
+         pShared = create(Set(std::move(rhs.pShared->tree), a));
+      else
+         pShared = create(Set(rhs.tree(), a));
+   }
+   set(const std::initializer_list <T> & il, const allocator_type & a = allocator_type()) : pShared(nullptr), alloc(a)
+   {
+      pShared = create(Set(il, a));
+   }
+   template <class Iterator>
+   set(Iterator first, Iterator last, const allocator_type & a = allocator_type()) : pShared(nullptr), alloc(a)
+   {
+      pShared = create(Set(first, last, a));
+   }
+   template <class Iterator>
+   set(sorted_unique_t, Iterator first, Iterator last, const C & comp = C(),
+       const allocator_type & a = allocator_type()) : pShared(nullptr), alloc(a)
+   {
+      pShared = create(Set(sorted_unique, first, last, comp, a));
+   }
+   template <class Iterator>
+   static set from_sorted(Iterator first, Iterator last, const C & comp = C(), const allocator_type & a = allocator_type())
+   {
+      return set(sorted_unique, first, last, comp, a);
+   }
+  ~set()
+   {
+      release(pShared);
+   }
+
+   //
+   // Assign
+   //
+   set & operator = (const set & rhs)
+   {
+      if (this != &rhs && pShared != rhs.pShared)
+      {
+         Shared* pNew = rhs.share();
+         release(pShared);
+         pShared = pNew;
+         alloc = rhs.alloc;
+      }
+      return *this;
+   }
+   set & operator = (set && rhs)
+   {
+      swap(rhs);
+      return *this;
+   }
+   set & operator = (const std::initializer_list <T> & il)
+   {
+      clear();
+      insert(il);
+      return *this;
+   }
+   void swap(set & rhs) noexcept
+   {
+      std::swap(pShared, rhs.pShared);
+      std::swap(alloc, rhs.alloc);
+   }
+
+   // more than one set has this tree right now
+   bool is_shared() const
+   {
+      return pShared && pShared->refs.load(std::memory_order_acquire) > 1;
+   }
+
+   // A tree of our own right now, copied if need be, so the iterators we take
+   // from here on stay good across changes, until somebody copies us again
+   void unshare()
+   {
+      mine();
+   }
+
+   //
+   // Iterator
+   //
+   iterator begin() const noexcept { return tree().begin(); }
+   iterator end()   const noexcept { return tree().end();   }
+   reverse_iterator rbegin() const noexcept { return reverse_iterator(end());   }
+   reverse_iterator rend()   const noexcept { return reverse_iterator(begin()); }
+
+   //
+   // Access
+   //
+
+   // Set's find is not const, so go through lower_bound. It is the same
+   // trip down the tree and one more comparison
+   iterator find(const T & t) const
+   {
+      iterator it = tree().lower_bound(t);
+      return (it != end() && !key_comp()(t, *it)) ? it : end();
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator find(const K & k) const
+   {
+      iterator it = tree().lower_bound(k);
+      return (it != end() && !key_comp()(k, *it)) ? it : end();
+   }
+   size_t count(const T & t) const
+   {
+      return tree().count(t);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   size_t count(const K & k) const
+   {
+      return tree().count(k);
+   }
+
+   iterator lower_bound(const T & t) const { return tree().lower_bound(t); }
+   iterator upper_bound(const T & t) const { return tree().upper_bound(t); }
+   std::pair<iterator, iterator> equal_range(const T & t) const { return tree().equal_range(t); }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator lower_bound(const K & k) const { return tree().lower_bound(k); }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator upper_bound(const K & k) const { return tree().upper_bound(k); }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   std::pair<iterator, iterator> equal_range(const K & k) const { return tree().equal_range(k); }
+   template <class K>
+   iterator lower_bound(iterator itFrom, const K & k) const { return tree().lower_bound(itFrom, k); }
+
+   size_t rank(const T & t) const        { return tree().rank(t);   }
+   iterator select(size_t i) const       { return tree().select(i); }
+   size_t count_range(const T & lo, const T & hi) const { return tree().count_range(lo, hi); }
+
+   //
+   // Status
+   //
+   bool   empty() const noexcept { return tree().empty(); }
+   size_t size()  const noexcept { return tree().size();  }
+   allocator_type get_allocator() const noexcept { return tree().get_allocator(); }
+   key_compare   key_comp()   const { return tree().key_comp(); }
+   value_compare value_comp() const { return tree().key_comp(); }
+
+   //
+   // Insert
+   //
+
+   // already here is not a change, so a shared tree stays shared
+   std::pair<iterator, bool> insert(const T & t)
+   {
+      if (is_shared())
+      {
+         iterator it = find(t);
+         if (it != end())
+            return std::pair<iterator, bool>(it, false);
+      }
+      return mine().insert(t);
+   }
+   std::pair<iterator, bool> insert(T && t)
+   {
+      if (is_shared())
+      {
+         iterator it = find(t);
+         if (it != end())
+            return std::pair<iterator, bool>(it, false);
+      }
+      return mine().insert(std::move(t));
+   }
+   iterator insert(iterator itHint, const T & t)
+   {
+      return mine(itHint).insert(itHint, t);
+   }
+   iterator insert(iterator itHint, T && t)
+   {
+      return mine(itHint).insert(itHint, std::move(t));
+   }
+   // a shared tree needs the element built first, to see whether it is there already
+   template <class... Args>
+   std::pair<iterator, bool> emplace(Args&&... args)
+   {
+      if (is_shared())
+         return insert(T(std::forward<Args>(args)...));
+      return mine().emplace(std::forward<Args>(args)...);
+   }
+   template <class... Args>
+   iterator emplace_hint(iterator itHint, Args&&... args)
+   {
+      return mine(itHint).emplace_hint(itHint, std::forward<Args>(args)...);
+   }
+   void insert(const std::initializer_list <T> & il)
+   {
+      mine().insert(il);
+   }
+   template <class Iterator>
+   void insert(Iterator first, Iterator last)
+   {
+      mine().insert(first, last);
+   }
+
+   //
+   // Remove
+   //
+
+   // A shared tree is not copied just to be thrown away. We let go of it
+   // and start over with an empty one
+   void clear()
+   {
+      if (is_shared())
+      {
+         Shared* pEmpty = create(Set(key_comp(), get_allocator()));
+         release(pShared);
+         pShared = pEmpty;
+      }
+      else
+         mine().clear();
+   }
+   iterator erase(iterator & it)
+   {
+      return mine(it).erase(it);
+   }
+
+   // not here is not a change either
+   size_t erase(const T & t)
+   {
+      if (is_shared() && !count(t))
+         return 0;
+      return mine().erase(t);
+   }
+   iterator erase(iterator & itBegin, iterator & itEnd)
+   {
+      Set & s = mine(itBegin, itEnd);
+      return s.erase(itBegin, itEnd);
+   }
+
+   //
+   // Node handles
+   //
+   node_type extract(iterator it)
+   {
+      return mine(it).extract(it);
+   }
+   node_type extract(const T & t)
+   {
+      if (is_shared() && !count(t))
+         return node_type();
+      return mine().extract(t);
+   }
+   insert_return_type insert(node_type && nh)
+   {
+      return mine().insert(std::move(nh));
+   }
+
+   // both sides change, so both get trees of their own
+   void merge(set & source)
+   {
+      if (this != &source)
+         mine().merge(source.mine());
+   }
+   void merge(set && source)
+   {
+      merge(source);
+   }
+
+   //
+   // Set algebra
+   //
+   set & set_union(const set & rhs)
+   {
+      mine().set_union(rhs.tree());
+      return *this;
+   }
+   set & set_intersection(const set & rhs)
+   {
+      mine().set_intersection(rhs.tree());
+      return *this;
+   }
+   set & set_difference(const set & rhs)
+   {
+      mine().set_difference(rhs.tree());
+      return *this;
+   }
+   set & set_symmetric_difference(const set & rhs)
+   {
+      mine().set_symmetric_difference(rhs.tree());
+      return *this;
+   }
+
+private:
+
+   /************************************************
+    * SHARED
+    * The tree and how many sets have it. Only a tree
+    * with one owner ever changes
+    ***********************************************/
+   struct Shared
+   {
+      template <class... Args>
+      Shared(Args&&... args) : refs(1), tree(std::forward<Args>(args)...)
+      {
+      }
+      std::atomic<size_t> refs;
+      Set tree;
+   };
+   using SharedAlloc  = typename std::allocator_traits<A>::template rebind_alloc<Shared>;
+   using SharedTraits = std::allocator_traits<SharedAlloc>;
+
+   template <class... Args>
+   Shared* create(Args&&... args)
+   {
+      Shared* p = SharedTraits::allocate(alloc, 1);
+      try
+      {
+         SharedTraits::construct(alloc, p, std::forward<Args>(args)...);
+      }
+      catch (...)
+      {
+         SharedTraits::deallocate(alloc, p, 1);
+         throw;
+      }
+      return p;
+   }
+
+   // the last owner out frees the tree
+   void release(Shared* p)
+   {
+      if (p && p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+         SharedTraits::destroy(alloc, p);
+         SharedTraits::deallocate(alloc, p, 1);
+      }
+   }
+
+   // A moved-from set has no tree, and reads as an empty one
+   const Set & tree() const
+   {
+      static const Set empty;
+      return pShared ? pShared->tree : empty;
+   }
+
+   // One more owner for our tree
+   Shared* share() const
+   {
+      if (!pShared)
+         return nullptr;
+      pShared->refs.fetch_add(1, std::memory_order_relaxed);
+      cow_stats::shares.fetch_add(1, std::memory_order_relaxed);
+      return pShared;
+   }
+
+   // The tree, ours alone so it can change. If anybody else has it we copy
+   // it first, and if a move left us without one we start a new one
+   Set & mine()
+   {
+      if (!pShared)
+         pShared = create(Set());
+      else if (pShared->refs.load(std::memory_order_acquire) != 1)
+      {
+         Shared* pCopy = create(pShared->tree);
+         release(pShared);
+         pShared = pCopy;
+         cow_stats::clones.fetch_add(1, std::memory_order_relaxed);
+      }
+      return pShared->tree;
+   }
+
+   // Same, and move it to the same place in our own tree if we had to copy.
+   // Every element has a rank, and end() is the rank one past the last
+   Set & mine(iterator & it)
+   {
+      if (!is_shared())
+         return mine();
+      size_t index = it == end() ? size() : rank(*it);
+      Set & s = mine();
+      it = s.select(index);
+      return s;
+   }
+   Set & mine(iterator & itBegin, iterator & itEnd)
+   {
+      if (!is_shared())
+         return mine();
+      size_t indexBegin = itBegin == end() ? size() : rank(*itBegin);
+      size_t indexEnd = itEnd == end() ? size() : rank(*itEnd);
+      Set & s = mine();
+      itBegin = s.select(indexBegin);
+      itEnd = s.select(indexEnd);
+      return s;
+   }
+
+   Shared* pShared;      // the tree, and everybody else who has it
+   SharedAlloc alloc;    // where the tree's header comes from
+};
+
+}; // namespace custom
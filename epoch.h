@@ -0,0 +1,336 @@
+/***********************************************************************
+ * Header:
+ *    Epoch
+ * Summary:
+ *    When a lock-free container takes a node out, some other thread may
+ *    be standing on it that very moment, so it cannot be freed yet. It
+ *    can be freed once every thread that might have seen it has moved
+ *    on, and epochs are a cheap way to tell when that is.
+ *
+ *    There is one global epoch, a number that only goes up. A thread
+ *    pins itself before it touches anything and writes down the epoch
+ *    it saw, and unpins when it is done. The epoch only moves ahead when
+ *    every pinned thread has seen the current one. A node taken out is
+ *    tagged with the epoch at that moment. Anybody who could still be
+ *    standing on it pinned no later than that, and the epoch cannot get
+ *    two past them while they are still pinned. So once the epoch is
+ *    two past the tag, nobody is left who could see the node, and it
+ *    goes.
+ *
+ *    Pinning costs one store that waits for itself to be seen, to a
+ *    cache line nobody else writes to. The catch is that one thread pinned for a long time
+ *    holds up freeing for everybody, so hold a guard for one operation,
+ *    not for the life of the thread.
+ *
+ *    Every thread gets a record in the domain the first time it pins,
+ *    and gives it back when the thread ends so the next new thread can
+ *    have it. Whatever it had waiting to be freed goes along with it.
+ *
+ *    This will contain the class definition of:
+ *        epoch_domain        : The epoch and every thread's record of it
+ *        epoch_domain::guard : Keeps this thread pinned while it lives
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cstddef>     // for size_t
+#include <cstdint>     // for uint64_t
+#include <atomic>      // the epoch and each thread's copy of it
+#include <memory>      // for std::shared_ptr and std::weak_ptr
+#include <vector>      // what is waiting to be freed
+
+class TestLockFreeSet;  // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * EPOCH DOMAIN
+ * One epoch, shared by everybody working on one container.
+ * The container frees its own nodes, the domain just says when
+ ***********************************************/
+class epoch_domain
+{
+   friend class ::TestLockFreeSet; // give unit tests access to the privates
+   struct Record;
+public:
+   class guard;
+
+   // something to free once it is safe, and whoever knows how
+   using reclaimer = void (*)(void* context, void* p);
+
+   epoch_domain() : globalEpoch(FIRST_EPOCH), records(std::make_shared<Records>())
+   {
+   }
+   epoch_domain(const epoch_domain &) = delete;
+   epoch_domain & operator = (const epoch_domain &) = delete;
+
+   // Nobody is pinned any more, so everything still waiting can go. The
+   // records themselves stay until the last thread that had one is gone
+   ~epoch_domain()
+   {
+      for (Record* pRecord = records->pHead.load(); pRecord; pRecord = pRecord->pNext)
+         for (auto & bag : pRecord->bags)
+            freeBag(bag);
+   }
+
+   // stay pinned for as long as the guard is around
+   guard pin();
+
+   // Free p when nobody can see it any more. The caller has to be pinned
+   // and p has to be where no new reader can find it
+   void retire(void* p, reclaimer reclaim, void* context)
+   {
+      Record* pRecord = myRecord();
+      uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+
+      // A bag holds one epoch at a time. If it still has one from three
+      // epochs ago, that is long past safe
+      Bag & bag = pRecord->bags[epoch % NUM_BAGS];
+      if (bag.epoch != epoch)
+      {
+         freeBag(bag);
+         bag.epoch = epoch;
+      }
+      bag.retired.push_back(Retired{ p, reclaim, context });
+
+      // every so often see whether the epoch can move and free what we can
+      if (++pRecord->numRetired % ADVANCE_EVERY == 0)
+      {
+         tryAdvance();
+         collect(pRecord);
+      }
+   }
+
+   // everything this thread has retired that is not gone yet
+   size_t numWaiting()
+   {
+      size_t num = 0;
+      for (auto & bag : myRecord()->bags)
+         num += bag.retired.size();
+      return num;
+   }
+
+private:
+   static constexpr uint64_t QUIESCENT     = ~0ull; // not pinned, holding nothing up
+   static constexpr uint64_t FIRST_EPOCH   = 2;     // so a new bag's 0 is two behind already
+   static constexpr int      NUM_BAGS      = 3;     // the epoch we are in and the two behind it
+   static constexpr size_t   ADVANCE_EVERY = 64;    // retires between tries at moving the epoch
+
+   struct Retired
+   {
+      void* p;
+      reclaimer reclaim;
+      void* context;
+   };
+
+   struct Bag
+   {
+      uint64_t epoch = 0;               // when all of these were retired
+      std::vector<Retired> retired;
+   };
+
+   // One per thread, on its own cache line, since every pin writes to it
+   // and every try at advancing reads it
+   struct alignas(64) Record
+   {
+      std::atomic<uint64_t> epoch{ QUIESCENT }; // what this thread saw when it pinned
+      std::atomic<bool> taken{ true };          // a thread owns this right now
+      Record* pNext = nullptr;                  // the next record, set once and never changed
+
+      // only the thread that owns the record touches the rest
+      int depth = 0;                            // guards inside guards
+      size_t numRetired = 0;
+      Bag bags[NUM_BAGS];
+   };
+
+   // All the records, which only ever grows. It is shared with every thread
+   // that has one of them, so they can give it back when they end even if
+   // the domain went away first
+   struct Records
+   {
+      std::atomic<Record*> pHead{ nullptr };
+     ~Records()
+      {
+         for (Record* pRecord = pHead.load(); pRecord; )
+         {
+            Record* pNext = pRecord->pNext;
+            delete pRecord;
+            pRecord = pNext;
+         }
+      }
+   };
+
+   // The records this thread holds, one per domain. When the thread ends,
+   // every one of them whose domain is still around gets handed back
+   struct Owned
+   {
+      std::weak_ptr<Records> records;
+      Record* pRecord;
+   };
+   struct Holder
+   {
+      std::vector<Owned> owned;
+     ~Holder()
+      {
+         for (auto & own : owned)
+            if (auto records = own.records.lock())
+               own.pRecord->taken.store(false, std::memory_order_release);
+      }
+   };
+
+   /*************************************************
+    * MY RECORD
+    * The one this thread owns, found or taken the first
+    * time through. The weak pointer keeps the shared block
+    * alive, so a new domain can never look like an old one
+    *************************************************/
+   Record* myRecord()
+   {
+      thread_local Holder holder;
+      for (auto & own : holder.owned)
+         if (!own.records.owner_before(records) && !records.owner_before(own.records))
+            return own.pRecord;
+
+      // forget the domains that are gone while we are here
+      for (size_t i = holder.owned.size(); i > 0; i--)
+         if (holder.owned[i - 1].records.expired())
+            holder.owned.erase(holder.owned.begin() + (i - 1));
+
+      Record* pRecord = takeRecord();
+      holder.owned.push_back(Owned{ records, pRecord });
+      return pRecord;
+   }
+
+   // one a thread gave back, or a brand new one at the front of the list
+   Record* takeRecord()
+   {
+      for (Record* pRecord = records->pHead.load(std::memory_order_acquire); pRecord; pRecord = pRecord->pNext)
+      {
+         bool taken = false;
+         if (!pRecord->taken.load(std::memory_order_relaxed) &&
+             pRecord->taken.compare_exchange_strong(taken, true, std::memory_order_acquire))
+            return pRecord;
+      }
+
+      Record* pRecord = new Record;
+      pRecord->pNext = records->pHead.load(std::memory_order_relaxed);
+      while (!records->pHead.compare_exchange_weak(pRecord->pNext, pRecord,
+                                                   std::memory_order_release, std::memory_order_relaxed))
+         ;
+      return pRecord;
+   }
+
+   /*************************************************
+    * ENTER and LEAVE
+    * Write down the epoch, then look again. If it moved
+    * while we were writing, whoever moved it may not have
+    * seen us, so write down the new one
+    *************************************************/
+   void enter(Record* pRecord)
+   {
+      if (pRecord->depth++ > 0)
+         return;
+      uint64_t epoch = globalEpoch.load(std::memory_order_relaxed);
+      for (;;)
+      {
+         pRecord->epoch.store(epoch, std::memory_order_seq_cst);
+         uint64_t epochNow = globalEpoch.load(std::memory_order_seq_cst);
+         if (epochNow == epoch)
+            break;
+         epoch = epochNow;
+      }
+      collect(pRecord);
+   }
+   void leave(Record* pRecord)
+   {
+      if (--pRecord->depth == 0)
+         pRecord->epoch.store(QUIESCENT, std::memory_order_release);
+   }
+
+   // the epoch moves ahead if every pinned thread is in it already
+   void tryAdvance()
+   {
+      uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+      for (Record* pRecord = records->pHead.load(std::memory_order_acquire); pRecord; pRecord = pRecord->pNext)
+      {
+         uint64_t epochThere = pRecord->epoch.load(std::memory_order_seq_cst);
+         if (epochThere != QUIESCENT && epochThere != epoch)
+            return;
+      }
+      globalEpoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+   }
+
+   // free every bag of ours that is two epochs behind
+   void collect(Record* pRecord)
+   {
+      uint64_t epoch = globalEpoch.load(std::memory_order_acquire);
+      for (auto & bag : pRecord->bags)
+         if (bag.epoch + 2 <= epoch)
+            freeBag(bag);
+   }
+
+   static void freeBag(Bag & bag)
+   {
+      for (auto & retired : bag.retired)
+         retired.reclaim(retired.context, retired.p);
+      bag.retired.clear();
+   }
+
+   std::atomic<uint64_t> globalEpoch;   // the one and only epoch
+   std::shared_ptr<Records> records;    // every thread's record of it
+};
+
+/************************************************
+ * GUARD
+ * While one of these is around this thread is pinned, and
+ * nothing it can see will be freed out from under it. Guards
+ * nest, and a guard belongs to the thread that made it
+ ***********************************************/
+class epoch_domain::guard
+{
+public:
+   guard() : pDomain(nullptr), pRecord(nullptr)
+   {
+   }
+   guard(const guard & rhs) : pDomain(rhs.pDomain), pRecord(rhs.pRecord)
+   {
+      if (pDomain)
+         pDomain->enter(pRecord);
+   }
+   guard(guard && rhs) noexcept : pDomain(rhs.pDomain), pRecord(rhs.pRecord)
+   {
+      rhs.pDomain = nullptr;
+      rhs.pRecord = nullptr;
+   }
+  ~guard()
+   {
+      if (pDomain)
+         pDomain->leave(pRecord);
+   }
+   guard & operator = (guard rhs) noexcept
+   {
+      std::swap(pDomain, rhs.pDomain);
+      std::swap(pRecord, rhs.pRecord);
+      return *this;
+   }
+
+private:
+   friend class epoch_domain;
+   guard(epoch_domain* pDomain) : pDomain(pDomain), pRecord(pDomain->myRecord())
+   {
+      pDomain->enter(pRecord);
+   }
+
+   epoch_domain* pDomain;
+   epoch_domain::Record* pRecord;
+};
+
+inline epoch_domain::guard epoch_domain::pin()
+{
+   return guard(this);
+}
+
+} // namespace custom
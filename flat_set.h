@@ -0,0 +1,420 @@
+/***********************************************************************
+ * Header:
+ *    Flat Set
+ * Summary:
+ *    A set that keeps its elements side by side in one sorted array
+ *    instead of one node apiece. There are no pointers to store and
+ *    nothing to chase, so a set that is built once and then searched
+ *    over and over is smaller and faster this way. The price is insert
+ *    and erase, which have to shift everything after them over by one.
+ *    Insert a whole batch at once and it is sorted and merged in one go.
+ *
+ *    This will contain the class definition of:
+ *        flat_set            : A set stored in a sorted array
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <vector>      // where the elements live
+#include <algorithm>   // for std::sort, std::inplace_merge, std::unique
+#include <functional>  // for std::less
+#include <memory>      // for std::allocator
+#include <iterator>    // for std::reverse_iterator
+#include <utility>     // for std::pair
+#include "set.h"       // to convert to and from the node-based set
+
+class TestFlatSet;    // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * FLAT SET
+ * A set stored in a sorted array
+ * The same interface as set, but the iterators are random access
+ * and they go stale when anything is inserted or erased
+ ***********************************************/
+template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
+class flat_set : private CompareBase<C>
+{
+   friend class ::TestFlatSet; // give unit tests access to the privates
+public:
+   using value_type       = T;
+   using allocator_type   = A;
+   using key_compare      = C;
+   using value_compare    = C;
+   using iterator         = typename std::vector<T, A>::const_iterator;
+   using const_iterator   = iterator;
+   using reverse_iterator = std::reverse_iterator<iterator>;
+
+   //
+   // Construct
+   //
+   flat_set()
+   {
+   }
+   explicit flat_set(const A & a) : elements(a)
+   {
+   }
+   explicit flat_set(const C & comp, const A & a = A()) : CompareBase<C>(comp), elements(a)
+   {
+   }
+   flat_set(const flat_set & rhs) : CompareBase<C>(rhs.comp()), elements(rhs.elements)
+   {
+   }
+   flat_set(flat_set && rhs) : CompareBase<C>(rhs.comp()), elements(std::move(rhs.elements))
+   {
+   }
+   flat_set(const std::initializer_list <T> & il, const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), elements(a)
+   {
+      insert(il);
+   }
+   template <class Iterator>
+   flat_set(Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), elements(a)
+   {
+      insert(first, last);
+   }
+   template <class Iterator>
+   flat_set(sorted_unique_t, Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), elements(first, last, a)
+   {
+      // take their word for it, no comparisons at all
+   }
+
+   // a set already walks in order, so this is one straight copy with no sorting
+   explicit flat_set(const set<T, C, A> & s)
+      : CompareBase<C>(s.key_comp()), elements(s.begin(), s.end(), s.get_allocator())
+   {
+   }
+
+   // and going back the array is already sorted, so the tree is built bottom-up in linear time
+   set<T, C, A> to_set() const &
+   {
+      return set<T, C, A>(sorted_unique, elements.begin(), elements.end(), key_comp(), get_allocator());
+   }
+   set<T, C, A> to_set() &&
+   {
+      set<T, C, A> s(sorted_unique, std::make_move_iterator(elements.begin()),
+                     std::make_move_iterator(elements.end()), key_comp(), get_allocator());
+      elements.clear();
+      return s;
+   }
+
+   //
+   // Assign
+   //
+   flat_set & operator = (const flat_set & rhs)
+   {
+      this->comp() = rhs.comp();
+      elements = rhs.elements;
+      return *this;
+   }
+   flat_set & operator = (flat_set && rhs)
+   {
+      this->comp() = rhs.comp();
+      elements = std::move(rhs.elements);
+      return *this;
+   }
+   flat_set & operator = (const std::initializer_list <T> & il)
+   {
+      clear();
+      insert(il);
+      return *this;
+   }
+   void swap(flat_set & rhs)
+   {
+      std::swap(this->comp(), rhs.comp());
+      elements.swap(rhs.elements);
+   }
+
+   //
+   // Iterator
+   //
+   iterator begin() const noexcept { return elements.begin(); }
+   iterator end()   const noexcept { return elements.end();   }
+   reverse_iterator rbegin() const noexcept { return reverse_iterator(end());   }
+   reverse_iterator rend()   const noexcept { return reverse_iterator(begin()); }
+
+   //
+   // Access
+   //
+   iterator find(const T & t) const
+   {
+      return findIndex(t);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator find(const K & k) const
+   {
+      return findIndex(k);
+   }
+   size_t count(const T & t) const
+   {
+      return find(t) == end() ? 0 : 1;
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   size_t count(const K & k) const
+   {
+      return find(k) == end() ? 0 : 1;
+   }
+
+   iterator lower_bound(const T & t) const { return begin() + lowerIndex(t); }
+   iterator upper_bound(const T & t) const { return begin() + upperIndex(t); }
+   std::pair<iterator, iterator> equal_range(const T & t) const
+   {
+      return std::make_pair(lower_bound(t), upper_bound(t));
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator lower_bound(const K & k) const { return begin() + lowerIndex(k); }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator upper_bound(const K & k) const { return begin() + upperIndex(k); }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   std::pair<iterator, iterator> equal_range(const K & k) const
+   {
+      return std::make_pair(lower_bound(k), upper_bound(k));
+   }
+
+   // order statistics come for free when the elements are numbered
+   size_t rank(const T & t) const
+   {
+      return lowerIndex(t);
+   }
+   iterator select(size_t i) const
+   {
+      return i < size() ? begin() + i : end();
+   }
+   size_t count_range(const T & lo, const T & hi) const
+   {
+      size_t rankLo = lowerIndex(lo);
+      size_t rankHi = lowerIndex(hi);
+      return rankHi > rankLo ? rankHi - rankLo : 0;
+   }
+
+   //
+   // Status
+   //
+   bool   empty() const noexcept { return elements.empty(); }
+   size_t size()  const noexcept { return elements.size();  }
+   allocator_type get_allocator() const { return elements.get_allocator(); }
+   key_compare   key_comp()   const { return this->comp(); }
+   value_compare value_comp() const { return this->comp(); }
+
+   // a set that is done growing can give back the room it was saving for later
+   void reserve(size_t n) { elements.reserve(n); }
+   void shrink_to_fit()   { elements.shrink_to_fit(); }
+
+   //
+   // Insert
+   //
+
+   // one search, then everything after the spot moves over by one
+   std::pair<iterator, bool> insert(const T & t)
+   {
+      return insertValue(t);
+   }
+   std::pair<iterator, bool> insert(T && t)
+   {
+      return insertValue(std::move(t));
+   }
+
+   // no search at all if t belongs right in front of itHint
+   iterator insert(iterator itHint, const T & t)
+   {
+      return insertHint(itHint, t);
+   }
+   iterator insert(iterator itHint, T && t)
+   {
+      return insertHint(itHint, std::move(t));
+   }
+
+   // an array has no node to build the element in, so build it here and move it over
+   template <class... Args>
+   std::pair<iterator, bool> emplace(Args&&... args)
+   {
+      return insertValue(T(std::forward<Args>(args)...));
+   }
+   template <class... Args>
+   iterator emplace_hint(iterator itHint, Args&&... args)
+   {
+      return insertHint(itHint, T(std::forward<Args>(args)...));
+   }
+
+   void insert(const std::initializer_list <T> & il)
+   {
+      insert(il.begin(), il.end());
+   }
+
+   // Tack the whole batch onto the end, sort just the batch, and merge the two
+   // sorted runs. That is O(m log m + n) for m new elements instead of m shifts
+   // of the whole array. The merge is stable, so when an element is already here
+   // the old copy is the one we keep
+   template <class Iterator>
+   void insert(Iterator first, Iterator last)
+   {
+      size_t numOld = elements.size();
+      elements.insert(elements.end(), first, last);
+
+      auto itMiddle = elements.begin() + numOld;
+      auto byComp = [this](const T & lhs, const T & rhs) { return less(lhs, rhs); };
+      std::sort(itMiddle, elements.end(), byComp);
+      std::inplace_merge(elements.begin(), itMiddle, elements.end(), byComp);
+
+      // sorted, so an element equals its neighbor exactly when it is not less than it
+      auto itLast = std::unique(elements.begin(), elements.end(),
+         [this](const T & lhs, const T & rhs) { return !less(lhs, rhs); });
+      elements.erase(itLast, elements.end());
+   }
+
+   //
+   // Remove
+   //
+   void clear() noexcept
+   {
+      elements.clear();
+   }
+   iterator erase(iterator it)
+   {
+      return elements.erase(it);
+   }
+   size_t erase(const T & t)
+   {
+      auto it = find(t);
+      if (it == end())
+         return 0;
+      elements.erase(it);
+      return 1;
+   }
+   iterator erase(iterator itBegin, iterator itEnd)
+   {
+      return elements.erase(itBegin, itEnd);
+   }
+
+   //
+   // Set algebra
+   //
+
+   // The same in-place set algebra as set has. Both arrays are already sorted,
+   // so each one is a single merge pass into a new array, O(m + n)
+   flat_set & set_union(const flat_set & rhs)
+   {
+      return combine(rhs, [](auto first1, auto last1, auto first2, auto last2, auto out, auto comp)
+                          { return std::set_union(first1, last1, first2, last2, out, comp); });
+   }
+   flat_set & set_intersection(const flat_set & rhs)
+   {
+      return combine(rhs, [](auto first1, auto last1, auto first2, auto last2, auto out, auto comp)
+                          { return std::set_intersection(first1, last1, first2, last2, out, comp); });
+   }
+   flat_set & set_difference(const flat_set & rhs)
+   {
+      return combine(rhs, [](auto first1, auto last1, auto first2, auto last2, auto out, auto comp)
+                          { return std::set_difference(first1, last1, first2, last2, out, comp); });
+   }
+   flat_set & set_symmetric_difference(const flat_set & rhs)
+   {
+      return combine(rhs, [](auto first1, auto last1, auto first2, auto last2, auto out, auto comp)
+                          { return std::set_symmetric_difference(first1, last1, first2, last2, out, comp); });
+   }
+
+private:
+
+   template <class L, class R>
+   bool less(const L & lhs, const R & rhs) const { return this->comp()(lhs, rhs); }
+
+   // Binary search with no branch to guess wrong on. Each step either moves the
+   // base up by half or leaves it where it is, which the compiler turns into a
+   // conditional move. We always take all log n steps, which still beats
+   // mispredicting half of them
+   template <class K>
+   size_t lowerIndex(const K & k) const
+   {
+      size_t n = elements.size();
+      if (n == 0)
+         return 0;
+
+      auto itBase = elements.begin();
+      while (n > 1)
+      {
+         size_t half = n / 2;
+         itBase = less(itBase[half], k) ? itBase + half : itBase;
+         n -= half;
+      }
+      return (itBase - elements.begin()) + less(*itBase, k);
+   }
+
+   // same, but equal elements send us up
+   template <class K>
+   size_t upperIndex(const K & k) const
+   {
+      size_t n = elements.size();
+      if (n == 0)
+         return 0;
+
+      auto itBase = elements.begin();
+      while (n > 1)
+      {
+         size_t half = n / 2;
+         itBase = !less(k, itBase[half]) ? itBase + half : itBase;
+         n -= half;
+      }
+      return (itBase - elements.begin()) + !less(k, *itBase);
+   }
+
+   template <class K>
+   iterator findIndex(const K & k) const
+   {
+      size_t i = lowerIndex(k);
+      if (i < elements.size() && !less(k, elements[i]))
+         return begin() + i;
+      return end();
+   }
+
+   template <class U>
+   std::pair<iterator, bool> insertValue(U && t)
+   {
+      size_t i = lowerIndex(t);
+      if (i < elements.size() && !less(t, elements[i]))
+         return std::make_pair(begin() + i, false);
+      return std::make_pair(elements.insert(begin() + i, std::forward<U>(t)), true);
+   }
+
+   // t fits in front of itHint if it is smaller than the hint and bigger than the one before it
+   template <class U>
+   iterator insertHint(iterator itHint, U && t)
+   {
+      if ((itHint == end() || less(t, *itHint)) &&
+          (itHint == begin() || less(*(itHint - 1), t)))
+         return elements.insert(itHint, std::forward<U>(t));
+      return insertValue(std::forward<U>(t)).first;
+   }
+
+   // merge us and rhs with one of the std set algorithms and keep the result
+   template <class Algorithm>
+   flat_set & combine(const flat_set & rhs, Algorithm algorithm)
+   {
+      std::vector<T, A> result(elements.get_allocator());
+      result.reserve(elements.size() + rhs.elements.size());
+      algorithm(elements.begin(), elements.end(), rhs.elements.begin(), rhs.elements.end(),
+                std::back_inserter(result), this->comp());
+      elements.swap(result);
+      return *this;
+   }
+
+   std::vector<T, A> elements;   // sorted, no duplicates
+};
+
+/*****************************************************
+ * SWAP
+ * Stand-alone flat set swap
+ ****************************************************/
+template <typename T, typename C, typename A>
+void swap(flat_set <T, C, A> & lhs, flat_set <T, C, A> & rhs)
+{
+   lhs.swap(rhs);
+}
+
+}; // namespace custom
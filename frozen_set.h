@@ -0,0 +1,476 @@
+/***********************************************************************
+ * Header:
+ *    Frozen Set
+ * Summary:
+ *    A set that is built once and only ever searched after that. The
+ *    elements go in one array in Eytzinger order: the root is at 1, and
+ *    the children of k are at 2k and 2k+1, the same numbering a binary
+ *    heap uses. A search is then just k = 2k + (b[k] < key) over and over,
+ *    with no branch to guess wrong on, and the top of the tree, which
+ *    every search goes through, is packed together at the front where it
+ *    stays in cache.
+ *
+ *    The children of k, its grandchildren, and so on sit side by side, so
+ *    the sixteen great-great-grandchildren of k all share one cache line.
+ *    We ask for that line while we are still working on k and it is there
+ *    by the time we get to it.
+ *
+ *    The iterator goes in order like the other sets. It is just an index,
+ *    and moving it is climbing and descending the numbering.
+ *
+ *    This will contain the class definition of:
+ *        frozen_set          : A read-only set in Eytzinger order
+ *        frozen_set::iterator: An iterator through frozen_set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>     // for std::ptrdiff_t
+#include <new>         // for std::launder
+#include <memory>      // for std::allocator_traits
+#include <functional>  // for std::less
+#include <iterator>    // for std::bidirectional_iterator_tag
+#include <algorithm>   // for std::sort, std::unique, std::min
+#include <vector>      // to sort a range that was not sorted already
+#include "set.h"       // to freeze
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>    // for _BitScanForward64 and _mm_prefetch
+#endif
+
+class TestFrozenSet;  // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * FROZEN SET
+ * A read-only set in Eytzinger order
+ * Built from a set or a range, then searched without
+ * a single branch on the elements
+ ***********************************************/
+template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
+class frozen_set : private CompareBase<C>
+{
+   friend class ::TestFrozenSet; // give unit tests access to the privates
+public:
+   class iterator;
+   using value_type       = T;
+   using allocator_type   = A;
+   using key_compare      = C;
+   using value_compare    = C;
+   using const_iterator   = iterator;
+   using reverse_iterator = std::reverse_iterator<iterator>;
+
+   //
+   // Construct
+   //
+   frozen_set(const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), pLines(nullptr), numElements(0), alloc(a)
+   {
+   }
+
+   // a set walks in order, so this is one pass and no comparisons
+   explicit frozen_set(const set<T, C, A> & s)
+      : CompareBase<C>(s.key_comp()), pLines(nullptr), numElements(0), alloc(s.get_allocator())
+   {
+      build(s.begin(), s.size());
+   }
+   template <class Iterator>
+   frozen_set(sorted_unique_t, Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), pLines(nullptr), numElements(0), alloc(a)
+   {
+      // take their word for it
+      build(first, (size_t)std::distance(first, last));
+   }
+
+   // anything else gets sorted and the duplicates dropped first
+   template <class Iterator>
+   frozen_set(Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), pLines(nullptr), numElements(0), alloc(a)
+   {
+      std::vector<T> v(first, last);
+      auto byComp = [this](const T & lhs, const T & rhs) { return less(lhs, rhs); };
+      std::sort(v.begin(), v.end(), byComp);
+      v.erase(std::unique(v.begin(), v.end(),
+                          [this](const T & lhs, const T & rhs) { return !less(lhs, rhs); }), v.end());
+      build(v.begin(), v.size());
+   }
+   frozen_set(const std::initializer_list <T> & il, const C & comp = C(), const A & a = A())
+      : frozen_set(il.begin(), il.end(), comp, a)
+   {
+   }
+   frozen_set(const frozen_set & rhs)
+      : CompareBase<C>(rhs.comp()), pLines(nullptr), numElements(0),
+        alloc(std::allocator_traits<A>::select_on_container_copy_construction(rhs.alloc))
+   {
+      build(rhs.begin(), rhs.size());
+   }
+   frozen_set(frozen_set && rhs)
+      : CompareBase<C>(rhs.comp()), pLines(rhs.pLines), numElements(rhs.numElements), alloc(std::move(rhs.alloc))
+   {
+      rhs.pLines = nullptr;
+      rhs.numElements = 0;
+   }
+  ~frozen_set()
+   {
+      clear();
+   }
+
+   //
+   // Assign
+   //
+   frozen_set & operator = (const frozen_set & rhs)
+   {
+      if (this != &rhs)
+      {
+         clear();
+         this->comp() = rhs.comp();
+         build(rhs.begin(), rhs.size());
+      }
+      return *this;
+   }
+   frozen_set & operator = (frozen_set && rhs)
+   {
+      clear();
+      swap(rhs);
+      return *this;
+   }
+   void swap(frozen_set & rhs)
+   {
+      std::swap(this->comp(), rhs.comp());
+      std::swap(pLines, rhs.pLines);
+      std::swap(numElements, rhs.numElements);
+      std::swap(alloc, rhs.alloc);
+   }
+
+   // thawed back out into a tree, built bottom-up since it comes out in order
+   set<T, C, A> to_set() const
+   {
+      return set<T, C, A>(sorted_unique, begin(), end(), key_comp(), get_allocator());
+   }
+
+   //
+   // Iterator
+   //
+   iterator begin() const noexcept
+   {
+      // all the way down on the left
+      size_t k = 1;
+      while (2 * k <= numElements)
+         k = 2 * k;
+      return iterator(numElements ? k : 0, this);
+   }
+   iterator end() const noexcept
+   {
+      return iterator(0, this);
+   }
+   reverse_iterator rbegin() const noexcept { return reverse_iterator(end());   }
+   reverse_iterator rend()   const noexcept { return reverse_iterator(begin()); }
+
+   //
+   // Access
+   //
+   iterator lower_bound(const T & t) const
+   {
+      return iterator(lowerIndex(t), this);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator lower_bound(const K & k) const
+   {
+      return iterator(lowerIndex(k), this);
+   }
+   iterator upper_bound(const T & t) const
+   {
+      return iterator(upperIndex(t), this);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator upper_bound(const K & k) const
+   {
+      return iterator(upperIndex(k), this);
+   }
+   std::pair<iterator, iterator> equal_range(const T & t) const
+   {
+      return std::make_pair(lower_bound(t), upper_bound(t));
+   }
+
+   // lower_bound, and then one more comparison to see if it is t or something bigger
+   iterator find(const T & t) const
+   {
+      return iterator(findIndex(t), this);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator find(const K & k) const
+   {
+      return iterator(findIndex(k), this);
+   }
+   bool contains(const T & t) const
+   {
+      return findIndex(t) != 0;
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   bool contains(const K & k) const
+   {
+      return findIndex(k) != 0;
+   }
+   size_t count(const T & t) const
+   {
+      return contains(t) ? 1 : 0;
+   }
+
+   //
+   // Status
+   //
+   bool   empty() const noexcept { return numElements == 0; }
+   size_t size()  const noexcept { return numElements;      }
+   allocator_type get_allocator() const { return alloc; }
+   key_compare   key_comp()   const { return this->comp(); }
+   value_compare value_comp() const { return this->comp(); }
+
+private:
+
+   /************************************************
+    * LINE
+    * One cache line. The array is made of these so it
+    * starts on a line and every sixteenth int does too
+    ***********************************************/
+   struct alignas(64) Line
+   {
+      unsigned char bytes[64];
+   };
+   using LineAlloc  = typename std::allocator_traits<A>::template rebind_alloc<Line>;
+   using LineTraits = std::allocator_traits<LineAlloc>;
+
+   // How far down the line we ask for: the descendants this many times k
+   // fill the cache line that starts at b[k * STRIDE]
+   static constexpr size_t STRIDE = sizeof(T) >= 64 ? 1 : 64 / sizeof(T);
+
+   template <class L, class R>
+   bool less(const L & lhs, const R & rhs) const { return this->comp()(lhs, rhs); }
+
+   // b[1] through b[numElements], b[0] is never built
+   T* slot(size_t k) const { return reinterpret_cast<T*>(pLines) + k; }
+   const T & b(size_t k) const { return *std::launder(slot(k)); }
+
+   static size_t numLines(size_t n)
+   {
+      return ((n + 1) * sizeof(T) + sizeof(Line) - 1) / sizeof(Line);
+   }
+
+   // ask for the cache line holding b[k] without waiting for it
+   static void prefetch(const void* p)
+   {
+#if defined(__GNUC__) || defined(__clang__)
+      __builtin_prefetch(p);
+#elif defined(_M_X64) || defined(_M_IX86)
+      _mm_prefetch(reinterpret_cast<const char*>(p), _MM_HINT_T0);
+#endif
+   }
+
+   // How many 1 bits at the bottom of k. Going right in a search sets a bit,
+   // so the last time we went left is this many steps plus one back up
+   static int trailingOnes(size_t k)
+   {
+#if defined(__GNUC__) || defined(__clang__)
+      return __builtin_ctzll(~(unsigned long long)k);
+#elif defined(_M_X64)
+      unsigned long index;
+      _BitScanForward64(&index, ~(unsigned long long)k);
+      return (int)index;
+#else
+      int count = 0;
+      for (; k & 1; k >>= 1)
+         count++;
+      return count;
+#endif
+   }
+
+   // Down the tree, right when b[k] is less than key. We fall off the bottom
+   // and back up to the last place we went left, which is the first element
+   // not less than key. Nothing to go back up to means every one was less
+   template <class K>
+   size_t lowerIndex(const K & key) const
+   {
+      size_t k = 1;
+      while (k <= numElements)
+      {
+         prefetch(slot(std::min(k * STRIDE, numElements)));
+         k = 2 * k + less(b(k), key);
+      }
+      return k >> (trailingOnes(k) + 1);
+   }
+
+   // same, but equal elements send us right
+   template <class K>
+   size_t upperIndex(const K & key) const
+   {
+      size_t k = 1;
+      while (k <= numElements)
+      {
+         prefetch(slot(std::min(k * STRIDE, numElements)));
+         k = 2 * k + !less(key, b(k));
+      }
+      return k >> (trailingOnes(k) + 1);
+   }
+
+   template <class K>
+   size_t findIndex(const K & key) const
+   {
+      size_t k = lowerIndex(key);
+      return (k != 0 && !less(key, b(k))) ? k : 0;
+   }
+
+   // Lay n sorted elements out by walking the numbering in order: left
+   // subtree, this one, right subtree. That visits 1..n in sorted order
+   template <class Iterator>
+   void build(Iterator it, size_t n)
+   {
+      if (n == 0)
+         return;
+      LineAlloc a(alloc);
+      pLines = LineTraits::allocate(a, numLines(n));
+      numElements = n;
+      size_t numBuilt = 0;
+      try
+      {
+         place(it, 1, numBuilt);
+      }
+      catch (...)
+      {
+         // the ones that were built are the first numBuilt of the in-order walk
+         for (iterator itBuilt = begin(); numBuilt > 0; ++itBuilt, --numBuilt)
+            std::allocator_traits<A>::destroy(alloc, slot(itBuilt.k));
+         LineTraits::deallocate(a, pLines, numLines(n));
+         pLines = nullptr;
+         numElements = 0;
+         throw;
+      }
+   }
+   template <class Iterator>
+   void place(Iterator & it, size_t k, size_t & numBuilt)
+   {
+      if (k > numElements)
+         return;
+      place(it, 2 * k, numBuilt);
+      std::allocator_traits<A>::construct(alloc, slot(k), *it);
+      ++it;
+      numBuilt++;
+      place(it, 2 * k + 1, numBuilt);
+   }
+
+   void clear()
+   {
+      if (!pLines)
+         return;
+      for (size_t k = 1; k <= numElements; k++)
+         std::allocator_traits<A>::destroy(alloc, slot(k));
+      LineAlloc a(alloc);
+      LineTraits::deallocate(a, pLines, numLines(numElements));
+      pLines = nullptr;
+      numElements = 0;
+   }
+
+   Line*  pLines;        // the elements, starting at slot 1
+   size_t numElements;
+   A      alloc;         // rebound to get whole cache lines
+};
+
+/**************************************************
+ * FROZEN SET ITERATOR
+ * Just the index into the Eytzinger array. The
+ * end is 0, the one slot that is never used
+ *************************************************/
+template <typename T, typename C, typename A>
+class frozen_set <T, C, A> :: iterator
+{
+   friend class ::TestFrozenSet; // give unit tests access to the privates
+   friend class frozen_set<T, C, A>;
+public:
+   using iterator_category = std::bidirectional_iterator_tag;
+   using value_type        = T;
+   using difference_type   = std::ptrdiff_t;
+   using pointer           = const T*;
+   using reference         = const T&;
+
+   iterator() : k(0), pSet(nullptr)
+   {
+   }
+   iterator(size_t k, const frozen_set* pSet) : k(k), pSet(pSet)
+   {
+   }
+
+   // equals, not equals operator
+   bool operator == (const iterator & rhs) const { return k == rhs.k; }
+   bool operator != (const iterator & rhs) const { return k != rhs.k; }
+
+   // dereference operator
+   const T & operator * () const { return pSet->b(k); }
+   const T * operator -> () const { return &pSet->b(k); }
+
+   // Next is all the way left in the right subtree if there is one.
+   // Otherwise climb out of every right child and up one more
+   iterator & operator ++ ()
+   {
+      size_t n = pSet->numElements;
+      if (2 * k + 1 <= n)
+      {
+         k = 2 * k + 1;
+         while (2 * k <= n)
+            k = 2 * k;
+      }
+      else
+         k >>= frozen_set::trailingOnes(k) + 1;
+      return *this;
+   }
+   iterator operator ++ (int)
+   {
+      iterator tmp(*this);
+      ++(*this);
+      return tmp;
+   }
+
+   // The mirror image. Backing up from the end is all the way right
+   iterator & operator -- ()
+   {
+      size_t n = pSet->numElements;
+      if (k == 0)
+      {
+         if (n)
+            for (k = 1; 2 * k + 1 <= n; k = 2 * k + 1);
+      }
+      else if (2 * k <= n)
+      {
+         k = 2 * k;
+         while (2 * k + 1 <= n)
+            k = 2 * k + 1;
+      }
+      else
+         k >>= frozen_set::trailingOnes(~k) + 1;   // climb out of every left child
+      return *this;
+   }
+   iterator operator -- (int)
+   {
+      iterator tmp(*this);
+      --(*this);
+      return tmp;
+   }
+
+private:
+   size_t k;                  // where in the array, 0 is the end
+   const frozen_set* pSet;
+};
+
+/*****************************************************
+ * SWAP
+ * Stand-alone frozen set swap
+ ****************************************************/
+template <typename T, typename C, typename A>
+void swap(frozen_set <T, C, A> & lhs, frozen_set <T, C, A> & rhs)
+{
+   lhs.swap(rhs);
+}
+
+}; // namespace custom
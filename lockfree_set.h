@@ -0,0 +1,644 @@
+/***********************************************************************
+ * Header:
+ *    Lock-Free Set
+ * Summary:
+ *    An ordered set that many threads can insert into, erase from, and
+ *    search all at once without a single lock. It is a skip list: every
+ *    element is on the bottom list, about a quarter of them are on the
+ *    list above that too, a quarter of those on the list above that, and
+ *    so on, so a search skips along the top and drops down as it gets
+ *    close, about log n steps in all.
+ *
+ *    Every change is one compare-and-swap on one link. Erasing is two
+ *    steps: first the links out of the node get a mark in their low bit,
+ *    which says the node is on its way out and nobody may link anything
+ *    after it, then whoever walks past it next unlinks it. The mark on the
+ *    bottom link is the moment the element is gone. This is the skip
+ *    list from Herlihy and Shavit, after Fraser.
+ *
+ *    A node that has been unlinked may still have somebody standing on
+ *    it, so it goes to the epoch domain to be freed once nobody can.
+ *
+ *    The interface is custom::set's, as far as it can be when the set is
+ *    changing underneath. An iterator keeps its thread pinned, so the
+ *    node it is on never goes away, but that node may be erased while we
+ *    hold it, and walking on from it sees whatever is there by then.
+ *    Hold onto one for as short a time as you can, since nothing anybody
+ *    erases is freed while you do, and only use it on the thread that
+ *    made it.
+ *
+ *    This will contain the class definition of:
+ *        lockfree_set          : A lock-free skip list with the set interface
+ *        lockfree_set::iterator: An iterator through lockfree_set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>     // for size_t and std::ptrdiff_t
+#include <cstdint>     // for uintptr_t
+#include <atomic>      // every link is one
+#include <new>         // for placement new
+#include <memory>      // for std::allocator_traits
+#include <functional>  // for std::less
+#include <iterator>    // for std::forward_iterator_tag
+#include <utility>     // for std::pair
+#include "bst.h"       // for CompareBase
+#include "epoch.h"     // to know when an erased node can go
+
+class TestLockFreeSet;  // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * LOCK-FREE SET
+ * A skip list where every change is a compare-and-swap
+ * on one link, and erased nodes go when nobody can see them
+ ***********************************************/
+template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
+class lockfree_set : private CompareBase<C>
+{
+   friend class ::TestLockFreeSet; // give unit tests access to the privates
+   struct Node;
+public:
+   class iterator;
+   using key_type       = T;
+   using value_type     = T;
+   using size_type      = size_t;
+   using key_compare    = C;
+   using value_compare  = C;
+   using allocator_type = A;
+   using const_iterator = iterator;
+
+   //
+   // Construct
+   //
+   lockfree_set(const C & comp = C(), const A & a = A()) : CompareBase<C>(comp), alloc(a), numElements(0)
+   {
+      for (auto & link : head)
+         link.store(0, std::memory_order_relaxed);
+   }
+   lockfree_set(const std::initializer_list <T> & il, const C & comp = C(), const A & a = A())
+      : lockfree_set(comp, a)
+   {
+      insert(il);
+   }
+   template <class Iterator>
+   lockfree_set(Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+      : lockfree_set(comp, a)
+   {
+      insert(first, last);
+   }
+
+   // whatever is in rhs as we walk it
+   lockfree_set(const lockfree_set & rhs)
+      : lockfree_set(rhs.comp(), std::allocator_traits<A>::select_on_container_copy_construction(rhs.alloc))
+   {
+      insert(rhs.begin(), rhs.end());
+   }
+
+   // Other threads may be halfway through a change to either side, so
+   // there is no moving one of these or assigning one over another
+   lockfree_set & operator = (const lockfree_set &) = delete;
+
+   // Nobody else is using us any more, so whatever is still linked is
+   // still in the set. The domain frees what was erased after this
+  ~lockfree_set()
+   {
+      Node* pNode = pointer(head[0].load(std::memory_order_relaxed));
+      while (pNode)
+      {
+         Node* pNext = pointer(pNode->next[0].load(std::memory_order_relaxed));
+         destroyNode(pNode);
+         pNode = pNext;
+      }
+   }
+
+   //
+   // Iterator
+   //
+   iterator begin() const
+   {
+      auto guard = domain.pin();
+      return iterator(firstLive(head[0].load(std::memory_order_acquire)), std::move(guard));
+   }
+   iterator end() const noexcept
+   {
+      return iterator();
+   }
+
+   //
+   // Access
+   //
+   template <class K>
+   iterator find(const K & k) const
+   {
+      auto guard = domain.pin();
+      Node* pNode = search<false>(k);
+      if (pNode && less(k, pNode->data))
+         pNode = nullptr;
+      return iterator(pNode, std::move(guard));
+   }
+   template <class K>
+   iterator lower_bound(const K & k) const
+   {
+      auto guard = domain.pin();
+      return iterator(search<false>(k), std::move(guard));
+   }
+   template <class K>
+   iterator upper_bound(const K & k) const
+   {
+      auto guard = domain.pin();
+      return iterator(search<true>(k), std::move(guard));
+   }
+
+   // no iterator to make, so no second pin
+   template <class K>
+   bool contains(const K & k) const
+   {
+      auto guard = domain.pin();
+      Node* pNode = search<false>(k);
+      return pNode && !less(k, pNode->data);
+   }
+   template <class K>
+   size_t count(const K & k) const
+   {
+      return contains(k) ? 1 : 0;
+   }
+
+   //
+   // Status
+   //
+
+   // With other threads inserting and erasing this is only ever a close
+   // guess, but it is exact whenever nobody is
+   size_t size() const noexcept
+   {
+      return numElements.load(std::memory_order_relaxed);
+   }
+   bool empty() const noexcept
+   {
+      return size() == 0;
+   }
+   allocator_type get_allocator() const noexcept
+   {
+      return alloc;
+   }
+   key_compare key_comp() const
+   {
+      return this->comp();
+   }
+   value_compare value_comp() const
+   {
+      return this->comp();
+   }
+
+   //
+   // Insert
+   //
+   std::pair<iterator, bool> insert(const T & t)
+   {
+      return emplace(t);
+   }
+   std::pair<iterator, bool> insert(T && t)
+   {
+      return emplace(std::move(t));
+   }
+   template <class... Args>
+   std::pair<iterator, bool> emplace(Args&&... args);
+
+   template <class Iterator>
+   void insert(Iterator first, Iterator last)
+   {
+      for (; first != last; ++first)
+         emplace(*first);
+   }
+   void insert(const std::initializer_list <T> & il)
+   {
+      insert(il.begin(), il.end());
+   }
+
+   //
+   // Remove
+   //
+   template <class K>
+   size_t erase(const K & k);
+
+   // erase what it is on, and hand back the one after it
+   iterator erase(const iterator & it)
+   {
+      iterator itNext = it;
+      ++itNext;
+      erase(*it);
+      return itNext;
+   }
+
+   // one at a time, so this is as safe as any other erase while others work
+   void clear()
+   {
+      for (auto it = begin(); it != end(); it = erase(it))
+         ;
+   }
+
+private:
+   static constexpr int MAX_HEIGHT = 16;    // a quarter as many on each level up, enough for billions
+   using Link = std::atomic<uintptr_t>;     // a pointer to the next node, and the mark in bit 0
+
+   /*****************************************
+    * NODE
+    * The element and its links, as many as it is tall.
+    * The links go right after the node in the same block
+    *****************************************/
+   struct Node
+   {
+      template <class... Args>
+      Node(int height, Link* next, Args&&... args)
+         : data(std::forward<Args>(args)...), height(height), next(next), numDone(0)
+      {
+      }
+      T data;
+      int height;                // how many levels this one is on
+      Link* next;                // next[0] is the bottom level
+      std::atomic<int> numDone;  // the inserter and the eraser each check in, the second one retires it
+   };
+
+   using NodeAlloc  = typename std::allocator_traits<A>::template rebind_alloc<Node>;
+   using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+   static Node* pointer(uintptr_t link)   { return reinterpret_cast<Node*>(link & ~uintptr_t(1)); }
+   static bool  isMarked(uintptr_t link)  { return (link & 1) != 0; }
+   static uintptr_t linkTo(Node* pNode)   { return reinterpret_cast<uintptr_t>(pNode); }
+
+   template <class K1, class K2>
+   bool less(const K1 & lhs, const K2 & rhs) const { return this->comp()(lhs, rhs); }
+
+   // the links out of pNode, or out of the head when pNode is null
+   Link* linksOf(Node* pNode) const
+   {
+      return pNode ? pNode->next : head;
+   }
+
+   // the first node from here on down the bottom level that is not on its way out
+   static Node* firstLive(uintptr_t link)
+   {
+      Node* pNode = pointer(link);
+      while (pNode && isMarked(pNode->next[0].load(std::memory_order_acquire)))
+         pNode = pointer(pNode->next[0].load(std::memory_order_acquire));
+      return pNode;
+   }
+
+   template <bool OR_EQUAL, class K>
+   Node* search(const K & k) const;
+   template <class K>
+   bool locate(const K & k, Link* preds[], Node* succs[]);
+   void finish(Node* pNode);
+
+   int randomHeight();
+   template <class... Args>
+   Node* makeNode(int height, Args&&... args);
+   void destroyNode(Node* pNode);
+   static void reclaim(void* context, void* p)
+   {
+      static_cast<lockfree_set*>(context)->destroyNode(static_cast<Node*>(p));
+   }
+
+   // How many Node-sized pieces a node of this height takes, links and all
+   static size_t numBlocks(int height)
+   {
+      return 1 + (height * sizeof(Link) + sizeof(Node) - 1) / sizeof(Node);
+   }
+
+   NodeAlloc alloc;                           // where the nodes come from
+   mutable Link head[MAX_HEIGHT];             // the links out of the front of every level
+   std::atomic<size_t> numElements;           // how many, as of the last change
+   mutable epoch_domain domain;               // goes before alloc does, and frees what was erased
+};
+
+/**************************************************
+ * LOCK-FREE SET ITERATOR
+ * A node and a pin that keeps it from being freed
+ *************************************************/
+template <typename T, typename C, typename A>
+class lockfree_set <T, C, A> ::iterator
+{
+   friend class ::TestLockFreeSet;
+   friend class lockfree_set;
+public:
+   using iterator_category = std::forward_iterator_tag;
+   using value_type        = T;
+   using difference_type   = std::ptrdiff_t;
+   using pointer           = const T*;
+   using reference         = const T&;
+
+   iterator() : pNode(nullptr)
+   {
+   }
+
+   bool operator == (const iterator & rhs) const { return pNode == rhs.pNode; }
+   bool operator != (const iterator & rhs) const { return pNode != rhs.pNode; }
+
+   const T & operator * () const
+   {
+      assert(pNode);
+      return pNode->data;
+   }
+   const T * operator -> () const
+   {
+      return &**this;
+   }
+
+   // along the bottom level, stepping over anything on its way out
+   iterator & operator ++ ()
+   {
+      assert(pNode);
+      pNode = lockfree_set::firstLive(pNode->next[0].load(std::memory_order_acquire));
+      if (!pNode)
+         guard = epoch_domain::guard();   // end() holds nothing up
+      return *this;
+   }
+   iterator operator ++ (int)
+   {
+      iterator tmp(*this);
+      ++(*this);
+      return tmp;
+   }
+
+private:
+   iterator(Node* pNode, epoch_domain::guard && guard) : pNode(pNode), guard(std::move(guard))
+   {
+      if (!pNode)
+         this->guard = epoch_domain::guard();
+   }
+
+   Node* pNode;                  // null is end()
+   epoch_domain::guard guard;    // so pNode is not freed while we are on it
+};
+
+/*************************************************
+ * SEARCH
+ * Read only: step over anything marked without unlinking it.
+ * The first node not less than k, or with OR_EQUAL the first
+ * one greater than k. The caller is pinned
+ *************************************************/
+template <typename T, typename C, typename A>
+template <bool OR_EQUAL, class K>
+typename lockfree_set <T, C, A> ::Node* lockfree_set <T, C, A> ::search(const K & k) const
+{
+   Node* pPred = nullptr;
+   Node* pCurr = nullptr;
+   for (int level = MAX_HEIGHT - 1; level >= 0; level--)
+   {
+      pCurr = pointer(linksOf(pPred)[level].load(std::memory_order_acquire));
+      while (pCurr)
+      {
+         uintptr_t succ = pCurr->next[level].load(std::memory_order_acquire);
+         if (isMarked(succ))
+            pCurr = pointer(succ);
+         else if (OR_EQUAL ? !less(k, pCurr->data) : less(pCurr->data, k))
+         {
+            pPred = pCurr;
+            pCurr = pointer(succ);
+         }
+         else
+            break;
+      }
+   }
+   return pCurr;
+}
+
+/*************************************************
+ * LOCATE
+ * Where k goes on every level: preds[level] is the link to
+ * change and succs[level] is what it points to now. Marked
+ * nodes on the way get unlinked, and if somebody changes a
+ * link under us we start over. True if k is there. The caller
+ * is pinned
+ *************************************************/
+template <typename T, typename C, typename A>
+template <class K>
+bool lockfree_set <T, C, A> ::locate(const K & k, Link* preds[], Node* succs[])
+{
+retry:
+   Node* pPred = nullptr;
+   for (int level = MAX_HEIGHT - 1; level >= 0; level--)
+   {
+      Link* pLink = &linksOf(pPred)[level];
+      uintptr_t curr = pLink->load(std::memory_order_acquire);
+      if (isMarked(curr))
+         goto retry;               // the node we are standing on is on its way out
+      Node* pCurr = pointer(curr);
+      while (pCurr)
+      {
+         uintptr_t succ = pCurr->next[level].load(std::memory_order_acquire);
+         while (isMarked(succ))
+         {
+            // pCurr is on its way out, take it off this level
+            if (!pLink->compare_exchange_strong(curr, succ & ~uintptr_t(1),
+                                                std::memory_order_acq_rel, std::memory_order_acquire))
+               goto retry;
+            curr = succ & ~uintptr_t(1);
+            pCurr = pointer(curr);
+            if (!pCurr)
+               break;
+            succ = pCurr->next[level].load(std::memory_order_acquire);
+         }
+         if (pCurr && less(pCurr->data, k))
+         {
+            pPred = pCurr;
+            pLink = &pCurr->next[level];
+            curr = succ;
+            pCurr = pointer(curr);
+         }
+         else
+            break;
+      }
+      preds[level] = pLink;
+      succs[level] = pCurr;
+   }
+   return succs[0] && !less(k, succs[0]->data);
+}
+
+/*************************************************
+ * EMPLACE
+ * Link the bottom level first, which is the moment it is
+ * in the set, then the levels above one at a time. If it
+ * gets erased while we are still linking, stop
+ *************************************************/
+template <typename T, typename C, typename A>
+template <class... Args>
+std::pair<typename lockfree_set <T, C, A> ::iterator, bool> lockfree_set <T, C, A> ::emplace(Args&&... args)
+{
+   auto guard = domain.pin();
+   Link* preds[MAX_HEIGHT];
+   Node* succs[MAX_HEIGHT];
+   int height = randomHeight();
+   Node* pNode = makeNode(height, std::forward<Args>(args)...);
+   const T & t = pNode->data;
+
+   for (;;)
+   {
+      if (locate(t, preds, succs))
+      {
+         // nobody else ever saw it, so it can go right now
+         destroyNode(pNode);
+         return std::pair<iterator, bool>(iterator(succs[0], std::move(guard)), false);
+      }
+      for (int level = 0; level < height; level++)
+         pNode->next[level].store(linkTo(succs[level]), std::memory_order_relaxed);
+      uintptr_t expected = linkTo(succs[0]);
+      if (preds[0]->compare_exchange_strong(expected, linkTo(pNode),
+                                            std::memory_order_release, std::memory_order_relaxed))
+         break;
+   }
+   numElements.fetch_add(1, std::memory_order_relaxed);
+
+   for (int level = 1; level < height; level++)
+   {
+      for (;;)
+      {
+         // Point our link at the successor, unless an eraser has marked it
+         uintptr_t link = pNode->next[level].load(std::memory_order_acquire);
+         if (isMarked(link))
+         {
+            finish(pNode);
+            return std::pair<iterator, bool>(iterator(pNode, std::move(guard)), true);
+         }
+         if (pointer(link) != succs[level] &&
+             !pNode->next[level].compare_exchange_strong(link, linkTo(succs[level]),
+                                                         std::memory_order_release, std::memory_order_acquire))
+            continue;
+
+         uintptr_t expected = linkTo(succs[level]);
+         if (preds[level]->compare_exchange_strong(expected, linkTo(pNode),
+                                                   std::memory_order_release, std::memory_order_relaxed))
+            break;
+
+         // something changed, look again. If we are not where we were, we were erased
+         locate(t, preds, succs);
+         if (succs[0] != pNode)
+         {
+            finish(pNode);
+            return std::pair<iterator, bool>(iterator(pNode, std::move(guard)), true);
+         }
+      }
+   }
+   finish(pNode);
+   return std::pair<iterator, bool>(iterator(pNode, std::move(guard)), true);
+}
+
+/*************************************************
+ * ERASE
+ * Mark the links top down. Whoever marks the bottom one
+ * erased it, and unlinks it on the way out
+ *************************************************/
+template <typename T, typename C, typename A>
+template <class K>
+size_t lockfree_set <T, C, A> ::erase(const K & k)
+{
+   auto guard = domain.pin();
+   Link* preds[MAX_HEIGHT];
+   Node* succs[MAX_HEIGHT];
+   if (!locate(k, preds, succs))
+      return 0;
+   Node* pVictim = succs[0];
+
+   for (int level = pVictim->height - 1; level >= 1; level--)
+   {
+      uintptr_t link = pVictim->next[level].load(std::memory_order_acquire);
+      while (!isMarked(link) &&
+             !pVictim->next[level].compare_exchange_weak(link, link | 1,
+                                                         std::memory_order_acq_rel, std::memory_order_acquire))
+         ;
+   }
+
+   uintptr_t link = pVictim->next[0].load(std::memory_order_acquire);
+   for (;;)
+   {
+      if (isMarked(link))
+         return 0;                 // somebody else erased it first
+      if (pVictim->next[0].compare_exchange_weak(link, link | 1,
+                                                 std::memory_order_acq_rel, std::memory_order_acquire))
+         break;
+   }
+   numElements.fetch_sub(1, std::memory_order_relaxed);
+
+   locate(k, preds, succs);        // unlink it from every level it is on
+   if (pVictim->numDone.fetch_add(1, std::memory_order_acq_rel) == 1)
+      domain.retire(pVictim, reclaim, this);
+   return 1;
+}
+
+/*************************************************
+ * FINISH
+ * The inserter is done linking. If the node was erased in
+ * the meantime we may have linked it back onto a level after
+ * the eraser cleaned up, so clean up again. Whichever of
+ * the two gets here second hands the node to the domain
+ *************************************************/
+template <typename T, typename C, typename A>
+void lockfree_set <T, C, A> ::finish(Node* pNode)
+{
+   if (isMarked(pNode->next[0].load(std::memory_order_acquire)))
+   {
+      Link* preds[MAX_HEIGHT];
+      Node* succs[MAX_HEIGHT];
+      locate(pNode->data, preds, succs);
+   }
+   if (pNode->numDone.fetch_add(1, std::memory_order_acq_rel) == 1)
+      domain.retire(pNode, reclaim, this);
+}
+
+/*************************************************
+ * RANDOM HEIGHT
+ * One level, then a one in four chance of each more.
+ * Every thread flips its own coins
+ *************************************************/
+template <typename T, typename C, typename A>
+int lockfree_set <T, C, A> ::randomHeight()
+{
+   thread_local uint64_t state = 0x9e3779b97f4a7c15ull ^ reinterpret_cast<uintptr_t>(&state);
+   state ^= state << 13;
+   state ^= state >> 7;
+   state ^= state << 17;
+   int height = 1;
+   for (uint64_t bits = state; height < MAX_HEIGHT && (bits & 3) == 0; bits >>= 2)
+      height++;
+   return height;
+}
+
+/*************************************************
+ * MAKE NODE and DESTROY NODE
+ * One block for the node and its links
+ *************************************************/
+template <typename T, typename C, typename A>
+template <class... Args>
+typename lockfree_set <T, C, A> ::Node* lockfree_set <T, C, A> ::makeNode(int height, Args&&... args)
+{
+   Node* pNode = NodeTraits::allocate(alloc, numBlocks(height));
+   Link* next = reinterpret_cast<Link*>(pNode + 1);
+   for (int level = 0; level < height; level++)
+      new (next + level) Link(0);
+   try
+   {
+      NodeTraits::construct(alloc, pNode, height, next, std::forward<Args>(args)...);
+   }
+   catch (...)
+   {
+      NodeTraits::deallocate(alloc, pNode, numBlocks(height));
+      throw;
+   }
+   return pNode;
+}
+
+template <typename T, typename C, typename A>
+void lockfree_set <T, C, A> ::destroyNode(Node* pNode)
+{
+   int height = pNode->height;
+   NodeTraits::destroy(alloc, pNode);
+   NodeTraits::deallocate(alloc, pNode, numBlocks(height));
+}
+
+} // namespace custom
@@ -0,0 +1,410 @@
+/***********************************************************************
+ * Header:
+ *    Map
+ * Summary:
+ *    A map is a set of keys where every key drags a value along with
+ *    it. We do not need a second tree for that: the BST just holds
+ *    std::pair<const K, V> and only ever looks at the key to decide
+ *    where a pair goes. That way finding the key finds the value too.
+ *
+ *    This will contain the class definition of:
+ *        map                 : A class that represents a Map
+ *        map::iterator       : An iterator through Map
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <utility>     // for std::pair
+#include <tuple>       // for std::forward_as_tuple
+#include <stdexcept>   // for std::out_of_range
+#include <functional>  // for std::less
+#include <memory>      // for std::allocator
+#include <iterator>    // for std::bidirectional_iterator_tag
+#include "bst.h"
+
+class TestMap;        // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * MAP COMPARE
+ * Orders the pairs in the tree by their keys. It is transparent so
+ * the BST can be asked about a bare key without building a pair
+ ***********************************************/
+template <typename K, typename V, typename C>
+class MapCompare : private CompareBase<C>
+{
+public:
+   using is_transparent = void;
+
+   MapCompare(const C& comp = C()) : CompareBase<C>(comp) {}
+
+   bool operator()(const std::pair<const K, V>& lhs, const std::pair<const K, V>& rhs) const
+   {
+      return this->comp()(lhs.first, rhs.first);
+   }
+   bool operator()(const std::pair<const K, V>& lhs, const K& rhs) const
+   {
+      return this->comp()(lhs.first, rhs);
+   }
+   bool operator()(const K& lhs, const std::pair<const K, V>& rhs) const
+   {
+      return this->comp()(lhs, rhs.first);
+   }
+
+   C key_comp() const { return this->comp(); }
+};
+
+/************************************************
+ * MAP
+ * A class that represents a Map
+ * Every lookup, insert, or assign is one trip down the tree
+ ***********************************************/
+template <typename K, typename V, typename C = std::less<K>,
+          typename A = std::allocator<std::pair<const K, V>>>
+class map
+{
+   friend class ::TestMap; // give unit tests access to the privates
+   template <class KK, class VV, class CC, class AA>
+   friend void swap(map<KK, VV, CC, AA>& lhs, map<KK, VV, CC, AA>& rhs);
+public:
+   using key_type       = K;
+   using mapped_type    = V;
+   using value_type     = std::pair<const K, V>;
+   using key_compare    = C;
+   using allocator_type = A;
+
+   //
+   // Construct
+   //
+   map()
+   {
+   }
+   explicit map(const C & comp, const A & a = A()) : bst(MapCompare<K, V, C>(comp), a)
+   {
+   }
+   explicit map(const A & a) : bst(a)
+   {
+   }
+   map(const map & rhs) : bst(rhs.bst)
+   {
+   }
+   map(map && rhs) : bst(std::move(rhs.bst))
+   {
+   }
+   map(const std::initializer_list <value_type> & il, const C & comp = C(), const A & a = A())
+      : bst(MapCompare<K, V, C>(comp), a)
+   {
+      insert(il);
+   }
+   template <class Iterator>
+   map(Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+      : bst(MapCompare<K, V, C>(comp), a)
+   {
+      insert(first, last);
+   }
+  ~map() { }
+
+   //
+   // Assign
+   //
+   map & operator = (const map & rhs)
+   {
+      bst = rhs.bst;
+      return *this;
+   }
+   map & operator = (map && rhs)
+   {
+      bst = std::move(rhs.bst);
+      return *this;
+   }
+   map & operator = (const std::initializer_list <value_type> & il)
+   {
+      clear();
+      insert(il);
+      return *this;
+   }
+   void swap(map & rhs)
+   {
+      bst.swap(rhs.bst);
+   }
+
+   //
+   // Iterator
+   //
+   class iterator;
+   iterator begin() const noexcept
+   {
+      return bst.begin();
+   }
+   iterator end() const noexcept
+   {
+      return bst.end();
+   }
+   using reverse_iterator = std::reverse_iterator<iterator>;
+   reverse_iterator rbegin() const noexcept
+   {
+      return reverse_iterator(end());
+   }
+   reverse_iterator rend() const noexcept
+   {
+      return reverse_iterator(begin());
+   }
+
+   //
+   // Access
+   //
+
+   // the value for k, a default one is made only if k is not there yet
+   V & operator [] (const K & k)
+   {
+      return try_emplace(k).first->second;
+   }
+   V & operator [] (K && k)
+   {
+      return try_emplace(std::move(k)).first->second;
+   }
+
+   // the value for k, which had better be there
+   V & at(const K & k)
+   {
+      auto pNode = bst.findNode(k);
+      if (!pNode)
+         throw std::out_of_range("custom::map::at: key not found");
+      return pNode->data.second;
+   }
+   const V & at(const K & k) const
+   {
+      auto pNode = bst.findNode(k);
+      if (!pNode)
+         throw std::out_of_range("custom::map::at: key not found");
+      return pNode->data.second;
+   }
+
+   iterator find(const K & k)
+   {
+      return bst.find(k);
+   }
+   size_t count(const K & k) const
+   {
+      return bst.findNode(k) ? 1 : 0;
+   }
+   iterator lower_bound(const K & k) const
+   {
+      return bst.lower_bound(k);
+   }
+   iterator upper_bound(const K & k) const
+   {
+      return bst.upper_bound(k);
+   }
+
+   //
+   // Insert
+   //
+
+   // Build the value from args only if k is missing. If k is already there
+   // nothing is built, copied, or moved, not even args
+   template <class... Args>
+   std::pair<iterator, bool> try_emplace(const K & k, Args&&... args)
+   {
+      auto result = bst.findOrInsert(k, [&]()
+      {
+         return bst.createNode(std::in_place, std::piecewise_construct,
+                               std::forward_as_tuple(k),
+                               std::forward_as_tuple(std::forward<Args>(args)...));
+      });
+      return std::pair<iterator, bool>(result.first, result.second);
+   }
+   template <class... Args>
+   std::pair<iterator, bool> try_emplace(K && k, Args&&... args)
+   {
+      auto result = bst.findOrInsert(k, [&]()
+      {
+         return bst.createNode(std::in_place, std::piecewise_construct,
+                               std::forward_as_tuple(std::move(k)),
+                               std::forward_as_tuple(std::forward<Args>(args)...));
+      });
+      return std::pair<iterator, bool>(result.first, result.second);
+   }
+
+   // put m in for k, whether or not k was there before
+   template <class M>
+   std::pair<iterator, bool> insert_or_assign(const K & k, M && m)
+   {
+      auto result = bst.findOrInsert(k, [&]()
+      {
+         return bst.createNode(std::in_place, k, std::forward<M>(m));
+      });
+      if (!result.second)
+         result.first.pNode->data.second = std::forward<M>(m);
+      return std::pair<iterator, bool>(result.first, result.second);
+   }
+   template <class M>
+   std::pair<iterator, bool> insert_or_assign(K && k, M && m)
+   {
+      auto result = bst.findOrInsert(k, [&]()
+      {
+         return bst.createNode(std::in_place, std::move(k), std::forward<M>(m));
+      });
+      if (!result.second)
+         result.first.pNode->data.second = std::forward<M>(m);
+      return std::pair<iterator, bool>(result.first, result.second);
+   }
+
+   // like set, a key that is already there keeps its old value
+   std::pair<iterator, bool> insert(const value_type & t)
+   {
+      auto result = bst.findOrInsert(t.first, [&]() { return bst.createNode(t); });
+      return std::pair<iterator, bool>(result.first, result.second);
+   }
+   std::pair<iterator, bool> insert(value_type && t)
+   {
+      auto result = bst.findOrInsert(t.first, [&]() { return bst.createNode(std::move(t)); });
+      return std::pair<iterator, bool>(result.first, result.second);
+   }
+   void insert(const std::initializer_list <value_type> & il)
+   {
+      for (auto && t : il)
+         insert(t);
+   }
+   template <class Iterator>
+   void insert(Iterator first, Iterator last)
+   {
+      for (auto it = first; it != last; ++it)
+         insert(*it);
+   }
+
+   //
+   // Remove
+   //
+   void clear() noexcept
+   {
+      bst.clear();
+   }
+   iterator erase(iterator & it)
+   {
+      it = bst.erase(it.it);
+      return it;
+   }
+   size_t erase(const K & k)
+   {
+      auto it = bst.find(k);
+      if (it == bst.end())
+         return 0;
+      bst.erase(it);
+      return 1;
+   }
+
+   //
+   // Status
+   //
+   bool   empty() const noexcept { return bst.empty(); }
+   size_t size()  const noexcept { return bst.size();  }
+   key_compare key_comp() const  { return bst.key_comp().key_comp(); }
+   allocator_type get_allocator() const { return bst.get_allocator(); }
+
+private:
+
+   custom::BST <value_type, MapCompare<K, V, C>, A> bst;
+};
+
+
+/**************************************************
+ * MAP ITERATOR
+ * An iterator through Map. Unlike a set, the value
+ * can be changed through it, only the key is const
+ *************************************************/
+template <typename K, typename V, typename C, typename A>
+class map <K, V, C, A> :: iterator
+{
+   friend class ::TestMap; // give unit tests access to the privates
+   friend class custom::map<K, V, C, A>;
+
+   using BSTIterator = typename custom::BST<std::pair<const K, V>, MapCompare<K, V, C>, A>::iterator;
+public:
+   using iterator_category = std::bidirectional_iterator_tag;
+   using value_type        = std::pair<const K, V>;
+   using difference_type   = std::ptrdiff_t;
+   using pointer           = value_type*;
+   using reference         = value_type&;
+
+   // constructors, destructors, and assignment operator
+   iterator()
+   {
+   }
+   iterator(const BSTIterator & itRHS) : it(itRHS)
+   {
+   }
+   iterator(const iterator & rhs) : it(rhs.it)
+   {
+   }
+   iterator & operator = (const iterator & rhs)
+   {
+      it = rhs.it;
+      return *this;
+   }
+
+   // equals, not equals operator
+   bool operator != (const iterator & rhs) const { return it != rhs.it; }
+   bool operator == (const iterator & rhs) const { return it == rhs.it; }
+
+   // dereference operator: the node's pair itself, so the value can change
+   value_type & operator * () const
+   {
+      return it.pNode->data;
+   }
+   value_type * operator -> () const
+   {
+      return &it.pNode->data;
+   }
+
+   // prefix increment
+   iterator & operator ++ ()
+   {
+      ++it;
+      return *this;
+   }
+
+   // postfix increment
+   iterator operator ++ (int)
+   {
+      iterator tmp(*this);
+      ++it;
+      return tmp;
+   }
+
+   // prefix decrement
+   iterator & operator -- ()
+   {
+      --it;
+      return *this;
+   }
+
+   // postfix decrement
+   iterator operator -- (int)
+   {
+      iterator tmp(*this);
+      --it;
+      return tmp;
+   }
+
+private:
+
+   BSTIterator it;
+};
+
+/*****************************************************
+ * SWAP
+ * Stand-alone map swap
+ ****************************************************/
+template <typename K, typename V, typename C, typename A>
+void swap(map <K, V, C, A> & lhs, map <K, V, C, A> & rhs)
+{
+   lhs.bst.swap(rhs.bst);
+}
+
+}; // namespace custom
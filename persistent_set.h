@@ -0,0 +1,639 @@
+/***********************************************************************
+ * Header:
+ *    Persistent Set
+ * Summary:
+ *    A set that never changes once it is made. Inserting or erasing
+ *    gives back a new set and leaves the old one just as it was, so
+ *    anybody holding the old one has a view of the set at one moment
+ *    that stays that way for as long as they want it.
+ *
+ *    The new set is not a copy. Only the nodes on the path from the root
+ *    down to the change are made again, about log n of them, and the new
+ *    ones point at the same subtrees the old ones did everywhere else.
+ *    Every node counts how many parents and sets point at it and goes
+ *    away when the last of them does. Copying a set, or taking a
+ *    snapshot(), is one more count on the root, however big it is.
+ *
+ *    The tree is an AVL tree rather than the red-black tree BST uses.
+ *    Nodes that are shared cannot point at their parent, since each
+ *    version has a parent of its own, and an AVL tree can be kept in
+ *    balance on the way back up from a change without ever looking up.
+ *    The iterator keeps the path it came down instead of parent pointers.
+ *
+ *    Nothing in a node changes after it is made but its count, so any
+ *    number of threads can search, walk, and copy the same set at once.
+ *    One persistent_set object is like one std::shared_ptr: putting a new
+ *    version in it while another thread reads that same object needs a
+ *    lock, but only around the assignment, which is one pointer swap.
+ *
+ *    This will contain the class definition of:
+ *        persistent_set          : An immutable set, sharing nodes between versions
+ *        persistent_set::iterator: An iterator through persistent_set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>     // for size_t and std::ptrdiff_t
+#include <cstdint>     // for uint32_t
+#include <atomic>      // every node's count
+#include <memory>      // for std::allocator_traits
+#include <functional>  // for std::less
+#include <iterator>    // for std::forward_iterator_tag
+#include <algorithm>   // for std::sort, std::unique, std::max
+#include <vector>      // to sort a range that was not sorted already
+#include <utility>     // for std::swap, std::exchange, and std::forward
+#include "set.h"       // for CompareBase, sorted_unique, and to start from a set
+
+class TestPersistentSet;  // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * PERSISTENT SET
+ * An immutable AVL tree. Changes give back a new set
+ * that shares every node the change did not touch
+ ***********************************************/
+template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
+class persistent_set : private CompareBase<C>
+{
+   friend class ::TestPersistentSet; // give unit tests access to the privates
+   struct Node;
+public:
+   class iterator;
+   using value_type     = T;
+   using allocator_type = A;
+   using key_compare    = C;
+   using value_compare  = C;
+   using const_iterator = iterator;
+
+   //
+   // Construct
+   //
+   persistent_set(const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), root(nullptr), numElements(0), alloc(a)
+   {
+   }
+
+   // a set walks in order, so the tree is built balanced in one pass
+   explicit persistent_set(const set<T, C, A> & s)
+      : CompareBase<C>(s.key_comp()), root(nullptr), numElements(0), alloc(s.get_allocator())
+   {
+      auto it = s.begin();
+      root = build(it, s.size());
+      numElements = s.size();
+   }
+   template <class Iterator>
+   persistent_set(sorted_unique_t, Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), root(nullptr), numElements(0), alloc(a)
+   {
+      // take their word for it
+      size_t num = (size_t)std::distance(first, last);
+      root = build(first, num);
+      numElements = num;
+   }
+
+   // anything else gets sorted and the duplicates dropped first
+   template <class Iterator>
+   persistent_set(Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+      : CompareBase<C>(comp), root(nullptr), numElements(0), alloc(a)
+   {
+      std::vector<T> v(first, last);
+      std::sort(v.begin(), v.end(), [this](const T & lhs, const T & rhs) { return less(lhs, rhs); });
+      v.erase(std::unique(v.begin(), v.end(),
+                          [this](const T & lhs, const T & rhs) { return !less(lhs, rhs); }), v.end());
+      auto it = v.begin();
+      root = build(it, v.size());
+      numElements = v.size();
+   }
+   persistent_set(const std::initializer_list <T> & il, const C & comp = C(), const A & a = A())
+      : persistent_set(il.begin(), il.end(), comp, a)
+   {
+   }
+
+   // One more count on the root, and that is the whole copy. The allocator
+   // comes along as it is, since whichever version lets go of a node last
+   // is the one that frees it
+   persistent_set(const persistent_set & rhs)
+      : CompareBase<C>(rhs.comp()), root(share(rhs.root)), numElements(rhs.numElements), alloc(rhs.alloc)
+   {
+   }
+   persistent_set(persistent_set && rhs) noexcept
+      : CompareBase<C>(rhs.comp()), root(rhs.root), numElements(rhs.numElements), alloc(rhs.alloc)
+   {
+      rhs.root = nullptr;
+      rhs.numElements = 0;
+   }
+  ~persistent_set()
+   {
+      release(root);
+   }
+
+   //
+   // Assign
+   //
+
+   // copying is cheap, so copy-and-swap costs nothing worth avoiding
+   persistent_set & operator = (persistent_set rhs) noexcept
+   {
+      swap(rhs);
+      return *this;
+   }
+   void swap(persistent_set & rhs) noexcept
+   {
+      std::swap(this->comp(), rhs.comp());
+      std::swap(root, rhs.root);
+      std::swap(numElements, rhs.numElements);
+      std::swap(alloc, rhs.alloc);
+   }
+
+   // this version, for as long as you want it
+   persistent_set snapshot() const
+   {
+      return *this;
+   }
+
+   //
+   // Iterator
+   //
+   iterator begin() const
+   {
+      iterator it;
+      it.pushLeft(root);
+      return it;
+   }
+   iterator end() const
+   {
+      return iterator();
+   }
+
+   //
+   // Access
+   //
+   iterator lower_bound(const T & t) const;
+   iterator upper_bound(const T & t) const;
+   iterator find(const T & t) const
+   {
+      iterator it = lower_bound(t);
+      return (it != end() && !less(t, *it)) ? it : end();
+   }
+   bool contains(const T & t) const
+   {
+      for (const Node* p = root; p; )
+         if (less(t, p->data))
+            p = p->pLeft;
+         else if (less(p->data, t))
+            p = p->pRight;
+         else
+            return true;
+      return false;
+   }
+   size_t count(const T & t) const
+   {
+      return contains(t) ? 1 : 0;
+   }
+
+   //
+   // Status
+   //
+   bool   empty() const noexcept { return numElements == 0; }
+   size_t size()  const noexcept { return numElements;      }
+   allocator_type get_allocator() const { return allocator_type(alloc); }
+   key_compare   key_comp()   const { return this->comp(); }
+   value_compare value_comp() const { return this->comp(); }
+
+   //
+   // Insert
+   //
+
+   // A new set with t in it. If t was there already nothing is made and
+   // we get this one back, so size() says whether it went in
+   persistent_set insert(const T & t) const
+   {
+      return inserted(t);
+   }
+   persistent_set insert(T && t) const
+   {
+      return inserted(std::move(t));
+   }
+
+   // we need the element to compare, so it is made before we know whether it goes in
+   template <class... Args>
+   persistent_set emplace(Args&&... args) const
+   {
+      return inserted(T(std::forward<Args>(args)...));
+   }
+
+   //
+   // Remove
+   //
+
+   // a new set without t, or this one if t was never there
+   persistent_set erase(const T & t) const
+   {
+      bool isGone = false;
+      Node* pRoot = eraseNode(root, t, isGone);
+      if (!isGone)
+         return *this;
+      return persistent_set(*this, pRoot, numElements - 1);
+   }
+
+private:
+   using NodeAlloc  = typename std::allocator_traits<A>::template rebind_alloc<Node>;
+   using NodeTraits = std::allocator_traits<NodeAlloc>;
+
+   /************************************************
+    * NODE
+    * Never changed after it is made, but for its count
+    ***********************************************/
+   struct Node
+   {
+      template <class... Args>
+      Node(Node* pLeft, Node* pRight, Args&&... args)
+         : refs(1), height(1 + std::max(heightOf(pLeft), heightOf(pRight))),
+           pLeft(pLeft), pRight(pRight), data(std::forward<Args>(args)...)
+      {
+      }
+
+      // Parents and sets pointing here. Each of them takes at least one
+      // node or set of its own, so this cannot wrap before memory runs out
+      std::atomic<uint32_t> refs;
+      int height;          // 1 for a leaf
+      Node* pLeft;
+      Node* pRight;
+      T data;
+   };
+
+   // a version of our own, taking over the count on pRoot
+   persistent_set(const persistent_set & from, Node* pRoot, size_t num)
+      : CompareBase<C>(from.comp()), root(pRoot), numElements(num), alloc(from.alloc)
+   {
+   }
+
+   template <class U>
+   persistent_set inserted(U && t) const
+   {
+      bool isNew = false;
+      Node* pRoot = insertNode(root, std::forward<U>(t), isNew);
+      if (!isNew)
+         return *this;
+      return persistent_set(*this, pRoot, numElements + 1);
+   }
+
+   bool less(const T & lhs, const T & rhs) const { return this->comp()(lhs, rhs); }
+   static int heightOf(const Node* p) { return p ? p->height : 0; }
+
+   // one more count on p, for a new parent or a new set
+   static Node* share(Node* p)
+   {
+      if (p)
+         p->refs.fetch_add(1, std::memory_order_relaxed);
+      return p;
+   }
+
+   // One less count on p. The last one out frees it and lets go of its
+   // children, which only goes deeper as far as the tree is tall
+   void release(Node* p) const
+   {
+      if (p && p->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+      {
+         release(p->pLeft);
+         release(p->pRight);
+         NodeAlloc a(alloc);
+         NodeTraits::destroy(a, p);
+         NodeTraits::deallocate(a, p, 1);
+      }
+   }
+
+   // A new node over two children whose counts it takes. If making the
+   // element throws, it lets go of them, so the caller never has to
+   template <class... Args>
+   Node* make(Node* pLeft, Node* pRight, Args&&... args) const
+   {
+      NodeAlloc a(alloc);
+      Node* p = nullptr;
+      try
+      {
+         p = NodeTraits::allocate(a, 1);
+         NodeTraits::construct(a, p, pLeft, pRight, std::forward<Args>(args)...);
+      }
+      catch (...)
+      {
+         if (p)
+            NodeTraits::deallocate(a, p, 1);
+         release(pLeft);
+         release(pRight);
+         throw;
+      }
+      return p;
+   }
+
+   Node* balance(Node* pLeft, const T & data, Node* pRight) const;
+   template <class Iterator>
+   Node* build(Iterator & it, size_t num) const;
+   template <class U>
+   Node* insertNode(Node* p, U && t, bool & isNew) const;
+   Node* eraseNode(Node* p, const T & t, bool & isGone) const;
+   Node* eraseLeftmost(Node* p) const;
+
+   Node* root;             // this version's tree, holding one count on it
+   size_t numElements;
+   NodeAlloc alloc;        // where the nodes come from, shared by every version
+};
+
+/************************************************
+ * PERSISTENT SET ITERATOR
+ * The path down from the root to where we are, only the
+ * nodes we went left at, since those are the ones still to
+ * come. Moving on is popping the one we are at and going
+ * down the left side of its right child
+ ***********************************************/
+template <typename T, typename C, typename A>
+class persistent_set <T, C, A> ::iterator
+{
+   friend class persistent_set;
+public:
+   using iterator_category = std::forward_iterator_tag;
+   using value_type        = T;
+   using difference_type   = std::ptrdiff_t;
+   using pointer           = const T*;
+   using reference         = const T&;
+
+   iterator() : depth(0)
+   {
+   }
+
+   bool operator == (const iterator & rhs) const
+   {
+      return current() == rhs.current();
+   }
+   bool operator != (const iterator & rhs) const
+   {
+      return !(*this == rhs);
+   }
+
+   const T & operator * () const
+   {
+      assert(depth > 0);
+      return current()->data;
+   }
+   const T * operator -> () const
+   {
+      return &**this;
+   }
+
+   iterator & operator ++ ()
+   {
+      assert(depth > 0);
+      const Node* p = path[--depth];
+      pushLeft(p->pRight);
+      return *this;
+   }
+   iterator operator ++ (int)
+   {
+      iterator tmp(*this);
+      ++(*this);
+      return tmp;
+   }
+
+private:
+   // An AVL tree 64 tall would need more than 10^13 nodes, so this is as
+   // deep as the path can get
+   static constexpr int MAX_HEIGHT = 64;
+
+   const Node* current() const
+   {
+      return depth ? path[depth - 1] : nullptr;
+   }
+   void push(const Node* p)
+   {
+      assert(depth < MAX_HEIGHT);
+      path[depth++] = p;
+   }
+   void pushLeft(const Node* p)
+   {
+      for (; p; p = p->pLeft)
+         push(p);
+   }
+
+   const Node* path[MAX_HEIGHT];
+   int depth;
+};
+
+/*************************************************
+ * LOWER BOUND and UPPER BOUND
+ * Keep the nodes we went left at, since they are bigger
+ * than what we are looking for. The last one is the answer
+ *************************************************/
+template <typename T, typename C, typename A>
+typename persistent_set <T, C, A> ::iterator persistent_set <T, C, A> ::lower_bound(const T & t) const
+{
+   iterator it;
+   for (const Node* p = root; p; )
+      if (less(p->data, t))
+         p = p->pRight;
+      else
+      {
+         it.push(p);
+         p = p->pLeft;
+      }
+   return it;
+}
+
+template <typename T, typename C, typename A>
+typename persistent_set <T, C, A> ::iterator persistent_set <T, C, A> ::upper_bound(const T & t) const
+{
+   iterator it;
+   for (const Node* p = root; p; )
+      if (less(t, p->data))
+      {
+         it.push(p);
+         p = p->pLeft;
+      }
+      else
+         p = p->pRight;
+   return it;
+}
+
+/*************************************************
+ * BALANCE
+ * A new node for data over two children whose counts
+ * we take, which may differ in height by two after an
+ * insert or erase below. If they do, rotate, which makes
+ * new nodes for the ones that move and shares the rest
+ *************************************************/
+template <typename T, typename C, typename A>
+typename persistent_set <T, C, A> ::Node* persistent_set <T, C, A> ::balance(Node* pLeft, const T & data, Node* pRight) const
+{
+   // too tall on the left
+   if (heightOf(pLeft) > heightOf(pRight) + 1)
+   {
+      Node* pNewRight = nullptr;   // ours until a make() takes it
+      try
+      {
+         // the left child comes up and we go down on its right
+         if (heightOf(pLeft->pLeft) >= heightOf(pLeft->pRight))
+         {
+            pNewRight = make(share(pLeft->pRight), pRight, data);
+            Node* pRoot = make(share(pLeft->pLeft), std::exchange(pNewRight, nullptr), pLeft->data);
+            release(pLeft);
+            return pRoot;
+         }
+
+         // the left child's right child comes all the way up
+         Node* pMiddle = pLeft->pRight;
+         pNewRight = make(share(pMiddle->pRight), pRight, data);
+         Node* pNewLeft = make(share(pLeft->pLeft), share(pMiddle->pLeft), pLeft->data);
+         Node* pRoot = make(pNewLeft, std::exchange(pNewRight, nullptr), pMiddle->data);
+         release(pLeft);
+         return pRoot;
+      }
+      catch (...)
+      {
+         // make() let go of whatever it was given, so only these are still ours
+         release(pNewRight);
+         release(pLeft);
+         throw;
+      }
+   }
+
+   // too tall on the right
+   if (heightOf(pRight) > heightOf(pLeft) + 1)
+   {
+      Node* pNewLeft = nullptr;    // ours until a make() takes it
+      try
+      {
+         // the right child comes up and we go down on its left
+         if (heightOf(pRight->pRight) >= heightOf(pRight->pLeft))
+         {
+            pNewLeft = make(pLeft, share(pRight->pLeft), data);
+            Node* pRoot = make(std::exchange(pNewLeft, nullptr), share(pRight->pRight), pRight->data);
+            release(pRight);
+            return pRoot;
+         }
+
+         // the right child's left child comes all the way up
+         Node* pMiddle = pRight->pLeft;
+         pNewLeft = make(pLeft, share(pMiddle->pLeft), data);
+         Node* pNewRight = make(share(pMiddle->pRight), share(pRight->pRight), pRight->data);
+         Node* pRoot = make(std::exchange(pNewLeft, nullptr), pNewRight, pMiddle->data);
+         release(pRight);
+         return pRoot;
+      }
+      catch (...)
+      {
+         release(pNewLeft);
+         release(pRight);
+         throw;
+      }
+   }
+
+   return make(pLeft, pRight, data);
+}
+
+/*************************************************
+ * BUILD
+ * num elements in order, the middle one at the top and
+ * each half the same way below it, so the two sides never
+ * differ by more than one
+ *************************************************/
+template <typename T, typename C, typename A>
+template <class Iterator>
+typename persistent_set <T, C, A> ::Node* persistent_set <T, C, A> ::build(Iterator & it, size_t num) const
+{
+   if (num == 0)
+      return nullptr;
+   Node* pLeft = build(it, num / 2);
+   Iterator itData = it;
+   ++it;
+   Node* pRight;
+   try
+   {
+      pRight = build(it, num - num / 2 - 1);
+   }
+   catch (...)
+   {
+      release(pLeft);
+      throw;
+   }
+   return make(pLeft, pRight, *itData);
+}
+
+/*************************************************
+ * INSERT NODE
+ * Down to where t goes and a new leaf there, then new
+ * copies of every node on the way back up. Nothing is made
+ * if t is already here, and isNew says so
+ *************************************************/
+template <typename T, typename C, typename A>
+template <class U>
+typename persistent_set <T, C, A> ::Node* persistent_set <T, C, A> ::insertNode(Node* p, U && t, bool & isNew) const
+{
+   if (!p)
+   {
+      isNew = true;
+      return make(nullptr, nullptr, std::forward<U>(t));
+   }
+   if (less(t, p->data))
+   {
+      Node* pLeft = insertNode(p->pLeft, std::forward<U>(t), isNew);
+      return isNew ? balance(pLeft, p->data, share(p->pRight)) : nullptr;
+   }
+   if (less(p->data, t))
+   {
+      Node* pRight = insertNode(p->pRight, std::forward<U>(t), isNew);
+      return isNew ? balance(share(p->pLeft), p->data, pRight) : nullptr;
+   }
+   return nullptr;
+}
+
+/*************************************************
+ * ERASE NODE
+ * Down to t, and the tree without it on the way back up.
+ * A node with two children takes the smallest element on
+ * its right in its place. Nothing is made if t is not here
+ *************************************************/
+template <typename T, typename C, typename A>
+typename persistent_set <T, C, A> ::Node* persistent_set <T, C, A> ::eraseNode(Node* p, const T & t, bool & isGone) const
+{
+   if (!p)
+      return nullptr;
+   if (less(t, p->data))
+   {
+      Node* pLeft = eraseNode(p->pLeft, t, isGone);
+      return isGone ? balance(pLeft, p->data, share(p->pRight)) : nullptr;
+   }
+   if (less(p->data, t))
+   {
+      Node* pRight = eraseNode(p->pRight, t, isGone);
+      return isGone ? balance(share(p->pLeft), p->data, pRight) : nullptr;
+   }
+
+   isGone = true;
+   if (!p->pLeft)
+      return share(p->pRight);
+   if (!p->pRight)
+      return share(p->pLeft);
+
+   // the old version still holds the smallest node, so it is there to copy from
+   const Node* pSmallest = p->pRight;
+   while (pSmallest->pLeft)
+      pSmallest = pSmallest->pLeft;
+   Node* pRight = eraseLeftmost(p->pRight);
+   return balance(share(p->pLeft), pSmallest->data, pRight);
+}
+
+// p without its smallest element
+template <typename T, typename C, typename A>
+typename persistent_set <T, C, A> ::Node* persistent_set <T, C, A> ::eraseLeftmost(Node* p) const
+{
+   if (!p->pLeft)
+      return share(p->pRight);
+   Node* pLeft = eraseLeftmost(p->pLeft);
+   return balance(pLeft, p->data, share(p->pRight));
+}
+
+} // namespace custom
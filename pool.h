@@ -0,0 +1,193 @@
+/***********************************************************************
+ * Header:
+ *    POOL
+ * Summary:
+ *    A pool allocator for the nodes of our BST. Instead of going to the
+ *    heap for every single node, we grab a big chunk of memory and carve
+ *    the nodes out of it. When a node is freed it goes on a free list so
+ *    the next insert can have it back without asking the heap again.
+ *
+ *    This will contain the class definition of:
+ *        pool                : A slab of fixed-size blocks with a free list
+ *        pool_allocator      : An allocator that hands out blocks from a pool
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>     // for std::max_align_t
+#include <memory>      // for std::shared_ptr
+#include <new>         // for ::operator new
+#include <type_traits> // for std::true_type
+
+class TestPool;        // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * POOL
+ * A bunch of chunks, each chopped into blocks of the same size.
+ * The block size is fixed the first time someone asks for a single
+ * object, anything else is passed straight through to the heap.
+ ***********************************************/
+class pool
+{
+   friend class ::TestPool; // give unit tests access to the privates
+public:
+   pool() : sizeBlock(0), numBlocksNext(FIRST_CHUNK), numCarved(0), numLeft(0),
+            pChunks(nullptr), pFree(nullptr), numChunks(0), numBlocks(0) {}
+   pool(const pool& rhs) = delete;
+   pool& operator = (const pool& rhs) = delete;
+  ~pool()
+   {
+      // give every chunk back to the heap, the blocks go with them
+      while (pChunks)
+      {
+         Chunk* pNext = pChunks->pNext;
+         ::operator delete(pChunks);
+         pChunks = pNext;
+      }
+   }
+
+   // hand out one block big enough for size bytes
+   void* allocate(size_t size)
+   {
+      if (sizeBlock == 0)
+         sizeBlock = roundUp(size);
+      if (roundUp(size) != sizeBlock)
+         return ::operator new(size);
+
+      ++numBlocks;
+
+      // a recycled block is the cheapest thing we have
+      if (pFree)
+      {
+         Block* pBlock = pFree;
+         pFree = pFree->pNext;
+         return pBlock;
+      }
+
+      // carve the next block out of the current chunk
+      if (numLeft == 0)
+         newChunk();
+      numLeft--;
+      return reinterpret_cast<char*>(pChunks) + HEADER + sizeBlock * numCarved++;
+   }
+
+   // put the block back on the free list, we never give it to the heap
+   void deallocate(void* p, size_t size)
+   {
+      if (roundUp(size) != sizeBlock)
+      {
+         ::operator delete(p);
+         return;
+      }
+
+      assert(numBlocks > 0);
+      --numBlocks;
+      Block* pBlock = static_cast<Block*>(p);
+      pBlock->pNext = pFree;
+      pFree = pBlock;
+   }
+
+   size_t chunks() const { return numChunks; } // how many times we went to the heap
+   size_t blocks() const { return numBlocks; } // how many blocks are handed out right now
+
+private:
+   // a freed block holds the link to the next free block
+   struct Block { Block* pNext; };
+
+   // every chunk starts with a link to the chunk before it
+   struct Chunk { Chunk* pNext; };
+
+   static const size_t ALIGN = alignof(std::max_align_t);
+   static const size_t HEADER = (sizeof(Chunk) + ALIGN - 1) / ALIGN * ALIGN;
+   static const size_t FIRST_CHUNK = 32;   // blocks in the first chunk
+   static const size_t MAX_CHUNK = 4096;   // chunks double until they get this big
+
+   // blocks have to be able to hold a free list link and stay aligned
+   static size_t roundUp(size_t size)
+   {
+      if (size < sizeof(Block))
+         size = sizeof(Block);
+      return (size + ALIGN - 1) / ALIGN * ALIGN;
+   }
+
+   // go to the heap for a new chunk, each one twice as big as the last
+   void newChunk()
+   {
+      Chunk* pChunk = static_cast<Chunk*>(::operator new(HEADER + sizeBlock * numBlocksNext));
+      pChunk->pNext = pChunks;
+      pChunks = pChunk;
+      numCarved = 0;
+      numLeft = numBlocksNext;
+      if (numBlocksNext < MAX_CHUNK)
+         numBlocksNext *= 2;
+      ++numChunks;
+   }
+
+   size_t sizeBlock;      // size of each block, zero until the first allocation
+   size_t numBlocksNext;  // how many blocks the next chunk will hold
+   size_t numCarved;      // blocks already cut from the current chunk
+   size_t numLeft;        // blocks still available in the current chunk
+   Chunk* pChunks;        // the most recent chunk, the others hang off of it
+   Block* pFree;          // blocks that were given back
+   size_t numChunks;      // statistics
+   size_t numBlocks;
+};
+
+
+/************************************************
+ * POOL ALLOCATOR
+ * A standard allocator that gets its memory from a pool. Copies and
+ * rebinds share the same pool, so they can free each other's memory.
+ * A container that copies itself gets a brand new pool.
+ ***********************************************/
+template <class T>
+class pool_allocator
+{
+   friend class ::TestPool; // give unit tests access to the privates
+   template <class U>
+   friend class pool_allocator;
+public:
+   using value_type = T;
+   using propagate_on_container_copy_assignment = std::false_type;
+   using propagate_on_container_move_assignment = std::true_type;
+   using propagate_on_container_swap            = std::true_type;
+   using is_always_equal                        = std::false_type;
+
+   pool_allocator() : spPool(std::make_shared<pool>()) {}
+   pool_allocator(const pool_allocator& rhs) noexcept : spPool(rhs.spPool) {}
+   template <class U>
+   pool_allocator(const pool_allocator<U>& rhs) noexcept : spPool(rhs.spPool) {}
+
+   T* allocate(size_t n)
+   {
+      return static_cast<T*>(spPool->allocate(n * sizeof(T)));
+   }
+   void deallocate(T* p, size_t n) noexcept
+   {
+      spPool->deallocate(p, n * sizeof(T));
+   }
+
+   // a copy of a container does not share the original's pool
+   pool_allocator select_on_container_copy_construction() const
+   {
+      return pool_allocator();
+   }
+
+   const pool& getPool() const { return *spPool; }
+
+   template <class U>
+   bool operator == (const pool_allocator<U>& rhs) const noexcept { return spPool == rhs.spPool; }
+   template <class U>
+   bool operator != (const pool_allocator<U>& rhs) const noexcept { return spPool != rhs.spPool; }
+
+private:
+   std::shared_ptr<pool> spPool;
+};
+
+}; // namespace custom
@@ -0,0 +1,294 @@
+/***********************************************************************
+ * Header:
+ *    Red Black
+ * Summary:
+ *    The rotations and the fix-ups that keep a tree red-black, written
+ *    once for every red-black tree in here. custom::set's BST and
+ *    concurrent_set keep their links differently. The BST's are plain
+ *    pointers, and every node knows the size of its subtree. The ones in
+ *    concurrent_set are atomic, so readers can follow them without a
+ *    lock. Neither one changes which node goes where, so the tree tells
+ *    this how to get at its links and this does the rest.
+ *
+ *    The tree hands these over, where redblack can see them:
+ *        leftOf(p), rightOf(p)         : the children of p
+ *        setLeft(p, c), setRight(p, c) : hang c under p, c may be null
+ *        replaceChild(pParent, p, c)   : c takes p's spot under pParent,
+ *                                        or the root when pParent is null
+ *        rootNode()                    : the top of the tree
+ *        rotated(p, pPivot)            : pPivot just rotated above p
+ *        leaving(p)                    : p is about to leave its spot
+ *        replaced(p, pNext)            : pNext just took p's spot
+ *    The last three are for whatever else the tree keeps in a node, and
+ *    a tree with nothing else can leave them empty. Every node has a
+ *    pParent and an isRed, which redblack reads and writes directly.
+ *
+ *    This will contain the class definition of:
+ *        redblack            : Rotations, and rebalancing after insert and erase
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+namespace custom
+{
+
+/************************************************
+ * RED BLACK
+ * Nothing but static functions. The tree comes along
+ * with every call, since the root lives in the tree
+ ***********************************************/
+template <class Tree, class Node>
+class redblack
+{
+public:
+   static void rotateLeft(Tree & tree, Node* pNode);
+   static void rotateRight(Tree & tree, Node* pNode);
+   static void balanceInsert(Tree & tree, Node* pNode);
+   static void balanceErase(Tree & tree, Node* pNode, Node* pParent);
+   static void unlink(Tree & tree, Node* pDelete);
+
+private:
+   // an empty spot counts as black
+   static bool isRed(const Node* pNode) { return pNode && pNode->isRed; }
+   static bool isLeftChild(const Tree & tree, const Node* pNode)
+   {
+      return pNode->pParent && tree.leftOf(pNode->pParent) == pNode;
+   }
+};
+
+/*************************************************
+ * ROTATE LEFT and ROTATE RIGHT
+ *      (p)                (r)          (p)          (l)
+ *        +--+    ==>    +--+         +--+   ==>     +--+
+ *          (r)        (p)          (l)                (p)
+ * The order matters to a reader that takes no lock: pNode
+ * lets go of the pivot before the pivot takes hold of pNode,
+ * so nobody walking down ever finds a loop
+ *************************************************/
+template <class Tree, class Node>
+void redblack <Tree, Node> ::rotateLeft(Tree & tree, Node* pNode)
+{
+   Node* pPivot = tree.rightOf(pNode);
+   Node* pParent = pNode->pParent;
+   tree.setRight(pNode, tree.leftOf(pPivot));
+   tree.setLeft(pPivot, pNode);
+   tree.rotated(pNode, pPivot);
+   tree.replaceChild(pParent, pNode, pPivot);
+}
+
+template <class Tree, class Node>
+void redblack <Tree, Node> ::rotateRight(Tree & tree, Node* pNode)
+{
+   Node* pPivot = tree.leftOf(pNode);
+   Node* pParent = pNode->pParent;
+   tree.setLeft(pNode, tree.rightOf(pPivot));
+   tree.setRight(pPivot, pNode);
+   tree.rotated(pNode, pPivot);
+   tree.replaceChild(pParent, pNode, pPivot);
+}
+
+/*************************************************
+ * BALANCE INSERT
+ * The new red node may sit under a red parent. A red aunt
+ * means recolor and move the problem up to granny, otherwise
+ * one or two rotations fix it for good
+ *************************************************/
+template <class Tree, class Node>
+void redblack <Tree, Node> ::balanceInsert(Tree & tree, Node* pNode)
+{
+   while (isRed(pNode->pParent))
+   {
+      Node* pParent = pNode->pParent;
+      Node* pGranny = pParent->pParent;
+
+      // a red root, just paint it black
+      if (!pGranny)
+      {
+         pParent->isRed = false;
+         break;
+      }
+
+      Node* pAunt = isLeftChild(tree, pParent) ? tree.rightOf(pGranny) : tree.leftOf(pGranny);
+      if (isRed(pAunt))
+      {
+         pParent->isRed = false;
+         pAunt->isRed = false;
+         pGranny->isRed = true;
+         pNode = pGranny;
+      }
+      else if (isLeftChild(tree, pParent))
+      {
+         if (!isLeftChild(tree, pNode))
+         {
+            rotateLeft(tree, pParent);
+            pParent = pNode;
+         }
+         pParent->isRed = false;
+         pGranny->isRed = true;
+         rotateRight(tree, pGranny);
+         break;   // the top of this subtree is black now, so we are done
+      }
+      else
+      {
+         if (isLeftChild(tree, pNode))
+         {
+            rotateRight(tree, pParent);
+            pParent = pNode;
+         }
+         pParent->isRed = false;
+         pGranny->isRed = true;
+         rotateLeft(tree, pGranny);
+         break;
+      }
+   }
+
+   tree.rootNode()->isRed = false;
+}
+
+/*************************************************
+ * BALANCE ERASE
+ * A black node came out, so the side holding pNode is one
+ * black short. pNode may be null, so its parent comes along
+ *************************************************/
+template <class Tree, class Node>
+void redblack <Tree, Node> ::balanceErase(Tree & tree, Node* pNode, Node* pParent)
+{
+   while (pNode != tree.rootNode() && !isRed(pNode))
+   {
+      if (pNode == tree.leftOf(pParent))
+      {
+         Node* pSibling = tree.rightOf(pParent);
+         if (isRed(pSibling))
+         {
+            pSibling->isRed = false;
+            pParent->isRed = true;
+            rotateLeft(tree, pParent);
+            pSibling = tree.rightOf(pParent);
+         }
+         if (!pSibling)
+         {
+            pNode = pParent;
+            pParent = pNode->pParent;
+         }
+         else if (!isRed(tree.leftOf(pSibling)) && !isRed(tree.rightOf(pSibling)))
+         {
+            pSibling->isRed = true;
+            pNode = pParent;
+            pParent = pNode->pParent;
+         }
+         else
+         {
+            if (!isRed(tree.rightOf(pSibling)))
+            {
+               tree.leftOf(pSibling)->isRed = false;
+               pSibling->isRed = true;
+               rotateRight(tree, pSibling);
+               pSibling = tree.rightOf(pParent);
+            }
+            pSibling->isRed = pParent->isRed;
+            pParent->isRed = false;
+            tree.rightOf(pSibling)->isRed = false;
+            rotateLeft(tree, pParent);
+            pNode = tree.rootNode();
+         }
+      }
+      else
+      {
+         Node* pSibling = tree.leftOf(pParent);
+         if (isRed(pSibling))
+         {
+            pSibling->isRed = false;
+            pParent->isRed = true;
+            rotateRight(tree, pParent);
+            pSibling = tree.leftOf(pParent);
+         }
+         if (!pSibling)
+         {
+            pNode = pParent;
+            pParent = pNode->pParent;
+         }
+         else if (!isRed(tree.leftOf(pSibling)) && !isRed(tree.rightOf(pSibling)))
+         {
+            pSibling->isRed = true;
+            pNode = pParent;
+            pParent = pNode->pParent;
+         }
+         else
+         {
+            if (!isRed(tree.leftOf(pSibling)))
+            {
+               tree.rightOf(pSibling)->isRed = false;
+               pSibling->isRed = true;
+               rotateLeft(tree, pSibling);
+               pSibling = tree.leftOf(pParent);
+            }
+            pSibling->isRed = pParent->isRed;
+            pParent->isRed = false;
+            tree.leftOf(pSibling)->isRed = false;
+            rotateRight(tree, pParent);
+            pNode = tree.rootNode();
+         }
+      }
+   }
+
+   if (pNode)
+      pNode->isRed = false;
+}
+
+/*************************************************
+ * UNLINK
+ * Take pDelete out of the tree and rebalance. A node with
+ * two children trades places with the next one along. The
+ * nodes are relinked, never copied over, so the elements
+ * stay where they are and so does anybody looking at them.
+ * pDelete still has its own links when this is done, and
+ * the tree decides what to do with them
+ *************************************************/
+template <class Tree, class Node>
+void redblack <Tree, Node> ::unlink(Tree & tree, Node* pDelete)
+{
+   Node* pFix;         // the node that moved into the hole, may be null
+   Node* pFixParent;   // the parent of the hole, needed when pFix is null
+   bool removedBlack;
+
+   if (!tree.leftOf(pDelete) || !tree.rightOf(pDelete))
+   {
+      tree.leaving(pDelete);
+      removedBlack = !pDelete->isRed;
+      pFix = tree.leftOf(pDelete) ? tree.leftOf(pDelete) : tree.rightOf(pDelete);
+      pFixParent = pDelete->pParent;
+      tree.replaceChild(pDelete->pParent, pDelete, pFix);
+   }
+   else
+   {
+      Node* pIOS = tree.rightOf(pDelete);
+      while (tree.leftOf(pIOS))
+         pIOS = tree.leftOf(pIOS);
+
+      // the successor is the node that really leaves its spot, pDelete is on the way up
+      tree.leaving(pIOS);
+      removedBlack = !pIOS->isRed;
+      pFix = tree.rightOf(pIOS);
+
+      // the successor lets go of where it was, then takes over pDelete's children
+      if (pIOS != tree.rightOf(pDelete))
+      {
+         pFixParent = pIOS->pParent;
+         tree.setLeft(pIOS->pParent, pFix);
+         tree.setRight(pIOS, tree.rightOf(pDelete));
+      }
+      else
+         pFixParent = pIOS;
+      tree.setLeft(pIOS, tree.leftOf(pDelete));
+      tree.replaceChild(pDelete->pParent, pDelete, pIOS);
+      pIOS->isRed = pDelete->isRed;
+      tree.replaced(pDelete, pIOS);
+   }
+
+   if (removedBlack)
+      balanceErase(tree, pFix, pFixParent);
+}
+
+} // namespace custom
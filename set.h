@@ -21,23 +21,66 @@
 #include <cassert>
 #include <iostream>
 #include "bst.h"
+#include "pool.h"     // for custom::pool_allocator
 #include <memory>     // for std::allocator
 #include <functional> // for std::less
+#include <iterator>   // for std::iterator_traits
+#include <algorithm>  // for std::set_union and friends
+#include <vector>     // to collect the result of a merge
 
 class TestSet;        // forward declaration for unit tests
+class TestPool;
 
 namespace custom
 {
 
+/************************************************
+ * SORTED UNIQUE
+ * Pass this to a set constructor to promise the range is already sorted
+ * with no duplicates, then the set is built in linear time. It is the
+ * same idea as C++23's std::sorted_unique_t, which we cannot count on yet
+ ***********************************************/
+struct sorted_unique_t { explicit sorted_unique_t() = default; };
+inline constexpr sorted_unique_t sorted_unique{};
+
+template <typename T, typename C, typename A>
+class set;
+
+// the set algebra, each one makes a brand new set out of two others
+template <typename T, typename C, typename A>
+set<T, C, A> set_union(const set<T, C, A>& lhs, const set<T, C, A>& rhs);
+template <typename T, typename C, typename A>
+set<T, C, A> set_intersection(const set<T, C, A>& lhs, const set<T, C, A>& rhs);
+template <typename T, typename C, typename A>
+set<T, C, A> set_difference(const set<T, C, A>& lhs, const set<T, C, A>& rhs);
+template <typename T, typename C, typename A>
+set<T, C, A> set_symmetric_difference(const set<T, C, A>& lhs, const set<T, C, A>& rhs);
+
+// Walking both sets side by side costs m + n, walking the small one and finger
+// searching the big one costs about m log(n/m). The second wins once the small
+// one is a good order of magnitude smaller
+inline bool isMuchSmaller(size_t m, size_t n)
+{
+   return m * 16 < n;
+}
+
 /************************************************
  * SET
  * A class that represents a Set
+ * The elements are ordered by C and the nodes come from A,
+ * use custom::pool_allocator<T> to carve them out of big chunks
+ * or custom::pmr::set to get them from a memory resource
  ***********************************************/
-template <typename T>
+template <typename T, typename C = std::less<T>, typename A = std::allocator<T>>
 class set
 {
    friend class ::TestSet; // give unit tests access to the privates
+   friend class ::TestPool;
 public:
+   using allocator_type = A;
+   using key_compare    = C;
+   using value_compare  = C;
+   using node_type      = typename custom::BST<T, C, A>::node_type;
    
    // 
    // Construct
@@ -45,21 +88,43 @@ public:
    set() 
    { 
    }
+   explicit set(const A & a) : bst(a)
+   {
+   }
+   explicit set(const C & comp, const A & a = A()) : bst(comp, a)
+   {
+   }
    set(const set &  rhs) : bst(rhs.bst)
    { 
    }
+   set(const set & rhs, const A & a) : bst(rhs.bst, a)
+   {
+   }
    set(set && rhs) : bst(std::move(rhs.bst))
    { 
    }
-   set(const std::initializer_list <T> & il)
+   set(set && rhs, const A & a) : bst(std::move(rhs.bst), a)
+   {
+   }
+   set(const std::initializer_list <T> & il, const A & a = A()) : bst(a)
    {
 	   insert(il); // make new set from initializer list byt inserting each element into the set
    }
    template <class Iterator>
-   set(Iterator first, Iterator last) 
+   set(Iterator first, Iterator last, const A & a = A()) : bst(a)
    {
 	   insert(first, last); // same as above but with iterators
    }
+   template <class Iterator>
+   set(sorted_unique_t, Iterator first, Iterator last, const C & comp = C(), const A & a = A()) : bst(comp, a)
+   {
+       bst.assignSorted(first, last); // take their word for it, no comparisons at all
+   }
+   template <class Iterator>
+   static set from_sorted(Iterator first, Iterator last, const C & comp = C(), const A & a = A())
+   {
+       return set(sorted_unique, first, last, comp, a);
+   }
   ~set() { }
 
    //
@@ -80,7 +145,8 @@ public:
    }
    set & operator = (const std::initializer_list <T> & il)
    {
-       bst = il;
+       clear();     // the BST would happily take duplicates, so go through our own insert
+       insert(il);
        return *this;
    }
    void swap(set& rhs) noexcept
@@ -103,6 +169,18 @@ public:
 	   return bst.end(); // or send back a iterator that starts at the end of the set
    }
 
+   // Walk the set from the biggest down. Backing up from end() lands right on
+   // the biggest element, which the BST keeps track of, so this starts in O(1)
+   using reverse_iterator = std::reverse_iterator<iterator>;
+   reverse_iterator rbegin() const noexcept
+   {
+       return reverse_iterator(end());
+   }
+   reverse_iterator rend() const noexcept
+   {
+       return reverse_iterator(begin());
+   }
+
    //
    // Access
    //
@@ -113,6 +191,86 @@ public:
 	   return bst.find(t); // when called, find will return the binary search tree's find function that will return the iterator of the element we are looking for
    }
 
+   // With a transparent comparator like std::less<> we can look for anything
+   // the comparator knows how to order against T, a string_view in a set of
+   // strings for example, without building a T just to throw it away
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator find(const K& k)
+   {
+       return bst.find(k);
+   }
+
+   // The bounds of the elements equal to t. Each one is a single trip down the
+   // tree, so scanning [a, b) is lower_bound(a) to lower_bound(b) instead of
+   // walking from begin()
+   iterator lower_bound(const T& t) const
+   {
+       return bst.lower_bound(t);
+   }
+   iterator upper_bound(const T& t) const
+   {
+       return bst.upper_bound(t);
+   }
+   std::pair<iterator, iterator> equal_range(const T& t) const
+   {
+       auto range = bst.equal_range(t);
+       return std::pair<iterator, iterator>(range.first, range.second);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator lower_bound(const K& k) const
+   {
+       return bst.lower_bound(k);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   iterator upper_bound(const K& k) const
+   {
+       return bst.upper_bound(k);
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   std::pair<iterator, iterator> equal_range(const K& k) const
+   {
+       auto range = bst.equal_range(k);
+       return std::pair<iterator, iterator>(range.first, range.second);
+   }
+
+   // Finger search: lower_bound, but start at itFrom instead of the root. Everything
+   // before itFrom must be less than k. Looking up a sorted run of keys this way
+   // costs the log of how far we move each time rather than the log of the size
+   template <class K>
+   iterator lower_bound(iterator itFrom, const K& k) const
+   {
+       return bst.lower_bound(itFrom.it, k);
+   }
+
+   // Order statistics. Every node knows how big its subtree is, so these are
+   // one trip down the tree instead of counting elements one at a time
+   size_t rank(const T & t) const
+   {
+       return bst.rank(t); // how many elements are less than t
+   }
+   iterator select(size_t i) const
+   {
+       return bst.select(i); // the element with i in front of it, end() if we are not that big
+   }
+   size_t count_range(const T & lo, const T & hi) const
+   {
+       // how many are in [lo, hi)
+       size_t rankLo = bst.rank(lo);
+       size_t rankHi = bst.rank(hi);
+       return rankHi > rankLo ? rankHi - rankLo : 0;
+   }
+
+   // a set has each element once, so count is either zero or one
+   size_t count(const T& t) const
+   {
+       return bst.findNode(t) ? 1 : 0;
+   }
+   template <class K, class CC = C, class = typename CC::is_transparent>
+   size_t count(const K& k) const
+   {
+       return bst.findNode(k) ? 1 : 0;
+   }
+
    //
    // Status
    //
@@ -126,6 +284,18 @@ public:
    { 
        return bst.size();
    }
+   allocator_type get_allocator() const noexcept
+   {
+       return bst.get_allocator(); // whoever is handing out our nodes
+   }
+   key_compare key_comp() const
+   {
+       return bst.key_comp(); // whoever decides what comes first
+   }
+   value_compare value_comp() const
+   {
+       return bst.key_comp(); // in a set the key is the value
+   }
 
    //
    // Insert
@@ -135,25 +305,69 @@ public:
    // They insert a new element into the bst then send back the iterator
    std::pair<iterator, bool> insert(const T& t)
    {
-       return bst.insert(t);
+       return bst.insert(t, true /* keepUnique */);
    }
 
    std::pair<iterator, bool> insert(T&& t)
    {
-       return bst.insert(std::move(t));
+       return bst.insert(std::move(t), true /* keepUnique */);
+   }
+
+   // Insert right in front of itHint if t belongs there, otherwise it is a
+   // regular insert. Appending sorted data with end() as the hint costs one
+   // comparison per element instead of a trip down the tree
+   iterator insert(iterator itHint, const T& t)
+   {
+       return bst.insertHint(itHint.it, t, true /* keepUnique */).first;
+   }
+   iterator insert(iterator itHint, T&& t)
+   {
+       return bst.insertHint(itHint.it, std::move(t), true /* keepUnique */).first;
+   }
+
+   // Build the element right inside its node out of args, no copy and no move.
+   // We can only see the element once it is built, so if it turns out to be a
+   // duplicate the node is thrown away
+   template <class... Args>
+   std::pair<iterator, bool> emplace(Args&&... args)
+   {
+       auto result = bst.insertNode(bst.createNode(std::in_place, std::forward<Args>(args)...), true /* keepUnique */);
+       return std::pair<iterator, bool>(result.first, result.second);
+   }
+
+   // same, but check right in front of itHint first
+   template <class... Args>
+   iterator emplace_hint(iterator itHint, Args&&... args)
+   {
+       return bst.insertNodeHint(itHint.it, bst.createNode(std::in_place, std::forward<Args>(args)...)).first;
    }
 
    void insert(const std::initializer_list <T>& il)
    {
        for (auto&& t : il)
-           bst.insert(t);
+           bst.insert(t, true /* keepUnique */);
    }
 
+   // If we are empty and the range is already sorted we can skip the inserts
+   // and build the tree in one pass. Checking costs one comparison per element,
+   // which is cheap next to the log n each insert would cost. Input iterators
+   // can only be read once so they always go the slow way
    template <class Iterator>
    void insert(Iterator first, Iterator last)
    {
+       using category = typename std::iterator_traits<Iterator>::iterator_category;
+       if constexpr (std::is_base_of<std::forward_iterator_tag, category>::value)
+       {
+           if (empty() && bst.isSortedUnique(first, last))
+           {
+               bst.assignSorted(first, last);
+               return;
+           }
+       }
+
+       // mostly sorted data gets the append fast path
        for (auto it = first; it != last; it++)
-           bst.insert(*it);
+           bst.insertHint(bst.end(), *it, true /* keepUnique */);
    }
 
 
@@ -184,17 +398,121 @@ public:
    }
    iterator erase(iterator &itBegin, iterator &itEnd)
    {
-       auto it = itBegin;   // okay start here
+	   return bst.erase(itBegin.it, itEnd.it); // the BST knows how to drop a whole run without searching
+   }
 
-       while (it != itEnd) // did i say stop? Then keep going
-		   it = erase(it); // erase me
+   //
+   // Node handles
+   //
 
-	   return it; // send back trash can with less trash
+   // Take the node out of the set without freeing it. The element rides along
+   // in the handle and can go into another set that shares our allocator, or
+   // back into this one after it has been changed. No new, no delete, no copy
+   node_type extract(iterator it)
+   {
+       return bst.extract(it.it);
+   }
+   node_type extract(const T & t)
+   {
+       return bst.extract(bst.find(t)); // an empty handle if t is not here
+   }
+
+   // Hang an extracted node in this set. If we already have its element the
+   // node stays in the handle that comes back, so nothing is lost
+   struct insert_return_type;
+   insert_return_type insert(node_type && nh);
+
+   // Move every element of source that we do not have yet over here by relinking
+   // its node. Elements we already have stay behind in source
+   void merge(set & source)
+   {
+       bst.merge(source.bst, true /* keepUnique */);
+   }
+   void merge(set && source)
+   {
+       merge(source);
+   }
+
+   //
+   // Set algebra
+   //
+
+   // These change this set in place. When rhs is much smaller we finger search
+   // our own tree for each of its elements and insert or erase right there, which
+   // is O(m log(n/m + 1)). Otherwise we merge the two in one pass, O(m + n)
+   set & set_union(const set & rhs)
+   {
+       if (!isMuchSmaller(rhs.size(), size()))
+           return *this = custom::set_union(*this, rhs);
+
+       auto itFinger = bst.begin();
+       for (auto it = rhs.begin(); it != rhs.end(); ++it)
+       {
+           itFinger = bst.lower_bound(itFinger, *it);
+           if (itFinger == bst.end() || bst.less(*it, *itFinger))
+               itFinger = bst.insertBefore(itFinger, *it);
+       }
+       return *this;
+   }
+
+   set & set_intersection(const set & rhs)
+   {
+       // we are the small one, throw out whatever rhs does not have
+       if (isMuchSmaller(size(), rhs.size()))
+       {
+           auto itFinger = rhs.begin();
+           for (auto it = bst.begin(); it != bst.end(); )
+           {
+               itFinger = rhs.lower_bound(itFinger, *it);
+               if (itFinger == rhs.end() || bst.less(*it, *itFinger))
+                   it = bst.erase(it);
+               else
+                   ++it;
+           }
+           return *this;
+       }
+       return *this = custom::set_intersection(*this, rhs);
+   }
+
+   set & set_difference(const set & rhs)
+   {
+       // rhs is the small one, so erase its elements from us one at a time
+       if (isMuchSmaller(rhs.size(), size()))
+       {
+           auto itFinger = bst.begin();
+           for (auto it = rhs.begin(); it != rhs.end(); ++it)
+           {
+               itFinger = bst.lower_bound(itFinger, *it);
+               if (itFinger != bst.end() && !bst.less(*it, *itFinger))
+                   itFinger = bst.erase(itFinger);
+           }
+           return *this;
+       }
+       // we are the small one, the free function already knows how to do that
+       return *this = custom::set_difference(*this, rhs);
+   }
+
+   set & set_symmetric_difference(const set & rhs)
+   {
+       if (!isMuchSmaller(rhs.size(), size()))
+           return *this = custom::set_symmetric_difference(*this, rhs);
+
+       // what we share goes away, what only rhs has comes in
+       auto itFinger = bst.begin();
+       for (auto it = rhs.begin(); it != rhs.end(); ++it)
+       {
+           itFinger = bst.lower_bound(itFinger, *it);
+           if (itFinger != bst.end() && !bst.less(*it, *itFinger))
+               itFinger = bst.erase(itFinger);
+           else
+               itFinger = bst.insertBefore(itFinger, *it);
+       }
+       return *this;
    }
 
 private:
    
-   custom::BST <T> bst;
+   custom::BST <T, C, A> bst;
 };
 
 
@@ -202,18 +520,25 @@ private:
  * SET ITERATOR
  * An iterator through Set
  *************************************************/
-template <typename T>
-class set <T> :: iterator
+template <typename T, typename C, typename A>
+class set <T, C, A> :: iterator
 {
    friend class ::TestSet; // give unit tests access to the privates
-   friend class custom::set<T>;
+   friend class custom::set<T, C, A>;
 
 public:
+   // so the standard algorithms know what we are
+   using iterator_category = std::bidirectional_iterator_tag;
+   using value_type        = T;
+   using difference_type   = std::ptrdiff_t;
+   using pointer           = const T*;
+   using reference         = const T&;
+
    // constructors, destructors, and assignment operator
    iterator() 
    { 
    }
-   iterator(const typename custom::BST<T>::iterator& itRHS) 
+   iterator(const typename custom::BST<T, C, A>::iterator& itRHS) 
    {  
 	   this->it = itRHS; // Dont know what type you are but i like you and want to copy you
    }
@@ -242,6 +567,10 @@ public:
    { 
 	   return *it; // what am i pointing at? Call me and find out //Pointing is rude!
    }
+   const T * operator -> () const
+   {
+       return &*it; // reverse_iterator wants this one
+   }
 
    // prefix increment
    iterator & operator ++ ()
@@ -251,7 +580,7 @@ public:
    }
 
    // postfix increment
-   iterator operator++ (int postfix)
+   iterator operator++ (int)
    {
 	   auto tmp = *this; // what I said above but on steroids
        it++;
@@ -264,9 +593,21 @@ public:
 	   --it;    // what I said above but backwards
        return *this;
    }
+
+   // jump n elements in O(log n), not n single steps
+   iterator & operator += (std::ptrdiff_t n)
+   {
+       it += n;
+       return *this;
+   }
+   iterator & operator -= (std::ptrdiff_t n)
+   {
+       it -= n;
+       return *this;
+   }
    
    // postfix decrement
-   iterator operator-- (int postfix)
+   iterator operator-- (int)
    {
 	   auto tmp = *this; // also what I said above but backwards and on steroids
        it--;
@@ -275,11 +616,137 @@ public:
    
 private:
 
-   typename custom::BST<T>::iterator it;
+   typename custom::BST<T, C, A>::iterator it;
+};
+
+/**************************************************
+ * SET INSERT RETURN TYPE
+ * What insert(node_type&&) hands back: where the element is,
+ * whether the node went in, and the node if it did not
+ *************************************************/
+template <typename T, typename C, typename A>
+struct set <T, C, A> :: insert_return_type
+{
+   iterator  position;
+   bool      inserted;
+   node_type node;
 };
 
+template <typename T, typename C, typename A>
+typename set <T, C, A> :: insert_return_type set <T, C, A> :: insert(node_type && nh)
+{
+   auto result = bst.insert(std::move(nh), true /* keepUnique */);
+   return insert_return_type{ iterator(result.first), result.second, std::move(nh) };
+}
+
+
+/**************************************************
+ * SET ALGEBRA
+ * Each of these walks both sets in order, side by side, and
+ * builds the answer bottom-up from the sorted result. That is
+ * O(m + n) instead of O(m log n) for a find or insert per element.
+ * The intersection and difference only need to look at the small
+ * set when one is much smaller, so they finger search the big one
+ *************************************************/
+
+// The allocator the answer starts with, the same one a copy of s would get.
+// A is whatever was asked for, which for a B-tree or copy-on-write set is a
+// tag, so the set's own allocator_type is the one to ask
+template <typename T, typename C, typename A>
+typename set<T, C, A>::allocator_type allocatorForCopy(const set<T, C, A>& s)
+{
+   using Alloc = typename set<T, C, A>::allocator_type;
+   return std::allocator_traits<Alloc>::select_on_container_copy_construction(s.get_allocator());
+}
+
+template <typename T, typename C, typename A>
+set<T, C, A> set_union(const set<T, C, A>& lhs, const set<T, C, A>& rhs)
+{
+   std::vector<T> v;
+   v.reserve(lhs.size() + rhs.size());
+   std::set_union(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                  std::back_inserter(v), lhs.key_comp());
+   return set<T, C, A>::from_sorted(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()),
+      lhs.key_comp(), allocatorForCopy(lhs));
+}
+
+template <typename T, typename C, typename A>
+set<T, C, A> set_intersection(const set<T, C, A>& lhs, const set<T, C, A>& rhs)
+{
+   std::vector<T> v;
+   if (isMuchSmaller(lhs.size(), rhs.size()) || isMuchSmaller(rhs.size(), lhs.size()))
+   {
+      const set<T, C, A>& small = lhs.size() < rhs.size() ? lhs : rhs;
+      const set<T, C, A>& big   = lhs.size() < rhs.size() ? rhs : lhs;
+      auto comp = lhs.key_comp();
+      auto itFinger = big.begin();
+      for (auto it = small.begin(); it != small.end(); ++it)
+      {
+         itFinger = big.lower_bound(itFinger, *it);
+         if (itFinger != big.end() && !comp(*it, *itFinger))
+            v.push_back(*it);
+      }
+   }
+   else
+      std::set_intersection(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                            std::back_inserter(v), lhs.key_comp());
+   return set<T, C, A>::from_sorted(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()),
+      lhs.key_comp(), allocatorForCopy(lhs));
+}
+
+template <typename T, typename C, typename A>
+set<T, C, A> set_difference(const set<T, C, A>& lhs, const set<T, C, A>& rhs)
+{
+   std::vector<T> v;
+   if (isMuchSmaller(lhs.size(), rhs.size()))
+   {
+      auto comp = lhs.key_comp();
+      auto itFinger = rhs.begin();
+      for (auto it = lhs.begin(); it != lhs.end(); ++it)
+      {
+         itFinger = rhs.lower_bound(itFinger, *it);
+         if (itFinger == rhs.end() || comp(*it, *itFinger))
+            v.push_back(*it);
+      }
+   }
+   else
+      std::set_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                          std::back_inserter(v), lhs.key_comp());
+   return set<T, C, A>::from_sorted(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()),
+      lhs.key_comp(), allocatorForCopy(lhs));
+}
+
+template <typename T, typename C, typename A>
+set<T, C, A> set_symmetric_difference(const set<T, C, A>& lhs, const set<T, C, A>& rhs)
+{
+   std::vector<T> v;
+   v.reserve(lhs.size() + rhs.size());
+   std::set_symmetric_difference(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(),
+                                 std::back_inserter(v), lhs.key_comp());
+   return set<T, C, A>::from_sorted(std::make_move_iterator(v.begin()), std::make_move_iterator(v.end()),
+      lhs.key_comp(), allocatorForCopy(lhs));
+}
 
 }; // namespace custom
 
+/**************************************************
+ * PMR SET
+ * A set whose nodes come from a std::pmr::memory_resource,
+ * back it with a monotonic_buffer_resource for short-lived sets
+ *************************************************/
+#if defined(__has_include)
+#if __has_include(<memory_resource>)
+#include <memory_resource>
+namespace custom
+{
+namespace pmr
+{
+   template <typename T, typename C = std::less<T>>
+   using set = custom::set<T, C, std::pmr::polymorphic_allocator<T>>;
+}
+}
+#endif
+#endif
+
 
 
@@ -0,0 +1,388 @@
+/***********************************************************************
+ * Header:
+ *    Sharded Set
+ * Summary:
+ *    The simplest way to let many threads at one set: don't. Split the
+ *    elements by hash into N trees that have nothing to do with each
+ *    other, each with its own lock, and every insert, erase, and lookup
+ *    goes to exactly one of them. Two threads only ever wait on each
+ *    other when they want the same shard, which with N shards happens
+ *    about one time in N.
+ *
+ *    Every shard's lock, count, and tree header sit together on cache
+ *    lines of their own, so working on one shard never drags another
+ *    shard's lines away from the core that is using them.
+ *
+ *    What splitting by hash costs is order. No one shard knows where an
+ *    element falls among the others, so walking the whole set in order
+ *    means walking all N at once and taking the smallest each time. A
+ *    scan() holds every shard for reading while it does that, so it sees
+ *    the set as it was at one moment.
+ *
+ *    This will contain the class definition of:
+ *        sharded_set                : A set split over N independent trees
+ *        sharded_set::view          : Every shard held still for a walk
+ *        sharded_set::view::iterator: In order across all the shards
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cassert>
+#include <cstddef>      // for size_t and std::ptrdiff_t
+#include <cstdint>      // for uint64_t
+#include <atomic>       // each shard's count
+#include <mutex>        // for std::unique_lock
+#include <shared_mutex> // each shard's lock
+#include <functional>   // for std::less and std::hash
+#include <optional>     // for find, which may not find anything
+#include <iterator>     // for std::forward_iterator_tag
+#include <algorithm>    // for std::push_heap and std::pop_heap
+#include <vector>       // the heap that merges the shards
+#include "bst.h"        // what each shard keeps its elements in
+
+class TestShardedSet;  // forward declaration for unit tests
+
+namespace custom
+{
+
+/************************************************
+ * SHARDED SET
+ * N trees, each behind its own lock, and an element
+ * always goes to the one its hash picks
+ ***********************************************/
+template <typename T, size_t N = 16, typename C = std::less<T>, typename H = std::hash<T>,
+          typename A = std::allocator<T>>
+class sharded_set
+{
+   static_assert(N > 0, "there has to be somewhere to put things");
+   friend class ::TestShardedSet; // give unit tests access to the privates
+public:
+   class view;
+   using key_type       = T;
+   using value_type     = T;
+   using size_type      = size_t;
+   using key_compare    = C;
+   using value_compare  = C;
+   using hasher         = H;
+   using allocator_type = A;
+
+   //
+   // Construct
+   //
+   sharded_set() : shards(), hash()
+   {
+   }
+   explicit sharded_set(const C & comp, const H & hash = H(), const A & a = A()) : hash(hash)
+   {
+      for (auto & shard : shards)
+         shard.bst = BST<T, C, A>(comp, a);
+   }
+   sharded_set(const std::initializer_list <T> & il) : sharded_set()
+   {
+      for (const T & t : il)
+         insert(t);
+   }
+   template <class Iterator>
+   sharded_set(Iterator first, Iterator last) : sharded_set()
+   {
+      for (; first != last; ++first)
+         insert(*first);
+   }
+
+   // Other threads may be halfway through a change to either side, so there
+   // is no copying or moving one of these. Walk a scan() to copy one
+   sharded_set(const sharded_set &) = delete;
+   sharded_set & operator = (const sharded_set &) = delete;
+
+   //
+   // Access
+   //
+
+   // one shard, held for reading, so lookups on the same shard go side by side
+   bool contains(const T & t) const
+   {
+      const Shard & shard = shardOf(t);
+      std::shared_lock<std::shared_mutex> lock(shard.lock);
+      return isAt(shard, t, shard.bst.lower_bound(t));
+   }
+   size_t count(const T & t) const
+   {
+      return contains(t) ? 1 : 0;
+   }
+
+   // a copy of the element, since the one in the set may be gone the moment we let go
+   std::optional<T> find(const T & t) const
+   {
+      const Shard & shard = shardOf(t);
+      std::shared_lock<std::shared_mutex> lock(shard.lock);
+      auto it = shard.bst.lower_bound(t);
+      if (!isAt(shard, t, it))
+         return std::nullopt;
+      return *it;
+   }
+
+   // every shard held still, to walk in order
+   view scan() const
+   {
+      return view(*this);
+   }
+
+   //
+   // Status
+   //
+
+   // Adds up the shards' counts without taking a single lock. With other
+   // threads inserting and erasing it is a close guess, exact when nobody is
+   size_t size() const noexcept
+   {
+      size_t num = 0;
+      for (auto & shard : shards)
+         num += shard.numElements.load(std::memory_order_relaxed);
+      return num;
+   }
+   bool empty() const noexcept
+   {
+      return size() == 0;
+   }
+   allocator_type get_allocator() const
+   {
+      return shards[0].bst.get_allocator();
+   }
+   key_compare key_comp() const
+   {
+      return shards[0].bst.key_comp();
+   }
+   value_compare value_comp() const
+   {
+      return shards[0].bst.key_comp();
+   }
+   hasher hash_function() const
+   {
+      return hash;
+   }
+
+   //
+   // Insert
+   //
+
+   // true if it went in, false if it was there already
+   bool insert(const T & t)
+   {
+      Shard & shard = shardOf(t);
+      std::unique_lock<std::shared_mutex> lock(shard.lock);
+      bool isNew = shard.bst.insert(t, true /* keepUnique */).second;
+      shard.numElements.store(shard.bst.size(), std::memory_order_relaxed);
+      return isNew;
+   }
+   bool insert(T && t)
+   {
+      Shard & shard = shardOf(t);
+      std::unique_lock<std::shared_mutex> lock(shard.lock);
+      bool isNew = shard.bst.insert(std::move(t), true /* keepUnique */).second;
+      shard.numElements.store(shard.bst.size(), std::memory_order_relaxed);
+      return isNew;
+   }
+
+   // we need the element to hash it, so it is made before we know where it goes
+   template <class... Args>
+   bool emplace(Args&&... args)
+   {
+      return insert(T(std::forward<Args>(args)...));
+   }
+
+   //
+   // Remove
+   //
+   size_t erase(const T & t)
+   {
+      Shard & shard = shardOf(t);
+      std::unique_lock<std::shared_mutex> lock(shard.lock);
+      auto it = shard.bst.find(t);
+      if (it == shard.bst.end())
+         return 0;
+      shard.bst.erase(it);
+      shard.numElements.store(shard.bst.size(), std::memory_order_relaxed);
+      return 1;
+   }
+
+   // one shard at a time, so nobody waits on all of them at once
+   void clear()
+   {
+      for (auto & shard : shards)
+      {
+         std::unique_lock<std::shared_mutex> lock(shard.lock);
+         shard.bst.clear();
+         shard.numElements.store(0, std::memory_order_relaxed);
+      }
+   }
+
+private:
+
+   // A shard's lock, its count, and its tree header, on cache lines no
+   // other shard touches
+   struct alignas(64) Shard
+   {
+      mutable std::shared_mutex lock;
+      std::atomic<size_t> numElements{ 0 };
+      BST<T, C, A> bst;
+   };
+
+   // Mix the hash before picking a shard. std::hash of an integer is often
+   // the integer itself, and runs of them would otherwise land in runs of shards
+   size_t shardIndex(const T & t) const
+   {
+      uint64_t mixed = (uint64_t)hash(t) * 0x9e3779b97f4a7c15ull;
+      return (size_t)((mixed >> 32) % N);
+   }
+   Shard & shardOf(const T & t)
+   {
+      return shards[shardIndex(t)];
+   }
+   const Shard & shardOf(const T & t) const
+   {
+      return shards[shardIndex(t)];
+   }
+
+   // lower_bound landed on t itself
+   static bool isAt(const Shard & shard, const T & t, const typename BST<T, C, A>::iterator & it)
+   {
+      return it != shard.bst.end() && !shard.bst.key_comp()(t, *it);
+   }
+
+   Shard shards[N];  // the trees
+   H hash;           // picks which tree
+};
+
+/************************************************
+ * VIEW
+ * Every shard held for reading, from the first to the
+ * last, for as long as the view is around. Writers only
+ * ever hold one shard, so they cannot hold one of ours
+ * while waiting on another
+ ***********************************************/
+template <typename T, size_t N, typename C, typename H, typename A>
+class sharded_set <T, N, C, H, A> ::view
+{
+   friend class sharded_set;
+public:
+   class iterator;
+
+   iterator begin() const;
+   iterator end() const
+   {
+      return iterator();
+   }
+
+   view(view &&) = default;
+
+private:
+   view(const sharded_set & s) : pSet(&s)
+   {
+      for (size_t i = 0; i < N; i++)
+         locks[i] = std::shared_lock<std::shared_mutex>(s.shards[i].lock);
+   }
+
+   const sharded_set* pSet;
+   std::shared_lock<std::shared_mutex> locks[N];
+};
+
+/************************************************
+ * VIEW ITERATOR
+ * Where we are in every shard, kept in a heap with the
+ * smallest on top. Moving on is taking the top one a
+ * step along its shard and letting it sink to its place
+ ***********************************************/
+template <typename T, size_t N, typename C, typename H, typename A>
+class sharded_set <T, N, C, H, A> ::view::iterator
+{
+   friend class view;
+   using TreeIterator = typename BST<T, C, A>::iterator;
+public:
+   using iterator_category = std::forward_iterator_tag;
+   using value_type        = T;
+   using difference_type   = std::ptrdiff_t;
+   using pointer           = const T*;
+   using reference         = const T&;
+
+   iterator() : pSet(nullptr)
+   {
+   }
+
+   // end() has an empty heap, and so does anything walked off the end
+   bool operator == (const iterator & rhs) const
+   {
+      if (heap.empty() || rhs.heap.empty())
+         return heap.empty() == rhs.heap.empty();
+      return heap.front() == rhs.heap.front();
+   }
+   bool operator != (const iterator & rhs) const
+   {
+      return !(*this == rhs);
+   }
+
+   const T & operator * () const
+   {
+      assert(!heap.empty());
+      return *heap.front();
+   }
+   const T * operator -> () const
+   {
+      return &**this;
+   }
+
+   iterator & operator ++ ()
+   {
+      assert(!heap.empty());
+      std::pop_heap(heap.begin(), heap.end(), Greater{ pSet });
+      ++heap.back();
+      if (heap.back() == TreeIterator())
+         heap.pop_back();
+      else
+         std::push_heap(heap.begin(), heap.end(), Greater{ pSet });
+      return *this;
+   }
+   iterator operator ++ (int)
+   {
+      iterator tmp(*this);
+      ++(*this);
+      return tmp;
+   }
+
+private:
+   // std::push_heap keeps the biggest on top, so order them backwards
+   struct Greater
+   {
+      const sharded_set* pSet;
+      bool operator () (const TreeIterator & lhs, const TreeIterator & rhs) const
+      {
+         return pSet->key_comp()(*rhs, *lhs);
+      }
+   };
+
+   const sharded_set* pSet;
+   std::vector<TreeIterator> heap;   // the next one from every shard that has any left
+};
+
+// The first of every shard. Each tree keeps track of its smallest node,
+// so this is one read per shard, and many readers can do it at once
+template <typename T, size_t N, typename C, typename H, typename A>
+typename sharded_set <T, N, C, H, A> ::view::iterator sharded_set <T, N, C, H, A> ::view::begin() const
+{
+   iterator it;
+   it.pSet = pSet;
+   it.heap.reserve(N);
+   for (auto & shard : pSet->shards)
+   {
+      auto itShard = shard.bst.begin();
+      if (itShard != shard.bst.end())
+      {
+         it.heap.push_back(itShard);
+         std::push_heap(it.heap.begin(), it.heap.end(), typename iterator::Greater{ pSet });
+      }
+   }
+   return it;
+}
+
+} // namespace custom
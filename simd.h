@@ -0,0 +1,271 @@
+/***********************************************************************
+ * Header:
+ *    SIMD
+ * Summary:
+ *    Searching one B-tree node full of plain numbers. The answer to
+ *    lower_bound is just how many of them are less than the key, and a
+ *    vector compare checks four or eight at once. We compare the whole
+ *    node, room that is not in use included, the same number of times
+ *    every time, and throw away the answers past the end with a mask.
+ *    That leaves no branch for the CPU to guess wrong on at all.
+ *
+ *    SSE2 comes with every x86-64, so that is the floor. AVX2 is twice as
+ *    wide but not everywhere, so we ask the CPU once and remember. 64-bit
+ *    integers need AVX2 to compare, before that they go one at a time.
+ *    Everything else, and every other CPU, goes one at a time too, and
+ *    that one-at-a-time version is what the unit tests hold the vector
+ *    versions to.
+ *
+ *    This will contain:
+ *        isSearchable        : The types the vector versions handle
+ *        width               : How many fit in the widest vector
+ *        countLess           : How many are less than the key
+ *        countLessEqual      : How many are less than or equal to the key
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#include <cstdint>
+#include <type_traits>  // for std::is_integral
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define CUSTOM_SIMD_X86 1
+#include <immintrin.h>  // SSE2 and AVX2 intrinsics
+#ifdef _MSC_VER
+#include <intrin.h>     // for __cpuid
+#endif
+#else
+#define CUSTOM_SIMD_X86 0
+#endif
+
+// GCC and Clang only let us use AVX2 in a function that says so. MSVC lets
+// any function use it, it is up to us to not call it on the wrong CPU
+#if defined(__GNUC__) || defined(__clang__)
+#define CUSTOM_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define CUSTOM_TARGET_AVX2
+#endif
+
+namespace custom
+{
+namespace simd
+{
+
+/************************************************
+ * IS SEARCHABLE
+ * Signed integers and floating point, four or eight bytes.
+ * Unsigned would need its sign bit flipped to compare right
+ ***********************************************/
+template <class T>
+inline constexpr bool isSearchable =
+   (std::is_integral<T>::value && std::is_signed<T>::value && (sizeof(T) == 4 || sizeof(T) == 8)) ||
+   std::is_same<T, float>::value || std::is_same<T, double>::value;
+
+// A node searched this way has room for a whole number of the widest vectors
+template <class T>
+inline constexpr int width = 32 / sizeof(T);
+
+/************************************************
+ * COUNT SCALAR
+ * One at a time. Adding the bool instead of branching on
+ * it keeps this straight-line code too
+ ***********************************************/
+template <bool OR_EQUAL, class T>
+int countScalar(const T* p, int n, T k)
+{
+   int count = 0;
+   for (int i = 0; i < n; i++)
+      count += OR_EQUAL ? !(k < p[i]) : (p[i] < k);
+   return count;
+}
+
+#if CUSTOM_SIMD_X86
+
+// how many bits are on in the first n bits of the answers
+inline int countBits(uint64_t bits, int n)
+{
+   bits &= n >= 64 ? ~0ull : (1ull << n) - 1;
+#if defined(__GNUC__) || defined(__clang__)
+   return __builtin_popcountll(bits);
+#else
+   int count = 0;
+   for (; bits; bits &= bits - 1)
+      count++;
+   return count;
+#endif
+}
+
+/************************************************
+ * HAS AVX2
+ * Ask the CPU, and on Windows also ask whether the OS
+ * saves the wide registers when it switches threads
+ ***********************************************/
+inline bool hasAvx2()
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+   int info[4];
+   __cpuid(info, 0);
+   if (info[0] < 7)
+      return false;
+   __cpuid(info, 1);
+   bool osSavesYmm = (info[2] & (1 << 27)) && (_xgetbv(0) & 6) == 6;
+   __cpuidex(info, 7, 0);
+   return osSavesYmm && (info[1] & (1 << 5));
+#else
+   return __builtin_cpu_supports("avx2");
+#endif
+}
+
+// asked once, the first time anybody searches
+inline bool useAvx2()
+{
+   static const bool avx2 = hasAvx2();
+   return avx2;
+}
+
+/************************************************
+ * SSE2 kernels: four int32 or float, two double.
+ * Each compare adds a few bits to the answers, one per
+ * element. For integers v <= k is everything that is not v > k
+ ***********************************************/
+template <bool OR_EQUAL, int CAPACITY, class T>
+int countSse2Int32(const T* p, int n, T k)
+{
+   const __m128i key = _mm_set1_epi32((int32_t)k);
+   uint64_t bits = 0;
+   for (int i = 0; i < CAPACITY; i += 4)
+   {
+      __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + i));
+      __m128i hit = OR_EQUAL ? _mm_cmpgt_epi32(v, key) : _mm_cmpgt_epi32(key, v);
+      bits |= (uint64_t)(_mm_movemask_ps(_mm_castsi128_ps(hit)) ^ (OR_EQUAL ? 0xf : 0)) << i;
+   }
+   return countBits(bits, n);
+}
+
+template <bool OR_EQUAL, int CAPACITY>
+int countSse2Float(const float* p, int n, float k)
+{
+   const __m128 key = _mm_set1_ps(k);
+   uint64_t bits = 0;
+   for (int i = 0; i < CAPACITY; i += 4)
+   {
+      __m128 v = _mm_loadu_ps(p + i);
+      bits |= (uint64_t)_mm_movemask_ps(OR_EQUAL ? _mm_cmple_ps(v, key) : _mm_cmplt_ps(v, key)) << i;
+   }
+   return countBits(bits, n);
+}
+
+template <bool OR_EQUAL, int CAPACITY>
+int countSse2Double(const double* p, int n, double k)
+{
+   const __m128d key = _mm_set1_pd(k);
+   uint64_t bits = 0;
+   for (int i = 0; i < CAPACITY; i += 2)
+   {
+      __m128d v = _mm_loadu_pd(p + i);
+      bits |= (uint64_t)_mm_movemask_pd(OR_EQUAL ? _mm_cmple_pd(v, key) : _mm_cmplt_pd(v, key)) << i;
+   }
+   return countBits(bits, n);
+}
+
+/************************************************
+ * AVX2 kernels: eight int32 or float, four int64 or double
+ ***********************************************/
+template <bool OR_EQUAL, int CAPACITY, class T>
+CUSTOM_TARGET_AVX2 int countAvx2Int32(const T* p, int n, T k)
+{
+   const __m256i key = _mm256_set1_epi32((int32_t)k);
+   uint64_t bits = 0;
+   for (int i = 0; i < CAPACITY; i += 8)
+   {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+      __m256i hit = OR_EQUAL ? _mm256_cmpgt_epi32(v, key) : _mm256_cmpgt_epi32(key, v);
+      bits |= (uint64_t)(_mm256_movemask_ps(_mm256_castsi256_ps(hit)) ^ (OR_EQUAL ? 0xff : 0)) << i;
+   }
+   return countBits(bits, n);
+}
+
+template <bool OR_EQUAL, int CAPACITY, class T>
+CUSTOM_TARGET_AVX2 int countAvx2Int64(const T* p, int n, T k)
+{
+   const __m256i key = _mm256_set1_epi64x((long long)k);
+   uint64_t bits = 0;
+   for (int i = 0; i < CAPACITY; i += 4)
+   {
+      __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+      __m256i hit = OR_EQUAL ? _mm256_cmpgt_epi64(v, key) : _mm256_cmpgt_epi64(key, v);
+      bits |= (uint64_t)(_mm256_movemask_pd(_mm256_castsi256_pd(hit)) ^ (OR_EQUAL ? 0xf : 0)) << i;
+   }
+   return countBits(bits, n);
+}
+
+template <bool OR_EQUAL, int CAPACITY>
+CUSTOM_TARGET_AVX2 int countAvx2Float(const float* p, int n, float k)
+{
+   const __m256 key = _mm256_set1_ps(k);
+   uint64_t bits = 0;
+   for (int i = 0; i < CAPACITY; i += 8)
+   {
+      __m256 v = _mm256_loadu_ps(p + i);
+      bits |= (uint64_t)_mm256_movemask_ps(_mm256_cmp_ps(v, key, OR_EQUAL ? _CMP_LE_OQ : _CMP_LT_OQ)) << i;
+   }
+   return countBits(bits, n);
+}
+
+template <bool OR_EQUAL, int CAPACITY>
+CUSTOM_TARGET_AVX2 int countAvx2Double(const double* p, int n, double k)
+{
+   const __m256d key = _mm256_set1_pd(k);
+   uint64_t bits = 0;
+   for (int i = 0; i < CAPACITY; i += 4)
+   {
+      __m256d v = _mm256_loadu_pd(p + i);
+      bits |= (uint64_t)_mm256_movemask_pd(_mm256_cmp_pd(v, key, OR_EQUAL ? _CMP_LE_OQ : _CMP_LT_OQ)) << i;
+   }
+   return countBits(bits, n);
+}
+
+#endif // CUSTOM_SIMD_X86
+
+/************************************************
+ * COUNT
+ * Pick the widest kernel this T and this CPU can use
+ ***********************************************/
+template <bool OR_EQUAL, int CAPACITY, class T>
+int count(const T* p, int n, T k)
+{
+   static_assert(isSearchable<T>, "only plain signed numbers can be counted a vector at a time");
+   static_assert(CAPACITY % width<T> == 0 && CAPACITY <= 64, "the room has to be whole vectors, one bit apiece");
+#if CUSTOM_SIMD_X86
+   if constexpr (std::is_integral<T>::value && sizeof(T) == 4)
+      return useAvx2() ? countAvx2Int32<OR_EQUAL, CAPACITY>(p, n, k) : countSse2Int32<OR_EQUAL, CAPACITY>(p, n, k);
+   else if constexpr (std::is_integral<T>::value && sizeof(T) == 8)
+      return useAvx2() ? countAvx2Int64<OR_EQUAL, CAPACITY>(p, n, k) : countScalar<OR_EQUAL>(p, n, k);
+   else if constexpr (std::is_same<T, float>::value)
+      return useAvx2() ? countAvx2Float<OR_EQUAL, CAPACITY>(p, n, k) : countSse2Float<OR_EQUAL, CAPACITY>(p, n, k);
+   else if constexpr (std::is_same<T, double>::value)
+      return useAvx2() ? countAvx2Double<OR_EQUAL, CAPACITY>(p, n, k) : countSse2Double<OR_EQUAL, CAPACITY>(p, n, k);
+#endif
+   return countScalar<OR_EQUAL>(p, n, k);
+}
+
+// p has room for CAPACITY and the first n are sorted. How many of those n are
+// less than k, which is where lower_bound lands. The rest of the room is read
+// but never counted, so it does not matter what is in it
+template <int CAPACITY, class T>
+int countLess(const T* p, int n, T k)
+{
+   return count<false, CAPACITY>(p, n, k);
+}
+
+// and how many are not greater than k, which is where upper_bound lands
+template <int CAPACITY, class T>
+int countLessEqual(const T* p, int n, T k)
+{
+   return count<true, CAPACITY>(p, n, k);
+}
+
+} // namespace simd
+} // namespace custom
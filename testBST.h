@@ -20,6 +20,8 @@
 #include <iostream>
 #include <string>
 #include <functional> // for std::less and std::greater
+#include <algorithm>  // for std::max
+#include <random>     // for std::mt19937
 
  /***********************************************
   * TEST BST
@@ -81,6 +83,8 @@ public:
       test_find_standardBegin();
       test_find_standardLast();
       test_find_standardMissing();
+      test_find_comparisonsPerLevel();
+      test_equalRange_duplicates();
 
       // Insert
       test_insert_oneLeft();
@@ -91,6 +95,8 @@ public:
       test_insertMove_oneRight();
       test_insertMove_duplicate();
       test_insertMove_keepUnique();
+      test_insert_comparisonsPerLevel();
+      test_emplace_duplicate();
 
       // Remove
       test_erase_empty();
@@ -100,6 +106,21 @@ public:
       test_erase_twoChildren();
       test_clear_empty();
       test_clear_standard();
+      test_clear_tallLeftVine();
+      test_copy_tallRightVine();
+      test_assign_tallRightVine();
+      test_stress_sequential();
+
+      // Balance
+      test_balance_rotateLeft();
+      test_balance_rotateRightLeft();
+      test_balance_recolor();
+      test_balance_insertSorted();
+      test_balance_insertReverse();
+      test_balance_eraseMany();
+      test_balance_insertEraseMixed();
+      test_validate_standard();
+      test_validate_redRed();
 
       // Status
       test_empty_empty();
@@ -121,6 +142,7 @@ public:
       std::allocator<custom::BST<Spy>> alloc;
       custom::BST<Spy> bst;
       bst.numElements = 99;
+      bst.findEnds();
       bst.root = (custom::BST<Spy>::BNode*)0xBAADF00D;
       Spy::reset();
       // exercise
@@ -146,6 +168,7 @@ public:
       custom::BST<Spy> bstDest;
       std::allocator<custom::BST<Spy>> alloc;
       bstDest.numElements = 99;
+      bstDest.findEnds();
       bstDest.root = (custom::BST<Spy>::BNode*)0xBAADF00D;
       Spy::reset();
       // exercise
@@ -635,6 +658,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstDest.root = p99;
       bstDest.numElements = 1;
+      bstDest.findEnds();
       Spy::reset();
       // exercise
       bstDest = bstSrc;
@@ -676,6 +700,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstSrc.root = p99;
       bstSrc.numElements = 1;
+      bstSrc.findEnds();
       //                (50) = bstDest
       //          +-------+-------+
       //        (30)            (70)
@@ -877,6 +902,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstDest.root = p99;
       bstDest.numElements = 1;
+      bstDest.findEnds();
       Spy::reset();
       // exercise
       bstDest = std::move(bstSrc);
@@ -911,6 +937,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstSrc.root = p99;
       bstSrc.numElements = 1;
+      bstSrc.findEnds();
       //                (50) = bstDest
       //          +-------+-------+
       //        (30)            (70)
@@ -1028,6 +1055,7 @@ public:
       custom::BST <Spy>::BNode* p99 = new custom::BST<Spy>::BNode(Spy(99));
       bstDest.root = p99;
       bstDest.numElements = 1;
+      bstDest.findEnds();
       Spy::reset();
       // exercise
       bstDest = ilSrc;
@@ -1244,6 +1272,113 @@ public:
       assertEmptyFixture(bst);
    }  // teardown
 
+   /***************************************
+    * STACK SAFETY
+    * A tree this tall would take a million stack frames
+    * to walk recursively. Red-black balancing keeps insert
+    * from building one, so we build them by hand
+    ***************************************/
+
+   static const int SIZE_VINE = 1000000;
+
+   // hang n nodes off of each other, all to the left or all to the right
+   void setupVine(custom::BST <int>& bst, int n, bool toLeft)
+   {
+      custom::BST <int> ::BNode* pTail = nullptr;
+      for (int i = 0; i < n; i++)
+      {
+         auto pNode = bst.createNode(toLeft ? n - 1 - i : i);
+         pNode->isRed = false;
+         pNode->size = n - i;
+         if (!pTail)
+            bst.root = pNode;
+         else if (toLeft)
+            pTail->addLeft(pNode);
+         else
+            pTail->addRight(pNode);
+         pTail = pNode;
+      }
+      bst.numElements = n;
+   }
+
+   // clearing a left vine, the worst case for a post-order walk
+   void test_clear_tallLeftVine()
+   {  // setup
+      custom::BST <int> bst;
+      setupVine(bst, SIZE_VINE, true /* toLeft */);
+      // exercise
+      bst.clear();
+      // verify
+      assertUnit(bst.numElements == 0);
+      assertUnit(bst.root == nullptr);
+   }  // teardown
+
+   // copying a right vine gives the same vine with the parents hooked up
+   void test_copy_tallRightVine()
+   {  // setup
+      custom::BST <int> bst;
+      setupVine(bst, SIZE_VINE, false /* toLeft */);
+      // exercise
+      custom::BST <int> bstCopy(bst);
+      // verify
+      assertUnit(bstCopy.numElements == SIZE_VINE);
+      bool sameVine = bstCopy.root != nullptr && bstCopy.root->pParent == nullptr;
+      int expected = 0;
+      for (auto pNode = bstCopy.root; pNode; pNode = pNode->pRight, expected++)
+         sameVine = sameVine && pNode->data == expected && pNode->pLeft == nullptr &&
+                    (pNode->pRight == nullptr || pNode->pRight->pParent == pNode);
+      assertUnit(sameVine);
+      assertUnit(expected == SIZE_VINE);
+   }  // teardown
+
+   // assigning onto a tree of a different shape reuses what it can and trims the rest
+   void test_assign_tallRightVine()
+   {  // setup
+      custom::BST <int> bst;
+      setupVine(bst, SIZE_VINE, false /* toLeft */);
+      custom::BST <int> bstDest;
+      setupVine(bstDest, 1000, true /* toLeft */);
+      // exercise
+      bstDest = bst;
+      // verify
+      assertUnit(bstDest.numElements == SIZE_VINE);
+      bool sameVine = true;
+      int expected = 0;
+      for (auto pNode = bstDest.root; pNode; pNode = pNode->pRight, expected++)
+         sameVine = sameVine && pNode->data == expected && pNode->pLeft == nullptr;
+      assertUnit(sameVine);
+      assertUnit(expected == SIZE_VINE);
+      // exercise
+      bst = custom::BST <int>();
+      bstDest = bst;
+      // verify
+      assertUnit(bstDest.numElements == 0);
+      assertUnit(bstDest.root == nullptr);
+   }  // teardown
+
+   // ten million in a row, copy them, and tear both down
+   void test_stress_sequential()
+   {  // setup
+      custom::BST <int> bst;
+      const int num = 10000000;
+      for (int i = 0; i < num; i++)
+         bst.insert(i);
+      // exercise
+      custom::BST <int> bstCopy(bst);
+      // verify
+      assertUnit(bstCopy.size() == num);
+      assertUnit(bstCopy.validate());
+      assertUnit(height(bstCopy.root) <= 2 * 24);   // 2 log(10 million)
+      // exercise
+      bst.clear();
+      bstCopy.clear();
+      // verify
+      assertUnit(bst.numElements == 0);
+      assertUnit(bst.root == nullptr);
+      assertUnit(bstCopy.numElements == 0);
+      assertUnit(bstCopy.root == nullptr);
+   }  // teardown
+
    /***************************************
     * Iterator
     *     BST::begin()
@@ -1674,8 +1809,8 @@ public:
       // exercise
       it = bst.find(s);
       // verify
-      assertUnit(Spy::numEquals() == 3);      // check [50][30][20]
-      assertUnit(Spy::numLessthan() == 2);    // compare [50][30]
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numLessthan() == 4);    // compare [50][30][20] then check [20]
       assertUnit(Spy::numDestructor() == 0);
       assertUnit(Spy::numDelete() == 0);
       assertUnit(Spy::numAssign() == 0);
@@ -1717,8 +1852,8 @@ public:
       // exercise
       it = bst.find(s);
       // verify
-      assertUnit(Spy::numEquals() == 3);      // check [50][70][80]
-      assertUnit(Spy::numLessthan() == 2);    // compare [50][70]
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numLessthan() == 4);    // compare [50][70][80] then check [80]
       assertUnit(Spy::numDestructor() == 0);
       assertUnit(Spy::numDelete() == 0);
       assertUnit(Spy::numAssign() == 0);
@@ -1760,8 +1895,8 @@ public:
       // exercise
       it = bst.find(s);
       // verify
-      assertUnit(Spy::numEquals() == 3);      // check [50][30][40]
-      assertUnit(Spy::numLessthan() == 3);    // compare [50][30][40]
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(Spy::numLessthan() == 4);    // compare [50][30][40] then check [40]
       assertUnit(Spy::numDestructor() == 0);
       assertUnit(Spy::numDelete() == 0);
       assertUnit(Spy::numAssign() == 0);
@@ -1777,6 +1912,47 @@ public:
       teardownStandardFixture(bst);
    }
 
+   // no matter where the element is, we pay one comparison per level plus one
+   void test_find_comparisonsPerLevel()
+   {  // setup
+      custom::BST <Spy> bst;
+      for (int i = 0; i < 1000; i += 2)
+         bst.insert(Spy(i));
+      int levels = height(bst.root);
+      bool withinBound = true;
+      // exercise
+      for (int i = -1; i <= 1000; i++)
+      {
+         Spy s(i);
+         Spy::reset();
+         auto it = bst.find(s);
+         withinBound = withinBound && (Spy::numLessthan() + Spy::numEquals() <= levels + 1);
+         // verify
+         assertUnit((it != bst.end()) == (i >= 0 && i < 1000 && i % 2 == 0));
+      }
+      // verify
+      assertUnit(withinBound);
+   }  // teardown
+
+
+   // a plain BST keeps duplicates, the range has to cover all of them
+   void test_equalRange_duplicates()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 10; i++)
+         bst.insert(i % 3);   // 0 1 2 0 1 2 0 1 2 0
+      // exercise
+      auto range = bst.equal_range(1);
+      // verify
+      int num = 0;
+      for (auto it = range.first; it != range.second; ++it, ++num)
+         assertUnit(*it == 1);
+      assertUnit(num == 3);
+      assertUnit(range.second != bst.end());
+      assertUnit(*range.second == 2);
+      assertUnit(bst.lower_bound(3) == bst.end());
+      assertUnit(*bst.upper_bound(-1) == 0);
+   }  // teardown
 
 
    /***************************************
@@ -1792,6 +1968,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.findEnds();
       Spy s(60);
       Spy::reset();
       // exercise
@@ -1851,6 +2028,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.findEnds();
       Spy s(40);
       Spy::reset();
       // exercise
@@ -1913,6 +2091,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.findEnds();
       Spy s(50);
       Spy::reset();
       // exercise
@@ -1981,8 +2160,8 @@ public:
       // exercise
       auto pairBST = bst.insert(s, true /* keepUnique */);
       // verify
-      assertUnit(Spy::numLessthan() == 2);    // compare [50][30]
-      assertUnit(Spy::numEquals() == 3);      // compare [50][30][40]
+      assertUnit(Spy::numLessthan() == 4);    // compare [50][30][40] then check [40]
+      assertUnit(Spy::numEquals() == 0);
       assertUnit(Spy::numCopy() == 0);
       assertUnit(Spy::numAlloc() == 0);
       assertUnit(Spy::numDestructor() == 0);
@@ -2022,6 +2201,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.findEnds();
       Spy s(60);
       Spy::reset();
       // exercise
@@ -2081,6 +2261,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.findEnds();
       Spy s(40);
       Spy::reset();
       // exercise
@@ -2144,6 +2325,7 @@ public:
       custom::BST<Spy>::BNode* p50 = new custom::BST<Spy>::BNode(Spy(50));
       bst.root = p50;
       bst.numElements = 1;
+      bst.findEnds();
       Spy s(50);
       Spy::reset();
       // exercise
@@ -2213,8 +2395,8 @@ public:
       // exercise
       auto pairBST = bst.insert(std::move(s), true /* keepUnique */);
       // verify
-      assertUnit(Spy::numLessthan() == 2);    // compare [50][30]
-      assertUnit(Spy::numEquals() == 3);      // compare [50][30][40]
+      assertUnit(Spy::numLessthan() == 4);    // compare [50][30][40] then check [40]
+      assertUnit(Spy::numEquals() == 0);
       assertUnit(Spy::numCopy() == 0);
       assertUnit(Spy::numAlloc() == 0);
       assertUnit(Spy::numDestructor() == 0);
@@ -2239,6 +2421,49 @@ public:
       teardownStandardFixture(bst);
    }
 
+   // inserting a new element or bumping into a duplicate costs one comparison per level plus one
+   void test_insert_comparisonsPerLevel()
+   {  // setup
+      custom::BST <Spy> bst;
+      for (int i = 0; i < 1000; i += 2)
+         bst.insert(Spy(i));
+      bool withinBound = true;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+      {
+         Spy s(i);
+         int levels = height(bst.root);
+         Spy::reset();
+         auto pairBST = bst.insert(std::move(s), true /* keepUnique */);
+         withinBound = withinBound && (Spy::numLessthan() + Spy::numEquals() <= levels + 1);
+         // verify
+         assertUnit(pairBST.second == (i % 2 == 1));
+      }
+      // verify
+      assertUnit(withinBound);
+      assertUnit(bst.numElements == 1000);
+      assertUnit(bst.validate());
+   }  // teardown
+
+   // a plain BST takes the duplicate, built right in its node
+   void test_emplace_duplicate()
+   {  // setup
+      custom::BST <Spy> bst;
+      bst.emplace(50);
+      bst.emplace(30);
+      Spy::reset();
+      // exercise
+      auto it = bst.emplace(50);
+      // verify
+      assertUnit(bst.numElements == 3);
+      assertUnit((*it).get() == 50);
+      assertUnit(it.pNode != bst.root);
+      assertUnit(Spy::numNondefault() == 1);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(bst.validate());
+   }  // teardown
+
 
    /***************************************
     * Erase
@@ -2366,6 +2591,7 @@ public:
       p30->pLeft = p20;
       p30->pRight = p40;
       bst.numElements = 6;
+      bst.findEnds();
       auto it = custom::BST <int> :: iterator(p10);
       // exercise
       auto itReturn = bst.erase(it);
@@ -2430,6 +2656,7 @@ public:
       p50->pRight = p60;
       p30->pRight = p40;
       bst.numElements = 8;
+      bst.findEnds();
       auto it = custom::BST <int> ::iterator(p20);
       // exercise
       auto itReturn = bst.erase(it);
@@ -2475,13 +2702,268 @@ public:
       bst.root = nullptr;
    }
 
+   /***************************************
+    * BALANCE
+    *    BST::balanceInsert()
+    *    BST::balanceErase()
+    *    BST::validate()
+    ***************************************/
+
+   // insert in order so the tree leans right and has to rotate left
+   void test_balance_rotateLeft()
+   {  // setup
+      //   (10b)
+      //      +----+
+      //         (20r)
+      custom::BST <Spy> bst;
+      bst.insert(Spy(10));
+      bst.insert(Spy(20));
+      Spy s(30);
+      Spy::reset();
+      // exercise
+      bst.insert(std::move(s));
+      // verify
+      //         (20b)
+      //     +----+----+
+      //   (10r)     (30r)
+      assertUnit(Spy::numCopyMove() == 1);   // move [30], rotations never touch the data
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numAssignMove() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numDelete() == 0);
+      assertUnit(bst.numElements == 3);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == Spy(20));
+         assertUnit(bst.root->isRed == false);
+         assertUnit(bst.root->pParent == nullptr);
+         assertUnit(bst.root->pLeft != nullptr);
+         assertUnit(bst.root->pRight != nullptr);
+         if (bst.root->pLeft)
+         {
+            assertUnit(bst.root->pLeft->data == Spy(10));
+            assertUnit(bst.root->pLeft->isRed == true);
+            assertUnit(bst.root->pLeft->pParent == bst.root);
+         }
+         if (bst.root->pRight)
+         {
+            assertUnit(bst.root->pRight->data == Spy(30));
+            assertUnit(bst.root->pRight->isRed == true);
+            assertUnit(bst.root->pRight->pParent == bst.root);
+         }
+      }
+      assertUnit(bst.validate());
+   }  // teardown
+
+   // insert in the middle so the tree needs a double rotation
+   void test_balance_rotateRightLeft()
+   {  // setup
+      //   (10b)
+      //      +----+
+      //         (30r)
+      custom::BST <Spy> bst;
+      bst.insert(Spy(10));
+      bst.insert(Spy(30));
+      // exercise
+      bst.insert(Spy(20));
+      // verify
+      //         (20b)
+      //     +----+----+
+      //   (10r)     (30r)
+      assertUnit(bst.numElements == 3);
+      assertUnit(bst.root != nullptr);
+      if (bst.root)
+      {
+         assertUnit(bst.root->data == Spy(20));
+         assertUnit(bst.root->isRed == false);
+         assertUnit(bst.root->pLeft && bst.root->pLeft->data == Spy(10));
+         assertUnit(bst.root->pRight && bst.root->pRight->data == Spy(30));
+      }
+      assertUnit(bst.validate());
+   }  // teardown
+
+   // a red aunt means we just recolor, no rotation
+   void test_balance_recolor()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      // exercise
+      bst.insert(Spy(10));
+      // verify
+      //                (50b)
+      //          +-------+-------+
+      //        (30r)           (70b)
+      //     +----+----+     +----+----+
+      //   (20b)     (40b) (60r)     (80r)
+      //  +--+
+      // (10r)
+      assertUnit(bst.numElements == 8);
+      assertUnit(bst.root->data == Spy(50));
+      assertUnit(bst.root->pLeft->isRed == true);
+      assertUnit(bst.root->pLeft->pLeft->isRed == false);
+      assertUnit(bst.root->pLeft->pRight->isRed == false);
+      assertUnit(bst.root->pLeft->pLeft->pLeft != nullptr);
+      if (bst.root->pLeft->pLeft->pLeft)
+      {
+         assertUnit(bst.root->pLeft->pLeft->pLeft->data == Spy(10));
+         assertUnit(bst.root->pLeft->pLeft->pLeft->isRed == true);
+      }
+      assertUnit(bst.validate());
+      // teardown
+      bst.clear();
+   }
+
+   // sorted input used to make a linked list, now the height stays logarithmic
+   void test_balance_insertSorted()
+   {  // setup
+      custom::BST <int> bst;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         bst.insert(i);
+      // verify
+      assertUnit(bst.numElements == 1000);
+      assertUnit(bst.validate());
+      assertUnit(height(bst.root) <= 20);   // 2 log(n + 1)
+      int expected = 0;
+      for (auto it = bst.begin(); it != bst.end(); ++it)
+         assertUnit(*it == expected++);
+      assertUnit(expected == 1000);
+   }  // teardown
+
+   // same thing from the other direction
+   void test_balance_insertReverse()
+   {  // setup
+      custom::BST <int> bst;
+      // exercise
+      for (int i = 1000; i > 0; i--)
+         bst.insert(i);
+      // verify
+      assertUnit(bst.numElements == 1000);
+      assertUnit(bst.validate());
+      assertUnit(height(bst.root) <= 20);   // 2 log(n + 1)
+   }  // teardown
+
+   // erase half of a big tree and make sure it stays balanced every step of the way
+   void test_balance_eraseMany()
+   {  // setup
+      custom::BST <int> bst;
+      for (int i = 0; i < 1000; i++)
+         bst.insert((i * 37) % 1000);
+      bool valid = true;
+      // exercise
+      for (auto it = bst.begin(); it != bst.end(); )
+      {
+         if (*it % 2 == 0)
+            it = bst.erase(it);
+         else
+            ++it;
+         valid = valid && bst.validate();
+      }
+      // verify
+      assertUnit(valid);
+      assertUnit(bst.numElements == 500);
+      assertUnit(height(bst.root) <= 18);   // 2 log(n + 1)
+      int expected = 1;
+      for (auto it = bst.begin(); it != bst.end(); ++it, expected += 2)
+         assertUnit(*it == expected);
+      // exercise
+      while (!bst.empty())
+      {
+         auto it = bst.begin();
+         bst.erase(it);
+         valid = valid && bst.validate();
+      }
+      // verify
+      assertUnit(valid);
+      assertUnit(bst.root == nullptr);
+      assertUnit(bst.numElements == 0);
+   }  // teardown
+
+   // inserts and erases all mixed up, so a rotation can land under a red node
+   void test_balance_insertEraseMixed()
+   {  // setup
+      custom::BST <int> bst;
+      std::mt19937 random(321);
+      bool valid = true;
+      // exercise
+      for (int i = 0; i < 2000; i++)
+      {
+         int key = (int)(random() % 500);
+         if (random() % 3 == 0)
+         {
+            auto it = bst.find(key);
+            if (it != bst.end())
+               bst.erase(it);
+         }
+         else
+            bst.insert(key, true);
+         valid = valid && bst.validate();
+      }
+      // verify
+      assertUnit(valid);
+      assertUnit(height(bst.root) <= 18);   // 2 log(n + 1)
+   }  // teardown
+
+   // the standard fixture is a valid red-black tree
+   void test_validate_standard()
+   {  // setup
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      // exercise
+      bool valid = bst.validate();
+      // verify
+      assertUnit(valid);
+      assertStandardFixture(bst);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   // two reds in a row is not allowed
+   void test_validate_redRed()
+   {  // setup
+      //                (50b)
+      //          +-------+-------+
+      //        (30r)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      custom::BST <Spy> bst;
+      setupStandardFixture(bst);
+      bst.root->pLeft->isRed = true;
+      bst.findEnds();
+      // exercise
+      bool valid = bst.validate();
+      // verify
+      assertUnit(valid == false);
+      // teardown
+      teardownStandardFixture(bst);
+   }
+
+   /**************************************************************
+    * HEIGHT
+    * The number of levels in a tree
+    *************************************************************/
+   template <class Node>
+   int height(const Node* pNode)
+   {
+      if (!pNode)
+         return 0;
+      return 1 + std::max(height(pNode->pLeft), height(pNode->pRight));
+   }
+
    /**************************************************************
     * SETUP STANDARD FIXTURE
-    *                (50) 
+    *                (50b)
     *          +-------+-------+
-    *        (30)            (70) 
+    *        (30b)           (70b)
     *     +----+----+     +----+----+
-    *   (20)      (40)  (60)      (80) 
+    *   (20r)     (40r) (60r)     (80r)
     *************************************************************/
    void setupStandardFixture(custom::BST <Spy>& bst)
    {
@@ -2511,9 +2993,17 @@ public:
       p30->pParent = p70->pParent = p50;
       p60->pParent = p80->pParent = p70;
 
+      // color everything
+      p50->isRed = p30->isRed = p70->isRed = false;
+
+      // count everything, the leaves are already 1
+      p30->size = p70->size = 3;
+      p50->size = 7;
+
       // now assign everything to the bst
       bst.root = p50;
       bst.numElements = 7;
+      bst.findEnds();
    }
 
    /**************************************************************
@@ -0,0 +1,445 @@
+/***********************************************************************
+ * Header:
+ *    TEST BTREE
+ * Summary:
+ *    Unit tests for the B-tree backed set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "btree.h"      // class under test
+#include "spy.h"        // for the elements in the set
+#include "unitTest.h"   // unit test baseclass
+
+#include <cstdint>      // for int64_t
+#include <vector>
+#include <algorithm>    // for std::shuffle and std::set_union
+#include <iterator>     // for std::back_inserter
+#include <random>       // for std::mt19937
+#include <functional>   // for std::less
+
+/***********************************************
+ * TEST BTREE
+ * Unit tests for set<T, C, btree_tag>
+ ***********************************************/
+class TestBTree : public UnitTest
+{
+   template <class T>
+   using bset = custom::set<T, std::less<T>, custom::btree_tag>;
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructInit_standard();
+      test_constructSorted_noComparisons();
+      test_constructCopy_standard();
+      test_constructMove_standard();
+      test_nodeSize_cacheLines();
+
+      // Access
+      test_find_standard();
+      test_bounds_everyKey();
+      test_lowerBound_finger();
+      test_iterator_backwards();
+
+      // Insert
+      test_insert_random();
+      test_insert_duplicate();
+      test_insertHint_append();
+
+      // Remove
+      test_erase_nextIterator();
+      test_erase_everything();
+      test_eraseRange_standard();
+      test_erase_noLeaks();
+
+      // Set algebra
+      test_algebra_freeFunctions();
+      test_algebra_smallAndBig();
+
+      report("BTree");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // a new set has no tree at all
+   void test_construct_default()
+   {  // setup
+      // exercise
+      bset<int> s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(s.btree.root == nullptr);
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // a few elements fit in the root, which is a leaf
+   void test_constructInit_standard()
+   {  // setup
+      // exercise
+      bset<int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      // verify
+      assertUnit(s.size() == 7);
+      assertUnit(s.btree.validate());
+      assertUnit(s.btree.root->isLeaf);
+      assertUnit(*s.begin() == 20);
+      assertUnit(*s.rbegin() == 80);
+   }  // teardown
+
+   // sorted input goes in along the right edge without a comparison
+   void test_constructSorted_noComparisons()
+   {  // setup
+      std::vector<Spy> v;
+      for (int i = 0; i < 500; i++)
+         v.push_back(Spy(i));
+      Spy::reset();
+      // exercise
+      bset<Spy> s(custom::sorted_unique, v.begin(), v.end());
+      // verify
+      assertUnit(s.size() == 500);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(s.btree.validate());
+   }  // teardown
+
+   // a copy has the same shape and its own elements
+   void test_constructCopy_standard()
+   {  // setup
+      bset<int> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(i);
+      // exercise
+      bset<int> sCopy(s);
+      sCopy.erase(500);
+      // verify
+      assertUnit(sCopy.size() == 999);
+      assertUnit(s.size() == 1000);
+      assertUnit(s.count(500) == 1);
+      assertUnit(sCopy.btree.validate());
+      assertUnit(s.btree.validate());
+      assertUnit(s.btree.root != sCopy.btree.root);
+   }  // teardown
+
+   // a move takes the whole tree and leaves nothing behind
+   void test_constructMove_standard()
+   {  // setup
+      bset<int> s{ 10, 20, 30 };
+      auto pRoot = s.btree.root;
+      // exercise
+      bset<int> sMove(std::move(s));
+      // verify
+      assertUnit(sMove.btree.root == pRoot);
+      assertUnit(sMove.size() == 3);
+      assertUnit(s.btree.root == nullptr);
+      assertUnit(s.empty());
+   }  // teardown
+
+   // an int64_t leaf is a few cache lines holding a few dozen elements
+   void test_nodeSize_cacheLines()
+   {  // setup
+      using Tree = custom::BTree<int64_t>;
+      // exercise
+      size_t bytes = sizeof(Tree::Node);
+      // verify
+      assertUnit(bytes <= Tree::NODE_BYTES);
+      assertUnit(Tree::MAX_KEYS >= 24);
+      assertUnit(custom::BTree<char>::MIN_KEYS >= 1);
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // find hits elements in leaves and in inner nodes
+   void test_find_standard()
+   {  // setup
+      bset<int> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(i * 2);
+      bool allRight = true;
+      // exercise
+      for (int i = -1; i <= 2000; i++)
+      {
+         auto it = s.find(i);
+         // verify
+         if (i % 2 == 0 && i >= 0 && i < 2000)
+            allRight = allRight && it != s.end() && *it == i;
+         else
+            allRight = allRight && it == s.end();
+      }
+      assertUnit(allRight);
+      assertUnit(!s.btree.root->isLeaf);
+   }  // teardown
+
+   // lower_bound and upper_bound land where std::lower_bound and std::upper_bound do
+   void test_bounds_everyKey()
+   {  // setup
+      bool allRight = true;
+      for (int n = 0; n < 300; n += 37)
+      {
+         bset<int> s;
+         for (int i = 0; i < n; i++)
+            s.insert(i * 2);
+         std::vector<int> v(s.begin(), s.end());
+         // exercise
+         for (int key = -1; key <= n * 2; key++)
+         {
+            auto itLower = s.lower_bound(key);
+            auto itUpper = s.upper_bound(key);
+            // verify
+            auto iLower = std::lower_bound(v.begin(), v.end(), key) - v.begin();
+            auto iUpper = std::upper_bound(v.begin(), v.end(), key) - v.begin();
+            allRight = allRight && std::distance(s.begin(), itLower) == iLower;
+            allRight = allRight && std::distance(s.begin(), itUpper) == iUpper;
+         }
+      }
+      assertUnit(allRight);
+   }  // teardown
+
+   // starting from the last answer finds the same thing as starting from the root
+   void test_lowerBound_finger()
+   {  // setup
+      bset<int> s;
+      for (int i = 0; i < 5000; i++)
+         s.insert(i * 3);
+      bool allRight = true;
+      auto itFinger = s.begin();
+      // exercise
+      for (int key = -1; key <= 15001; key += 7)
+      {
+         itFinger = s.lower_bound(itFinger, key);
+         // verify
+         allRight = allRight && itFinger == s.lower_bound(key);
+      }
+      assertUnit(allRight);
+      assertUnit(itFinger == s.end());
+   }  // teardown
+
+   // backing up from the end walks everything in reverse, through leaves and inner nodes
+   void test_iterator_backwards()
+   {  // setup
+      bset<int> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(i);
+      int expected = 999;
+      bool allRight = true;
+      // exercise
+      for (auto it = s.end(); it != s.begin(); )
+      {
+         --it;
+         // verify
+         allRight = allRight && *it == expected--;
+      }
+      assertUnit(allRight);
+      assertUnit(expected == -1);
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // every split keeps the tree legal
+   void test_insert_random()
+   {  // setup
+      std::vector<int> values;
+      for (int i = 0; i < 5000; i++)
+         values.push_back(i);
+      std::mt19937 random(232);
+      std::shuffle(values.begin(), values.end(), random);
+      bset<int> s;
+      // exercise
+      for (auto value : values)
+         s.insert(value);
+      // verify
+      assertUnit(s.size() == 5000);
+      assertUnit(s.btree.validate());
+      int expected = 0;
+      bool allRight = true;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         allRight = allRight && *it == expected++;
+      assertUnit(allRight);
+      assertUnit(expected == 5000);
+   }  // teardown
+
+   // a duplicate finds the one that is there and changes nothing
+   void test_insert_duplicate()
+   {  // setup
+      bset<int> s;
+      for (int i = 0; i < 100; i++)
+         s.insert(i);
+      // exercise
+      auto result = s.insert(42);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(*result.first == 42);
+      assertUnit(s.size() == 100);
+   }  // teardown
+
+   // appending with end() as the hint is one comparison each
+   void test_insertHint_append()
+   {  // setup
+      bset<Spy> s;
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 500; i++)
+         s.insert(s.end(), Spy(i));
+      // verify
+      assertUnit(s.size() == 500);
+      assertUnit(Spy::numLessthan() == 499);
+      assertUnit(s.btree.validate());
+   }  // teardown
+
+   /***************************************
+    * REMOVE
+    ***************************************/
+
+   // erase hands back the next one, even when the tree has to shuffle things around
+   void test_erase_nextIterator()
+   {  // setup
+      bset<int> s;
+      for (int i = 0; i < 2000; i++)
+         s.insert(i);
+      bool allRight = true;
+      // exercise
+      for (auto it = s.begin(); it != s.end(); )
+      {
+         int value = *it;
+         if (value % 3 == 0)
+         {
+            s.erase(it);
+            // verify
+            allRight = allRight && (it == s.end() || *it == value + 1);
+         }
+         else
+            ++it;
+      }
+      assertUnit(allRight);
+      assertUnit(s.size() == 2000 - 667);
+      assertUnit(s.count(999) == 0);
+      assertUnit(s.count(1000) == 1);
+      assertUnit(s.btree.validate());
+   }  // teardown
+
+   // borrowing and merging all the way down to nothing
+   void test_erase_everything()
+   {  // setup
+      std::vector<int> values;
+      for (int i = 0; i < 3000; i++)
+         values.push_back(i);
+      bset<int> s(values.begin(), values.end());
+      std::mt19937 random(232);
+      std::shuffle(values.begin(), values.end(), random);
+      bool allValid = true;
+      // exercise
+      for (size_t i = 0; i < values.size(); i++)
+      {
+         s.erase(values[i]);
+         if (i % 100 == 0)
+            allValid = allValid && s.btree.validate();
+      }
+      // verify
+      assertUnit(allValid);
+      assertUnit(s.empty());
+      assertUnit(s.btree.root == nullptr);
+   }  // teardown
+
+   // a run in the middle goes away and we get the one after it
+   void test_eraseRange_standard()
+   {  // setup
+      bset<int> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(i);
+      auto itBegin = s.lower_bound(100);
+      auto itEnd = s.lower_bound(900);
+      // exercise
+      auto it = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(*it == 900);
+      assertUnit(s.size() == 200);
+      assertUnit(s.count(500) == 0);
+      assertUnit(s.btree.validate());
+   }  // teardown
+
+   // every element that went in is destroyed when it comes out
+   void test_erase_noLeaks()
+   {  // setup
+      Spy::reset();
+      {
+         bset<Spy> s;
+         for (int i = 0; i < 1000; i++)
+            s.insert(Spy(i));
+         // exercise
+         for (int i = 0; i < 1000; i += 2)
+            s.erase(Spy(i));
+      }
+      // verify
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   /***************************************
+    * SET ALGEBRA
+    ***************************************/
+
+   // the free functions give back B-tree sets, with what std::set_union and friends say
+   void test_algebra_freeFunctions()
+   {  // setup
+      bset<int> lhs;
+      bset<int> rhs;
+      for (int i = 0; i < 600; i += 2)
+         lhs.insert(i);
+      for (int i = 0; i < 600; i += 3)
+         rhs.insert(i);
+      std::vector<int> vLhs(lhs.begin(), lhs.end());
+      std::vector<int> vRhs(rhs.begin(), rhs.end());
+      std::vector<int> vUnion, vIntersection, vDifference, vSymmetric;
+      std::set_union(vLhs.begin(), vLhs.end(), vRhs.begin(), vRhs.end(), std::back_inserter(vUnion));
+      std::set_intersection(vLhs.begin(), vLhs.end(), vRhs.begin(), vRhs.end(), std::back_inserter(vIntersection));
+      std::set_difference(vLhs.begin(), vLhs.end(), vRhs.begin(), vRhs.end(), std::back_inserter(vDifference));
+      std::set_symmetric_difference(vLhs.begin(), vLhs.end(), vRhs.begin(), vRhs.end(), std::back_inserter(vSymmetric));
+      // exercise
+      bset<int> sUnion = custom::set_union(lhs, rhs);
+      bset<int> sIntersection = custom::set_intersection(lhs, rhs);
+      bset<int> sDifference = custom::set_difference(lhs, rhs);
+      bset<int> sSymmetric = custom::set_symmetric_difference(lhs, rhs);
+      // verify
+      assertUnit(std::vector<int>(sUnion.begin(), sUnion.end()) == vUnion);
+      assertUnit(std::vector<int>(sIntersection.begin(), sIntersection.end()) == vIntersection);
+      assertUnit(std::vector<int>(sDifference.begin(), sDifference.end()) == vDifference);
+      assertUnit(std::vector<int>(sSymmetric.begin(), sSymmetric.end()) == vSymmetric);
+      assertUnit(sUnion.btree.validate());
+      assertUnit(sIntersection.btree.validate());
+      assertUnit(sDifference.btree.validate());
+      assertUnit(sSymmetric.btree.validate());
+      assertUnit(lhs.size() == 300);
+      assertUnit(rhs.size() == 200);
+   }  // teardown
+
+   // one side much smaller, so the big one is finger searched instead of walked
+   void test_algebra_smallAndBig()
+   {  // setup
+      bset<int> small{ -5, 10, 11, 500, 2001, 3000 };
+      bset<int> big;
+      for (int i = 0; i < 3000; i += 2)
+         big.insert(i);
+      // exercise
+      bset<int> sIntersection = custom::set_intersection(small, big);
+      bset<int> sIntersectionSwapped = custom::set_intersection(big, small);
+      bset<int> sDifference = custom::set_difference(small, big);
+      // verify
+      assertUnit(std::vector<int>(sIntersection.begin(), sIntersection.end()) == std::vector<int>({ 10, 500 }));
+      assertUnit(std::vector<int>(sIntersectionSwapped.begin(), sIntersectionSwapped.end()) == std::vector<int>({ 10, 500 }));
+      assertUnit(std::vector<int>(sDifference.begin(), sDifference.end()) == std::vector<int>({ -5, 11, 2001, 3000 }));
+      assertUnit(sDifference.btree.validate());
+   }  // teardown
+};
+
+#endif // DEBUG
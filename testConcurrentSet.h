@@ -0,0 +1,396 @@
+/***********************************************************************
+ * Header:
+ *    TEST CONCURRENT SET
+ * Summary:
+ *    Unit tests for concurrent_set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "concurrent_set.h" // class under test
+#include "set.h"            // what snapshot hands back
+#include "spy.h"            // for the elements in the set
+#include "unitTest.h"       // unit test baseclass
+
+#include <cstdint>          // for uintptr_t
+#include <string>
+#include <string_view>
+#include <vector>
+#include <set>              // what the set should hold, to check against
+#include <thread>
+#include <atomic>
+#include <chrono>           // for std::chrono::milliseconds
+#include <random>           // for std::mt19937
+#include <algorithm>        // for std::is_sorted
+
+/***********************************************
+ * TEST CONCURRENT SET
+ * Unit tests for the concurrent set
+ ***********************************************/
+class TestConcurrentSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructSet_standard();
+      test_version_cacheLine();
+
+      // One thread at a time
+      test_insert_standard();
+      test_erase_standard();
+      test_find_copy();
+      test_contains_transparent();
+      test_snapshot_independent();
+      test_erase_balanced();
+
+      // Reading while writing
+      test_read_retriesAfterChange();
+      test_read_fallsBackToLock();
+      test_contains_whileWriterHoldsLock();
+      test_erase_waitsForReaders();
+
+      // Many at once
+      test_insert_manyWriters();
+      test_contains_readersWithWriters();
+
+      report("ConcurrentSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // nothing in it, and nobody in the middle of a change
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::concurrent_set <int> s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.version == 0);
+      assertUnit(!s.contains(0));
+   }  // teardown
+
+   // take a set that is already built
+   void test_constructSet_standard()
+   {  // setup
+      custom::set <int> sBuilt{ 50, 30, 70 };
+      // exercise
+      custom::concurrent_set <int> s(std::move(sBuilt));
+      // verify
+      assertUnit(s.size() == 3);
+      assertUnit(s.contains(30));
+      assertUnit(sBuilt.empty());
+   }  // teardown
+
+   // writers taking turns do not drag the version readers look at along with the lock
+   void test_version_cacheLine()
+   {  // setup
+      custom::concurrent_set <int> s;
+      // exercise
+      uintptr_t version = reinterpret_cast<uintptr_t>(&s.version);
+      uintptr_t lock = reinterpret_cast<uintptr_t>(&s.writerLock);
+      // verify
+      assertUnit(version % 64 == 0);
+      assertUnit(lock % 64 == 0);
+      assertUnit(version / 64 != lock / 64);
+   }  // teardown
+
+   /***************************************
+    * ONE THREAD
+    ***************************************/
+
+   // the answer says whether it was new
+   void test_insert_standard()
+   {  // setup
+      custom::concurrent_set <int> s;
+      // exercise
+      bool first = s.insert(42);
+      bool second = s.insert(42);
+      bool third = s.emplace(7);
+      // verify
+      assertUnit(first);
+      assertUnit(!second);
+      assertUnit(third);
+      assertUnit(s.size() == 2);
+      assertUnit(s.contains(42));
+      assertUnit(s.count(7) == 1);
+   }  // teardown
+
+   // gone once, and not there to go a second time
+   void test_erase_standard()
+   {  // setup
+      custom::concurrent_set <int> s{ 10, 20, 30 };
+      // exercise
+      size_t first = s.erase(20);
+      size_t second = s.erase(20);
+      // verify
+      assertUnit(first == 1);
+      assertUnit(second == 0);
+      assertUnit(s.size() == 2);
+      assertUnit(!s.contains(20));
+   }  // teardown
+
+   // we get our own copy or nothing
+   void test_find_copy()
+   {  // setup
+      custom::concurrent_set <std::string> s{ "alpha", "bravo", "charlie" };
+      // exercise
+      auto found = s.find("bravo");
+      auto missing = s.find("delta");
+      // verify
+      assertUnit(found.has_value());
+      assertUnit(*found == "bravo");
+      assertUnit(!missing.has_value());
+   }  // teardown
+
+   // with std::less<> we can look for a string_view without making a string
+   void test_contains_transparent()
+   {  // setup
+      custom::concurrent_set <std::string, std::less<>> s(std::less<>{});
+      s.insert(std::string("alpha"));
+      s.insert(std::string("bravo"));
+      // exercise
+      // verify
+      assertUnit(s.contains(std::string_view("alpha")));
+      assertUnit(!s.contains(std::string_view("charlie")));
+   }  // teardown
+
+   // writes after the snapshot do not show up in it
+   void test_snapshot_independent()
+   {  // setup
+      custom::concurrent_set <int> s{ 1, 2, 3 };
+      // exercise
+      custom::set <int> sSnapshot = s.snapshot();
+      s.insert(4);
+      s.erase(1);
+      // verify
+      assertUnit(sSnapshot.size() == 3);
+      assertUnit(sSnapshot.count(1) == 1);
+      assertUnit(sSnapshot.count(4) == 0);
+      assertUnit(s.size() == 3);
+   }  // teardown
+
+   // still a red-black tree after a long run of inserts and erases
+   void test_erase_balanced()
+   {  // setup
+      std::mt19937 random(321);
+      custom::concurrent_set <int> s;
+      std::set <int> expected;
+      // exercise
+      for (int i = 0; i < 4000; i++)
+      {
+         int key = (int)(random() % 500);
+         if (random() % 3 == 0)
+            assertUnit(s.erase(key) == expected.erase(key));
+         else
+            assertUnit(s.insert(key) == expected.insert(key).second);
+      }
+      // verify
+      custom::set <int> sSnapshot = s.snapshot();
+      assertUnit(s.size() == expected.size());
+      assertUnit(sSnapshot.size() == expected.size());
+      assertUnit(std::equal(sSnapshot.begin(), sSnapshot.end(), expected.begin()));
+      assertUnit(isRedBlack(s));
+      assertUnit(s.version % 2 == 0);
+   }  // teardown
+
+   /***************************************
+    * READING WHILE WRITING
+    ***************************************/
+
+   // a writer finished while we were looking, so we look again
+   void test_read_retriesAfterChange()
+   {  // setup
+      custom::concurrent_set <int> s{ 1, 2, 3 };
+      int numLooks = 0;
+      // exercise
+      int result = s.read([&]()
+      {
+         if (++numLooks == 1)
+            s.version.fetch_add(2);   // as if an insert came and went
+         return numLooks;
+      });
+      // verify
+      assertUnit(numLooks == 2);
+      assertUnit(result == 2);
+   }  // teardown
+
+   // spoiled every time, so the last look is made with the writers locked out
+   void test_read_fallsBackToLock()
+   {  // setup
+      custom::concurrent_set <int> s{ 1, 2, 3 };
+      std::vector<bool> lockedOut;
+      // exercise
+      s.read([&]()
+      {
+         std::thread other([&]()
+         {
+            bool otherTook = s.writerLock.try_lock();
+            if (otherTook)
+               s.writerLock.unlock();
+            lockedOut.push_back(!otherTook);
+         });
+         other.join();
+         s.version.fetch_add(2);
+         return 0;
+      });
+      // verify
+      assertUnit(lockedOut.size() == (size_t)custom::concurrent_set <int> ::MAX_TRIES + 1);
+      assertUnit(lockedOut.back());
+      assertUnit(std::count(lockedOut.begin(), lockedOut.end(), true) == 1);
+   }  // teardown
+
+   // a writer holding the lock does not keep a reader out
+   void test_contains_whileWriterHoldsLock()
+   {  // setup
+      custom::concurrent_set <int> s{ 10, 20, 30 };
+      std::atomic<bool> done(false);
+      bool found = false;
+      bool missing = false;
+      s.writerLock.lock();
+      // exercise
+      std::thread reader([&]()
+      {
+         found = s.contains(20) && s.find(30).has_value();
+         missing = !s.contains(25);
+         done = true;
+      });
+      for (int wait = 0; wait < 5000 && !done; wait++)
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      bool doneWhileLocked = done;
+      s.writerLock.unlock();
+      reader.join();
+      // verify
+      assertUnit(doneWhileLocked);
+      assertUnit(found);
+      assertUnit(missing);
+   }  // teardown
+
+   // a reader may be standing on what we erase, so it is not freed until nobody can be
+   void test_erase_waitsForReaders()
+   {  // setup
+      Spy::reset();
+      {
+         custom::concurrent_set <Spy> s{ Spy(10), Spy(20), Spy(30) };
+         Spy key(20);
+         {
+            auto guard = s.domain.pin();   // a reader in the middle of a look
+            int numDeleteBefore = Spy::numDelete();
+            // exercise
+            size_t numErased = s.erase(key);
+            // verify
+            assertUnit(numErased == 1);
+            assertUnit(Spy::numDelete() == numDeleteBefore);
+            assertUnit(s.domain.numWaiting() == 1);
+         }
+         assertUnit(!s.contains(key));
+         assertUnit(s.size() == 2);
+      }
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   /***************************************
+    * MANY THREADS
+    ***************************************/
+
+   // writers on every thread, and nothing gets lost
+   void test_insert_manyWriters()
+   {  // setup
+      custom::concurrent_set <int> s;
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 8; t++)
+         threads.emplace_back([&s, t]()
+         {
+            for (int i = 0; i < 500; i++)
+               s.insert(t * 1000 + i);
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      custom::set <int> sSnapshot = s.snapshot();
+      assertUnit(sSnapshot.size() == 8 * 500);
+      assertUnit(std::is_sorted(sSnapshot.begin(), sSnapshot.end()));
+      assertUnit(s.contains(7499));
+      assertUnit(!s.contains(7500));
+   }  // teardown
+
+   // readers never miss what nobody is touching while writers churn the rest
+   void test_contains_readersWithWriters()
+   {  // setup
+      custom::concurrent_set <int> s;
+      for (int i = 0; i < 1000; i += 2)
+         s.insert(i);
+      std::atomic<bool> allFound(true);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 2; t++)
+         threads.emplace_back([&s, t]()
+         {
+            for (int round = 0; round < 20; round++)
+               for (int i = 1 + t * 2; i < 1000; i += 4)
+                  if (round % 2 == 0)
+                     s.insert(i);
+                  else
+                     s.erase(i);
+         });
+      for (int t = 0; t < 4; t++)
+         threads.emplace_back([&s, &allFound]()
+         {
+            for (int round = 0; round < 10; round++)
+               for (int i = 0; i < 1000; i += 2)
+                  if (!s.contains(i))
+                     allFound = false;
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      assertUnit(allFound);
+      assertUnit(s.size() == 500);
+      custom::set <int> sSnapshot = s.snapshot();
+      assertUnit(std::is_sorted(sSnapshot.begin(), sSnapshot.end()));
+      assertUnit(isRedBlack(s));
+   }  // teardown
+
+private:
+
+   // black root, no red node under a red one, the same number of black nodes
+   // down every path, and every child points back up at its parent
+   template <class T>
+   bool isRedBlack(const custom::concurrent_set <T> & s)
+   {
+      auto pRoot = s.root.load();
+      return !pRoot || (!pRoot->isRed && !pRoot->pParent && blackHeight(pRoot) != -1);
+   }
+   template <class Node>
+   int blackHeight(const Node* pNode)
+   {
+      if (!pNode)
+         return 1;
+      const Node* pLeft = pNode->pLeft.load();
+      const Node* pRight = pNode->pRight.load();
+      if ((pLeft && (pLeft->pParent != pNode || !(pLeft->data < pNode->data))) ||
+          (pRight && (pRight->pParent != pNode || !(pNode->data < pRight->data))))
+         return -1;
+      if (pNode->isRed && ((pLeft && pLeft->isRed) || (pRight && pRight->isRed)))
+         return -1;
+      int heightLeft = blackHeight(pLeft);
+      int heightRight = blackHeight(pRight);
+      if (heightLeft == -1 || heightLeft != heightRight)
+         return -1;
+      return heightLeft + (pNode->isRed ? 0 : 1);
+   }
+};
+
+#endif // DEBUG
@@ -0,0 +1,385 @@
+/***********************************************************************
+ * Header:
+ *    TEST COW SET
+ * Summary:
+ *    Unit tests for set<T, C, cow_alloc<A>>
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "cow_set.h"    // class under test
+#include "spy.h"        // for the elements in the set
+#include "unitTest.h"   // unit test baseclass
+
+#include <vector>
+#include <string>
+#include <thread>
+#include <algorithm>    // for std::is_sorted and std::set_union
+#include <iterator>     // for std::back_inserter
+
+/***********************************************
+ * TEST COW SET
+ * Unit tests for the copy-on-write set
+ ***********************************************/
+class TestCowSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Share
+      test_construct_default();
+      test_constructCopy_shares();
+      test_assign_shares();
+
+      // Clone
+      test_insert_clones();
+      test_insert_alreadyThere();
+      test_erase_notThere();
+      test_eraseIterator_movesOver();
+      test_insertHint_movesOver();
+      test_clear_noClone();
+      test_constructMove_startsOver();
+
+      // Iterators
+      test_iterator_staysWithOldTree();
+      test_unshare_iteratorsStayGood();
+
+      // Set algebra
+      test_algebra_freeFunctions();
+
+      // Free
+      test_release_lastOwner();
+
+      // Many threads
+      test_clone_manyThreads();
+
+      report("CowSet");
+   }
+
+   /***************************************
+    * SHARE
+    ***************************************/
+
+   // a tree of its own, empty
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::set <int, std::less<int>, custom::cow_tag> s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.pShared != nullptr);
+      assertUnit(!s.is_shared());
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // the copy has the same tree and not one element was copied
+   void test_constructCopy_shares()
+   {  // setup
+      custom::set <Spy, std::less<Spy>, custom::cow_tag> s{ Spy(10), Spy(20), Spy(30) };
+      Spy::reset();
+      custom::cow_stats::reset();
+      // exercise
+      custom::set <Spy, std::less<Spy>, custom::cow_tag> sCopy(s);
+      // verify
+      assertUnit(sCopy.pShared == s.pShared);
+      assertUnit(s.is_shared());
+      assertUnit(sCopy.size() == 3);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(custom::cow_stats::numShares() == 1);
+      assertUnit(custom::cow_stats::numClones() == 0);
+   }  // teardown
+
+   // letting go of the old tree frees it, taking the new one shares it
+   void test_assign_shares()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s{ 1, 2, 3 };
+      custom::set <int, std::less<int>, custom::cow_tag> sOther{ 4, 5 };
+      custom::cow_stats::reset();
+      // exercise
+      sOther = s;
+      // verify
+      assertUnit(sOther.pShared == s.pShared);
+      assertUnit(s.pShared->refs == 2);
+      assertUnit(sOther.size() == 3);
+      assertUnit(custom::cow_stats::numShares() == 1);
+   }  // teardown
+
+   /***************************************
+    * CLONE
+    ***************************************/
+
+   // the first change copies, the rest are in place, and the original never sees any of it
+   void test_insert_clones()
+   {  // setup
+      custom::set <std::string, std::less<std::string>, custom::cow_tag> s{ "alpha", "charlie" };
+      custom::set <std::string, std::less<std::string>, custom::cow_tag> sCopy(s);
+      custom::cow_stats::reset();
+      // exercise
+      sCopy.insert("bravo");
+      sCopy.insert("delta");
+      // verify
+      assertUnit(custom::cow_stats::numClones() == 1);
+      assertUnit(sCopy.pShared != s.pShared);
+      assertUnit(!s.is_shared());
+      assertUnit(!sCopy.is_shared());
+      assertUnit(s.size() == 2);
+      assertUnit(s.find("bravo") == s.end());
+      std::vector<std::string> walked(sCopy.begin(), sCopy.end());
+      assertUnit(walked == std::vector<std::string>({ "alpha", "bravo", "charlie", "delta" }));
+   }  // teardown
+
+   // nothing changed, so nothing copied
+   void test_insert_alreadyThere()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s{ 10, 20, 30 };
+      custom::set <int, std::less<int>, custom::cow_tag> sCopy(s);
+      custom::cow_stats::reset();
+      // exercise
+      auto result = sCopy.insert(20);
+      auto resultEmplace = sCopy.emplace(30);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(*result.first == 20);
+      assertUnit(!resultEmplace.second);
+      assertUnit(sCopy.pShared == s.pShared);
+      assertUnit(custom::cow_stats::numClones() == 0);
+   }  // teardown
+
+   // erasing what is not there is not a change either
+   void test_erase_notThere()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s{ 10, 20, 30 };
+      custom::set <int, std::less<int>, custom::cow_tag> sCopy(s);
+      custom::cow_stats::reset();
+      // exercise
+      size_t numMissing = sCopy.erase(25);
+      size_t numThere = sCopy.erase(20);
+      // verify
+      assertUnit(numMissing == 0);
+      assertUnit(numThere == 1);
+      assertUnit(custom::cow_stats::numClones() == 1);
+      assertUnit(s.size() == 3);
+      assertUnit(sCopy.size() == 2);
+   }  // teardown
+
+   // an iterator into the shared tree erases the same element from our copy of it
+   void test_eraseIterator_movesOver()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s{ 10, 20, 30, 40 };
+      custom::set <int, std::less<int>, custom::cow_tag> sCopy(s);
+      auto it = sCopy.find(30);
+      // exercise
+      auto itNext = sCopy.erase(it);
+      // verify
+      assertUnit(itNext != sCopy.end());
+      assertUnit(*itNext == 40);
+      std::vector<int> walkedCopy(sCopy.begin(), sCopy.end());
+      std::vector<int> walked(s.begin(), s.end());
+      assertUnit(walkedCopy == std::vector<int>({ 10, 20, 40 }));
+      assertUnit(walked == std::vector<int>({ 10, 20, 30, 40 }));
+   }  // teardown
+
+   // end() as the hint moves over to our own end()
+   void test_insertHint_movesOver()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s{ 10, 20 };
+      custom::set <int, std::less<int>, custom::cow_tag> sCopy(s);
+      // exercise
+      auto it = sCopy.insert(sCopy.end(), 30);
+      // verify
+      assertUnit(*it == 30);
+      assertUnit(sCopy.size() == 3);
+      assertUnit(s.size() == 2);
+      assertUnit(std::is_sorted(sCopy.begin(), sCopy.end()));
+   }  // teardown
+
+   // no sense copying a tree just to empty it
+   void test_clear_noClone()
+   {  // setup
+      custom::set <Spy, std::less<Spy>, custom::cow_tag> s{ Spy(1), Spy(2), Spy(3) };
+      custom::set <Spy, std::less<Spy>, custom::cow_tag> sCopy(s);
+      custom::cow_stats::reset();
+      Spy::reset();
+      // exercise
+      sCopy.clear();
+      // verify
+      assertUnit(sCopy.empty());
+      assertUnit(s.size() == 3);
+      assertUnit(!s.is_shared());
+      assertUnit(custom::cow_stats::numClones() == 0);
+      assertUnit(Spy::numCopy() == 0);
+   }  // teardown
+
+   // moved out of, it reads as empty and takes new elements
+   void test_constructMove_startsOver()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s{ 1, 2, 3 };
+      // exercise
+      custom::set <int, std::less<int>, custom::cow_tag> sMoved(std::move(s));
+      // verify
+      assertUnit(s.pShared == nullptr);
+      assertUnit(s.empty());
+      assertUnit(s.begin() == s.end());
+      assertUnit(sMoved.size() == 3);
+      s.insert(4);
+      assertUnit(s.size() == 1);
+      assertUnit(sMoved.size() == 3);
+   }  // teardown
+
+   /***************************************
+    * ITERATORS
+    ***************************************/
+
+   // taken before the copy, it stays in the tree the other set still has,
+   // and never sees what we changed
+   void test_iterator_staysWithOldTree()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s{ 10, 20, 30 };
+      auto it = s.find(20);
+      custom::set <int, std::less<int>, custom::cow_tag> sCopy(s);
+      // exercise
+      s.insert(25);
+      // verify
+      assertUnit(it == sCopy.find(20));
+      assertUnit(it != s.find(20));
+      assertUnit(*it == 20);
+      ++it;
+      assertUnit(*it == 30);   // the old tree, with no 25 in it
+      assertUnit(s.count(25) == 1);
+   }  // teardown
+
+   // with a tree of our own, iterators live through changes like std::set's
+   void test_unshare_iteratorsStayGood()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s{ 10, 20, 30 };
+      custom::set <int, std::less<int>, custom::cow_tag> sCopy(s);
+      custom::cow_stats::reset();
+      // exercise
+      s.unshare();
+      auto it = s.find(20);
+      s.insert(25);
+      s.erase(10);
+      // verify
+      assertUnit(custom::cow_stats::numClones() == 1);
+      assertUnit(it == s.find(20));
+      ++it;
+      assertUnit(*it == 25);
+      assertUnit(!s.is_shared());
+      assertUnit(sCopy.size() == 3);
+      s.unshare();
+      assertUnit(custom::cow_stats::numClones() == 1);   // already ours, nothing to copy
+   }  // teardown
+
+   /***************************************
+    * SET ALGEBRA
+    ***************************************/
+
+   // the free functions take copy-on-write sets and hand one back, and
+   // leave both sides, and whoever shares them, alone
+   void test_algebra_freeFunctions()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> lhs;
+      custom::set <int, std::less<int>, custom::cow_tag> rhs;
+      for (int i = 0; i < 600; i += 2)
+         lhs.insert(i);
+      for (int i = 0; i < 600; i += 3)
+         rhs.insert(i);
+      custom::set <int, std::less<int>, custom::cow_tag> small{ 4, 5, 6 };
+      custom::set <int, std::less<int>, custom::cow_tag> lhsCopy(lhs);
+      std::vector<int> vLhs(lhs.begin(), lhs.end());
+      std::vector<int> vRhs(rhs.begin(), rhs.end());
+      std::vector<int> vUnion, vIntersection, vDifference, vSymmetric;
+      std::set_union(vLhs.begin(), vLhs.end(), vRhs.begin(), vRhs.end(), std::back_inserter(vUnion));
+      std::set_intersection(vLhs.begin(), vLhs.end(), vRhs.begin(), vRhs.end(), std::back_inserter(vIntersection));
+      std::set_difference(vLhs.begin(), vLhs.end(), vRhs.begin(), vRhs.end(), std::back_inserter(vDifference));
+      std::set_symmetric_difference(vLhs.begin(), vLhs.end(), vRhs.begin(), vRhs.end(), std::back_inserter(vSymmetric));
+      custom::cow_stats::reset();
+      // exercise
+      auto sUnion = custom::set_union(lhs, rhs);
+      auto sIntersection = custom::set_intersection(lhs, rhs);
+      auto sDifference = custom::set_difference(lhs, rhs);
+      auto sSymmetric = custom::set_symmetric_difference(lhs, rhs);
+      auto sSmall = custom::set_intersection(small, lhs);   // small enough to finger search lhs
+      // verify
+      assertUnit(std::vector<int>(sUnion.begin(), sUnion.end()) == vUnion);
+      assertUnit(std::vector<int>(sIntersection.begin(), sIntersection.end()) == vIntersection);
+      assertUnit(std::vector<int>(sDifference.begin(), sDifference.end()) == vDifference);
+      assertUnit(std::vector<int>(sSymmetric.begin(), sSymmetric.end()) == vSymmetric);
+      assertUnit(std::vector<int>(sSmall.begin(), sSmall.end()) == std::vector<int>({ 4, 6 }));
+      assertUnit(!sUnion.is_shared());
+      assertUnit(lhs.pShared == lhsCopy.pShared);
+      assertUnit(custom::cow_stats::numClones() == 0);
+      assertUnit(lhs.size() == 300);
+      assertUnit(rhs.size() == 200);
+   }  // teardown
+
+   /***************************************
+    * FREE
+    ***************************************/
+
+   // the tree goes with the last set that has it
+   void test_release_lastOwner()
+   {  // setup
+      Spy::reset();
+      {
+         auto* pFirst = new custom::set <Spy, std::less<Spy>, custom::cow_tag>{ Spy(1), Spy(2), Spy(3) };
+         custom::set <Spy, std::less<Spy>, custom::cow_tag> second(*pFirst);
+         custom::set <Spy, std::less<Spy>, custom::cow_tag> third(second);
+         third.insert(Spy(4));
+         // exercise
+         delete pFirst;
+         // verify
+         assertUnit(!second.is_shared());
+         assertUnit(second.size() == 3);
+         assertUnit(third.size() == 4);
+      }
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   /***************************************
+    * MANY THREADS
+    ***************************************/
+
+   // every thread gets a copy of the same tree and changes its own
+   void test_clone_manyThreads()
+   {  // setup
+      custom::set <int, std::less<int>, custom::cow_tag> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(i);
+      custom::cow_stats::reset();
+      std::vector<custom::set <int, std::less<int>, custom::cow_tag>> copies(4, s);
+      std::vector<size_t> numWalked(4);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 4; t++)
+         threads.emplace_back([&copies, &numWalked, t]()
+         {
+            auto & mine = copies[t];
+            // walk the shared tree while the others may be changing theirs
+            numWalked[t] = (size_t)std::distance(mine.begin(), mine.end());
+            for (int i = t; i < 1000; i += 4)
+               mine.erase(i);
+            mine.insert(1000 + t);
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      assertUnit(s.size() == 1000);
+      assertUnit(custom::cow_stats::numShares() == 4);
+      assertUnit(custom::cow_stats::numClones() == 4);
+      bool allRight = true;
+      for (int t = 0; t < 4; t++)
+         allRight = allRight && numWalked[t] == 1000 && copies[t].size() == 751 && copies[t].count(t) == 0 &&
+                    copies[t].count(1000 + t) == 1 && std::is_sorted(copies[t].begin(), copies[t].end());
+      assertUnit(allRight);
+   }  // teardown
+};
+
+#endif // DEBUG
@@ -0,0 +1,331 @@
+/***********************************************************************
+ * Header:
+ *    TEST FLAT SET
+ * Summary:
+ *    Unit tests for flat_set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "flat_set.h"   // class under test
+#include "set.h"        // to convert to and from
+#include "spy.h"        // for the elements in the set
+#include "unitTest.h"   // unit test baseclass
+
+#include <algorithm>    // for std::lower_bound
+
+/***********************************************
+ * TEST FLAT SET
+ * Unit tests for the flat set
+ ***********************************************/
+class TestFlatSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructRange_unsorted();
+      test_constructSorted_noComparisons();
+      test_constructSet_standard();
+      test_toSet_standard();
+
+      // Access
+      test_find_standard();
+      test_bounds_everyKey();
+      test_find_comparisons();
+      test_select_standard();
+
+      // Insert
+      test_insert_middle();
+      test_insert_duplicate();
+      test_insertHint_append();
+      test_insertRange_merge();
+
+      // Remove
+      test_erase_key();
+      test_eraseRange_standard();
+
+      // Set algebra
+      test_union_standard();
+
+      report("FlatSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // a new flat set is empty
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::flat_set <int> s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(s.begin() == s.end());
+   }  // teardown
+
+   // out of order and with duplicates, it comes out sorted and unique
+   void test_constructRange_unsorted()
+   {  // setup
+      int values[] = { 50, 30, 70, 30, 20, 80, 50, 40, 60 };
+      // exercise
+      custom::flat_set <int> s(values, values + 9);
+      // verify
+      assertUnit(s.size() == 7);
+      assertUnit(isSortedUnique(s));
+      assertUnit(*s.begin() == 20);
+      assertUnit(*s.rbegin() == 80);
+   }  // teardown
+
+   // sorted input is taken as is
+   void test_constructSorted_noComparisons()
+   {  // setup
+      std::vector<Spy> v;
+      for (int i = 0; i < 100; i++)
+         v.push_back(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::flat_set <Spy> s(custom::sorted_unique, v.begin(), v.end());
+      // verify
+      assertUnit(s.size() == 100);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(Spy::numEquals() == 0);
+   }  // teardown
+
+   // from a tree is a straight copy, in order
+   void test_constructSet_standard()
+   {  // setup
+      custom::set <int> sTree{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      custom::flat_set <int> s(sTree);
+      // verify
+      assertUnit(s.size() == 7);
+      assertUnit(isSortedUnique(s));
+      assertUnit(std::equal(s.begin(), s.end(), sTree.begin()));
+   }  // teardown
+
+   // back to a tree, built without a single comparison
+   void test_toSet_standard()
+   {  // setup
+      custom::flat_set <Spy> s;
+      for (int i = 0; i < 100; i++)
+         s.insert(s.end(), Spy(i));
+      Spy::reset();
+      // exercise
+      custom::set <Spy> sTree = s.to_set();
+      // verify
+      assertUnit(sTree.size() == 100);
+      assertUnit(Spy::numLessthan() == 0);
+      int expected = 0;
+      for (auto it = sTree.begin(); it != sTree.end(); ++it)
+         assertUnit((*it).get() == expected++);
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // find hits and misses
+   void test_find_standard()
+   {  // setup
+      custom::flat_set <int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      auto it40 = s.find(40);
+      auto it45 = s.find(45);
+      auto it10 = s.find(10);
+      auto it90 = s.find(90);
+      // verify
+      assertUnit(it40 != s.end() && *it40 == 40);
+      assertUnit(it45 == s.end());
+      assertUnit(it10 == s.end());
+      assertUnit(it90 == s.end());
+      assertUnit(s.count(80) == 1);
+      assertUnit(s.count(85) == 0);
+   }  // teardown
+
+   // the branchless search lands where std::lower_bound and std::upper_bound do, every size and every key
+   void test_bounds_everyKey()
+   {  // setup
+      bool allRight = true;
+      for (int n = 0; n < 40; n++)
+      {
+         custom::flat_set <int> s;
+         for (int i = 0; i < n; i++)
+            s.insert(i * 2);
+         // exercise
+         for (int key = -1; key <= n * 2; key++)
+         {
+            auto itLower = s.lower_bound(key);
+            auto itUpper = s.upper_bound(key);
+            // verify
+            allRight = allRight && itLower == std::lower_bound(s.begin(), s.end(), key);
+            allRight = allRight && itUpper == std::upper_bound(s.begin(), s.end(), key);
+         }
+      }
+      assertUnit(allRight);
+   }  // teardown
+
+   // every search is the same number of comparisons, no matter the key
+   void test_find_comparisons()
+   {  // setup
+      custom::flat_set <Spy> s;
+      for (int i = 0; i < 1024; i++)
+         s.insert(s.end(), Spy(i));
+      Spy key(777);
+      Spy::reset();
+      // exercise
+      auto it = s.find(key);
+      // verify
+      assertUnit(it != s.end() && (*it).get() == 777);
+      assertUnit(Spy::numLessthan() == 10 + 1 + 1);  // log 1024 halvings, the last one, and the equals check
+      assertUnit(Spy::numEquals() == 0);
+   }  // teardown
+
+   // rank and select are just subtraction and addition
+   void test_select_standard()
+   {  // setup
+      custom::flat_set <int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      auto it3 = s.select(3);
+      auto it7 = s.select(7);
+      // verify
+      assertUnit(*it3 == 50);
+      assertUnit(it7 == s.end());
+      assertUnit(s.rank(45) == 3);
+      assertUnit(s.count_range(30, 70) == 4);
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // the rest of the array moves over to make room
+   void test_insert_middle()
+   {  // setup
+      custom::flat_set <int> s{ 20, 30, 40, 60, 70 };
+      // exercise
+      auto result = s.insert(50);
+      // verify
+      assertUnit(result.second);
+      assertUnit(*result.first == 50);
+      assertUnit(result.first - s.begin() == 3);
+      assertUnit(s.size() == 6);
+      assertUnit(isSortedUnique(s));
+   }  // teardown
+
+   // a duplicate leaves the array alone
+   void test_insert_duplicate()
+   {  // setup
+      custom::flat_set <int> s{ 20, 30, 40 };
+      // exercise
+      auto result = s.insert(30);
+      // verify
+      assertUnit(!result.second);
+      assertUnit(*result.first == 30);
+      assertUnit(s.size() == 3);
+   }  // teardown
+
+   // appending with end() as the hint is one comparison
+   void test_insertHint_append()
+   {  // setup
+      custom::flat_set <Spy> s;
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 100; i++)
+         s.insert(s.end(), Spy(i));
+      // verify
+      assertUnit(s.size() == 100);
+      assertUnit(Spy::numLessthan() == 99);
+      assertUnit(isSortedUnique(s));
+   }  // teardown
+
+   // a batch is sorted on its own and merged in, the old copies of duplicates stay
+   void test_insertRange_merge()
+   {  // setup
+      custom::flat_set <int> s{ 10, 20, 30, 40 };
+      int values[] = { 35, 5, 20, 45, 5, 25 };
+      // exercise
+      s.insert(values, values + 6);
+      // verify
+      assertUnit(s.size() == 8);   // 5 10 20 25 30 35 40 45
+      assertUnit(isSortedUnique(s));
+      assertUnit(*s.begin() == 5);
+      assertUnit(*s.rbegin() == 45);
+      assertUnit(s.count(25) == 1);
+   }  // teardown
+
+   /***************************************
+    * REMOVE
+    ***************************************/
+
+   // erase by key
+   void test_erase_key()
+   {  // setup
+      custom::flat_set <int> s{ 20, 30, 40 };
+      // exercise
+      size_t numMissing = s.erase(35);
+      size_t numFound = s.erase(30);
+      // verify
+      assertUnit(numMissing == 0);
+      assertUnit(numFound == 1);
+      assertUnit(s.size() == 2);
+      assertUnit(s.count(30) == 0);
+   }  // teardown
+
+   // erase a run using the bounds
+   void test_eraseRange_standard()
+   {  // setup
+      custom::flat_set <int> s;
+      for (int i = 0; i < 100; i++)
+         s.insert(s.end(), i);
+      // exercise
+      auto it = s.erase(s.lower_bound(10), s.lower_bound(20));
+      // verify
+      assertUnit(*it == 20);
+      assertUnit(s.size() == 90);
+      assertUnit(s.count(15) == 0);
+      assertUnit(isSortedUnique(s));
+   }  // teardown
+
+   /***************************************
+    * SET ALGEBRA
+    ***************************************/
+
+   // union is one merge pass
+   void test_union_standard()
+   {  // setup
+      custom::flat_set <int> s1{ 10, 20, 30 };
+      custom::flat_set <int> s2{ 20, 40 };
+      // exercise
+      s1.set_union(s2);
+      // verify
+      assertUnit(s1.size() == 4);
+      assertUnit(isSortedUnique(s1));
+      assertUnit(s1.count(40) == 1);
+      assertUnit(s2.size() == 2);
+   }  // teardown
+
+   /*************************************************************
+    * IS SORTED UNIQUE
+    * Strictly increasing from front to back
+    *************************************************************/
+   template <class T>
+   bool isSortedUnique(const custom::flat_set<T>& s)
+   {
+      for (size_t i = 1; i < s.elements.size(); i++)
+         if (!(s.elements[i - 1] < s.elements[i]))
+            return false;
+      return true;
+   }
+};
+
+#endif // DEBUG
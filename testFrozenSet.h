@@ -0,0 +1,261 @@
+/***********************************************************************
+ * Header:
+ *    TEST FROZEN SET
+ * Summary:
+ *    Unit tests for frozen_set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "frozen_set.h" // class under test
+#include "set.h"        // to freeze and thaw
+#include "spy.h"        // for the elements in the set
+#include "unitTest.h"   // unit test baseclass
+
+#include <vector>
+#include <string>
+#include <algorithm>    // for std::lower_bound
+
+/***********************************************
+ * TEST FROZEN SET
+ * Unit tests for the frozen set
+ ***********************************************/
+class TestFrozenSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructSet_layout();
+      test_constructRange_unsorted();
+      test_constructSorted_noComparisons();
+      test_constructCopy_standard();
+      test_toSet_standard();
+
+      // Iterate
+      test_iterator_everySize();
+      test_iterator_backwards();
+
+      // Access
+      test_find_standard();
+      test_bounds_everyKey();
+      test_find_comparisons();
+      test_contains_string();
+
+      report("FrozenSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // nothing to search, nothing allocated
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::frozen_set <int> s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(s.pLines == nullptr);
+      assertUnit(s.begin() == s.end());
+      assertUnit(!s.contains(0));
+   }  // teardown
+
+   // seven in order come out as the heap numbering of a balanced tree
+   //                  50
+   //          30              70
+   //      20      40      60      80
+   void test_constructSet_layout()
+   {  // setup
+      custom::set <int> sTree{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      custom::frozen_set <int> s(sTree);
+      // verify
+      assertUnit(s.size() == 7);
+      assertUnit(s.b(1) == 50);
+      assertUnit(s.b(2) == 30);
+      assertUnit(s.b(3) == 70);
+      assertUnit(s.b(4) == 20);
+      assertUnit(s.b(5) == 40);
+      assertUnit(s.b(6) == 60);
+      assertUnit(s.b(7) == 80);
+      assertUnit(reinterpret_cast<uintptr_t>(s.pLines) % 64 == 0);
+   }  // teardown
+
+   // out of order with duplicates comes out sorted and unique
+   void test_constructRange_unsorted()
+   {  // setup
+      int values[] = { 50, 30, 70, 30, 20, 80, 50, 40, 60 };
+      // exercise
+      custom::frozen_set <int> s(values, values + 9);
+      // verify
+      assertUnit(s.size() == 7);
+      std::vector<int> v(s.begin(), s.end());
+      assertUnit(v == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // sorted input is taken at its word
+   void test_constructSorted_noComparisons()
+   {  // setup
+      std::vector<Spy> v;
+      for (int i = 0; i < 100; i++)
+         v.push_back(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::frozen_set <Spy> s(custom::sorted_unique, v.begin(), v.end());
+      // verify
+      assertUnit(s.size() == 100);
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(Spy::numCopy() == 100);
+   }  // teardown
+
+   // a copy has its own array
+   void test_constructCopy_standard()
+   {  // setup
+      custom::frozen_set <std::string> s{ "cherry", "apple", "banana" };
+      // exercise
+      custom::frozen_set <std::string> sCopy(s);
+      // verify
+      assertUnit(sCopy.size() == 3);
+      assertUnit(sCopy.pLines != s.pLines);
+      assertUnit(*sCopy.begin() == "apple");
+      assertUnit(sCopy.contains("banana"));
+   }  // teardown
+
+   // back into a tree, in order
+   void test_toSet_standard()
+   {  // setup
+      custom::frozen_set <int> s{ 3, 1, 4, 1, 5, 9, 2, 6 };
+      // exercise
+      custom::set <int> sTree = s.to_set();
+      // verify
+      assertUnit(sTree.size() == 7);
+      assertUnit(std::equal(sTree.begin(), sTree.end(), s.begin()));
+   }  // teardown
+
+   /***************************************
+    * ITERATE
+    ***************************************/
+
+   // in order no matter how full the bottom row is
+   void test_iterator_everySize()
+   {  // setup
+      bool allRight = true;
+      for (int n = 0; n < 70; n++)
+      {
+         std::vector<int> v;
+         for (int i = 0; i < n; i++)
+            v.push_back(i);
+         // exercise
+         custom::frozen_set <int> s(custom::sorted_unique, v.begin(), v.end());
+         std::vector<int> walked(s.begin(), s.end());
+         // verify
+         allRight = allRight && walked == v;
+      }
+      assertUnit(allRight);
+   }  // teardown
+
+   // backing up from the end lands on the biggest and walks down
+   void test_iterator_backwards()
+   {  // setup
+      std::vector<int> v;
+      for (int i = 0; i < 100; i++)
+         v.push_back(i);
+      custom::frozen_set <int> s(custom::sorted_unique, v.begin(), v.end());
+      int expected = 99;
+      bool allRight = true;
+      // exercise
+      for (auto it = s.rbegin(); it != s.rend(); ++it)
+         // verify
+         allRight = allRight && *it == expected--;
+      assertUnit(allRight);
+      assertUnit(expected == -1);
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // hits and misses on both sides and in between
+   void test_find_standard()
+   {  // setup
+      custom::frozen_set <int> s{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      auto it40 = s.find(40);
+      auto it45 = s.find(45);
+      auto it10 = s.find(10);
+      auto it90 = s.find(90);
+      // verify
+      assertUnit(it40 != s.end() && *it40 == 40);
+      assertUnit(it45 == s.end());
+      assertUnit(it10 == s.end());
+      assertUnit(it90 == s.end());
+      assertUnit(s.count(80) == 1);
+      assertUnit(s.count(85) == 0);
+   }  // teardown
+
+   // lower_bound and upper_bound land where std::lower_bound and std::upper_bound do
+   void test_bounds_everyKey()
+   {  // setup
+      bool allRight = true;
+      for (int n = 0; n < 70; n++)
+      {
+         std::vector<int> v;
+         for (int i = 0; i < n; i++)
+            v.push_back(i * 2);
+         custom::frozen_set <int> s(custom::sorted_unique, v.begin(), v.end());
+         // exercise
+         for (int key = -1; key <= n * 2; key++)
+         {
+            auto itLower = s.lower_bound(key);
+            auto itUpper = s.upper_bound(key);
+            // verify
+            auto iLower = std::lower_bound(v.begin(), v.end(), key);
+            auto iUpper = std::upper_bound(v.begin(), v.end(), key);
+            allRight = allRight && (iLower == v.end() ? itLower == s.end() : *itLower == *iLower);
+            allRight = allRight && (iUpper == v.end() ? itUpper == s.end() : *itUpper == *iUpper);
+         }
+      }
+      assertUnit(allRight);
+   }  // teardown
+
+   // every search goes all the way to the bottom, so it is the same count every time
+   void test_find_comparisons()
+   {  // setup
+      std::vector<Spy> v;
+      for (int i = 0; i < 1023; i++)
+         v.push_back(Spy(i));
+      custom::frozen_set <Spy> s(custom::sorted_unique, v.begin(), v.end());
+      Spy key(777);
+      Spy::reset();
+      // exercise
+      auto it = s.find(key);
+      // verify
+      assertUnit(it != s.end() && (*it).get() == 777);
+      assertUnit(Spy::numLessthan() == 10 + 1);   // ten levels and the equals check
+      assertUnit(Spy::numEquals() == 0);
+   }  // teardown
+
+   // anything with a comparator works, it just does not get the cache lines as full
+   void test_contains_string()
+   {  // setup
+      custom::frozen_set <std::string> s{ "delta", "alpha", "echo", "charlie", "bravo" };
+      // exercise
+      // verify
+      assertUnit(s.contains("alpha"));
+      assertUnit(s.contains("echo"));
+      assertUnit(!s.contains("foxtrot"));
+      assertUnit(!s.contains("aardvark"));
+      assertUnit(*s.lower_bound("c") == "charlie");
+   }  // teardown
+};
+
+#endif // DEBUG
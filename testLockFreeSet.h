@@ -0,0 +1,454 @@
+/***********************************************************************
+ * Header:
+ *    TEST LOCK-FREE SET
+ * Summary:
+ *    Unit tests for lockfree_set and the epochs that free its nodes
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "lockfree_set.h" // class under test
+#include "epoch.h"        // and what frees its nodes
+#include "spy.h"          // for the elements in the set
+#include "unitTest.h"     // unit test baseclass
+
+#include <cstdint>        // for uint64_t
+#include <set>            // what the answers are held to
+#include <unordered_set>  // states already tried
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>      // for std::lower_bound and std::is_sorted
+
+/***********************************************
+ * TEST LOCK-FREE SET
+ * Unit tests for the lock-free skip list
+ ***********************************************/
+class TestLockFreeSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructInit_sorted();
+      test_constructCopy_standard();
+
+      // One thread at a time
+      test_insert_duplicate();
+      test_bounds_everyKey();
+      test_erase_standard();
+      test_eraseIterator_next();
+      test_height_quarterAsMany();
+      test_clear_noLeaks();
+
+      // Epochs
+      test_epoch_pinnedHoldsUp();
+      test_epoch_erasedStillReadable();
+
+      // Many at once
+      test_insert_manyWriters();
+      test_history_linearizable();
+
+      report("LockFreeSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // nothing on any level
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::lockfree_set <int> s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(s.begin() == s.end());
+      assertUnit(s.head[0].load() == 0);
+      assertUnit(!s.contains(0));
+   }  // teardown
+
+   // out of order in, in order out, once apiece
+   void test_constructInit_sorted()
+   {  // setup
+      // exercise
+      custom::lockfree_set <int> s{ 50, 30, 70, 30, 20, 80, 50, 40, 60 };
+      // verify
+      assertUnit(s.size() == 7);
+      std::vector<int> v(s.begin(), s.end());
+      assertUnit(v == std::vector<int>({ 20, 30, 40, 50, 60, 70, 80 }));
+   }  // teardown
+
+   // a copy has its own nodes
+   void test_constructCopy_standard()
+   {  // setup
+      custom::lockfree_set <int> s{ 1, 2, 3 };
+      // exercise
+      custom::lockfree_set <int> sCopy(s);
+      sCopy.erase(2);
+      // verify
+      assertUnit(s.size() == 3);
+      assertUnit(s.contains(2));
+      assertUnit(sCopy.size() == 2);
+      assertUnit(!sCopy.contains(2));
+   }  // teardown
+
+   /***************************************
+    * ONE THREAD
+    ***************************************/
+
+   // a duplicate finds the one that is there and changes nothing
+   void test_insert_duplicate()
+   {  // setup
+      custom::lockfree_set <int> s{ 10, 20, 30 };
+      // exercise
+      auto resultNew = s.insert(25);
+      auto resultOld = s.insert(20);
+      // verify
+      assertUnit(resultNew.second);
+      assertUnit(*resultNew.first == 25);
+      assertUnit(!resultOld.second);
+      assertUnit(*resultOld.first == 20);
+      assertUnit(s.size() == 4);
+   }  // teardown
+
+   // find, lower_bound and upper_bound land where std::lower_bound and std::upper_bound do
+   void test_bounds_everyKey()
+   {  // setup
+      custom::lockfree_set <int> s;
+      std::vector<int> v;
+      for (int i = 0; i < 500; i++)
+      {
+         s.insert(i * 2);
+         v.push_back(i * 2);
+      }
+      bool allRight = true;
+      // exercise
+      for (int key = -1; key <= 1000; key++)
+      {
+         auto itFind = s.find(key);
+         auto itLower = s.lower_bound(key);
+         auto itUpper = s.upper_bound(key);
+         // verify
+         auto iLower = std::lower_bound(v.begin(), v.end(), key);
+         auto iUpper = std::upper_bound(v.begin(), v.end(), key);
+         bool isThere = key >= 0 && key < 1000 && key % 2 == 0;
+         allRight = allRight && (isThere ? itFind != s.end() && *itFind == key : itFind == s.end());
+         allRight = allRight && (iLower == v.end() ? itLower == s.end() : *itLower == *iLower);
+         allRight = allRight && (iUpper == v.end() ? itUpper == s.end() : *itUpper == *iUpper);
+      }
+      assertUnit(allRight);
+   }  // teardown
+
+   // gone once, and not there to go a second time
+   void test_erase_standard()
+   {  // setup
+      custom::lockfree_set <int> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(i);
+      // exercise
+      size_t numErased = 0;
+      for (int i = 0; i < 1000; i += 3)
+         numErased += s.erase(i);
+      size_t numAgain = s.erase(0);
+      // verify
+      assertUnit(numErased == 334);
+      assertUnit(numAgain == 0);
+      assertUnit(s.size() == 666);
+      assertUnit(!s.contains(999));
+      assertUnit(s.contains(998));
+      std::vector<int> v(s.begin(), s.end());
+      assertUnit(v.size() == 666);
+      assertUnit(std::is_sorted(v.begin(), v.end()));
+   }  // teardown
+
+   // erase hands back the one after
+   void test_eraseIterator_next()
+   {  // setup
+      custom::lockfree_set <int> s{ 10, 20, 30 };
+      auto it = s.find(20);
+      // exercise
+      it = s.erase(it);
+      // verify
+      assertUnit(it != s.end());
+      assertUnit(*it == 30);
+      assertUnit(s.size() == 2);
+   }  // teardown
+
+   // each level up has about a quarter as many as the one below
+   void test_height_quarterAsMany()
+   {  // setup
+      custom::lockfree_set <int> s;
+      // exercise
+      for (int i = 0; i < 20000; i++)
+         s.insert(i);
+      // verify
+      int numLevel0 = 0;
+      int numLevel1 = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+      {
+         numLevel0++;
+         numLevel1 += it.pNode->height > 1;
+      }
+      assertUnit(numLevel0 == 20000);
+      assertUnit(numLevel1 > 20000 / 6 && numLevel1 < 20000 / 3);
+   }  // teardown
+
+   // every element made is destroyed, the erased ones too
+   void test_clear_noLeaks()
+   {  // setup
+      Spy::reset();
+      {
+         custom::lockfree_set <Spy> s;
+         for (int i = 0; i < 1000; i++)
+            s.insert(Spy(i));
+         for (int i = 0; i < 1000; i += 2)
+            s.erase(Spy(i));
+         // exercise
+         s.clear();
+         // verify
+         assertUnit(s.empty());
+         assertUnit(s.begin() == s.end());
+      }
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   /***************************************
+    * EPOCHS
+    ***************************************/
+
+   // Somebody pinned in an old epoch keeps the epoch where it is, and
+   // nothing retired after they pinned is freed until they are done
+   void test_epoch_pinnedHoldsUp()
+   {  // setup
+      custom::epoch_domain domain;
+      int numFreed = 0;
+      auto count = [](void* context, void*) { (*static_cast<int*>(context))++; };
+      std::atomic<bool> pinned(false);
+      std::atomic<bool> done(false);
+      std::thread reader([&]()
+      {
+         auto guard = domain.pin();
+         pinned = true;
+         while (!done)
+            std::this_thread::yield();
+      });
+      while (!pinned)
+         std::this_thread::yield();
+      // exercise
+      for (int i = 0; i < 1000; i++)
+      {
+         auto guard = domain.pin();
+         domain.retire(nullptr, count, &numFreed);
+      }
+      int numFreedWhilePinned = numFreed;
+      done = true;
+      reader.join();
+      for (int i = 0; i < 1000; i++)
+      {
+         auto guard = domain.pin();
+         domain.retire(nullptr, count, &numFreed);
+      }
+      // verify
+      assertUnit(numFreedWhilePinned == 0);
+      assertUnit(numFreed > 0);
+      assertUnit(numFreed + domain.numWaiting() == 2000);
+   }  // teardown
+
+   // an iterator keeps its node alive even after it is erased
+   void test_epoch_erasedStillReadable()
+   {  // setup
+      custom::lockfree_set <Spy> s;
+      for (int i = 0; i < 10; i++)
+         s.insert(Spy(i));
+      auto it = s.find(Spy(5));
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 10; i++)
+         s.erase(Spy(i));
+      for (int round = 0; round < 200; round++)
+      {
+         s.insert(Spy(round));
+         s.erase(Spy(round));
+      }
+      // verify
+      assertUnit((*it).get() == 5);
+      assertUnit(s.empty());
+   }  // teardown
+
+   /***************************************
+    * MANY THREADS
+    ***************************************/
+
+   // writers on every thread, and nothing gets lost
+   void test_insert_manyWriters()
+   {  // setup
+      custom::lockfree_set <int> s;
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 8; t++)
+         threads.emplace_back([&s, t]()
+         {
+            for (int i = 0; i < 500; i++)
+               s.insert(i * 8 + t);
+            for (int i = 0; i < 500; i += 2)
+               s.erase(i * 8 + t);
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      std::vector<int> v(s.begin(), s.end());
+      assertUnit(s.size() == 8 * 250);
+      assertUnit(v.size() == 8 * 250);
+      assertUnit(std::is_sorted(v.begin(), v.end()));
+      assertUnit(std::adjacent_find(v.begin(), v.end()) == v.end());
+   }  // teardown
+
+   /*************************************************************
+    * HISTORY LINEARIZABLE
+    * Threads hammer a handful of keys with inserts, erases, and
+    * lookups, and write down what they did, what they got back,
+    * and when they started and finished on one shared clock. The
+    * set is right if there is some order of those operations, one
+    * at a time, that agrees with every answer and never puts an
+    * operation before one that had finished before it started.
+    * Each key of a set is on its own, so we check one key at a
+    * time against a std::set, which keeps the search small
+    *************************************************************/
+   void test_history_linearizable()
+   {  // setup
+      const int NUM_THREADS = 4;
+      const int NUM_KEYS = 16;
+      const int NUM_OPS = 3000;
+      custom::lockfree_set <int> s;
+      std::atomic<uint64_t> clock(0);
+      std::vector<std::vector<Event>> history(NUM_THREADS);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < NUM_THREADS; t++)
+         threads.emplace_back([&, t]()
+         {
+            uint64_t random = t * 7919 + 17;
+            for (int i = 0; i < NUM_OPS; i++)
+            {
+               random = random * 6364136223846793005ull + 1442695040888963407ull;
+               Event event;
+               event.key = (int)((random >> 33) % NUM_KEYS);
+               event.op = (int)((random >> 20) % 3);
+               event.start = clock++;
+               if (event.op == INSERT)
+                  event.result = s.insert(event.key).second;
+               else if (event.op == ERASE)
+                  event.result = s.erase(event.key) == 1;
+               else
+                  event.result = s.contains(event.key);
+               event.end = clock++;
+               history[t].push_back(event);
+            }
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      bool allLinearizable = true;
+      for (int key = 0; key < NUM_KEYS; key++)
+      {
+         std::vector<std::vector<Event>> perThread(NUM_THREADS);
+         for (int t = 0; t < NUM_THREADS; t++)
+            for (auto & event : history[t])
+               if (event.key == key)
+                  perThread[t].push_back(event);
+         allLinearizable = allLinearizable && isLinearizable(perThread, key);
+      }
+      assertUnit(allLinearizable);
+   }  // teardown
+
+private:
+   enum { INSERT, ERASE, CONTAINS };
+   struct Event
+   {
+      int key;
+      int op;
+      bool result;
+      uint64_t start;
+      uint64_t end;
+   };
+
+   /*************************************************************
+    * IS LINEARIZABLE
+    * Depth first through the orders, a std::set standing in for
+    * the set. What matters about where we are is how far along
+    * each thread is and whether the key is in, so remember those
+    * we have already given up on
+    *************************************************************/
+   bool isLinearizable(const std::vector<std::vector<Event>> & perThread, int key)
+   {
+      std::vector<size_t> next(perThread.size(), 0);
+      std::set<int> model;
+      std::unordered_set<uint64_t> deadEnds;
+      return tryOrders(perThread, key, next, model, deadEnds);
+   }
+
+   bool tryOrders(const std::vector<std::vector<Event>> & perThread, int key,
+                  std::vector<size_t> & next, std::set<int> & model,
+                  std::unordered_set<uint64_t> & deadEnds)
+   {
+      // where we are: how far along each thread is, and whether the key is in
+      uint64_t state = model.count(key);
+      bool allDone = true;
+      uint64_t firstEnd = UINT64_MAX;
+      for (size_t t = 0; t < perThread.size(); t++)
+      {
+         state = state * 4099 + next[t];
+         if (next[t] < perThread[t].size())
+         {
+            allDone = false;
+            firstEnd = std::min(firstEnd, perThread[t][next[t]].end);
+         }
+      }
+      if (allDone)
+         return true;
+      if (deadEnds.count(state))
+         return false;
+
+      // anything that started before the first pending one finished can go next
+      for (size_t t = 0; t < perThread.size(); t++)
+      {
+         if (next[t] >= perThread[t].size())
+            continue;
+         const Event & event = perThread[t][next[t]];
+         if (event.start > firstEnd)
+            continue;
+
+         bool wasIn = model.count(key) == 1;
+         bool agrees;
+         if (event.op == INSERT)
+            agrees = event.result == model.insert(key).second;
+         else if (event.op == ERASE)
+            agrees = event.result == (model.erase(key) == 1);
+         else
+            agrees = event.result == wasIn;
+
+         next[t]++;
+         bool found = agrees && tryOrders(perThread, key, next, model, deadEnds);
+         next[t]--;
+         if (wasIn)
+            model.insert(key);
+         else
+            model.erase(key);
+         if (found)
+            return true;
+      }
+      deadEnds.insert(state);
+      return false;
+   }
+};
+
+#endif // DEBUG
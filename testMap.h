@@ -0,0 +1,326 @@
+/***********************************************************************
+ * Header:
+ *    TEST MAP
+ * Summary:
+ *    Unit tests for map
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "map.h"        // class under test
+#include "spy.h"        // for the keys and values in the map
+#include "unitTest.h"   // unit test baseclass
+
+#include <string>
+#include <stdexcept>    // for std::out_of_range
+
+/***********************************************
+ * TEST MAP
+ * Unit tests for the map
+ ***********************************************/
+class TestMap : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructInit_standard();
+      test_constructCopy_standard();
+
+      // Access
+      test_subscript_missing();
+      test_subscript_present();
+      test_subscript_oneDescent();
+      test_at_present();
+      test_at_missing();
+      test_iterator_changeValue();
+      test_reverse_standard();
+
+      // Insert
+      test_tryEmplace_missing();
+      test_tryEmplace_present();
+      test_insertOrAssign_missing();
+      test_insertOrAssign_present();
+      test_insert_duplicate();
+
+      // Remove
+      test_erase_key();
+      test_swap_standard();
+
+      report("Map");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // a new map is empty
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::map <int, std::string> m;
+      // verify
+      assertUnit(m.empty());
+      assertUnit(m.size() == 0);
+      assertUnit(m.bst.root == nullptr);
+      assertUnit(m.begin() == m.end());
+   }  // teardown
+
+   // the pairs come out sorted by key
+   void test_constructInit_standard()
+   {  // setup
+      // exercise
+      custom::map <int, std::string> m{ { 50, "fifty" }, { 30, "thirty" }, { 70, "seventy" } };
+      // verify
+      assertUnit(m.size() == 3);
+      assertUnit(m.bst.validate());
+      auto it = m.begin();
+      assertUnit(it->first == 30 && it->second == "thirty");
+      ++it;
+      assertUnit(it->first == 50 && it->second == "fifty");
+      ++it;
+      assertUnit(it->first == 70 && it->second == "seventy");
+      ++it;
+      assertUnit(it == m.end());
+   }  // teardown
+
+   // a copy has its own values
+   void test_constructCopy_standard()
+   {  // setup
+      custom::map <int, std::string> m{ { 50, "fifty" }, { 30, "thirty" }, { 70, "seventy" } };
+      // exercise
+      custom::map <int, std::string> mCopy(m);
+      mCopy[30] = "trente";
+      // verify
+      assertUnit(mCopy.size() == 3);
+      assertUnit(mCopy.bst.validate());
+      assertUnit(mCopy.at(30) == "trente");
+      assertUnit(m.at(30) == "thirty");
+      assertUnit(mCopy.bst.root != m.bst.root);
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // a missing key gets a default value
+   void test_subscript_missing()
+   {  // setup
+      custom::map <int, Spy> m;
+      Spy::reset();
+      // exercise
+      Spy & s = m[42];
+      // verify
+      assertUnit(s.empty());
+      assertUnit(m.size() == 1);
+      assertUnit(Spy::numDefault() == 1);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);  // built right in the node
+   }  // teardown
+
+   // a present key hands back its value, nothing gets built
+   void test_subscript_present()
+   {  // setup
+      custom::map <int, Spy> m;
+      m.insert_or_assign(42, Spy(99));
+      Spy::reset();
+      // exercise
+      Spy & s = m[42];
+      // verify
+      assertUnit(s.get() == 99);
+      assertUnit(m.size() == 1);
+      assertUnit(Spy::numDefault() == 0);
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+   }  // teardown
+
+   // finding the key is the only search, the value comes with it
+   void test_subscript_oneDescent()
+   {  // setup
+      custom::map <Spy, int> m;
+      for (int i = 0; i < 1000; i++)
+         m[Spy(i)] = i;
+      Spy key(500);
+      Spy::reset();
+      // exercise
+      m[key] += 1;
+      // verify
+      assertUnit(m.at(key) == 501);
+      assertUnit(Spy::numLessthan() <= 2 * 2 * 10 + 1);   // two lookups, each at most 2 log(1000)
+      assertUnit(Spy::numEquals() == 0);
+   }  // teardown
+
+   // at can change the value in place
+   void test_at_present()
+   {  // setup
+      custom::map <std::string, int> m{ { "apple", 1 }, { "banana", 2 } };
+      // exercise
+      m.at("banana") = 20;
+      // verify
+      assertUnit(m.at("banana") == 20);
+      assertUnit(m.at("apple") == 1);
+      assertUnit(m.size() == 2);
+   }  // teardown
+
+   // at does not make anything up
+   void test_at_missing()
+   {  // setup
+      custom::map <std::string, int> m{ { "apple", 1 } };
+      bool thrown = false;
+      // exercise
+      try
+      {
+         m.at("cherry");
+      }
+      catch (const std::out_of_range &)
+      {
+         thrown = true;
+      }
+      // verify
+      assertUnit(thrown);
+      assertUnit(m.size() == 1);
+   }  // teardown
+
+   // the value, but not the key, can be changed through the iterator
+   void test_iterator_changeValue()
+   {  // setup
+      custom::map <int, int> m{ { 1, 10 }, { 2, 20 }, { 3, 30 } };
+      // exercise
+      for (auto it = m.begin(); it != m.end(); ++it)
+         it->second *= 2;
+      // verify
+      assertUnit(m.at(1) == 20);
+      assertUnit(m.at(2) == 40);
+      assertUnit(m.at(3) == 60);
+   }  // teardown
+
+   // the biggest key comes first going backwards
+   void test_reverse_standard()
+   {  // setup
+      custom::map <int, int> m{ { 1, 10 }, { 2, 20 }, { 3, 30 } };
+      int expected = 3;
+      // exercise
+      for (auto it = m.rbegin(); it != m.rend(); ++it, --expected)
+      // verify
+         assertUnit(it->first == expected && it->second == expected * 10);
+      assertUnit(expected == 0);
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    ***************************************/
+
+   // the value is built from the arguments
+   void test_tryEmplace_missing()
+   {  // setup
+      custom::map <int, std::string> m;
+      // exercise
+      auto result = m.try_emplace(7, 3, 'x');
+      // verify
+      assertUnit(result.second == true);
+      assertUnit(result.first->first == 7);
+      assertUnit(result.first->second == "xxx");
+      assertUnit(m.size() == 1);
+   }  // teardown
+
+   // nothing happens to the arguments when the key is there
+   void test_tryEmplace_present()
+   {  // setup
+      custom::map <int, Spy> m;
+      m.insert_or_assign(7, Spy(70));
+      Spy s(99);
+      Spy::reset();
+      // exercise
+      auto result = m.try_emplace(7, std::move(s));
+      // verify
+      assertUnit(result.second == false);
+      assertUnit(result.first->second.get() == 70);
+      assertUnit(!s.empty());             // still ours, it was never moved from
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numCopy() == 0);
+   }  // teardown
+
+   // a new key goes in with the value
+   void test_insertOrAssign_missing()
+   {  // setup
+      custom::map <int, std::string> m{ { 1, "one" } };
+      // exercise
+      auto result = m.insert_or_assign(2, "two");
+      // verify
+      assertUnit(result.second == true);
+      assertUnit(result.first->second == "two");
+      assertUnit(m.size() == 2);
+      assertUnit(m.bst.validate());
+   }  // teardown
+
+   // an old key gets the new value
+   void test_insertOrAssign_present()
+   {  // setup
+      custom::map <int, std::string> m{ { 1, "one" }, { 2, "two" } };
+      // exercise
+      auto result = m.insert_or_assign(2, "deux");
+      // verify
+      assertUnit(result.second == false);
+      assertUnit(result.first->second == "deux");
+      assertUnit(m.at(2) == "deux");
+      assertUnit(m.size() == 2);
+   }  // teardown
+
+   // insert leaves the old value alone
+   void test_insert_duplicate()
+   {  // setup
+      custom::map <int, std::string> m{ { 1, "one" } };
+      // exercise
+      auto result = m.insert(std::pair<const int, std::string>(1, "uno"));
+      // verify
+      assertUnit(result.second == false);
+      assertUnit(m.at(1) == "one");
+      assertUnit(m.size() == 1);
+   }  // teardown
+
+   /***************************************
+    * REMOVE
+    ***************************************/
+
+   // erase by key
+   void test_erase_key()
+   {  // setup
+      custom::map <int, std::string> m{ { 1, "one" }, { 2, "two" }, { 3, "three" } };
+      // exercise
+      size_t numMissing = m.erase(4);
+      size_t numFound = m.erase(2);
+      // verify
+      assertUnit(numMissing == 0);
+      assertUnit(numFound == 1);
+      assertUnit(m.size() == 2);
+      assertUnit(m.count(2) == 0);
+      assertUnit(m.count(3) == 1);
+      assertUnit(m.bst.validate());
+   }  // teardown
+
+   // swap trades the trees
+   void test_swap_standard()
+   {  // setup
+      custom::map <int, int> m1{ { 1, 10 } };
+      custom::map <int, int> m2{ { 2, 20 }, { 3, 30 } };
+      // exercise
+      swap(m1, m2);
+      // verify
+      assertUnit(m1.size() == 2);
+      assertUnit(m2.size() == 1);
+      assertUnit(m1.at(3) == 30);
+      assertUnit(m2.at(1) == 10);
+   }  // teardown
+};
+
+#endif // DEBUG
@@ -0,0 +1,369 @@
+/***********************************************************************
+ * Header:
+ *    TEST PERSISTENT SET
+ * Summary:
+ *    Unit tests for persistent_set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "persistent_set.h" // class under test
+#include "set.h"            // to start from
+#include "spy.h"            // for the elements in the set
+#include "unitTest.h"       // unit test baseclass
+
+#include <set>              // what the set should hold, to check against
+#include <vector>
+#include <string>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <random>           // for std::mt19937
+#include <algorithm>        // for std::is_sorted
+#include <cstdlib>          // for std::abs
+
+/***********************************************
+ * TEST PERSISTENT SET
+ * Unit tests for the persistent set
+ ***********************************************/
+class TestPersistentSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_constructRange_unsorted();
+      test_constructSet_balanced();
+      test_snapshot_shares();
+
+      // Change
+      test_insert_oldUnchanged();
+      test_insert_sharesUntouched();
+      test_insert_alreadyThere();
+      test_erase_twoChildren();
+      test_change_manyVersions();
+
+      // Access
+      test_bounds_everyKey();
+
+      // Free
+      test_release_lastOneOut();
+
+      // Many threads
+      test_snapshot_whileWriting();
+
+      report("PersistentSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // nothing to hold, nothing to walk
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::persistent_set <int> s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(s.root == nullptr);
+      assertUnit(s.begin() == s.end());
+      assertUnit(!s.contains(0));
+   }  // teardown
+
+   // sorted, and the duplicates gone
+   void test_constructRange_unsorted()
+   {  // setup
+      std::vector<int> v{ 50, 20, 70, 20, 10, 90, 50 };
+      // exercise
+      custom::persistent_set <int> s(v.begin(), v.end());
+      // verify
+      std::vector<int> walked(s.begin(), s.end());
+      assertUnit(walked == std::vector<int>({ 10, 20, 50, 70, 90 }));
+      assertUnit(s.size() == 5);
+      assertUnit(isAVL(s));
+   }  // teardown
+
+   // built from a set in one pass, as short as a tree of that many can be
+   void test_constructSet_balanced()
+   {  // setup
+      custom::set <int> source;
+      for (int i = 0; i < 1023; i++)
+         source.insert(i);
+      // exercise
+      custom::persistent_set <int> s(source);
+      // verify
+      assertUnit(s.size() == 1023);
+      assertUnit(s.root->height == 10);
+      assertUnit(isAVL(s));
+      assertUnit(std::equal(s.begin(), s.end(), source.begin()));
+   }  // teardown
+
+   // one more count on the root, the same nodes under both
+   void test_snapshot_shares()
+   {  // setup
+      custom::persistent_set <int> s{ 1, 2, 3, 4, 5 };
+      // exercise
+      custom::persistent_set <int> snap = s.snapshot();
+      // verify
+      assertUnit(snap.root == s.root);
+      assertUnit(s.root->refs == 2);
+      assertUnit(s.root->pLeft->refs == 1);
+      assertUnit(snap.size() == 5);
+   }  // teardown
+
+   /***************************************
+    * CHANGE
+    ***************************************/
+
+   // the old one does not see what went into the new one
+   void test_insert_oldUnchanged()
+   {  // setup
+      custom::persistent_set <std::string> before{ "alpha", "charlie" };
+      // exercise
+      custom::persistent_set <std::string> after = before.insert("bravo");
+      // verify
+      assertUnit(before.size() == 2);
+      assertUnit(!before.contains("bravo"));
+      assertUnit(after.size() == 3);
+      assertUnit(after.contains("bravo"));
+      std::vector<std::string> walked(after.begin(), after.end());
+      assertUnit(walked == std::vector<std::string>({ "alpha", "bravo", "charlie" }));
+   }  // teardown
+
+   // only the path down to the new leaf is new, and a rotation or two
+   void test_insert_sharesUntouched()
+   {  // setup
+      custom::persistent_set <int> before;
+      for (int i = 0; i < 1000; i++)
+         before = before.insert(i * 2);
+      std::set<const void*> nodesBefore;
+      collect(before.root, nodesBefore);
+      // exercise
+      custom::persistent_set <int> after = before.insert(999);
+      // verify
+      std::set<const void*> nodesAfter;
+      collect(after.root, nodesAfter);
+      size_t numNew = 0;
+      for (const void* p : nodesAfter)
+         numNew += nodesBefore.count(p) == 0;
+      assertUnit(numNew <= (size_t)after.root->height + 2);
+      assertUnit(nodesAfter.size() == 1001);
+      assertUnit(isAVL(before));
+      assertUnit(isAVL(after));
+   }  // teardown
+
+   // nothing made, and the same tree back
+   void test_insert_alreadyThere()
+   {  // setup
+      custom::persistent_set <Spy> before{ Spy(10), Spy(20), Spy(30) };
+      Spy::reset();
+      // exercise
+      custom::persistent_set <Spy> after = before.insert(Spy(20));
+      // verify
+      assertUnit(after.root == before.root);
+      assertUnit(after.size() == 3);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+   }  // teardown
+
+   // the node with two children takes the next one along in its place
+   void test_erase_twoChildren()
+   {  // setup
+      custom::persistent_set <int> before{ 10, 20, 30, 40, 50, 60, 70 };
+      assertUnit(before.root->data == 40);
+      // exercise
+      custom::persistent_set <int> after = before.erase(40);
+      custom::persistent_set <int> same = after.erase(40);
+      // verify
+      std::vector<int> walked(after.begin(), after.end());
+      assertUnit(walked == std::vector<int>({ 10, 20, 30, 50, 60, 70 }));
+      assertUnit(after.root->data == 50);
+      assertUnit(same.root == after.root);
+      assertUnit(before.size() == 7);
+      assertUnit(before.contains(40));
+      assertUnit(isAVL(after));
+   }  // teardown
+
+   // every version stays what it was, however many come after it
+   void test_change_manyVersions()
+   {  // setup
+      std::mt19937 random(232);
+      std::vector<custom::persistent_set <int>> versions(1);
+      std::vector<std::set<int>> expected(1);
+      // exercise
+      for (int i = 0; i < 2000; i++)
+      {
+         int key = (int)(random() % 300);
+         std::set<int> next = expected.back();
+         if (random() % 3 == 0)
+         {
+            versions.push_back(versions.back().erase(key));
+            next.erase(key);
+         }
+         else
+         {
+            versions.push_back(versions.back().insert(key));
+            next.insert(key);
+         }
+         expected.push_back(next);
+      }
+      // verify
+      bool allRight = true;
+      for (size_t i = 0; i < versions.size(); i += 50)
+         allRight = allRight && isAVL(versions[i]) && versions[i].size() == expected[i].size() &&
+                    std::equal(versions[i].begin(), versions[i].end(), expected[i].begin());
+      assertUnit(allRight);
+   }  // teardown
+
+   /***************************************
+    * ACCESS
+    ***************************************/
+
+   // the bounds agree with std::set for every key and the ones between them
+   void test_bounds_everyKey()
+   {  // setup
+      std::set<int> expected;
+      for (int i = 0; i < 100; i++)
+         expected.insert(i * 3);
+      custom::persistent_set <int> s(expected.begin(), expected.end());
+      // exercise
+      bool allRight = true;
+      for (int key = -2; key < 305; key++)
+      {
+         auto itLower = s.lower_bound(key);
+         auto itUpper = s.upper_bound(key);
+         auto itFind = s.find(key);
+         auto itLowerExpected = expected.lower_bound(key);
+         auto itUpperExpected = expected.upper_bound(key);
+         allRight = allRight &&
+                    (itLower == s.end() ? itLowerExpected == expected.end() : *itLower == *itLowerExpected) &&
+                    (itUpper == s.end() ? itUpperExpected == expected.end() : *itUpper == *itUpperExpected) &&
+                    ((itFind != s.end()) == (expected.count(key) == 1));
+      }
+      // verify
+      assertUnit(allRight);
+   }  // teardown
+
+   /***************************************
+    * FREE
+    ***************************************/
+
+   // the nodes go with the last version that holds them, and not before
+   void test_release_lastOneOut()
+   {  // setup
+      Spy::reset();
+      {
+         custom::persistent_set <Spy>* pFirst = new custom::persistent_set <Spy>;
+         for (int i = 0; i < 100; i++)
+            *pFirst = pFirst->insert(Spy(i));
+         custom::persistent_set <Spy> second = pFirst->erase(Spy(50)).insert(Spy(500));
+         // exercise
+         delete pFirst;
+         // verify
+         assertUnit(second.size() == 100);
+         assertUnit(second.contains(Spy(0)));
+         assertUnit(!second.contains(Spy(50)));
+         assertUnit(isAVL(second));
+      }
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
+   /***************************************
+    * MANY THREADS
+    ***************************************/
+
+   // readers walk their snapshot while the writer keeps making new versions
+   void test_snapshot_whileWriting()
+   {  // setup
+      std::mutex lock;
+      custom::persistent_set <int> current;
+      for (int i = 0; i < 500; i++)
+         current = current.insert(i * 2);
+      std::atomic<bool> allRight(true);
+      std::vector<std::thread> threads;
+      // exercise
+      threads.emplace_back([&]()
+      {
+         custom::persistent_set <int> mine = current;
+         for (int round = 0; round < 200; round++)
+         {
+            int key = 2 * (round % 500);
+            mine = mine.erase(key).insert(key + 1).insert(key);
+            std::lock_guard<std::mutex> guard(lock);
+            current = mine;
+         }
+      });
+      for (int t = 0; t < 3; t++)
+         threads.emplace_back([&]()
+         {
+            for (int round = 0; round < 50; round++)
+            {
+               custom::persistent_set <int> snap;
+               {
+                  std::lock_guard<std::mutex> guard(lock);
+                  snap = current.snapshot();
+               }
+               std::vector<int> walked(snap.begin(), snap.end());
+               size_t numEven = std::count_if(walked.begin(), walked.end(), [](int i) { return i % 2 == 0; });
+               if (walked.size() != snap.size() || numEven != 500 ||
+                   !std::is_sorted(walked.begin(), walked.end()))
+                  allRight = false;
+            }
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      assertUnit(allRight);
+      assertUnit(current.size() == 700);
+   }  // teardown
+
+private:
+
+   // in order, and no node with one side more than one taller than the other
+   template <class T>
+   bool isAVL(const custom::persistent_set <T> & s)
+   {
+      int height;
+      return isAVL(s.root, (const T*)nullptr, (const T*)nullptr, height) &&
+             (size_t)std::distance(s.begin(), s.end()) == s.size();
+   }
+   template <class Node, class T>
+   bool isAVL(const Node* p, const T* pLow, const T* pHigh, int & height)
+   {
+      if (!p)
+      {
+         height = 0;
+         return true;
+      }
+      if ((pLow && !(*pLow < p->data)) || (pHigh && !(p->data < *pHigh)))
+         return false;
+      int heightLeft;
+      int heightRight;
+      if (!isAVL(p->pLeft, pLow, &p->data, heightLeft) || !isAVL(p->pRight, &p->data, pHigh, heightRight))
+         return false;
+      height = 1 + std::max(heightLeft, heightRight);
+      return p->height == height && std::abs(heightLeft - heightRight) <= 1;
+   }
+
+   // every node in the tree
+   template <class Node>
+   void collect(const Node* p, std::set<const void*> & nodes)
+   {
+      if (!p)
+         return;
+      nodes.insert(p);
+      collect(p->pLeft, nodes);
+      collect(p->pRight, nodes);
+   }
+};
+
+#endif // DEBUG
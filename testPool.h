@@ -0,0 +1,294 @@
+/***********************************************************************
+ * Header:
+ *    TEST POOL
+ * Summary:
+ *    Unit tests for the pool allocator
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "pool.h"       // class under test
+#include "set.h"        // the pool is a policy on set
+#include "spy.h"        // for the elements in the set
+#include "unitTest.h"   // unit test baseclass
+
+#include <memory>       // for std::allocator
+
+enum { NODE_ALLOC,      // number of times the allocator went to the heap
+       NODE_DELETE,     // number of times the allocator gave memory back
+       NUM_NODE_MARKERS};
+
+/***********************************************
+ * ALLOC SPY
+ * Like the Spy, but it watches the allocator instead of the element
+ ***********************************************/
+class AllocSpy
+{
+public:
+   static void reset()
+   {
+      for (int i = 0; i < NUM_NODE_MARKERS; i++)
+         counters[i] = 0;
+   }
+   static int numAlloc()  { return counters[NODE_ALLOC];  }
+   static int numDelete() { return counters[NODE_DELETE]; }
+
+   // keep track of how it is used
+   static int counters[NUM_NODE_MARKERS];
+};
+
+/***********************************************
+ * SPY ALLOCATOR
+ * A heap allocator that reports every trip to the heap to AllocSpy
+ ***********************************************/
+template <class T>
+class SpyAllocator
+{
+public:
+   using value_type = T;
+   SpyAllocator() {}
+   template <class U>
+   SpyAllocator(const SpyAllocator<U>&) {}
+
+   T* allocate(size_t n)
+   {
+      AllocSpy::counters[NODE_ALLOC]++;
+      return std::allocator<T>().allocate(n);
+   }
+   void deallocate(T* p, size_t n)
+   {
+      AllocSpy::counters[NODE_DELETE]++;
+      std::allocator<T>().deallocate(p, n);
+   }
+
+   template <class U>
+   bool operator == (const SpyAllocator<U>&) const { return true; }
+   template <class U>
+   bool operator != (const SpyAllocator<U>&) const { return false; }
+};
+
+/***********************************************
+ * TEST POOL
+ * Unit tests for the pool and the pool allocator
+ ***********************************************/
+class TestPool : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Pool
+      test_pool_empty();
+      test_pool_allocateOne();
+      test_pool_allocateChunk();
+      test_pool_recycle();
+      test_pool_otherSize();
+
+      // Allocator
+      test_allocator_rebindShares();
+      test_allocator_copyConstructFresh();
+
+      // Set
+      test_set_heapAllocations();
+      test_set_poolAllocations();
+      test_set_poolCopy();
+
+      report("Pool");
+   }
+
+   /***************************************
+    * POOL
+    ***************************************/
+
+   // a new pool has not gone to the heap yet
+   void test_pool_empty()
+   {  // setup
+      // exercise
+      custom::pool p;
+      // verify
+      assertUnit(p.chunks() == 0);
+      assertUnit(p.blocks() == 0);
+      assertUnit(p.sizeBlock == 0);
+      assertUnit(p.pFree == nullptr);
+      assertUnit(p.pChunks == nullptr);
+   }  // teardown
+
+   // the first allocation grabs a chunk
+   void test_pool_allocateOne()
+   {  // setup
+      custom::pool p;
+      // exercise
+      void* pBlock = p.allocate(40);
+      // verify
+      assertUnit(pBlock != nullptr);
+      assertUnit(p.chunks() == 1);
+      assertUnit(p.blocks() == 1);
+      assertUnit(p.sizeBlock >= 40);
+      assertUnit(p.numLeft == custom::pool::FIRST_CHUNK - 1);
+      // teardown
+      p.deallocate(pBlock, 40);
+   }
+
+   // we only go back to the heap when the chunk is all used up
+   void test_pool_allocateChunk()
+   {  // setup
+      custom::pool p;
+      char* blocks[custom::pool::FIRST_CHUNK + 1];
+      // exercise
+      for (size_t i = 0; i < custom::pool::FIRST_CHUNK; i++)
+         blocks[i] = static_cast<char*>(p.allocate(40));
+      // verify
+      assertUnit(p.chunks() == 1);
+      for (size_t i = 1; i < custom::pool::FIRST_CHUNK; i++)
+         assertUnit(blocks[i] - blocks[i - 1] == (long)p.sizeBlock); // right next to each other
+      // exercise
+      blocks[custom::pool::FIRST_CHUNK] = static_cast<char*>(p.allocate(40));
+      // verify
+      assertUnit(p.chunks() == 2);
+      assertUnit(p.blocks() == custom::pool::FIRST_CHUNK + 1);
+      assertUnit(p.numLeft == custom::pool::FIRST_CHUNK * 2 - 1);
+      // teardown
+      for (size_t i = 0; i <= custom::pool::FIRST_CHUNK; i++)
+         p.deallocate(blocks[i], 40);
+   }
+
+   // a freed block is the next one handed out
+   void test_pool_recycle()
+   {  // setup
+      custom::pool p;
+      void* pFirst = p.allocate(40);
+      void* pSecond = p.allocate(40);
+      p.deallocate(pFirst, 40);
+      // exercise
+      void* pThird = p.allocate(40);
+      // verify
+      assertUnit(pThird == pFirst);
+      assertUnit(pThird != pSecond);
+      assertUnit(p.chunks() == 1);
+      assertUnit(p.blocks() == 2);
+      assertUnit(p.pFree == nullptr);
+      // teardown
+      p.deallocate(pSecond, 40);
+      p.deallocate(pThird, 40);
+   }
+
+   // arrays and other sizes go straight to the heap
+   void test_pool_otherSize()
+   {  // setup
+      custom::pool p;
+      void* pBlock = p.allocate(40);
+      // exercise
+      void* pArray = p.allocate(400);
+      // verify
+      assertUnit(pArray != nullptr);
+      assertUnit(p.chunks() == 1);
+      assertUnit(p.blocks() == 1);
+      // teardown
+      p.deallocate(pArray, 400);
+      p.deallocate(pBlock, 40);
+   }
+
+   /***************************************
+    * ALLOCATOR
+    ***************************************/
+
+   // a rebound allocator can free what the original allocated
+   void test_allocator_rebindShares()
+   {  // setup
+      custom::pool_allocator<int> allocInt;
+      // exercise
+      custom::pool_allocator<double> allocDouble(allocInt);
+      // verify
+      assertUnit(allocInt == allocDouble);
+      assertUnit(allocInt.spPool == allocDouble.spPool);
+   }  // teardown
+
+   // a container copy gets its own pool
+   void test_allocator_copyConstructFresh()
+   {  // setup
+      custom::pool_allocator<int> alloc;
+      // exercise
+      custom::pool_allocator<int> allocCopy(alloc.select_on_container_copy_construction());
+      // verify
+      assertUnit(alloc != allocCopy);
+   }  // teardown
+
+   /***************************************
+    * SET
+    ***************************************/
+
+   // before: every insert and every erase is a trip to the heap
+   void test_set_heapAllocations()
+   {  // setup
+      custom::set<Spy, std::less<Spy>, SpyAllocator<Spy>> s;
+      AllocSpy::reset();
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         s.insert(Spy(i));
+      for (int i = 0; i < 1000; i += 2)
+         s.erase(Spy(i));
+      for (int i = 0; i < 1000; i += 2)
+         s.insert(Spy(i));
+      // verify
+      assertUnit(AllocSpy::numAlloc() == 1500);
+      assertUnit(AllocSpy::numDelete() == 500);
+      assertUnit(s.size() == 1000);
+      // teardown
+   }
+
+   // after: a handful of chunks, and erased nodes are reused
+   void test_set_poolAllocations()
+   {  // setup
+      custom::set<Spy, std::less<Spy>, custom::pool_allocator<Spy>> s;
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         s.insert(Spy(i));
+      // verify
+      assertUnit(s.bst.alloc.getPool().chunks() == 6); // 32 + 64 + 128 + 256 + 512 + 1024
+      assertUnit(s.bst.alloc.getPool().blocks() == 1000);
+      // exercise
+      for (int i = 0; i < 1000; i += 2)
+         s.erase(Spy(i));
+      for (int i = 0; i < 1000; i += 2)
+         s.insert(Spy(i));
+      // verify
+      assertUnit(s.bst.alloc.getPool().chunks() == 6);  // no more trips to the heap
+      assertUnit(s.bst.alloc.getPool().blocks() == 1000);
+      assertUnit(s.size() == 1000);
+      assertUnit(s.bst.validate());
+      int expected = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         assertUnit((*it).get() == expected++);
+      // exercise
+      s.clear();
+      // verify
+      assertUnit(s.bst.alloc.getPool().blocks() == 0);
+   }  // teardown
+
+   // copying a set does not share the pool with the original
+   void test_set_poolCopy()
+   {  // setup
+      custom::set<int, std::less<int>, custom::pool_allocator<int>> s;
+      for (int i = 0; i < 100; i++)
+         s.insert(i);
+      // exercise
+      custom::set<int, std::less<int>, custom::pool_allocator<int>> sCopy(s);
+      // verify
+      assertUnit(s.bst.alloc != sCopy.bst.alloc);
+      assertUnit(s.bst.alloc.getPool().blocks() == 100);
+      assertUnit(sCopy.bst.alloc.getPool().blocks() == 100);
+      assertUnit(sCopy.size() == 100);
+      // exercise
+      s.clear();
+      // verify
+      assertUnit(sCopy.bst.alloc.getPool().blocks() == 100);
+      assertUnit(sCopy.bst.validate());
+   }  // teardown
+};
+
+#endif // DEBUG
@@ -17,7 +17,19 @@
 #include "testSet.h"        // for the set unit tests
 #include "testBST.h"        // for the BST unit tests
 #include "testSpy.h"        // for the spy unit tests
+#include "testPool.h"       // for the pool allocator unit tests
+#include "testMap.h"        // for the map unit tests
+#include "testFlatSet.h"    // for the flat set unit tests
+#include "testBTree.h"      // for the B-tree unit tests
+#include "testSimd.h"       // for the vector search unit tests
+#include "testFrozenSet.h"  // for the frozen set unit tests
+#include "testConcurrentSet.h" // for the concurrent set unit tests
+#include "testLockFreeSet.h"   // for the lock-free set unit tests
+#include "testShardedSet.h"    // for the sharded set unit tests
+#include "testPersistentSet.h" // for the persistent set unit tests
+#include "testCowSet.h"        // for the copy-on-write set unit tests
 int Spy::counters[] = {};
+int AllocSpy::counters[] = {};
 
 /**********************************************************************
  * MAIN
@@ -30,6 +42,17 @@ int main()
    TestSpy().run();
    TestBST().run();
    TestSet().run();
+   TestPool().run();
+   TestMap().run();
+   TestFlatSet().run();
+   TestBTree().run();
+   TestSimd().run();
+   TestFrozenSet().run();
+   TestConcurrentSet().run();
+   TestLockFreeSet().run();
+   TestShardedSet().run();
+   TestPersistentSet().run();
+   TestCowSet().run();
 #endif // DEBUG
    
    return 0;
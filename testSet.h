@@ -14,12 +14,19 @@
 
 #include "set.h"
 #include "unitTest.h"
+#include "spy.h"
 #include <set>
 #include <vector>
+#include <algorithm>
+#include <memory_resource>
+#include <string>
+#include <string_view>
 
 #include <iostream>
 #include <cassert>
 #include <memory>
+#include <thread>
+#include <stdexcept>
 
 class TestSet : public UnitTest
 {
@@ -42,6 +49,12 @@ public:
       test_constructRange_empty();
       test_constructRange_one();
       test_constructRange_standard();
+      test_constructRange_sortedDetected();
+      test_constructRange_unsorted();
+      test_constructSorted_standard();
+      test_constructSorted_noComparisons();
+      test_constructSorted_everySize();
+      test_constructSorted_throws();
       test_destructor_empty();
       test_destructor_standard();
 
@@ -81,12 +94,30 @@ public:
       test_iterator_increment_standardToDone();
       test_iterator_increment_standardEnd();
       test_iterator_dereference_standardRead();
+      test_iterator_decrement_standardEnd();
+      test_iterator_decrement_emptyEnd();
+      test_iterator_postfix_standard();
+      test_reverse_standard();
+      test_begin_cached();
+      test_assignMove_sourceForgetsEnds();
+      test_constructCopy_endsReady();
 
       // Access
       test_find_empty();
       test_find_standardBegin();
       test_find_standardLast();
       test_find_standardMissing();
+      test_lowerBound_standard();
+      test_upperBound_standard();
+      test_equalRange_standardPresent();
+      test_equalRange_standardMissing();
+      test_lowerBound_comparisonsPerLevel();
+      test_lowerBound_finger();
+      test_rank_standard();
+      test_select_standard();
+      test_countRange_standard();
+      test_orderStatistics_afterChurn();
+      test_iterator_jump();
 
       // Insert
       test_insert_empty();
@@ -104,6 +135,15 @@ public:
       test_insertInit_standardInsertNone();
       test_insertInit_standardInsertDuplicates();
       test_insertInit_manyInsertMany();
+      test_insertHint_append();
+      test_insertHint_middle();
+      test_insertHint_wrong();
+      test_insertHint_appendAfterErase();
+      test_insertRange_appendNonEmpty();
+      test_emplace_empty();
+      test_emplace_duplicate();
+      test_emplaceHint_sequential();
+      test_emplaceHint_wrong();
 
       // Remove
       test_clear_empty();
@@ -124,6 +164,18 @@ public:
       test_eraseRange_standardMany();
       test_eraseRange_oneChild();
       test_eraseRange_twoChildren();
+      test_eraseRange_everything();
+      test_eraseRange_bounds();
+
+      // Node handles
+      test_extract_twoChildren();
+      test_extract_missing();
+      test_insertNode_noCopies();
+      test_insertNode_duplicate();
+      test_insertNode_changeValue();
+      test_nodeHandle_dropped();
+      test_merge_standard();
+      test_merge_intoEmpty();
 
 
       // Status
@@ -132,6 +184,32 @@ public:
       test_size_empty();
       test_size_standard();
 
+      // Allocator
+      test_allocator_default();
+      test_allocator_pmrBuffer();
+      test_allocator_pmrCopy();
+      test_allocator_pmrMoveSame();
+      test_allocator_pmrMoveDifferent();
+
+      // Set algebra
+      test_union_merge();
+      test_intersection_merge();
+      test_difference_merge();
+      test_symmetricDifference_merge();
+      test_intersection_smallFinger();
+      test_difference_smallFinger();
+      test_union_memberSmall();
+      test_intersection_memberSmall();
+      test_difference_memberSmall();
+      test_symmetricDifference_memberSmall();
+
+      // Compare
+      test_compare_emptyBase();
+      test_compare_greater();
+      test_compare_stateful();
+      test_compare_transparentString();
+      test_compare_transparentSpy();
+
       report("Set");
    }
    
@@ -172,6 +250,7 @@ public:
       custom::set<int> sSrc;
       sSrc.bst.root = new custom::BST<int>::BNode(int(50));
       sSrc.bst.numElements = 1;
+      sSrc.bst.findEnds();
       
       // exercise
       custom::set<int> sDest(sSrc);
@@ -387,6 +466,129 @@ public:
       teardownStandardFixture(s);
    }
 
+   // sorted input is noticed and built without a single insert
+   void test_constructRange_sortedDetected()
+   {  // setup
+      std::vector<Spy> v;
+      for (int i = 0; i < 1000; i++)
+         v.push_back(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::set <Spy> s(v.begin(), v.end());
+      // verify
+      assertUnit(Spy::numLessthan() == 999);  // one per neighbor to check the order
+      assertUnit(Spy::numCopy() == 1000);
+      assertUnit(s.size() == 1000);
+      assertUnit(s.bst.validate());
+      int expected = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         assertUnit((*it).get() == expected++);
+   }  // teardown
+
+   // out of order or duplicated input still goes through insert
+   void test_constructRange_unsorted()
+   {  // setup
+      std::vector<int> v{ 30, 10, 20, 10, 40 };
+      // exercise
+      custom::set <int> s(v.begin(), v.end());
+      // verify
+      assertUnit(s.size() == 4);
+      assertUnit(s.bst.validate());
+      auto it = s.begin();
+      assertUnit(*it == 10);
+      ++it;
+      assertUnit(*it == 20);
+      ++it;
+      assertUnit(*it == 30);
+      ++it;
+      assertUnit(*it == 40);
+   }  // teardown
+
+   // seven sorted elements make exactly the standard fixture, colors and all
+   void test_constructSorted_standard()
+   {  // setup
+      std::vector<int> v{ 20, 30, 40, 50, 60, 70, 80 };
+      // exercise
+      custom::set <int> s(custom::sorted_unique, v.begin(), v.end());
+      // verify
+      //                (50b)
+      //          +-------+-------+
+      //        (30b)           (70b)
+      //     +----+----+     +----+----+
+      //   (20r)     (40r) (60r)     (80r)
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // we take the caller's word that it is sorted, so nothing gets compared
+   void test_constructSorted_noComparisons()
+   {  // setup
+      std::vector<Spy> v;
+      for (int i = 0; i < 1000; i++)
+         v.push_back(Spy(i));
+      Spy::reset();
+      // exercise
+      auto s = custom::set <Spy> ::from_sorted(v.begin(), v.end());
+      // verify
+      assertUnit(Spy::numLessthan() == 0);
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(s.size() == 1000);
+      assertUnit(s.bst.validate());
+      assertUnit(s.find(Spy(500)) != s.end());
+   }  // teardown
+
+   // the colors work out whether or not the bottom level is full
+   void test_constructSorted_everySize()
+   {  // setup
+      std::vector<int> v;
+      bool allValid = true;
+      bool allOrdered = true;
+      for (int n = 0; n <= 70; n++)
+      {
+         // exercise
+         auto s = custom::set <int> ::from_sorted(v.begin(), v.end());
+         // verify
+         allValid = allValid && s.bst.validate() && s.size() == (size_t)n;
+         int expected = 0;
+         for (auto it = s.begin(); it != s.end(); ++it)
+            allOrdered = allOrdered && *it == expected++;
+         allOrdered = allOrdered && expected == n;
+         v.push_back(n);
+      }
+      assertUnit(allValid);
+      assertUnit(allOrdered);
+   }  // teardown
+
+   // the input gives out part way through, and every node built so far is given back
+   void test_constructSorted_throws()
+   {  // setup
+      std::vector<Spy> v;
+      for (int i = 0; i < 20; i++)
+         v.push_back(Spy(i));
+      bool allThrew = true;
+      bool allKept = true;
+      Spy::reset();
+      // exercise
+      for (size_t numGood = 0; numGood < v.size(); numGood++)
+      {
+         custom::set <Spy> s{ Spy(99) };
+         try
+         {
+            s = custom::set <Spy> ::from_sorted(Faulty{ &v, 0, numGood }, Faulty{ &v, v.size(), numGood });
+            allThrew = false;
+         }
+         catch (const std::runtime_error&)
+         {
+         }
+         allKept = allKept && s.size() == 1;
+      }
+      // verify
+      assertUnit(allThrew);
+      assertUnit(allKept);
+      assertUnit(Spy::numAlloc() == Spy::numDelete());
+   }  // teardown
+
    /***************************************
     * CONSTRUCTOR INITIALIZE LIST
     ***************************************/
@@ -629,6 +831,7 @@ public:
       custom::BST <int>::BNode* p99 = new custom::BST<int>::BNode(int(99));
       sDest.bst.root = p99;
       sDest.bst.numElements = 1;
+      sDest.bst.findEnds();
       
       // exercise
       sDest = sSrc;
@@ -659,6 +862,7 @@ public:
       custom::BST <int>::BNode* p99 = new custom::BST<int>::BNode(int(99));
       sSrc.bst.root = p99;
       sSrc.bst.numElements = 1;
+      sSrc.bst.findEnds();
       //                (50b) = sDest
       //          +-------+-------+
       //        (30b)           (70b)
@@ -806,6 +1010,7 @@ public:
       custom::BST <int>::BNode* p99 = new custom::BST<int>::BNode(int(99));
       sDest.bst.root = p99;
       sDest.bst.numElements = 1;
+      sDest.bst.findEnds();
       
       // exercise
       sDest = std::move(sSrc);
@@ -829,6 +1034,7 @@ public:
       custom::BST <int>::BNode* p99 = new custom::BST<int>::BNode(int(99));
       sSrc.bst.root = p99;
       sSrc.bst.numElements = 1;
+      sSrc.bst.findEnds();
       //                (50b) = sDest
       //          +-------+-------+
       //        (30b)           (70b)
@@ -950,6 +1156,7 @@ public:
       custom::BST <int>::BNode* p99 = new custom::BST<int>::BNode(int(99));
       s.bst.root = p99;
       s.bst.numElements = 1;
+      s.bst.findEnds();
       
       // exercise
       s = il;
@@ -1410,6 +1617,157 @@ public:
       teardownStandardFixture(s);
    }
 
+   // one step back from the end is the biggest element
+   void test_iterator_decrement_standardEnd()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      auto it = s.end();
+      // exercise
+      --it;
+      // verify
+      assertUnit(it != s.end());
+      assertUnit(*it == 80);
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // there is nothing to back up to in an empty set
+   void test_iterator_decrement_emptyEnd()
+   {  // setup
+      custom::set <int> s;
+      auto it = s.end();
+      // exercise
+      --it;
+      // verify
+      assertUnit(it == s.end());
+      assertEmptyFixture(s);
+   }  // teardown
+
+   // postfix moves the iterator and hands back where it was
+   void test_iterator_postfix_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      auto it = s.find(50);
+      // exercise
+      auto itOld = it++;
+      // verify
+      assertUnit(*itOld == 50);
+      assertUnit(*it == 60);
+      // exercise
+      itOld = it--;
+      // verify
+      assertUnit(*itOld == 60);
+      assertUnit(*it == 50);
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // rbegin to rend is everything, biggest first
+   void test_reverse_standard()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      int expected = 80;
+      // exercise
+      for (auto it = s.rbegin(); it != s.rend(); ++it, expected -= 10)
+      // verify
+         assertUnit(*it == expected);
+      assertUnit(expected == 10);
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // the smallest node is remembered and kept up to date, so begin() does not descend
+   void test_begin_cached()
+   {  // setup
+      custom::set <int> s;
+      for (int i = 100; i < 200; i++)
+         s.insert(i);
+      // exercise
+      auto it = s.begin();
+      // verify
+      assertUnit(*it == 100);
+      assertUnit(s.bst.pLeftmost == it.it.pNode);
+      // exercise
+      s.insert(50);
+      // verify
+      assertUnit(s.bst.pLeftmost != nullptr);
+      assertUnit(s.bst.pLeftmost->data == 50);
+      // exercise
+      s.erase(50);
+      s.erase(100);
+      // verify
+      assertUnit(s.bst.pLeftmost != nullptr);
+      assertUnit(s.bst.pLeftmost->data == 101);
+      assertUnit(*s.begin() == 101);
+      assertUnit(s.bst.validate());
+   }  // teardown
+
+   // a copy knows its ends before anybody asks, so two threads can walk it at once
+   void test_constructCopy_endsReady()
+   {  // setup
+      custom::set <int> sSrc;
+      for (int i = 0; i < 500; i++)
+         sSrc.insert(i);
+      std::vector<int> walked[2];
+      // exercise
+      const custom::set <int> sCopy(sSrc);
+      std::thread first([&sCopy, &walked]() { for (int i : sCopy) walked[0].push_back(i); });
+      std::thread second([&sCopy, &walked]() { for (auto it = sCopy.rbegin(); it != sCopy.rend(); ++it) walked[1].push_back(*it); });
+      first.join();
+      second.join();
+      // verify
+      assertUnit(sCopy.bst.pLeftmost != nullptr);
+      assertUnit(sCopy.bst.pLeftmost->data == 0);
+      assertUnit(sCopy.bst.pRightmost->data == 499);
+      assertUnit(walked[0].size() == 500);
+      assertUnit(walked[1].size() == 500);
+      assertUnit(std::is_sorted(walked[0].begin(), walked[0].end()));
+      assertUnit(std::is_sorted(walked[1].rbegin(), walked[1].rend()));
+      assertUnit(sCopy.bst.validate());
+   }  // teardown
+
+   // after a move the source must not remember nodes that now belong to someone else
+   void test_assignMove_sourceForgetsEnds()
+   {  // setup
+      custom::set <int> sSrc{ 10, 20, 30 };
+      custom::set <int> sDest;
+      sSrc.begin();
+      sSrc.insert(sSrc.end(), 40);
+      // exercise
+      sDest = std::move(sSrc);
+      sSrc.insert(sSrc.end(), 5);
+      // verify
+      assertUnit(sSrc.size() == 1);
+      assertUnit(*sSrc.begin() == 5);
+      assertUnit(*--sSrc.end() == 5);
+      assertUnit(sSrc.bst.validate());
+      assertUnit(sDest.size() == 4);
+      assertUnit(*sDest.begin() == 10);
+      assertUnit(*--sDest.end() == 40);
+      assertUnit(sDest.bst.validate());
+   }  // teardown
+
    /***************************************
     * Find
     *    set::find(const T &)
@@ -1517,138 +1875,198 @@ public:
 
 
    /***************************************
-    * INSERT
-    *  set::insert(const T &)
+    * BOUNDS
+    *  set::lower_bound(const T &)
+    *  set::upper_bound(const T &)
+    *  set::equal_range(const T &)
     ***************************************/
-   
-   // insert an element when empty
-   void test_insert_empty() 
+
+   // lower bound lands on the element itself or the next one up
+   void test_lowerBound_standard()
    {  // setup
-      custom::set<int> s;
-      int num(50);
-      
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
       // exercise
-      auto pairSet = s.insert(num);
+      auto itFound = s.lower_bound(40);
+      auto itBetween = s.lower_bound(45);
+      auto itBefore = s.lower_bound(10);
+      auto itAfter = s.lower_bound(85);
       // verify
-      assertUnit(pairSet.first != s.end());
-      assertUnit(pairSet.second == true);
-      if (pairSet.first != s.end())
-         assertUnit(*(pairSet.first) == int(50));
-      //            (50b)
-      assertUnit(s.bst.root != nullptr);
-      assertUnit(s.bst.numElements == 1);
-
-      if (s.bst.root)
-      {
-         assertUnit(s.bst.root->data == int(50));
-         assertUnit(s.bst.root->pLeft == nullptr);
-         assertUnit(s.bst.root->pRight == nullptr);
-         assertUnit(s.bst.root->pParent == nullptr);
-      }
+      assertUnit(itFound.it.pNode == s.bst.root->pLeft->pRight);
+      assertUnit(itBetween.it.pNode == s.bst.root);
+      assertUnit(itBefore.it.pNode == s.bst.root->pLeft->pLeft);
+      assertUnit(itAfter == s.end());
+      assertStandardFixture(s);
       // teardown
-      delete s.bst.root;
-      s.bst.root = nullptr;
-      s.bst.numElements = 0;
+      teardownStandardFixture(s);
    }
 
-   // insert onto the end when there is excess capacity
-   void test_insert_standardEnd()
+   // upper bound always skips past the element
+   void test_upperBound_standard()
    {  // setup
       //                 50 
       //          +-------+-------+
       //         30              70  
-      //     +----+----+     +----+
-      //    20        40    60     
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
       custom::set <int> s;
       setupStandardFixture(s);
-      delete s.bst.root->pRight->pRight;
-      s.bst.root->pRight->pRight = nullptr;
-      s.bst.numElements = 6;
-      int num(80);
-      
       // exercise
-      auto pairSet = s.insert(num);
+      auto itFound = s.upper_bound(40);
+      auto itBetween = s.upper_bound(45);
+      auto itBefore = s.upper_bound(10);
+      auto itLast = s.upper_bound(80);
       // verify
-      assertUnit(pairSet.first != s.end());
-      assertUnit(pairSet.second == true);
-      if (pairSet.first != s.end())
-         assertUnit(*(pairSet.first) == int(80));
+      assertUnit(itFound.it.pNode == s.bst.root);
+      assertUnit(itBetween.it.pNode == s.bst.root);
+      assertUnit(itBefore.it.pNode == s.bst.root->pLeft->pLeft);
+      assertUnit(itLast == s.end());
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // the range around an element holds just that element
+   void test_equalRange_standardPresent()
+   {  // setup
       //                 50 
       //          +-------+-------+
       //         30              70  
       //     +----+----+     +----+----+
       //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      // exercise
+      auto range = s.equal_range(60);
+      // verify
+      assertUnit(range.first.it.pNode == s.bst.root->pRight->pLeft);
+      assertUnit(range.second.it.pNode == s.bst.root->pRight);
       assertStandardFixture(s);
       // teardown
       teardownStandardFixture(s);
    }
 
-   // insert to the beginning when we need to reallocat
-   void test_insert_standardFront()
+   // the range around a missing element is empty
+   void test_equalRange_standardMissing()
    {  // setup
       //                 50 
       //          +-------+-------+
       //         30              70  
-      //          +----+     +----+----+
-      //              40    60        80  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
       custom::set <int> s;
       setupStandardFixture(s);
-      delete s.bst.root->pLeft->pLeft;
-      s.bst.root->pLeft->pLeft = nullptr;
-      s.bst.numElements = 6;
-      int num(20);
-      
       // exercise
-      auto pairSet = s.insert(num);
+      auto range = s.equal_range(65);
       // verify
-      assertUnit(pairSet.first != s.end());
-      assertUnit(pairSet.second == true);
-      if (pairSet.first != s.end())
-         assertUnit(*(pairSet.first) == int(20));
+      assertUnit(range.first == range.second);
+      assertUnit(range.first.it.pNode == s.bst.root->pRight);
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // one comparison per level, never walking from begin()
+   void test_lowerBound_comparisonsPerLevel()
+   {  // setup
+      custom::set <Spy> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(Spy(i * 2));
+      Spy key(501);
+      Spy::reset();
+      // exercise
+      auto it = s.lower_bound(key);
+      // verify
+      assertUnit(it != s.end());
+      assertUnit((*it).get() == 502);
+      assertUnit(Spy::numLessthan() <= 20);   // 2 log(1001), the red-black height limit
+      assertUnit(Spy::numEquals() == 0);
+   }  // teardown
+
+   // starting from a node part way through gives the same answer as starting at the root
+   void test_lowerBound_finger()
+   {  // setup
       //                 50 
       //          +-------+-------+
       //         30              70  
       //     +----+----+     +----+----+
       //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      auto it20 = s.lower_bound(20);
+      auto it40 = s.lower_bound(40);
+      // exercise
+      auto itSame = s.lower_bound(it40, 40);
+      auto itUp = s.lower_bound(it20, 55);
+      auto itFar = s.lower_bound(it40, 75);
+      auto itPast = s.lower_bound(it20, 99);
+      // verify
+      assertUnit(itSame == it40);
+      assertUnit(itUp.it.pNode == s.bst.root->pRight->pLeft);
+      assertUnit(itFar.it.pNode == s.bst.root->pRight->pRight);
+      assertUnit(itPast == s.end());
       assertStandardFixture(s);
       // teardown
       teardownStandardFixture(s);
    }
 
-   // insert into the middle when there is excess capacity
-   void test_insert_standardMiddle() 
+   // rank counts the elements in front of a key, whether or not it is there
+   void test_rank_standard()
    {  // setup
       //                 50 
       //          +-------+-------+
       //         30              70  
-      //     +----+----+          +----+
-      //    20        40              80  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
       custom::set <int> s;
       setupStandardFixture(s);
-      delete s.bst.root->pRight->pLeft;
-      s.bst.root->pRight->pLeft = nullptr;
-      s.bst.numElements = 6;
-      int num(60);
-      
       // exercise
-      auto pairSet = s.insert(num);
+      size_t rank20 = s.rank(20);
+      size_t rank45 = s.rank(45);
+      size_t rank80 = s.rank(80);
+      size_t rank99 = s.rank(99);
       // verify
-      assertUnit(pairSet.first != s.end());
-      assertUnit(pairSet.second == true);
-      if (pairSet.first != s.end())
-         assertUnit(*(pairSet.first) == int(60));
+      assertUnit(rank20 == 0);
+      assertUnit(rank45 == 3);
+      assertUnit(rank80 == 6);
+      assertUnit(rank99 == 7);
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // select goes straight to the i-th element
+   void test_select_standard()
+   {  // setup
       //                 50 
       //          +-------+-------+
       //         30              70  
       //     +----+----+     +----+----+
       //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      // exercise
+      auto it0 = s.select(0);
+      auto it3 = s.select(3);
+      auto it6 = s.select(6);
+      auto it7 = s.select(7);
+      // verify
+      assertUnit(it0 != s.end() && *it0 == 20);
+      assertUnit(it3 != s.end() && *it3 == 50);
+      assertUnit(it6 != s.end() && *it6 == 80);
+      assertUnit(it7 == s.end());
       assertStandardFixture(s);
       // teardown
       teardownStandardFixture(s);
    }
 
-   // insert when the elements are already there. Nothing is added
-   void test_insert_standardDuplicate() 
+   // count_range counts [lo, hi)
+   void test_countRange_standard()
    {  // setup
       //                 50 
       //          +-------+-------+
@@ -1657,13 +2075,224 @@ public:
       //    20        40    60        80  
       custom::set <int> s;
       setupStandardFixture(s);
-      int num(60);
-      
       // exercise
-      auto pairSet = s.insert(num);
+      size_t numMiddle = s.count_range(30, 70);
+      size_t numNone = s.count_range(45, 50);
+      size_t numAll = s.count_range(0, 100);
+      size_t numBackwards = s.count_range(70, 30);
       // verify
-      assertUnit(pairSet.first != s.end());
-      assertUnit(pairSet.second == false);
+      assertUnit(numMiddle == 4);  // 30 40 50 60
+      assertUnit(numNone == 0);
+      assertUnit(numAll == 7);
+      assertUnit(numBackwards == 0);
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // the sizes survive every rotation that inserts and erases do
+   void test_orderStatistics_afterChurn()
+   {  // setup
+      custom::set <int> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert((i * 37) % 1000);
+      // exercise
+      for (int i = 0; i < 1000; i += 2)
+         s.erase(i);
+      // verify
+      assertUnit(s.bst.validate());
+      assertUnit(s.size() == 500);
+      bool allRight = true;
+      for (int i = 0; i < 500; i++)
+      {
+         auto it = s.select(i);
+         allRight = allRight && it != s.end() && *it == i * 2 + 1;
+         allRight = allRight && s.rank(i * 2 + 1) == (size_t)i;
+      }
+      assertUnit(allRight);
+      assertUnit(s.count_range(100, 200) == 50);
+   }  // teardown
+
+   // += and -= jump straight to where they are going
+   void test_iterator_jump()
+   {  // setup
+      custom::set <int> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(i);
+      auto it = s.begin();
+      // exercise
+      it += 500;
+      // verify
+      assertUnit(*it == 500);
+      // exercise
+      it -= 200;
+      // verify
+      assertUnit(*it == 300);
+      // exercise
+      it += 700;
+      // verify
+      assertUnit(it == s.end());
+      // exercise
+      it -= 1;
+      // verify
+      assertUnit(*it == 999);
+      // exercise
+      it -= 1000;
+      // verify
+      assertUnit(it == s.end());
+   }  // teardown
+
+   /***************************************
+    * INSERT
+    *  set::insert(const T &)
+    ***************************************/
+   
+   // insert an element when empty
+   void test_insert_empty() 
+   {  // setup
+      custom::set<int> s;
+      int num(50);
+      
+      // exercise
+      auto pairSet = s.insert(num);
+      // verify
+      assertUnit(pairSet.first != s.end());
+      assertUnit(pairSet.second == true);
+      if (pairSet.first != s.end())
+         assertUnit(*(pairSet.first) == int(50));
+      //            (50b)
+      assertUnit(s.bst.root != nullptr);
+      assertUnit(s.bst.numElements == 1);
+
+      if (s.bst.root)
+      {
+         assertUnit(s.bst.root->data == int(50));
+         assertUnit(s.bst.root->pLeft == nullptr);
+         assertUnit(s.bst.root->pRight == nullptr);
+         assertUnit(s.bst.root->pParent == nullptr);
+      }
+      // teardown
+      delete s.bst.root;
+      s.bst.root = nullptr;
+      s.bst.numElements = 0;
+   }
+
+   // insert onto the end when there is excess capacity
+   void test_insert_standardEnd()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+
+      //    20        40    60     
+      custom::set <int> s;
+      setupStandardFixture(s);
+      delete s.bst.root->pRight->pRight;
+      s.bst.root->pRight->pRight = nullptr;
+      s.bst.numElements = 6;
+      s.bst.findEnds();
+      int num(80);
+      
+      // exercise
+      auto pairSet = s.insert(num);
+      // verify
+      assertUnit(pairSet.first != s.end());
+      assertUnit(pairSet.second == true);
+      if (pairSet.first != s.end())
+         assertUnit(*(pairSet.first) == int(80));
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // insert to the beginning when we need to reallocat
+   void test_insert_standardFront()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //          +----+     +----+----+
+      //              40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      delete s.bst.root->pLeft->pLeft;
+      s.bst.root->pLeft->pLeft = nullptr;
+      s.bst.numElements = 6;
+      s.bst.findEnds();
+      int num(20);
+      
+      // exercise
+      auto pairSet = s.insert(num);
+      // verify
+      assertUnit(pairSet.first != s.end());
+      assertUnit(pairSet.second == true);
+      if (pairSet.first != s.end())
+         assertUnit(*(pairSet.first) == int(20));
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // insert into the middle when there is excess capacity
+   void test_insert_standardMiddle() 
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+          +----+
+      //    20        40              80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      delete s.bst.root->pRight->pLeft;
+      s.bst.root->pRight->pLeft = nullptr;
+      s.bst.numElements = 6;
+      s.bst.findEnds();
+      int num(60);
+      
+      // exercise
+      auto pairSet = s.insert(num);
+      // verify
+      assertUnit(pairSet.first != s.end());
+      assertUnit(pairSet.second == true);
+      if (pairSet.first != s.end())
+         assertUnit(*(pairSet.first) == int(60));
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      assertStandardFixture(s);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // insert when the elements are already there. Nothing is added
+   void test_insert_standardDuplicate() 
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      int num(60);
+      
+      // exercise
+      auto pairSet = s.insert(num);
+      // verify
+      assertUnit(pairSet.first != s.end());
+      assertUnit(pairSet.second == false);
       if (pairSet.first != s.end())
          assertUnit(*(pairSet.first) == int(60));
       //                 50 
@@ -1726,6 +2355,7 @@ public:
       delete s.bst.root->pRight->pRight;
       s.bst.root->pRight->pRight = nullptr;
       s.bst.numElements = 6;
+      s.bst.findEnds();
       int num(80);
       
       // exercise
@@ -1759,6 +2389,7 @@ public:
       delete s.bst.root->pLeft->pLeft;
       s.bst.root->pLeft->pLeft = nullptr;
       s.bst.numElements = 6;
+      s.bst.findEnds();
       int num(20);
       
       // exercise
@@ -1792,6 +2423,7 @@ public:
       delete s.bst.root->pRight->pLeft;
       s.bst.root->pRight->pLeft = nullptr;
       s.bst.numElements = 6;
+      s.bst.findEnds();
       int num(60);
       
       // exercise
@@ -1931,6 +2563,7 @@ public:
       p50->pRight = p70;
       p50->pLeft  = p30;
       s.bst.numElements = 3;
+      s.bst.findEnds();
       std::initializer_list<int> il{ int(20), int(40), int(60), int(80) };
       
       // exercise
@@ -1947,6 +2580,192 @@ public:
    }
 
 
+   /***************************************
+    * Insert Hint
+    *    set::insert(iterator, const T &)
+    ***************************************/
+
+   // appending with end() as the hint is one comparison, no descent
+   void test_insertHint_append()
+   {  // setup
+      custom::set <Spy> s;
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         s.insert(s.end(), Spy(i));
+      // verify
+      assertUnit(s.size() == 1000);
+      assertUnit(Spy::numLessthan() == 999);  // each one against the biggest so far
+      assertUnit(Spy::numEquals() == 0);
+      assertUnit(s.bst.validate());
+      assertUnit(s.bst.pRightmost != nullptr);
+      assertUnit(s.bst.pRightmost->data.get() == 999);
+   }  // teardown
+
+   // a hint in the middle of the tree costs two comparisons
+   void test_insertHint_middle()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      auto it50 = custom::set <int> ::iterator(s.bst.root);
+      // exercise
+      auto it = s.insert(it50, 45);
+      // verify
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      //                 +
+      //                45
+      assertUnit(*it == 45);
+      assertUnit(it.it.pNode->pParent == s.bst.root->pLeft->pRight);
+      assertUnit(s.bst.root->pLeft->pRight->pRight == it.it.pNode);
+      assertUnit(s.size() == 8);
+      assertUnit(s.bst.validate());
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // a hint that is wrong, or points at a duplicate, still does the right thing
+   void test_insertHint_wrong()
+   {  // setup
+      custom::set <int> s{ 10, 20, 30, 40 };
+      // exercise
+      auto it5 = s.insert(s.end(), 5);
+      auto it35 = s.insert(s.begin(), 35);
+      auto it20 = s.insert(s.find(30), 20);
+      // verify
+      assertUnit(*it5 == 5);
+      assertUnit(*it35 == 35);
+      assertUnit(*it20 == 20);
+      assertUnit(s.size() == 6);
+      assertUnit(s.bst.validate());
+      int expected[] = { 5, 10, 20, 30, 35, 40 };
+      int i = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         assertUnit(*it == expected[i++]);
+   }  // teardown
+
+   // taking the biggest one out does not lose track of the end
+   void test_insertHint_appendAfterErase()
+   {  // setup
+      custom::set <int> s;
+      for (int i = 0; i < 100; i++)
+         s.insert(s.end(), i);
+      // exercise
+      for (int i = 99; i >= 50; i--)
+         s.erase(i);
+      for (int i = 50; i < 60; i++)
+         s.insert(s.end(), i * 10);
+      // verify
+      assertUnit(s.size() == 60);
+      assertUnit(s.bst.validate());
+      assertUnit(s.bst.pRightmost->data == 590);
+      assertUnit(s.find(49) != s.end());
+      assertUnit(s.find(500) != s.end());
+      assertUnit(s.find(55) == s.end());
+   }  // teardown
+
+   // sorted data added to a set that already has something goes on the end
+   void test_insertRange_appendNonEmpty()
+   {  // setup
+      custom::set <Spy> s;
+      s.insert(Spy(-1));
+      std::vector<Spy> v;
+      for (int i = 0; i < 1000; i++)
+         v.push_back(Spy(i));
+      Spy::reset();
+      // exercise
+      s.insert(v.begin(), v.end());
+      // verify
+      assertUnit(s.size() == 1001);
+      assertUnit(Spy::numLessthan() == 1000);
+      assertUnit(s.bst.validate());
+   }  // teardown
+
+   /***************************************
+    * Emplace
+    *    set::emplace(Args&&...)
+    *    set::emplace_hint(iterator, Args&&...)
+    ***************************************/
+
+   // the element is built in its node, nothing is copied or moved
+   void test_emplace_empty()
+   {  // setup
+      custom::set <Spy> s;
+      Spy::reset();
+      // exercise
+      auto result = s.emplace(42);
+      // verify
+      assertUnit(result.second == true);
+      assertUnit((*result.first).get() == 42);
+      assertUnit(s.size() == 1);
+      assertUnit(Spy::numNondefault() == 1);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numDestructor() == 0);
+   }  // teardown
+
+   // a duplicate is built, found out, and thrown away
+   void test_emplace_duplicate()
+   {  // setup
+      custom::set <Spy> s;
+      for (int i = 0; i < 10; i++)
+         s.emplace(i);
+      Spy::reset();
+      // exercise
+      auto result = s.emplace(5);
+      // verify
+      assertUnit(result.second == false);
+      assertUnit((*result.first).get() == 5);
+      assertUnit(s.size() == 10);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numDestructor() == 1);
+      assertUnit(s.bst.validate());
+   }  // teardown
+
+   // a good hint skips the descent
+   void test_emplaceHint_sequential()
+   {  // setup
+      custom::set <Spy> s;
+      Spy::reset();
+      // exercise
+      for (int i = 0; i < 1000; i++)
+         s.emplace_hint(s.end(), i);
+      // verify
+      assertUnit(s.size() == 1000);
+      assertUnit(Spy::numLessthan() == 999);  // each one only checked against the one before
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(s.bst.validate());
+   }  // teardown
+
+   // a bad hint still puts everything in the right place
+   void test_emplaceHint_wrong()
+   {  // setup
+      custom::set <int> s{ 10, 20, 30, 40 };
+      // exercise
+      auto it5 = s.emplace_hint(s.end(), 5);
+      auto it25 = s.emplace_hint(s.begin(), 25);
+      auto it20 = s.emplace_hint(s.find(40), 20);
+      // verify
+      assertUnit(*it5 == 5);
+      assertUnit(*it25 == 25);
+      assertUnit(*it20 == 20);
+      assertUnit(s.size() == 6);
+      assertUnit(s.bst.validate());
+      int expected[] = { 5, 10, 20, 25, 30, 40 };
+      int i = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+         assertUnit(*it == expected[i++]);
+   }  // teardown
+
    /***************************************
     * Erase Range
     *    set::erase(itBegin, itBEnd)
@@ -2106,6 +2925,7 @@ public:
       p30->pLeft = p20;
       p30->pRight = p40;
       s.bst.numElements = 6;
+      s.bst.findEnds();
       auto itBST = custom::BST <int> ::iterator(p10);
       auto it = custom::set <int> ::iterator(itBST);
       // exercise
@@ -2173,6 +2993,7 @@ public:
       p50->pRight = p60;
       p30->pRight = p40;
       s.bst.numElements = 8;
+      s.bst.findEnds();
       auto itBST = custom::BST <int> ::iterator(p20);
       auto it = custom::set <int> ::iterator(itBST);
       // exercise
@@ -2314,6 +3135,7 @@ public:
       p30->pLeft = p20;
       p30->pRight = p40;
       s.bst.numElements = 6;
+      s.bst.findEnds();
       // exercise
       size_t num = s.erase(10);
       // verify
@@ -2377,6 +3199,7 @@ public:
       p50->pRight = p60;
       p30->pRight = p40;
       s.bst.numElements = 8;
+      s.bst.findEnds();
       // exercise
       size_t num = s.erase(20);
       // verify
@@ -2577,6 +3400,617 @@ public:
 
    }
 
+   /***************************************
+    * ALLOCATOR
+    *    set::set(const A &)
+    *    set::get_allocator()
+    ***************************************/
+
+   // a default set uses the regular heap
+   void test_allocator_default()
+   {  // setup
+      custom::set <int> s;
+      // exercise
+      std::allocator<int> alloc = s.get_allocator();
+      // verify
+      assertUnit(alloc == std::allocator<int>());
+      assertEmptyFixture(s);
+   }  // teardown
+
+   // every node comes out of the buffer and nothing touches the heap
+   void test_allocator_pmrBuffer()
+   {  // setup
+      char buffer[4096];
+      std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+      // exercise
+      custom::pmr::set <int> s(&resource);
+      for (int i = 0; i < 20; i++)
+         s.insert(i);
+      // verify
+      assertUnit(s.get_allocator().resource() == &resource);
+      assertUnit(s.size() == 20);
+      assertUnit(s.bst.validate());
+      int expected = 0;
+      for (auto it = s.begin(); it != s.end(); ++it)
+      {
+         const char* p = reinterpret_cast<const char*>(&*it);
+         assertUnit(p >= buffer && p < buffer + sizeof(buffer));
+         assertUnit(*it == expected++);
+      }
+      // exercise
+      s.clear();
+      resource.release();
+      // verify
+      assertEmptyFixture(s);
+   }  // teardown
+
+   // the allocator-extended copy puts the copy in a different resource
+   void test_allocator_pmrCopy()
+   {  // setup
+      char buffer[4096];
+      std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+      custom::pmr::set <int> sSrc{ 50, 30, 70, 20, 40, 60, 80 };
+      // exercise
+      custom::pmr::set <int> sDest(sSrc, &resource);
+      // verify
+      assertUnit(sDest.get_allocator().resource() == &resource);
+      assertUnit(sSrc.get_allocator().resource() == std::pmr::get_default_resource());
+      assertUnit(sDest.size() == 7);
+      assertUnit(sSrc.size() == 7);
+      assertUnit(sDest.bst.root != sSrc.bst.root);
+      const char* p = reinterpret_cast<const char*>(sDest.bst.root);
+      assertUnit(p >= buffer && p < buffer + sizeof(buffer));
+   }  // teardown
+
+   // moving between sets on the same resource steals the nodes
+   void test_allocator_pmrMoveSame()
+   {  // setup
+      char buffer[4096];
+      std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+      custom::pmr::set <int> sSrc(&resource);
+      sSrc.insert({ 50, 30, 70 });
+      auto pRoot = sSrc.bst.root;
+      custom::pmr::set <int> sDest(&resource);
+      // exercise
+      sDest = std::move(sSrc);
+      // verify
+      assertUnit(sDest.bst.root == pRoot);
+      assertUnit(sDest.size() == 3);
+      assertEmptyFixture(sSrc);
+   }  // teardown
+
+   // moving between different resources has to copy the nodes over
+   void test_allocator_pmrMoveDifferent()
+   {  // setup
+      char buffer[4096];
+      std::pmr::monotonic_buffer_resource resource(buffer, sizeof(buffer), std::pmr::null_memory_resource());
+      custom::pmr::set <int> sSrc;
+      sSrc.insert({ 50, 30, 70 });
+      auto pRoot = sSrc.bst.root;
+      custom::pmr::set <int> sDest(&resource);
+      // exercise
+      sDest = std::move(sSrc);
+      // verify
+      assertUnit(sDest.bst.root != pRoot);
+      assertUnit(sDest.get_allocator().resource() == &resource);
+      assertUnit(sDest.size() == 3);
+      assertUnit(sDest.bst.validate());
+      assertEmptyFixture(sSrc);
+   }  // teardown
+
+   // erasing everything clears the tree in one go
+   void test_eraseRange_everything()
+   {  // setup
+      custom::set <int> s;
+      setupStandardFixture(s);
+      auto itBegin = s.begin();
+      auto itEnd = s.end();
+      // exercise
+      auto itReturn = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(itReturn == s.end());
+      assertEmptyFixture(s);
+   }  // teardown
+
+   // erase all the keys in [100, 200) using the bounds to find the ends
+   void test_eraseRange_bounds()
+   {  // setup
+      custom::set <int> s;
+      for (int i = 0; i < 1000; i++)
+         s.insert(i);
+      auto itBegin = s.lower_bound(100);
+      auto itEnd = s.lower_bound(200);
+      // exercise
+      auto itReturn = s.erase(itBegin, itEnd);
+      // verify
+      assertUnit(*itReturn == 200);
+      assertUnit(s.size() == 900);
+      assertUnit(s.bst.validate());
+      assertUnit(s.find(99) != s.end());
+      assertUnit(s.find(100) == s.end());
+      assertUnit(s.find(199) == s.end());
+      int expected = 0;
+      for (auto it = s.begin(); it != s.end(); ++it, ++expected)
+      {
+         if (expected == 100)
+            expected = 200;
+         assertUnit(*it == expected);
+      }
+   }  // teardown
+
+   /***************************************
+    * NODE HANDLES
+    *    extract(iterator)
+    *    extract(const T &)
+    *    insert(node_type &&)
+    *    merge(set &)
+    ***************************************/
+
+   // pull 30 out of the standard fixture, its node comes along in the handle
+   void test_extract_twoChildren()
+   {  // setup
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //     +----+----+     +----+----+
+      //    20        40    60        80  
+      custom::set <int> s;
+      setupStandardFixture(s);
+      auto it30 = s.find(30);
+      auto p30 = it30.it.pNode;
+      // exercise
+      auto nh = s.extract(it30);
+      // verify
+      assertUnit(!nh.empty());
+      assertUnit(nh.pNode == p30);
+      assertUnit(nh.value() == 30);
+      assertUnit(p30->pParent == nullptr);
+      assertUnit(p30->pLeft == nullptr);
+      assertUnit(p30->pRight == nullptr);
+      assertUnit(s.size() == 6);
+      assertUnit(s.find(30) == s.end());
+      assertUnit(s.bst.validate());
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // nothing to extract, nothing changes
+   void test_extract_missing()
+   {  // setup
+      custom::set <int> s;
+      setupStandardFixture(s);
+      // exercise
+      auto nh = s.extract(45);
+      // verify
+      assertUnit(nh.empty());
+      assertUnit(!nh);
+      assertUnit(s.size() == 7);
+      assertUnit(s.bst.validate());
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // the node moves from one set to the other without the element being touched
+   void test_insertNode_noCopies()
+   {  // setup
+      custom::set <Spy> sSrc;
+      custom::set <Spy> sDest;
+      for (int i = 0; i < 100; i++)
+      {
+         sSrc.insert(Spy(i));
+         sDest.insert(Spy(i + 1000));
+      }
+      auto it = sSrc.find(Spy(50));
+      auto pNode = it.it.pNode;
+      Spy::reset();
+      // exercise
+      auto result = sDest.insert(sSrc.extract(it));
+      // verify
+      assertUnit(result.inserted);
+      assertUnit(result.node.empty());
+      assertUnit(result.position.it.pNode == pNode);  // the very same node
+      assertUnit((*result.position).get() == 50);
+      assertUnit(sSrc.size() == 99);
+      assertUnit(sDest.size() == 101);
+      assertUnit(sSrc.bst.validate());
+      assertUnit(sDest.bst.validate());
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numAssign() == 0);
+      assertUnit(Spy::numAssignMove() == 0);
+      assertUnit(Spy::numDestructor() == 0);
+   }  // teardown
+
+   // a duplicate is turned away and handed back
+   void test_insertNode_duplicate()
+   {  // setup
+      custom::set <int> sSrc{ 30 };
+      custom::set <int> sDest;
+      setupStandardFixture(sDest);
+      auto nh = sSrc.extract(30);
+      // exercise
+      auto result = sDest.insert(std::move(nh));
+      // verify
+      assertUnit(!result.inserted);
+      assertUnit(!result.node.empty());
+      assertUnit(result.node.value() == 30);
+      assertUnit(result.position == sDest.find(30));
+      assertUnit(nh.empty());
+      assertUnit(sDest.size() == 7);
+      assertUnit(sSrc.empty());
+      // teardown
+      teardownStandardFixture(sDest);
+   }
+
+   // change an element while it is out of the tree, then put it back where it now belongs
+   void test_insertNode_changeValue()
+   {  // setup
+      custom::set <int> s;
+      setupStandardFixture(s);
+      auto nh = s.extract(20);
+      // exercise
+      nh.value() = 90;
+      auto result = s.insert(std::move(nh));
+      // verify
+      //                 50 
+      //          +-------+-------+
+      //         30              70  
+      //          +----+     +----+----+
+      //              40    60        80  
+      //                                +----+
+      //                                    90
+      assertUnit(result.inserted);
+      assertUnit(*result.position == 90);
+      assertUnit(s.size() == 7);
+      assertUnit(s.bst.validate());
+      assertUnit(s.find(20) == s.end());
+      assertUnit(*s.begin() == 30);
+      assertUnit(s.bst.rightmost()->data == 90);
+      // teardown
+      teardownStandardFixture(s);
+   }
+
+   // a handle nobody took frees its node and the element in it
+   void test_nodeHandle_dropped()
+   {  // setup
+      custom::set <Spy> s{ Spy(1), Spy(2), Spy(3) };
+      Spy::reset();
+      // exercise
+      {
+         auto nh = s.extract(s.begin());
+      }
+      // verify
+      assertUnit(Spy::numDestructor() == 1);
+      assertUnit(Spy::numDelete() == 1);
+      assertUnit(s.size() == 2);
+      assertUnit(s.bst.validate());
+   }  // teardown
+
+   // everything we do not have moves over, the duplicates stay put
+   void test_merge_standard()
+   {  // setup
+      custom::set <Spy> sDest;
+      custom::set <Spy> sSrc;
+      for (int i = 0; i < 100; i++)
+      {
+         sDest.insert(Spy(i));
+         sSrc.insert(Spy(i + 50));
+      }
+      Spy::reset();
+      // exercise
+      sDest.merge(sSrc);
+      // verify
+      assertUnit(sDest.size() == 150);
+      assertUnit(sSrc.size() == 50);
+      assertUnit(sDest.bst.validate());
+      assertUnit(sSrc.bst.validate());
+      int expected = 0;
+      for (auto it = sDest.begin(); it != sDest.end(); ++it)
+         assertUnit((*it).get() == expected++);
+      expected = 50;
+      for (auto it = sSrc.begin(); it != sSrc.end(); ++it)
+         assertUnit((*it).get() == expected++);
+      assertUnit(Spy::numAlloc() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numCopyMove() == 0);
+      assertUnit(Spy::numDestructor() == 0);
+   }  // teardown
+
+   // an empty set just takes the whole tree
+   void test_merge_intoEmpty()
+   {  // setup
+      custom::set <int> sSrc;
+      setupStandardFixture(sSrc);
+      auto pRoot = sSrc.bst.root;
+      custom::set <int> sDest;
+      // exercise
+      sDest.merge(sSrc);
+      // verify
+      assertUnit(sDest.bst.root == pRoot);
+      assertUnit(sDest.size() == 7);
+      assertEmptyFixture(sSrc);
+      // teardown
+      teardownStandardFixture(sDest);
+   }
+
+   /***************************************
+    * SET ALGEBRA
+    *    set_union(const set &, const set &)
+    *    set_intersection(const set &, const set &)
+    *    set_difference(const set &, const set &)
+    *    set_symmetric_difference(const set &, const set &)
+    *    set::set_union(const set &) and friends
+    ***************************************/
+
+   // every element of the set, in order, has to be exactly what we expected
+   bool sameElements(const custom::set<int>& s, const std::vector<int>& v)
+   {
+      if (s.size() != v.size() || !s.bst.validate())
+         return false;
+      auto itV = v.begin();
+      for (auto it = s.begin(); it != s.end(); ++it, ++itV)
+         if (*it != *itV)
+            return false;
+      return true;
+   }
+
+   // evens from 0 up to but not including n
+   custom::set<int> evens(int n)
+   {
+      std::vector<int> v;
+      for (int i = 0; i < n; i += 2)
+         v.push_back(i);
+      return custom::set<int>::from_sorted(v.begin(), v.end());
+   }
+
+   // everything in either one
+   void test_union_merge()
+   {  // setup
+      custom::set <int> sLeft{ 10, 20, 30, 40 };
+      custom::set <int> sRight{ 30, 40, 50 };
+      // exercise
+      custom::set <int> s = custom::set_union(sLeft, sRight);
+      // verify
+      assertUnit(sameElements(s, { 10, 20, 30, 40, 50 }));
+      assertUnit(sameElements(sLeft, { 10, 20, 30, 40 }));
+      assertUnit(sameElements(sRight, { 30, 40, 50 }));
+   }  // teardown
+
+   // only what is in both
+   void test_intersection_merge()
+   {  // setup
+      custom::set <int> sLeft{ 10, 20, 30, 40 };
+      custom::set <int> sRight{ 30, 40, 50 };
+      // exercise
+      custom::set <int> s = custom::set_intersection(sLeft, sRight);
+      // verify
+      assertUnit(sameElements(s, { 30, 40 }));
+   }  // teardown
+
+   // what the left has that the right does not
+   void test_difference_merge()
+   {  // setup
+      custom::set <int> sLeft{ 10, 20, 30, 40 };
+      custom::set <int> sRight{ 30, 40, 50 };
+      // exercise
+      custom::set <int> s = custom::set_difference(sLeft, sRight);
+      // verify
+      assertUnit(sameElements(s, { 10, 20 }));
+   }  // teardown
+
+   // what only one of them has
+   void test_symmetricDifference_merge()
+   {  // setup
+      custom::set <int> sLeft{ 10, 20, 30, 40 };
+      custom::set <int> sRight{ 30, 40, 50 };
+      // exercise
+      custom::set <int> s = custom::set_symmetric_difference(sLeft, sRight);
+      // verify
+      assertUnit(sameElements(s, { 10, 20, 50 }));
+   }  // teardown
+
+   // a tiny set against a huge one only costs a few comparisons per element
+   void test_intersection_smallFinger()
+   {  // setup
+      std::vector<Spy> v;
+      for (int i = 0; i < 10000; i += 2)
+         v.push_back(Spy(i));
+      auto sBig = custom::set <Spy> ::from_sorted(v.begin(), v.end());
+      custom::set <Spy> sSmall;
+      for (int i = 1000; i < 1010; i++)
+         sSmall.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      custom::set <Spy> s = custom::set_intersection(sSmall, sBig);
+      // verify
+      assertUnit(Spy::numLessthan() < 500);   // a merge would be over 5000
+      assertUnit(s.size() == 5);
+      assertUnit(s.bst.validate());
+      int expected = 1000;
+      for (auto it = s.begin(); it != s.end(); ++it, expected += 2)
+         assertUnit((*it).get() == expected);
+   }  // teardown
+
+   // only the small left side gets walked
+   void test_difference_smallFinger()
+   {  // setup
+      custom::set <int> sBig = evens(2000);
+      custom::set <int> sSmall{ 7, 8, 9, 10, 2001, 2002 };
+      // exercise
+      custom::set <int> s = custom::set_difference(sSmall, sBig);
+      // verify
+      assertUnit(sameElements(s, { 7, 9, 2001, 2002 }));
+   }  // teardown
+
+   // adding a few elements to a big set does not rebuild it
+   void test_union_memberSmall()
+   {  // setup
+      custom::set <int> s = evens(2000);
+      custom::set <int> sSmall{ -1, 0, 1, 501, 1998, 1999, 5000 };
+      // exercise
+      s.set_union(sSmall);
+      // verify
+      std::vector<int> expected{ -1, 1, 501, 1999, 5000 };
+      for (int i = 0; i < 2000; i += 2)
+         expected.push_back(i);
+      std::sort(expected.begin(), expected.end());
+      assertUnit(sameElements(s, expected));
+   }  // teardown
+
+   // a small set keeps what the big one also has
+   void test_intersection_memberSmall()
+   {  // setup
+      custom::set <int> s{ 3, 4, 5, 6, 1000, 3001 };
+      custom::set <int> sBig = evens(2000);
+      // exercise
+      s.set_intersection(sBig);
+      // verify
+      assertUnit(sameElements(s, { 4, 6, 1000 }));
+   }  // teardown
+
+   // pulling a few elements out of a big set
+   void test_difference_memberSmall()
+   {  // setup
+      custom::set <int> s = evens(2000);
+      custom::set <int> sSmall{ 0, 1, 500, 1998 };
+      // exercise
+      s.set_difference(sSmall);
+      // verify
+      std::vector<int> expected;
+      for (int i = 2; i < 1998; i += 2)
+         if (i != 500)
+            expected.push_back(i);
+      assertUnit(sameElements(s, expected));
+   }  // teardown
+
+   // shared elements go, new ones come in
+   void test_symmetricDifference_memberSmall()
+   {  // setup
+      custom::set <int> s = evens(2000);
+      custom::set <int> sSmall{ -5, 0, 3, 1000, 2500 };
+      // exercise
+      s.set_symmetric_difference(sSmall);
+      // verify
+      std::vector<int> expected{ -5 };
+      for (int i = 2; i < 2000; i += 2)
+      {
+         if (i == 4)
+            expected.push_back(3);
+         if (i != 1000)
+            expected.push_back(i);
+      }
+      expected.push_back(2500);
+      assertUnit(sameElements(s, expected));
+   }  // teardown
+
+   /***************************************
+    * COMPARE
+    *    set::set(const C &, const A &)
+    *    set::key_comp()
+    *    set::find(const K &)
+    *    set::count(const K &)
+    ***************************************/
+
+   // sorts backwards, but carries a flag around to do it
+   struct CompareWithState
+   {
+      bool backwards;
+      CompareWithState(bool backwards = false) : backwards(backwards) {}
+      bool operator()(int lhs, int rhs) const { return backwards ? rhs < lhs : lhs < rhs; }
+   };
+
+   // can compare a Spy to an int without making a new Spy
+   struct CompareSpyInt
+   {
+      using is_transparent = void;
+      bool operator()(const Spy& lhs, const Spy& rhs) const { return lhs.get() < rhs.get(); }
+      bool operator()(const Spy& lhs, int rhs) const { return lhs.get() < rhs; }
+      bool operator()(int lhs, const Spy& rhs) const { return lhs < rhs.get(); }
+   };
+
+   // a comparator with no data does not make the set any bigger
+   void test_compare_emptyBase()
+   {  // setup
+      // exercise
+      // verify
+      assertUnit(sizeof(custom::set<int, std::greater<int>>) == sizeof(custom::set<int>));
+      assertUnit(sizeof(custom::set<int, CompareWithState>) > sizeof(custom::set<int>));
+   }  // teardown
+
+   // std::greater puts the biggest element first
+   void test_compare_greater()
+   {  // setup
+      custom::set <int, std::greater<int>> s;
+      // exercise
+      s.insert({ 50, 30, 70, 20, 40, 60, 80 });
+      // verify
+      assertUnit(s.size() == 7);
+      assertUnit(s.bst.validate());
+      int expected = 80;
+      for (auto it = s.begin(); it != s.end(); ++it, expected -= 10)
+         assertUnit(*it == expected);
+      assertUnit(s.find(20) != s.end());
+      assertUnit(s.find(25) == s.end());
+   }  // teardown
+
+   // the comparator we were given is the one that is used, and copies keep it
+   void test_compare_stateful()
+   {  // setup
+      custom::set <int, CompareWithState> s(CompareWithState(true));
+      s.insert({ 50, 30, 70 });
+      // exercise
+      custom::set <int, CompareWithState> sCopy(s);
+      sCopy.insert(60);
+      // verify
+      assertUnit(s.key_comp().backwards == true);
+      assertUnit(sCopy.key_comp().backwards == true);
+      auto it = sCopy.begin();
+      assertUnit(*it == 70);
+      ++it;
+      assertUnit(*it == 60);
+      ++it;
+      assertUnit(*it == 50);
+      ++it;
+      assertUnit(*it == 30);
+      assertUnit(sCopy.bst.validate());
+   }  // teardown
+
+   // std::less<> lets us look up a string with a string_view
+   void test_compare_transparentString()
+   {  // setup
+      custom::set <std::string, std::less<>> s;
+      s.insert({ "banana", "apple", "cherry" });
+      std::string_view key = "cherry";
+      // exercise
+      auto it = s.find(key);
+      // verify
+      assertUnit(it != s.end());
+      assertUnit(*it == "cherry");
+      assertUnit(s.find(std::string_view("grape")) == s.end());
+      assertUnit(s.count(std::string_view("apple")) == 1);
+      assertUnit(s.count(std::string_view("grape")) == 0);
+   }  // teardown
+
+   // looking up with an int never builds a temporary Spy
+   void test_compare_transparentSpy()
+   {  // setup
+      custom::set <Spy, CompareSpyInt> s;
+      for (int i = 0; i < 100; i++)
+         s.insert(Spy(i));
+      Spy::reset();
+      // exercise
+      auto it = s.find(42);
+      size_t num = s.count(200);
+      // verify
+      assertUnit(it != s.end());
+      assertUnit((*it).get() == 42);
+      assertUnit(num == 0);
+      assertUnit(Spy::numNondefault() == 0);
+      assertUnit(Spy::numCopy() == 0);
+      assertUnit(Spy::numAlloc() == 0);
+   }  // teardown
+
    /*************************************************************
     * SETUP STANDARD FIXTURE
     *                (50b)
@@ -2614,10 +4048,16 @@ public:
       p60->pParent = p80->pParent = p70;
 
       // color everything
+      p50->isRed = p30->isRed = p70->isRed = false;
+
+      // count everything, the leaves are already 1
+      p30->size = p70->size = 3;
+      p50->size = 7;
 
       // now assign everything to the bst
       s.bst.root = p50;
       s.bst.numElements = 7;
+      s.bst.findEnds();
    }
 
    /*************************************************************
@@ -2631,7 +4071,8 @@ public:
    /*************************************************************
     * VERIFY EMPTY FIXTURE
     *************************************************************/
-   void assertEmptyFixtureParameters(const custom::set<int> &s, int line, const char* function)
+   template <class C, class A>
+   void assertEmptyFixtureParameters(const custom::set<int, C, A> &s, int line, const char* function)
    {
       assertIndirect(s.bst.root == nullptr);
       assertIndirect(s.bst.numElements == 0);
@@ -2705,7 +4146,23 @@ public:
       }
    }
 
-
+   // walks v, but throws instead of handing over the element at v[numGood]
+   struct Faulty
+   {
+      using iterator_category = std::forward_iterator_tag;
+      using value_type = Spy;
+      using difference_type = std::ptrdiff_t;
+      using pointer = const Spy*;
+      using reference = const Spy&;
+      const std::vector<Spy>* pV;
+      size_t i;
+      size_t numGood;
+      const Spy& operator * () const { if (i == numGood) throw std::runtime_error("faulty"); return (*pV)[i]; }
+      Faulty& operator ++ () { ++i; return *this; }
+      Faulty operator ++ (int) { Faulty was(*this); ++i; return was; }
+      bool operator == (const Faulty& rhs) const { return i == rhs.i; }
+      bool operator != (const Faulty& rhs) const { return i != rhs.i; }
+   };
 };
 
 #endif // DEBUG
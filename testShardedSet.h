@@ -0,0 +1,230 @@
+/***********************************************************************
+ * Header:
+ *    TEST SHARDED SET
+ * Summary:
+ *    Unit tests for sharded_set
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "sharded_set.h" // class under test
+#include "unitTest.h"    // unit test baseclass
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>     // for std::sort and std::is_sorted
+
+/***********************************************
+ * TEST SHARDED SET
+ * Unit tests for the sharded set
+ ***********************************************/
+class TestShardedSet : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Construct
+      test_construct_default();
+      test_shard_cacheLines();
+
+      // One thread at a time
+      test_insert_spreadsOut();
+      test_erase_standard();
+      test_find_copy();
+      test_scan_inOrder();
+      test_scan_strings();
+
+      // Many at once
+      test_insert_manyWriters();
+      test_scan_whileWriting();
+
+      report("ShardedSet");
+   }
+
+   /***************************************
+    * CONSTRUCT
+    ***************************************/
+
+   // every shard empty
+   void test_construct_default()
+   {  // setup
+      // exercise
+      custom::sharded_set <int, 8> s;
+      // verify
+      assertUnit(s.empty());
+      assertUnit(s.size() == 0);
+      assertUnit(!s.contains(0));
+      auto view = s.scan();
+      assertUnit(view.begin() == view.end());
+   }  // teardown
+
+   // no two shards share a cache line
+   void test_shard_cacheLines()
+   {  // setup
+      custom::sharded_set <int, 8> s;
+      // exercise
+      uintptr_t first = reinterpret_cast<uintptr_t>(&s.shards[0]);
+      uintptr_t second = reinterpret_cast<uintptr_t>(&s.shards[1]);
+      // verify
+      assertUnit(first % 64 == 0);
+      assertUnit(second - first >= 64);
+      assertUnit(sizeof(s.shards[0]) % 64 == 0);
+   }  // teardown
+
+   /***************************************
+    * ONE THREAD
+    ***************************************/
+
+   // a run of integers lands all over, not in a run of shards
+   void test_insert_spreadsOut()
+   {  // setup
+      custom::sharded_set <int, 8> s;
+      // exercise
+      bool allNew = true;
+      for (int i = 0; i < 800; i++)
+         allNew = allNew && s.insert(i);
+      bool again = s.insert(400);
+      // verify
+      assertUnit(allNew);
+      assertUnit(!again);
+      assertUnit(s.size() == 800);
+      bool allBusy = true;
+      for (auto & shard : s.shards)
+         allBusy = allBusy && shard.bst.size() > 50;
+      assertUnit(allBusy);
+   }  // teardown
+
+   // gone once, and not there to go a second time
+   void test_erase_standard()
+   {  // setup
+      custom::sharded_set <int, 4> s{ 10, 20, 30, 40 };
+      // exercise
+      size_t first = s.erase(20);
+      size_t second = s.erase(20);
+      // verify
+      assertUnit(first == 1);
+      assertUnit(second == 0);
+      assertUnit(s.size() == 3);
+      assertUnit(!s.contains(20));
+      assertUnit(s.contains(40));
+   }  // teardown
+
+   // we get our own copy or nothing
+   void test_find_copy()
+   {  // setup
+      custom::sharded_set <std::string> s{ "alpha", "bravo", "charlie" };
+      // exercise
+      auto found = s.find("bravo");
+      auto missing = s.find("delta");
+      // verify
+      assertUnit(found.has_value());
+      assertUnit(*found == "bravo");
+      assertUnit(!missing.has_value());
+   }  // teardown
+
+   // the walk merges every shard back into one order
+   void test_scan_inOrder()
+   {  // setup
+      custom::sharded_set <int, 8> s;
+      std::vector<int> expected;
+      for (int i = 0; i < 1000; i++)
+      {
+         int value = (i * 7919) % 1000;
+         s.insert(value);
+         expected.push_back(value);
+      }
+      std::sort(expected.begin(), expected.end());
+      // exercise
+      auto view = s.scan();
+      std::vector<int> walked(view.begin(), view.end());
+      // verify
+      assertUnit(walked == expected);
+   }  // teardown
+
+   // anything with a hash and an order works
+   void test_scan_strings()
+   {  // setup
+      custom::sharded_set <std::string, 3> s{ "delta", "alpha", "echo", "charlie", "bravo" };
+      // exercise
+      auto view = s.scan();
+      std::vector<std::string> walked(view.begin(), view.end());
+      // verify
+      assertUnit(walked == std::vector<std::string>({ "alpha", "bravo", "charlie", "delta", "echo" }));
+   }  // teardown
+
+   /***************************************
+    * MANY THREADS
+    ***************************************/
+
+   // writers on every thread, and nothing gets lost
+   void test_insert_manyWriters()
+   {  // setup
+      custom::sharded_set <int, 8> s;
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 8; t++)
+         threads.emplace_back([&s, t]()
+         {
+            for (int i = 0; i < 500; i++)
+               s.insert(i * 8 + t);
+            for (int i = 0; i < 500; i += 2)
+               s.erase(i * 8 + t);
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      auto view = s.scan();
+      std::vector<int> walked(view.begin(), view.end());
+      assertUnit(s.size() == 8 * 250);
+      assertUnit(walked.size() == 8 * 250);
+      assertUnit(std::is_sorted(walked.begin(), walked.end()));
+   }  // teardown
+
+   // a scan sees one moment: every key nobody touches, and in order
+   void test_scan_whileWriting()
+   {  // setup
+      custom::sharded_set <int, 8> s;
+      for (int i = 0; i < 1000; i += 2)
+         s.insert(i);
+      std::atomic<bool> allRight(true);
+      std::vector<std::thread> threads;
+      // exercise
+      for (int t = 0; t < 2; t++)
+         threads.emplace_back([&s, t]()
+         {
+            for (int round = 0; round < 20; round++)
+               for (int i = 1 + t * 2; i < 1000; i += 4)
+                  if (round % 2 == 0)
+                     s.insert(i);
+                  else
+                     s.erase(i);
+         });
+      for (int t = 0; t < 2; t++)
+         threads.emplace_back([&s, &allRight]()
+         {
+            for (int round = 0; round < 20; round++)
+            {
+               auto view = s.scan();
+               std::vector<int> walked(view.begin(), view.end());
+               size_t numEven = std::count_if(walked.begin(), walked.end(), [](int i) { return i % 2 == 0; });
+               if (!std::is_sorted(walked.begin(), walked.end()) || numEven != 500)
+                  allRight = false;
+            }
+         });
+      for (auto & thread : threads)
+         thread.join();
+      // verify
+      assertUnit(allRight);
+      assertUnit(s.size() == 500);
+   }  // teardown
+};
+
+#endif // DEBUG
@@ -0,0 +1,238 @@
+/***********************************************************************
+ * Header:
+ *    TEST SIMD
+ * Summary:
+ *    Unit tests for the vector searches, held to the scalar one
+ * Author
+ *    Joshua Sooaemalelagi & Brooklyn Sowards
+ ************************************************************************/
+
+#pragma once
+
+#ifdef DEBUG
+
+#include "simd.h"       // class under test
+#include "btree.h"      // the search it speeds up
+#include "spy.h"        // something that is not a plain number
+#include "unitTest.h"   // unit test baseclass
+
+#include <cstdint>      // for int32_t and int64_t
+#include <limits>       // for std::numeric_limits
+#include <vector>
+#include <algorithm>    // for std::lower_bound
+
+/***********************************************
+ * TEST SIMD
+ * Every vector count has to agree with counting one at a time
+ ***********************************************/
+class TestSimd : public UnitTest
+{
+public:
+   void run()
+   {
+      reset();
+
+      // Which types
+      test_isSearchable();
+
+      // Dispatch against scalar
+      test_count_int32();
+      test_count_int64();
+      test_count_float();
+      test_count_double();
+
+      // Every kernel against scalar, whatever this CPU would pick
+      test_kernels_sse2();
+      test_kernels_avx2();
+
+      // The container that uses it
+      test_btree_int64Bounds();
+      test_btree_doubleBounds();
+
+      report("Simd");
+   }
+
+   /***************************************
+    * WHICH TYPES
+    ***************************************/
+
+   // signed numbers four or eight bytes wide, and nothing else
+   void test_isSearchable()
+   {  // setup
+      // exercise
+      // verify
+      assertUnit(custom::simd::isSearchable<int32_t>);
+      assertUnit(custom::simd::isSearchable<int64_t>);
+      assertUnit(custom::simd::isSearchable<long long>);
+      assertUnit(custom::simd::isSearchable<float>);
+      assertUnit(custom::simd::isSearchable<double>);
+      assertUnit(!custom::simd::isSearchable<uint32_t>);
+      assertUnit(!custom::simd::isSearchable<short>);
+      assertUnit(!custom::simd::isSearchable<char>);
+      assertUnit(!custom::simd::isSearchable<Spy>);
+   }  // teardown
+
+   /***************************************
+    * DISPATCH
+    ***************************************/
+
+   void test_count_int32()
+   {  // setup
+      // exercise
+      // verify
+      assertUnit(crossCheck<int32_t>([](const int32_t* p, int n, int32_t k) { return custom::simd::countLess<ROOM>(p, n, k); },
+                                     [](const int32_t* p, int n, int32_t k) { return custom::simd::countLessEqual<ROOM>(p, n, k); }));
+   }  // teardown
+
+   void test_count_int64()
+   {  // setup
+      // exercise
+      // verify
+      assertUnit(crossCheck<int64_t>([](const int64_t* p, int n, int64_t k) { return custom::simd::countLess<ROOM>(p, n, k); },
+                                     [](const int64_t* p, int n, int64_t k) { return custom::simd::countLessEqual<ROOM>(p, n, k); }));
+   }  // teardown
+
+   void test_count_float()
+   {  // setup
+      // exercise
+      // verify
+      assertUnit(crossCheck<float>([](const float* p, int n, float k) { return custom::simd::countLess<ROOM>(p, n, k); },
+                                   [](const float* p, int n, float k) { return custom::simd::countLessEqual<ROOM>(p, n, k); }));
+   }  // teardown
+
+   void test_count_double()
+   {  // setup
+      // exercise
+      // verify
+      assertUnit(crossCheck<double>([](const double* p, int n, double k) { return custom::simd::countLess<ROOM>(p, n, k); },
+                                    [](const double* p, int n, double k) { return custom::simd::countLessEqual<ROOM>(p, n, k); }));
+   }  // teardown
+
+   /***************************************
+    * KERNELS
+    ***************************************/
+
+   // SSE2 is on every x86-64, so these always run there
+   void test_kernels_sse2()
+   {  // setup
+      bool allRight = true;
+#if CUSTOM_SIMD_X86
+      using namespace custom::simd;
+      // exercise
+      allRight = allRight && crossCheck<int32_t>([](const int32_t* p, int n, int32_t k) { return countSse2Int32<false, ROOM>(p, n, k); },
+                                                 [](const int32_t* p, int n, int32_t k) { return countSse2Int32<true, ROOM>(p, n, k); });
+      allRight = allRight && crossCheck<float>([](const float* p, int n, float k) { return countSse2Float<false, ROOM>(p, n, k); },
+                                               [](const float* p, int n, float k) { return countSse2Float<true, ROOM>(p, n, k); });
+      allRight = allRight && crossCheck<double>([](const double* p, int n, double k) { return countSse2Double<false, ROOM>(p, n, k); },
+                                                [](const double* p, int n, double k) { return countSse2Double<true, ROOM>(p, n, k); });
+#endif
+      // verify
+      assertUnit(allRight);
+   }  // teardown
+
+   // only where the CPU has AVX2, elsewhere there is nothing to hold them to
+   void test_kernels_avx2()
+   {  // setup
+      bool allRight = true;
+#if CUSTOM_SIMD_X86
+      using namespace custom::simd;
+      if (useAvx2())
+      {
+         // exercise
+         allRight = allRight && crossCheck<int32_t>([](const int32_t* p, int n, int32_t k) { return countAvx2Int32<false, ROOM>(p, n, k); },
+                                                    [](const int32_t* p, int n, int32_t k) { return countAvx2Int32<true, ROOM>(p, n, k); });
+         allRight = allRight && crossCheck<int64_t>([](const int64_t* p, int n, int64_t k) { return countAvx2Int64<false, ROOM>(p, n, k); },
+                                                    [](const int64_t* p, int n, int64_t k) { return countAvx2Int64<true, ROOM>(p, n, k); });
+         allRight = allRight && crossCheck<float>([](const float* p, int n, float k) { return countAvx2Float<false, ROOM>(p, n, k); },
+                                                  [](const float* p, int n, float k) { return countAvx2Float<true, ROOM>(p, n, k); });
+         allRight = allRight && crossCheck<double>([](const double* p, int n, double k) { return countAvx2Double<false, ROOM>(p, n, k); },
+                                                   [](const double* p, int n, double k) { return countAvx2Double<true, ROOM>(p, n, k); });
+      }
+#endif
+      // verify
+      assertUnit(allRight);
+   }  // teardown
+
+   /***************************************
+    * CONTAINERS
+    ***************************************/
+
+   // a B-tree of int64_t searches its nodes with vectors and lands where std::lower_bound does
+   void test_btree_int64Bounds()
+   {  // setup
+      custom::set<int64_t, std::less<int64_t>, custom::btree_tag> s;
+      for (int64_t i = -2000; i < 2000; i++)
+         s.insert(i * 3);
+      std::vector<int64_t> v(s.begin(), s.end());
+      bool allRight = true;
+      // exercise
+      for (int64_t key = -6010; key <= 6010; key++)
+      {
+         auto itLower = s.lower_bound(key);
+         auto itUpper = s.upper_bound(key);
+         // verify
+         auto iLower = std::lower_bound(v.begin(), v.end(), key);
+         auto iUpper = std::upper_bound(v.begin(), v.end(), key);
+         allRight = allRight && (iLower == v.end() ? itLower == s.end() : *itLower == *iLower);
+         allRight = allRight && (iUpper == v.end() ? itUpper == s.end() : *itUpper == *iUpper);
+      }
+      assertUnit(allRight);
+   }  // teardown
+
+   // doubles too, with keys that fall between the elements
+   void test_btree_doubleBounds()
+   {  // setup
+      custom::set<double, std::less<double>, custom::btree_tag> s;
+      for (int i = -1000; i < 1000; i++)
+         s.insert(i * 0.5);
+      std::vector<double> v(s.begin(), s.end());
+      bool allRight = true;
+      // exercise
+      for (int i = -2010; i <= 2010; i++)
+      {
+         double key = i * 0.25;
+         auto itLower = s.lower_bound(key);
+         auto itUpper = s.upper_bound(key);
+         // verify
+         auto iLower = std::lower_bound(v.begin(), v.end(), key);
+         auto iUpper = std::upper_bound(v.begin(), v.end(), key);
+         allRight = allRight && (iLower == v.end() ? itLower == s.end() : *itLower == *iLower);
+         allRight = allRight && (iUpper == v.end() ? itUpper == s.end() : *itUpper == *iUpper);
+      }
+      assertUnit(allRight);
+   }  // teardown
+
+   /*************************************************************
+    * CROSS CHECK
+    * Sorted runs of every length that fits in the room, searched for
+    * every key in them, every key between them, and the extremes. The
+    * room past the end is filled with things that would count if the
+    * mask let them through
+    *************************************************************/
+   static constexpr int ROOM = 32;
+
+   template <class T, class Less, class LessEqual>
+   bool crossCheck(Less countLess, LessEqual countLessEqual)
+   {
+      for (int n = 0; n <= ROOM; n++)
+      {
+         std::vector<T> v(ROOM, std::numeric_limits<T>::lowest());
+         for (int i = 0; i < n; i++)
+            v[i] = (T)(i * 2 - n);
+         std::vector<T> keys = { std::numeric_limits<T>::lowest(), std::numeric_limits<T>::max() };
+         for (int i = -n - 2; i <= n + 2; i++)
+            keys.push_back((T)i);
+
+         for (T k : keys)
+         {
+            if (countLess(v.data(), n, k) != custom::simd::countScalar<false>(v.data(), n, k))
+               return false;
+            if (countLessEqual(v.data(), n, k) != custom::simd::countScalar<true>(v.data(), n, k))
+               return false;
+         }
+      }
+      return true;
+   }
+};
+
+#endif // DEBUG